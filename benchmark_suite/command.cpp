@@ -0,0 +1,111 @@
+/** @file command.cpp
+ *
+ * Benchmark of encoding short commands: heap allocations and time per command
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <redisxx/command.hpp>
+#include <redisxx/commands.hpp>
+
+// count all heap allocations of this program
+static std::atomic<std::size_t> num_allocations{0u};
+
+void* operator new(std::size_t size) {
+	++num_allocations;
+	if (void* ptr = std::malloc(size == 0u ? 1u : size)) {
+		return ptr;
+	}
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+// keep the compiler from removing the benchmarked code
+static std::size_t volatile sink = 0u;
+
+template <typename Func>
+void measure(std::string const & name, std::size_t num, Func func) {
+	auto before = num_allocations.load();
+	auto start = std::chrono::steady_clock::now();
+	func();
+	auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	auto allocations = num_allocations.load() - before;
+	std::cout << name << ": " << static_cast<double>(allocations) / num << " allocations, "
+		<< static_cast<double>(duration.count()) / num << " ns per command\n";
+}
+
+// command as it was stored before: arguments inside a std::string, plus the request string
+struct LegacyCommand {
+	std::string buffer;
+	std::size_t num_bulks;
+	std::vector<redisxx::priv::Borrow> borrows;
+
+	template <typename... Args>
+	LegacyCommand(Args const & ...args)
+		: buffer{}
+		, num_bulks{0u}
+		, borrows{} {
+		redisxx::priv::dump(buffer, num_bulks, borrows, args...);
+	}
+
+	std::string operator*() const {
+		return "*" + std::to_string(num_bulks) + "\r\n" + buffer;
+	}
+};
+
+int main() {
+	std::size_t const num = 1000000u;
+	std::vector<std::string> keys;
+	keys.reserve(num);
+	for (auto i = 0u; i < num; ++i) {
+		keys.push_back("user:" + std::to_string(i) + ":session");
+	}
+
+	std::cout << "EXPIRE <key> 30, encoded and flattened\n";
+	measure("  std::string buffer (before)", num, [&]() {
+		for (auto const & key: keys) {
+			LegacyCommand cmd{"EXPIRE", key, 30};
+			sink += (*cmd).size();
+		}
+	});
+	measure("  redisxx::Command", num, [&]() {
+		for (auto const & key: keys) {
+			redisxx::Command cmd{"EXPIRE", key, 30};
+			sink += (*cmd).size();
+		}
+	});
+
+	std::cout << "EXPIRE <key> 30, encoded and gathered for writing\n";
+	measure("  redisxx::Command", num, [&]() {
+		for (auto const & key: keys) {
+			redisxx::Command cmd{"EXPIRE", key, 30};
+			redisxx::priv::Segments segments;
+			cmd.gather(segments);
+			sink += segments.gather().size();
+		}
+	});
+	measure("  redisxx::cmd::expire", num, [&]() {
+		for (auto const & key: keys) {
+			auto cmd = redisxx::cmd::expire(key, 30);
+			redisxx::priv::Segments segments;
+			cmd.gather(segments);
+			sink += segments.gather().size();
+		}
+	});
+}
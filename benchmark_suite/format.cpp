@@ -0,0 +1,94 @@
+/** @file format.cpp
+ *
+ * Benchmark of number formatting: std::to_string vs. redisxx::priv::format_*
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <redisxx/command.hpp>
+
+// keep the compiler from removing the benchmarked code
+static std::size_t volatile sink = 0u;
+
+template <typename Func>
+void measure(std::string const & name, std::size_t num, Func func) {
+	auto start = std::chrono::steady_clock::now();
+	func();
+	auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	std::cout << name << ": " << static_cast<double>(duration.count()) / num << " ns per number\n";
+}
+
+// bulk string as it was encoded before (one temporary per number, plus concatenation)
+template <typename T>
+std::string legacy_bulk(T value) {
+	auto tmp = std::to_string(value);
+	return '$' + std::to_string(tmp.size()) + "\r\n" + tmp + "\r\n";
+}
+
+int main() {
+	std::size_t const num = 1000000u;
+	std::mt19937_64 random{42u};
+	std::vector<std::int64_t> deltas(num);
+	std::vector<double> scores(num);
+	std::uniform_real_distribution<double> distribution{0.0, 1000000.0};
+	for (auto i = 0u; i < num; ++i) {
+		deltas[i] = static_cast<std::int64_t>(random() % 2000000u) - 1000000;
+		scores[i] = distribution(random);
+	}
+
+	std::cout << "integers (INCRBY deltas)\n";
+	measure("  std::to_string", num, [&]() {
+		for (auto value: deltas) {
+			sink += std::to_string(value).size();
+		}
+	});
+	measure("  format_integer", num, [&]() {
+		char tmp[redisxx::priv::max_integer_length];
+		for (auto value: deltas) {
+			sink += static_cast<std::size_t>(redisxx::priv::format_integer(tmp, value) - tmp);
+		}
+	});
+
+	std::cout << "floating point numbers (ZADD scores)\n";
+	measure("  std::to_string (6 decimals, lossy)", num, [&]() {
+		for (auto value: scores) {
+			sink += std::to_string(value).size();
+		}
+	});
+	measure("  format_float (Grisu2 round-trip)", num, [&]() {
+		char tmp[redisxx::priv::max_float_length];
+		for (auto value: scores) {
+			sink += static_cast<std::size_t>(redisxx::priv::format_float(tmp, value) - tmp);
+		}
+	});
+
+	std::cout << "encoding ZADD with 1000 scores\n";
+	std::size_t const num_members = 1000u, num_commands = num / num_members;
+	measure("  legacy concatenation", num, [&]() {
+		for (auto i = 0u; i < num_commands; ++i) {
+			std::string buffer;
+			for (auto j = 0u; j < num_members; ++j) {
+				buffer += legacy_bulk(scores[i * num_members + j]);
+				buffer += legacy_bulk(deltas[i * num_members + j]);
+			}
+			sink += buffer.size();
+		}
+	});
+	measure("  redisxx::Command", num, [&]() {
+		for (auto i = 0u; i < num_commands; ++i) {
+			redisxx::Command cmd{"ZADD", "scores"};
+			for (auto j = 0u; j < num_members; ++j) {
+				cmd << scores[i * num_members + j] << deltas[i * num_members + j];
+			}
+			sink += (*cmd).size();
+		}
+	});
+}
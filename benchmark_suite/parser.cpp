@@ -0,0 +1,87 @@
+/** @file parser.cpp
+ *
+ * Benchmark of reply parsing: scalar vs. SIMD header scanning
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <redisxx/parser.hpp>
+
+// keep the compiler from removing the benchmarked code
+static std::size_t volatile sink = 0u;
+
+// parse the reply repeatedly (recording its values) using the given kernel
+void measure(std::string const & name, std::string const & reply, std::size_t num_values,
+	std::size_t num_runs, redisxx::priv::ScanKernel kernel) {
+	if (!redisxx::priv::supports_scan_kernel(kernel)) {
+		std::cout << name << ": not supported\n";
+		return;
+	}
+	redisxx::priv::setScanKernel(kernel);
+	std::vector<redisxx::priv::ReplyNode> nodes;
+	nodes.reserve(num_values);
+	// take the fastest run, which is the least disturbed one
+	auto ns = std::numeric_limits<double>::max();
+	for (auto i = 0u; i < num_runs; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		nodes.clear();
+		redisxx::priv::ReplyParser parser{&nodes};
+		sink += parser.feed(reply.data(), reply.size());
+		auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		ns = std::min(ns, static_cast<double>(duration.count()));
+	}
+	std::cout << name << ": " << ns / num_values << " ns per value, "
+		<< reply.size() / ns << " GB/s\n";
+}
+
+// compare all kernels on the given reply
+void compare(std::string const & title, std::string const & reply, std::size_t num_values, std::size_t num_runs) {
+	std::cout << title << " (" << reply.size() << " bytes)\n";
+	measure("  scalar", reply, num_values, num_runs, redisxx::priv::ScanKernel::Scalar);
+	measure("  sse2  ", reply, num_values, num_runs, redisxx::priv::ScanKernel::Sse2);
+	measure("  avx2  ", reply, num_values, num_runs, redisxx::priv::ScanKernel::Avx2);
+}
+
+int main() {
+	std::size_t const num_fields = 100000u, num_runs = 50u;
+	std::mt19937_64 random{42u};
+
+	// HGETALL of a hash with short fields and values
+	std::string hgetall{"*" + std::to_string(2u * num_fields) + "\r\n"};
+	for (auto i = 0u; i < num_fields; ++i) {
+		auto field = "field:" + std::to_string(i);
+		auto value = std::to_string(random() % 1000000u);
+		hgetall += "$" + std::to_string(field.size()) + "\r\n" + field + "\r\n";
+		hgetall += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+	}
+	compare("HGETALL with 100k fields", hgetall, 2u * num_fields + 1u, num_runs);
+
+	// ZRANGE ... WITHSCORES with larger members
+	std::string zrange{"*" + std::to_string(2u * num_fields) + "\r\n"};
+	for (auto i = 0u; i < num_fields; ++i) {
+		std::string member(64u + random() % 64u, 'm');
+		auto score = std::to_string(static_cast<double>(random() % 100000000u) / 1000.0);
+		zrange += "$" + std::to_string(member.size()) + "\r\n" + member + "\r\n";
+		zrange += "$" + std::to_string(score.size()) + "\r\n" + score + "\r\n";
+	}
+	compare("ZRANGE WITHSCORES with 100k members", zrange, 2u * num_fields + 1u, num_runs);
+
+	// pipelined INCR replies
+	std::string integers{"*" + std::to_string(num_fields) + "\r\n"};
+	for (auto i = 0u; i < num_fields; ++i) {
+		integers += ":" + std::to_string(random() % 10000000000u) + "\r\n";
+	}
+	compare("100k integers", integers, num_fields + 1u, num_runs);
+
+	redisxx::priv::setScanKernel(redisxx::priv::detect_scan_kernel());
+}
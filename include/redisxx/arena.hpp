@@ -0,0 +1,205 @@
+/** @file arena.hpp
+ *
+ * RedisXX arena allocation implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace redisxx {
+
+/// Monotonic memory resource
+/**
+ *	An arena hands out memory from large chunks and never frees single
+ *	allocations. Instead, all of its memory is reused at once after `reset()`.
+ *	This is useful for batches of commands that are built and thrown away
+ *	repeatedly (e.g. once per tick): after a few batches, the arena provides
+ *	enough memory, so building a batch does not allocate at all.
+ *	If a batch needed more than one chunk, all chunks are replaced by a single
+ *	one on reset. So the memory of a batch becomes contiguous.
+ *	Note that an arena is not thread-safe. Everything that was allocated
+ *	from the arena is required to be destroyed (or at least not to be used
+ *	anymore) before the arena is reset or destroyed.
+ *
+ *	Example usage:
+ *	@code
+ *		redisxx::Arena arena;
+ *		while (running) {
+ *			{
+ *				redisxx::ArenaCommandList list{redisxx::BatchType::Pipeline, arena};
+ *				for (auto const & pair: updates) {
+ *					list.emplace_back("SET", pair.first, pair.second);
+ *				}
+ *				conn(list).get();
+ *			}
+ *			arena.reset();
+ *		}
+ *	@endcode
+ */
+class Arena {
+
+	struct Chunk {
+		std::unique_ptr<char[]> data;
+		std::size_t size;
+	};
+
+	private:
+		std::vector<Chunk> chunks;
+		std::size_t current;	// index of the chunk in use
+		std::size_t offset;		// number of used bytes of the current chunk
+		std::size_t used;		// number of bytes provided by previous chunks
+
+		void grow(std::size_t size) {
+			std::size_t capacity = chunks.empty() ? 4096u : 2u * chunks.back().size;
+			chunks.push_back(Chunk{std::unique_ptr<char[]>{new char[std::max(capacity, size)]}, std::max(capacity, size)});
+		}
+
+	public:
+		/// Create an arena
+		/**
+		 *	@param capacity Size of the first chunk (zero to allocate it once needed)
+		 */
+		Arena(std::size_t capacity=0u)
+			: chunks{}
+			, current{0u}
+			, offset{0u}
+			, used{0u} {
+			if (capacity > 0u) {
+				grow(capacity);
+			}
+		}
+
+		Arena(Arena const &) = delete;
+		Arena& operator=(Arena const &) = delete;
+
+		/// Provide memory
+		/**
+		 *	@throw std::bad_alloc if no memory is available
+		 *	@param size Number of bytes
+		 *	@param alignment Alignment of the memory
+		 *	@return Pointer to the memory
+		 */
+		void* allocate(std::size_t size, std::size_t alignment) {
+			while (true) {
+				if (current < chunks.size()) {
+					auto& chunk = chunks[current];
+					auto address = reinterpret_cast<std::uintptr_t>(chunk.data.get()) + offset;
+					auto padding = (alignment - address % alignment) % alignment;
+					if (offset + padding + size <= chunk.size) {
+						offset += padding + size;
+						return chunk.data.get() + offset - size;
+					}
+					used += offset;
+					++current;
+					offset = 0u;
+				} else {
+					grow(size + alignment);
+				}
+			}
+		}
+
+		/// Reuse all memory
+		/**
+		 *	Nothing that was allocated before may be used afterwards.
+		 */
+		void reset() {
+			if (chunks.size() > 1u) {
+				// merge all chunks, so the next batch fits into a single one
+				std::size_t capacity = 0u;
+				for (auto const & chunk: chunks) {
+					capacity += chunk.size;
+				}
+				chunks.clear();
+				grow(capacity);
+			}
+			current = 0u;
+			offset = 0u;
+			used = 0u;
+		}
+
+		/// Return the number of bytes allocated since the last reset
+		inline std::size_t size() const {
+			return used + offset;
+		}
+
+		/// Return the number of bytes provided by all chunks
+		inline std::size_t capacity() const {
+			std::size_t capacity = 0u;
+			for (auto const & chunk: chunks) {
+				capacity += chunk.size;
+			}
+			return capacity;
+		}
+};
+
+/// Allocator using an arena
+/**
+ *	Memory is taken from the given arena and never freed on its own. A
+ *	default-constructed allocator does not use an arena but the heap, so
+ *	containers using this allocator can be created without an arena, too.
+ *	Allocators equal if they use the same arena.
+ */
+template <typename T>
+class ArenaAllocator {
+
+	template <typename U>
+	friend class ArenaAllocator;
+
+	private:
+		Arena* arena;
+
+	public:
+		using value_type = T;
+
+		ArenaAllocator()
+			: arena{nullptr} {
+		}
+
+		ArenaAllocator(Arena& arena)
+			: arena{&arena} {
+		}
+
+		template <typename U>
+		ArenaAllocator(ArenaAllocator<U> const & other)
+			: arena{other.arena} {
+		}
+
+		T* allocate(std::size_t num) {
+			if (arena == nullptr) {
+				return static_cast<T*>(::operator new(num * sizeof(T)));
+			}
+			return static_cast<T*>(arena->allocate(num * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* ptr, std::size_t num) {
+			if (arena == nullptr) {
+				::operator delete(ptr);
+			}
+			// memory of the arena is reused once the arena is reset
+		}
+
+		/// Return the arena (or nullptr if the heap is used)
+		inline Arena* getArena() const {
+			return arena;
+		}
+
+		template <typename U>
+		inline bool operator==(ArenaAllocator<U> const & other) const {
+			return arena == other.arena;
+		}
+
+		template <typename U>
+		inline bool operator!=(ArenaAllocator<U> const & other) const {
+			return arena != other.arena;
+		}
+};
+
+} // ::redisxx
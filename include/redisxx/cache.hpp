@@ -0,0 +1,817 @@
+/** @file cache.hpp
+ *
+ * RedisXX client-side caching
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <redisxx/command.hpp>
+#include <redisxx/connection.hpp>
+#include <redisxx/error.hpp>
+#include <redisxx/keys.hpp>
+#include <redisxx/reply.hpp>
+#include <redisxx/socket.hpp>
+
+namespace redisxx {
+
+/// Policy of a client-side cache
+/**
+ *	The cache holds up to `max_bytes` of keys and replies (estimated), which
+ *	are split into `num_shards` independently locked shards. Each shard
+ *	evicts its least recently used keys once it exceeds its share of
+ *	`max_bytes`. If prefixes are given, only keys starting with any of them
+ *	are cached, and the server only reports modifications of those keys.
+ *	If the socket receiving invalidations fails, the cache is cleared and
+ *	bypassed until that socket is reopened, which is tried every `retry`.
+ */
+struct CachePolicy {
+	std::size_t max_bytes;				// max. size of all cached keys and replies
+	std::size_t num_shards;				// number of independently locked shards
+	std::vector<std::string> prefixes;	// of the keys to cache (empty = all keys)
+	std::chrono::milliseconds retry;	// delay before reopening the invalidation socket
+
+	CachePolicy(std::size_t max_bytes=64u << 20u, std::size_t num_shards=16u,
+		std::vector<std::string> const & prefixes=std::vector<std::string>{},
+		std::chrono::milliseconds retry=std::chrono::milliseconds{1000})
+		: max_bytes{max_bytes}
+		, num_shards{num_shards}
+		, prefixes{prefixes}
+		, retry{retry} {
+	}
+};
+
+/// Counters of a client-side cache
+struct CacheStats {
+	std::uint64_t hits;				// reads served by the cache
+	std::uint64_t misses;			// cacheable reads sent to the server
+	std::uint64_t invalidations;	// cached keys dropped because they were modified
+	std::uint64_t evictions;		// cached keys dropped to stay within the size limit
+	std::size_t num_bytes;			// estimated size of the cached keys and replies
+};
+
+namespace priv {
+
+// estimated memory used per cached key or reply, besides its payload
+static std::size_t const cache_entry_overhead = 64u;
+
+// channel the server publishes invalidated keys to
+static char const * const invalidation_channel = "__redis__:invalidate";
+
+/// Read whose reply can be cached
+struct CacheRead {
+	std::string key;
+	std::string field;
+	bool hash;		// "HGET <key> <field>" if set, else "GET <key>"
+};
+
+/// Find out whether the command's reply can be cached
+/**
+ *	@param cmd Command to inspect
+ *	@param read Assigned the key (and field) read by the command
+ *	@return False if the command is neither GET nor HGET
+ */
+template <typename Allocator>
+bool cache_read_of(BasicCommand<Allocator> const & cmd, CacheRead& read) {
+	auto const num = cmd.getNumArguments();
+	if (num == 2u && equals_upper(cmd.getArgument(0u), "GET")) {
+		read.key = std::string{cmd.getArgument(1u)};
+		read.field.clear();
+		read.hash = false;
+		return true;
+	}
+	if (num == 3u && equals_upper(cmd.getArgument(0u), "HGET")) {
+		read.key = std::string{cmd.getArgument(1u)};
+		read.field = std::string{cmd.getArgument(2u)};
+		read.hash = true;
+		return true;
+	}
+	return false;
+}
+
+/// Cached keys a request might modify
+struct CacheWrite {
+	std::vector<std::string> keys;
+	bool all;		// whether all keys are dropped (FLUSHALL or FLUSHDB)
+
+	CacheWrite()
+		: keys{}
+		, all{false} {
+	}
+
+	inline bool empty() const {
+		return keys.empty() && !all;
+	}
+};
+
+/// Find out whether a command may modify the keys it refers to
+/**
+ *	Commands that are known to only read keys don't. Any other command
+ *	referring to a key might.
+ *
+ *	@param cmd Command to inspect
+ *	@return True if the command may modify keys
+ */
+template <typename Allocator>
+bool may_modify(BasicCommand<Allocator> const & cmd) {
+	static char const * const read_only[] = {
+		"BITCOUNT", "EXISTS", "GET", "GETRANGE", "HEXISTS", "HGET", "HGETALL", "HKEYS", "HLEN",
+		"HMGET", "HSCAN", "HSTRLEN", "HVALS", "LINDEX", "LLEN", "LRANGE", "MGET", "PTTL", "SCARD",
+		"SISMEMBER", "SMEMBERS", "SSCAN", "STRLEN", "TTL", "TYPE", "ZCARD", "ZCOUNT", "ZRANGE",
+		"ZRANK", "ZSCAN", "ZSCORE"
+	};
+	StringView key;
+	if (!key_of(cmd, key)) {
+		return false;
+	}
+	auto const name = cmd.getArgument(0u);
+	for (auto other: read_only) {
+		if (equals_upper(name, other)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Shard of a client-side cache
+/**
+ *	The shard keeps the replies to GET and HGET by their key, so all of a
+ *	key's replies are dropped once it is invalidated. Each invalidation
+ *	increments the shard's epoch. A reply is only inserted if the epoch did
+ *	not change since its request was sent, so a reply that raced with an
+ *	invalidation of its key is never cached.
+ */
+class CacheShard {
+	private:
+		struct Entry {
+			std::list<std::string const *>::iterator position;	// in the recently used keys
+			bool has_value;
+			Reply value;										// reply to GET
+			std::unordered_map<std::string, Reply> fields;		// replies to HGET
+			std::size_t num_bytes;
+		};
+
+		using Entries = std::unordered_map<std::string, Entry>;
+
+		std::mutex mutex;
+		Entries entries;
+		std::list<std::string const *> recent;		// keys, most recently used first
+		std::size_t num_bytes;
+		std::uint64_t epoch;
+
+		// estimated size of a cached reply
+		static std::size_t size_of(std::string const & field, Reply const & value) {
+			return cache_entry_overhead + field.size() + (value.isNull() ? 0u : value.getString().size());
+		}
+
+		// drop the given key (the lock is held)
+		void erase(Entries::iterator it) {
+			num_bytes -= it->second.num_bytes;
+			recent.erase(it->second.position);
+			entries.erase(it);
+		}
+
+	public:
+		CacheShard()
+			: mutex{}
+			, entries{}
+			, recent{}
+			, num_bytes{0u}
+			, epoch{0u} {
+		}
+
+		/// Find the cached reply to the given read
+		/**
+		 *	@param read Read to look up
+		 *	@param value Assigned the cached reply
+		 *	@return False if the reply is not cached
+		 */
+		bool find(CacheRead const & read, Reply& value) {
+			std::lock_guard<std::mutex> lock{mutex};
+			auto it = entries.find(read.key);
+			if (it == entries.end()) {
+				return false;
+			}
+			auto& entry = it->second;
+			if (read.hash) {
+				auto field = entry.fields.find(read.field);
+				if (field == entry.fields.end()) {
+					return false;
+				}
+				value = field->second;
+			} else if (entry.has_value) {
+				value = entry.value;
+			} else {
+				return false;
+			}
+			recent.splice(recent.begin(), recent, entry.position);
+			return true;
+		}
+
+		/// Return the current epoch
+		inline std::uint64_t getEpoch() {
+			std::lock_guard<std::mutex> lock{mutex};
+			return epoch;
+		}
+
+		/// Cache the reply to the given read
+		/**
+		 *	The reply is dropped if any key of this shard was invalidated
+		 *	since the given epoch. Least recently used keys are evicted
+		 *	until the shard does not exceed the given size.
+		 *
+		 *	@param read Read the reply belongs to
+		 *	@param value Reply to cache (not sharing its receive buffer)
+		 *	@param epoch Epoch when the read was sent
+		 *	@param max_bytes Max. size of the shard
+		 *	@return Number of evicted keys
+		 */
+		std::size_t insert(CacheRead const & read, Reply const & value, std::uint64_t epoch, std::size_t max_bytes) {
+			auto const size = size_of(read.field, value);
+			std::lock_guard<std::mutex> lock{mutex};
+			if (epoch != this->epoch) {
+				return 0u;
+			}
+			auto it = entries.find(read.key);
+			if (it == entries.end()) {
+				it = entries.emplace(read.key, Entry{}).first;
+				recent.push_front(&it->first);
+				it->second.position = recent.begin();
+				it->second.has_value = false;
+				it->second.num_bytes = cache_entry_overhead + read.key.size();
+				num_bytes += it->second.num_bytes;
+			} else {
+				recent.splice(recent.begin(), recent, it->second.position);
+			}
+			auto& entry = it->second;
+			std::size_t replaced = 0u;
+			if (read.hash) {
+				auto field = entry.fields.find(read.field);
+				if (field != entry.fields.end()) {
+					replaced = size_of(read.field, field->second);
+				}
+				entry.fields[read.field] = value;
+			} else {
+				if (entry.has_value) {
+					replaced = size_of(read.field, entry.value);
+				}
+				entry.has_value = true;
+				entry.value = value;
+			}
+			entry.num_bytes += size - replaced;
+			num_bytes += size - replaced;
+			std::size_t evicted = 0u;
+			while (num_bytes > max_bytes && !recent.empty()) {
+				erase(entries.find(*recent.back()));
+				++evicted;
+			}
+			return evicted;
+		}
+
+		/// Drop the given key
+		/**
+		 *	@param key Key that was modified
+		 *	@return True if the key was cached
+		 */
+		bool invalidate(std::string const & key) {
+			std::lock_guard<std::mutex> lock{mutex};
+			++epoch;
+			auto it = entries.find(key);
+			if (it == entries.end()) {
+				return false;
+			}
+			erase(it);
+			return true;
+		}
+
+		/// Drop all keys
+		/**
+		 *	@return Number of keys that were cached
+		 */
+		std::size_t clear() {
+			std::lock_guard<std::mutex> lock{mutex};
+			++epoch;
+			auto const num = entries.size();
+			entries.clear();
+			recent.clear();
+			num_bytes = 0u;
+			return num;
+		}
+
+		/// Return the estimated size of the cached keys and replies
+		inline std::size_t getNumBytes() {
+			std::lock_guard<std::mutex> lock{mutex};
+			return num_bytes;
+		}
+};
+
+/// Client-side cache of replies to GET and HGET
+/**
+ *	Keys are spread across the shards by their hash. Replies are only
+ *	cached while the server reports modifications (see `setTracking()`).
+ */
+class Cache {
+	private:
+		std::vector<CacheShard> shards;
+		std::size_t const shard_bytes;		// max. size per shard
+		std::vector<std::string> const prefixes;
+		std::atomic<bool> tracking;
+		std::atomic<std::uint64_t> hits, misses, invalidations, evictions;
+
+		inline CacheShard& shardOf(std::string const & key) {
+			return shards[hash64(key.data(), key.size()) % shards.size()];
+		}
+
+	public:
+		Cache(CachePolicy const & policy)
+			: shards(std::max<std::size_t>(policy.num_shards, 1u))
+			, shard_bytes{policy.max_bytes / std::max<std::size_t>(policy.num_shards, 1u)}
+			, prefixes{policy.prefixes}
+			, tracking{false}
+			, hits{0u}
+			, misses{0u}
+			, invalidations{0u}
+			, evictions{0u} {
+		}
+
+		/// Return whether the given key may be cached
+		bool isCacheable(StringView key) const {
+			if (prefixes.empty()) {
+				return true;
+			}
+			for (auto const & prefix: prefixes) {
+				if (key.size() >= prefix.size() && StringView{key.data(), prefix.size()} == prefix) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/// Find the cached reply to the given read
+		/**
+		 *	@param read Read to look up
+		 *	@param value Assigned the cached reply
+		 *	@return False if the reply is not cached (a miss)
+		 */
+		bool find(CacheRead const & read, Reply& value) {
+			if (shardOf(read.key).find(read, value)) {
+				hits.fetch_add(1u, std::memory_order_relaxed);
+				return true;
+			}
+			misses.fetch_add(1u, std::memory_order_relaxed);
+			return false;
+		}
+
+		/// Return the epoch to pass to `insert()` once the read was replied
+		inline std::uint64_t prepare(CacheRead const & read) {
+			return shardOf(read.key).getEpoch();
+		}
+
+		/// Cache the reply to the given read
+		/**
+		 *	Only strings and nulls are cached (e.g. no errors). The reply
+		 *	is copied, so it does not keep its receive buffer alive.
+		 *
+		 *	@param read Read the reply belongs to
+		 *	@param epoch Epoch returned by `prepare()` before the read was sent
+		 *	@param value Reply to the read
+		 */
+		void insert(CacheRead const & read, std::uint64_t epoch, Reply const & value) {
+			if (!tracking.load(std::memory_order_acquire) || !(value.isBulk() || value.isNull())) {
+				return;
+			}
+			auto const evicted = shardOf(read.key).insert(read, copy_reply(value), epoch, shard_bytes);
+			evictions.fetch_add(evicted, std::memory_order_relaxed);
+		}
+
+		/// Drop the given key
+		void invalidate(StringView key) {
+			std::string const owned{key};
+			if (shardOf(owned).invalidate(owned)) {
+				invalidations.fetch_add(1u, std::memory_order_relaxed);
+			}
+		}
+
+		/// Collect the cached keys the command might modify
+		/**
+		 *	@param cmd Command to inspect
+		 *	@param write Keys to drop, the command's keys are appended
+		 */
+		template <typename Allocator>
+		void collect(BasicCommand<Allocator> const & cmd, CacheWrite& write) const {
+			auto const num = cmd.getNumArguments();
+			if (num == 0u) {
+				return;
+			}
+			auto const name = cmd.getArgument(0u);
+			if (equals_upper(name, "FLUSHALL") || equals_upper(name, "FLUSHDB")) {
+				write.all = true;
+				return;
+			}
+			if (!may_modify(cmd)) {
+				return;
+			}
+			// any argument might be a key (e.g. "MSET <key> <value> <key> <value>")
+			for (std::size_t i = 1u; i < num; ++i) {
+				auto const arg = cmd.getArgument(i);
+				if (isCacheable(arg)) {
+					write.keys.emplace_back(arg);
+				}
+			}
+		}
+
+		/// Drop the keys of a write
+		void forget(CacheWrite const & write) {
+			if (write.all) {
+				clear();
+				return;
+			}
+			for (auto const & key: write.keys) {
+				invalidate(StringView{key});
+			}
+		}
+
+		/// Drop all keys
+		void clear() {
+			std::size_t num = 0u;
+			for (auto& shard: shards) {
+				num += shard.clear();
+			}
+			invalidations.fetch_add(num, std::memory_order_relaxed);
+		}
+
+		/// Set whether the server reports modifications
+		/**
+		 *	Either way, all keys are dropped, because reports may have been
+		 *	missed. While not tracking, no replies are cached.
+		 *
+		 *	@param enabled Whether invalidations are received
+		 */
+		void setTracking(bool enabled) {
+			if (!enabled) {
+				tracking.store(false, std::memory_order_release);
+			}
+			clear();
+			if (enabled) {
+				tracking.store(true, std::memory_order_release);
+			}
+		}
+
+		/// Return the cache's counters
+		CacheStats getStats() {
+			CacheStats stats{hits.load(), misses.load(), invalidations.load(), evictions.load(), 0u};
+			for (auto& shard: shards) {
+				stats.num_bytes += shard.getNumBytes();
+			}
+			return stats;
+		}
+};
+
+/// Socket receiving the keys to invalidate
+/**
+ *	The socket enables client tracking in broadcasting mode, redirected to
+ *	itself, and subscribes to the invalidation channel. So the server
+ *	reports each modified key (matching any prefix), no matter which client
+ *	read it, which keeps the sockets of the connection's pool free of
+ *	tracking state. The messages are received by a dedicated thread. If
+ *	the socket fails, the cache is cleared and the socket is reopened.
+ */
+template <typename SocketImpl>
+class InvalidationListener {
+	private:
+		std::string const host;
+		std::uint16_t const port;
+		std::shared_ptr<Cache> const cache;
+		std::vector<std::string> const prefixes;
+		std::chrono::milliseconds const retry;
+
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		bool stopping;
+		std::unique_ptr<SocketImpl> socket;		// replaced by the thread only
+		std::string pending;					// bytes received by the thread
+		std::size_t parsed, received;			// number of parsed and received bytes
+		std::thread thread;
+
+		// receive the next message, keeping the bytes of the following ones
+		Reply receive(SocketImpl& socket) {
+			auto data = std::make_shared<ReplyData>();
+			ReplyParser parser{&data->nodes};
+			_receive(socket, parser, pending, parsed, received);
+			data->buffer.assign(pending, 0u, parsed);
+			pending.erase(0u, parsed);
+			received -= parsed;
+			parsed = 0u;
+			return Reply{std::move(data), 0u};
+		}
+
+		// open a socket and subscribe to invalidations
+		std::unique_ptr<SocketImpl> subscribe() {
+			auto socket = create_socket<SocketImpl>(host, port);
+			auto const id = _execute_request(*socket, *Command{"CLIENT", "ID"});
+			if (!id.isInteger()) {
+				throw ConnectionError{"Cannot get client id", host, port};
+			}
+			Command tracking{"CLIENT", "TRACKING", "ON", "REDIRECT", id.getInteger(), "BCAST"};
+			for (auto const & prefix: prefixes) {
+				tracking << "PREFIX" << prefix;
+			}
+			auto const enabled = _execute_request(*socket, *tracking);
+			if (enabled.isError()) {
+				throw ConnectionError{"Cannot enable client tracking: " + std::string{enabled.getString()}, host, port};
+			}
+			// invalidations may follow right away
+			auto const request = *Command{"SUBSCRIBE", invalidation_channel};
+			socket->write(request.data(), request.size());
+			pending.clear();
+			parsed = 0u;
+			received = 0u;
+			if (!receive(*socket).isArray()) {
+				throw ConnectionError{"Cannot subscribe to invalidations", host, port};
+			}
+			return socket;
+		}
+
+		// drop the keys of an invalidation message
+		void handle(Reply const & message) {
+			if (!message.isArray() || message.size() != 3u || message[0].getString() != "message") {
+				// e.g. confirming UNSUBSCRIBE
+				return;
+			}
+			auto const keys = message[2];
+			if (keys.isNull()) {
+				// FLUSHALL or FLUSHDB
+				cache->clear();
+				return;
+			}
+			for (auto const & key: keys) {
+				cache->invalidate(key.getString());
+			}
+		}
+
+		void run() {
+			while (true) {
+				SocketImpl* current;
+				{
+					std::lock_guard<std::mutex> lock{mutex};
+					current = socket.get();
+				}
+				if (current != nullptr) {
+					try {
+						while (true) {
+							auto const message = receive(*current);
+							{
+								std::lock_guard<std::mutex> lock{mutex};
+								if (stopping) {
+									return;
+								}
+							}
+							handle(message);
+						}
+					} catch (std::exception const &) {
+						// invalidations may be missed from now on
+						cache->setTracking(false);
+					}
+					std::lock_guard<std::mutex> lock{mutex};
+					socket.reset();
+				}
+				{
+					std::unique_lock<std::mutex> lock{mutex};
+					if (wakeup.wait_for(lock, retry, [this]() { return stopping; })) {
+						return;
+					}
+				}
+				try {
+					auto fresh = subscribe();
+					std::lock_guard<std::mutex> lock{mutex};
+					if (stopping) {
+						return;
+					}
+					socket = std::move(fresh);
+					cache->setTracking(true);
+				} catch (std::exception const &) {
+					// retry later
+				}
+			}
+		}
+
+	public:
+		/// Subscribe to invalidations of the given cache's keys
+		/**
+		 *	@throw ConnectionError if the socket cannot be opened or the
+		 *		server does not support client tracking
+		 *	@param host remote host's name OR local stream's filename
+		 *	@param port remote host's port number OR not used
+		 *	@param cache Cache to invalidate
+		 *	@param policy Prefixes to track and retry delay
+		 */
+		InvalidationListener(std::string const & host, std::uint16_t port, std::shared_ptr<Cache> cache,
+			CachePolicy const & policy)
+			: host{host}
+			, port{port}
+			, cache{std::move(cache)}
+			, prefixes{policy.prefixes}
+			, retry{policy.retry}
+			, mutex{}
+			, wakeup{}
+			, stopping{false}
+			, socket{}
+			, pending{}
+			, parsed{0u}
+			, received{0u}
+			, thread{} {
+			socket = subscribe();
+			this->cache->setTracking(true);
+			thread = std::thread{&InvalidationListener::run, this};
+		}
+
+		InvalidationListener(InvalidationListener const &) = delete;
+
+		/// Unsubscribe and wait for the thread
+		~InvalidationListener() {
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				stopping = true;
+				if (socket != nullptr) {
+					// the reply wakes the thread up
+					try {
+						auto const request = *Command{"UNSUBSCRIBE"};
+						socket->write(request.data(), request.size());
+					} catch (std::exception const &) {
+					}
+				}
+			}
+			wakeup.notify_all();
+			thread.join();
+		}
+};
+
+} // ::priv
+
+/// Connection serving reads from a client-side cache
+/**
+ *	Replies to GET and HGET are kept in a memory-bounded LRU cache (see
+ *	`CachePolicy`), so repeated reads of the same keys are served without
+ *	touching a socket. The cache is kept correct by the server, which
+ *	reports each modified key using client tracking (see
+ *	`priv::InvalidationListener`). Other requests are sent to the server
+ *	by a `Connection`. They drop the cached keys they might modify right
+ *	away and once more when they completed, before their reply is passed
+ *	on: a concurrent read might have cached a key's old value meanwhile,
+ *	if it reached the server first. So once a write completed, the
+ *	connection reads what was written (until the next modification).
+ *	Copies of a caching connection share the same cache and sockets.
+ *
+ *	Example usage:
+ *	@code
+ *		redisxx::CachingConnection<redisxx::BoostTcpSocket> conn{"localhost", 6379,
+ *			redisxx::CachePolicy{256u << 20u, 32u, {"user:"}}};
+ *		auto name = conn(redisxx::Command{"HGET", "user:42", "name"}).get();
+ *	@endcode
+ */
+#if defined(REDISXX_UNIX_SOCKET)
+template <typename SocketImpl = BoostUnixSocket>
+#elif defined(REDISXX_BOOST_SOCKET)
+template <typename SocketImpl = BoostTcpSocket>
+#elif defined(REDISXX_SFML_SOCKET)
+template <typename SocketImpl = SfmlTcpSocket>
+#elif defined(REDISXX_SDLNET_SOCKET)
+template <typename SocketImpl = SdlNetTcpSocket>
+#else
+template <typename SocketImpl>
+#endif
+class CachingConnection {
+
+	using Callback = std::function<void(std::exception_ptr, Reply)>;
+
+	private:
+		Connection<SocketImpl> connection;
+		std::shared_ptr<priv::Cache> cache;
+		std::shared_ptr<priv::InvalidationListener<SocketImpl>> listener;
+
+		// send a request, dropping the cached keys it might modify before and after it
+		template <typename Request>
+		void modify(Request const & request, priv::CacheWrite const & write, Callback callback) {
+			if (write.empty()) {
+				connection.async(request, std::move(callback));
+				return;
+			}
+			cache->forget(write);
+			auto const shared = cache;
+			connection.async(request, [shared, write, callback](std::exception_ptr error, Reply reply) {
+				shared->forget(write);
+				callback(error, std::move(reply));
+			});
+		}
+
+		template <typename Allocator>
+		void submit(BasicCommand<Allocator> const & cmd, Callback callback) {
+			priv::CacheRead read;
+			if (!priv::cache_read_of(cmd, read) || !cache->isCacheable(StringView{read.key})) {
+				priv::CacheWrite write;
+				cache->collect(cmd, write);
+				modify(cmd, write, std::move(callback));
+				return;
+			}
+			Reply value;
+			if (cache->find(read, value)) {
+				priv::invoke_callback(callback, nullptr, std::move(value));
+				return;
+			}
+			auto const epoch = cache->prepare(read);
+			auto const cache = this->cache;
+			connection.async(cmd, [cache, read, epoch, callback](std::exception_ptr error, Reply reply) {
+				if (error == nullptr) {
+					cache->insert(read, epoch, reply);
+				}
+				callback(error, std::move(reply));
+			});
+		}
+
+		template <typename Allocator>
+		void submit(BasicCommandList<Allocator> const & list, Callback callback) {
+			priv::CacheWrite write;
+			for (std::size_t i = 0u; i < list.size(); ++i) {
+				cache->collect(list.at(i), write);
+			}
+			modify(list, write, std::move(callback));
+		}
+
+	public:
+		/// Create a new caching connection to the given remote host or local stream
+		/**
+		 *	Unlike `Connection`, a socket is opened right away, which
+		 *	receives the invalidations. It enables client tracking, which
+		 *	requires redis 6 or newer.
+		 *
+		 *	@throw ConnectionError if the invalidation socket cannot be opened
+		 *		or client tracking is not supported
+		 *	@param host remote host's name OR local stream's filename
+		 *	@param port remote host's port number OR not used
+		 *	@param caching size, shards and prefixes of the cache
+		 *	@param policy size and idle policy of the socket pool
+		 *	@param pipelining batch size and time window of automatic pipelining
+		 */
+		CachingConnection(std::string const & host, std::uint16_t port=0u, CachePolicy const & caching=CachePolicy{},
+			PoolPolicy const & policy=PoolPolicy{}, PipelinePolicy const & pipelining=PipelinePolicy{})
+			: connection{host, port, policy, pipelining}
+			, cache{std::make_shared<priv::Cache>(caching)}
+			, listener{std::make_shared<priv::InvalidationListener<SocketImpl>>(host, port, cache, caching)} {
+		}
+
+		/// Execute the given request
+		/**
+		 *	This works like `Connection::operator()`. If the request is a
+		 *	GET or HGET whose reply is cached, the returned future is ready
+		 *	right away. Command lists are always sent to the server.
+		 *
+		 *	@param request Command or command list
+		 *	@return Future reply
+		 */
+		template <typename Request>
+		std::future<Reply> operator()(Request const & request) {
+			auto promise = std::make_shared<std::promise<Reply>>();
+			auto future = promise->get_future();
+			submit(request, priv::fulfil(promise));
+			return future;
+		}
+
+		/// Execute the given request and pass its reply to the given handler
+		/**
+		 *	This works like `Connection::async()`. If the reply is cached,
+		 *	the handler is called by the calling thread before this returns.
+		 *
+		 *	@param request Command or command list
+		 *	@param handler Callable as `void(std::exception_ptr, redisxx::Reply)`
+		 */
+		template <typename Request, typename Handler>
+		void async(Request const & request, Handler handler) {
+			submit(request, Callback{std::move(handler)});
+		}
+
+		/// Return the cache's counters
+		inline CacheStats getStats() const {
+			return cache->getStats();
+		}
+};
+
+} // ::redisxx
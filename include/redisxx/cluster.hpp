@@ -0,0 +1,712 @@
+/** @file cluster.hpp
+ *
+ * RedisXX Cluster Connection implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <redisxx/command.hpp>
+#include <redisxx/connection.hpp>
+#include <redisxx/error.hpp>
+#include <redisxx/fanout.hpp>
+#include <redisxx/format.hpp>
+#include <redisxx/keys.hpp>
+#include <redisxx/reply.hpp>
+
+namespace redisxx {
+namespace priv {
+
+// max. number of redirects followed per request
+static std::size_t const max_redirects = 5u;
+
+// slot that is not assigned to any node
+static std::uint16_t const unassigned_slot = 0xffffu;
+
+/// Redirect of a request to another node
+struct Redirect {
+	bool ask;				// ASK (this request only) OR MOVED (the slot's new owner)
+	std::size_t slot;
+	std::string host;		// empty if the node redirects to its own host
+	std::uint16_t port;
+};
+
+/// Parse a MOVED or ASK error
+/**
+ *	The errors look like "MOVED <slot> <host>:<port>" or "ASK <slot>
+ *	<host>:<port>". The host may contain colons itself (IPv6) or be empty.
+ *
+ *	@param error Error message
+ *	@param redirect Assigned the parsed redirect
+ *	@return False if the error is no redirect
+ */
+inline bool parse_redirect(StringView error, Redirect& redirect) {
+	std::string const str{error};
+	std::size_t pos;
+	if (str.compare(0u, 6u, "MOVED ") == 0) {
+		redirect.ask = false;
+		pos = 6u;
+	} else if (str.compare(0u, 4u, "ASK ") == 0) {
+		redirect.ask = true;
+		pos = 4u;
+	} else {
+		return false;
+	}
+	auto const space = str.find(' ', pos);
+	auto const colon = str.rfind(':');
+	if (space == std::string::npos || colon == std::string::npos || colon < space) {
+		return false;
+	}
+	auto const data = str.data();
+	if (!parse_integer(data + pos, data + space, redirect.slot) || redirect.slot >= num_hash_slots
+		|| !parse_integer(data + colon + 1u, data + str.size(), redirect.port)) {
+		return false;
+	}
+	redirect.host = str.substr(space + 1u, colon - space - 1u);
+	return true;
+}
+
+// the reply to a command is redirected as a whole
+template <typename Allocator>
+bool find_redirect(BasicCommand<Allocator> const &, Reply const & reply, Redirect& redirect) {
+	return reply.isError() && parse_redirect(reply.getString(), redirect);
+}
+
+// a transaction is aborted if a queued command was MOVED (ASK is not followed, because
+// ASKING only applies to the next command)
+template <typename Allocator>
+bool find_redirect(BasicCommandList<Allocator> const &, Reply const & reply, Redirect& redirect) {
+	if (!reply.isArray()) {
+		return false;
+	}
+	for (auto const & element: reply) {
+		if (element.isError() && parse_redirect(element.getString(), redirect) && !redirect.ask) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Master node of a cluster
+/**
+ *	The node's connection opens its socket once the first request is sent.
+ *	Requests to a node that is not connected are sent by its connector
+ *	thread, so at most one thread per node waits for a connection. The
+ *	connector is joined once the node is destroyed.
+ */
+template <typename SocketImpl>
+struct ClusterNode {
+	std::string host;
+	std::uint16_t port;
+	Connection<SocketImpl> connection;
+	std::atomic<bool> connected;	// whether the last request was answered
+
+	std::mutex mutex;
+	std::vector<std::function<void()>> pending;	// sent by the connector
+	bool connecting;							// whether the connector is running
+	std::thread connector;
+
+	ClusterNode(std::string const & host, std::uint16_t port, PoolPolicy const & policy,
+		PipelinePolicy const & pipelining)
+		: host{host}
+		, port{port}
+		, connection{host, port, policy, pipelining}
+		, connected{false}
+		, mutex{}
+		, pending{}
+		, connecting{false}
+		, connector{} {
+	}
+
+	~ClusterNode() {
+		if (!connector.joinable()) {
+			return;
+		}
+		if (connector.get_id() == std::this_thread::get_id()) {
+			// the connector released the node, so it is about to exit
+			connector.detach();
+		} else {
+			connector.join();
+		}
+	}
+};
+
+/// Assignment of hash slots to nodes
+/**
+ *	A slot map is never changed once it was published, but replaced by an
+ *	updated copy. So requests can be routed without holding a lock.
+ */
+template <typename SocketImpl>
+struct SlotMap {
+	std::vector<std::shared_ptr<ClusterNode<SocketImpl>>> nodes;	// at least one
+	std::vector<std::uint16_t> owners;	// index of each slot's node
+
+	SlotMap()
+		: nodes{}
+		, owners(num_hash_slots, unassigned_slot) {
+	}
+
+	// index of the given node, which is added if needed
+	std::uint16_t indexOf(std::shared_ptr<ClusterNode<SocketImpl>> const & node) {
+		for (std::size_t i = 0u; i < nodes.size(); ++i) {
+			if (nodes[i] == node) {
+				return static_cast<std::uint16_t>(i);
+			}
+		}
+		nodes.push_back(node);
+		return static_cast<std::uint16_t>(nodes.size() - 1u);
+	}
+
+	// node owning the given slot, requests for unassigned slots are sent anywhere
+	std::shared_ptr<ClusterNode<SocketImpl>> const & owner(std::size_t slot) const {
+		auto const index = owners[slot];
+		return nodes[(index == unassigned_slot) ? 0u : index];
+	}
+
+	// node for the given command
+	template <typename Allocator>
+	std::shared_ptr<ClusterNode<SocketImpl>> const & route(BasicCommand<Allocator> const & cmd) const {
+		StringView key;
+		return key_of(cmd, key) ? owner(hash_slot(key)) : nodes.front();
+	}
+};
+
+/// Routing of requests to the nodes of a cluster
+/**
+ *	Each master node is reached by its own `Connection`, so requests to
+ *	different nodes are multiplexed onto different sockets. Redirects are
+ *	followed by the thread that received them: the request is resent, and
+ *	the slot map is reloaded in the background after a MOVED error or a
+ *	connection error. Opening a socket blocks, so requests to a node that
+ *	is not connected (yet) are queued and sent by the node's connector
+ *	thread instead (see `ClusterNode`). Hence a reader never waits for a
+ *	connection to another node, and a burst of redirects to a new node
+ *	(e.g. while resharding) starts a single thread.
+ */
+template <typename SocketImpl>
+class Cluster: public std::enable_shared_from_this<Cluster<SocketImpl>> {
+
+	using Node = ClusterNode<SocketImpl>;
+	using NodePtr = std::shared_ptr<Node>;
+	using Map = SlotMap<SocketImpl>;
+	using NodeBatch = Batch<std::shared_ptr<ClusterNode<SocketImpl>>>;
+
+	public:
+		using Callback = std::function<void(std::exception_ptr, Reply)>;
+
+	private:
+		// request in flight, which owns a copy to be resent after a redirect
+		template <typename Request>
+		struct Attempt {
+			Request request;
+			Callback callback;
+			std::size_t redirects;
+
+			Attempt(Request&& request, Callback callback)
+				: request{std::move(request)}
+				, callback{std::move(callback)}
+				, redirects{0u} {
+			}
+		};
+
+		PoolPolicy policy;
+		PipelinePolicy pipelining;
+		std::mutex mutex;
+		std::map<std::string, NodePtr> nodes;	// all nodes known so far, by "host:port"
+		std::shared_ptr<Map> map;
+		std::atomic<bool> refreshing;
+
+		// node with the given address, which is created if needed (the lock is held)
+		NodePtr const & nodeAt(std::string const & host, std::uint16_t port) {
+			auto& node = nodes[host + ':' + std::to_string(port)];
+			if (node == nullptr) {
+				node = std::make_shared<Node>(host, port, policy, pipelining);
+			}
+			return node;
+		}
+
+		NodePtr getNode(std::string const & host, std::uint16_t port) {
+			std::lock_guard<std::mutex> lock{mutex};
+			return nodeAt(host, port);
+		}
+
+		// replace the slot map by the one described by a CLUSTER SLOTS reply
+		void install(Reply const & reply, Node const & source) {
+			if (!reply.isArray()) {
+				throw ProtocolError{"Invalid reply to CLUSTER SLOTS"};
+			}
+			auto next = std::make_shared<Map>();
+			std::lock_guard<std::mutex> lock{mutex};
+			for (auto const & range: reply) {
+				// [<first slot>, <last slot>, [<host>, <port>, ...], <replicas>...]
+				if (!range.isArray() || range.size() < 3u || !range[2].isArray() || range[2].size() < 2u) {
+					throw ProtocolError{"Invalid slot range in reply to CLUSTER SLOTS"};
+				}
+				auto const first = range[0].getInteger();
+				auto const last = range[1].getInteger();
+				auto const port = range[2][1].getInteger();
+				if (first < 0 || last < first || last >= static_cast<std::int64_t>(num_hash_slots)
+					|| port <= 0 || port > 65535) {
+					throw ProtocolError{"Invalid slot range in reply to CLUSTER SLOTS"};
+				}
+				std::string host{range[2][0].getString()};
+				if (host.empty() || host == "?") {
+					// the node does not know its address, so it is the one asked
+					host = source.host;
+				}
+				auto const index = next->indexOf(nodeAt(host, static_cast<std::uint16_t>(port)));
+				for (auto slot = first; slot <= last; ++slot) {
+					next->owners[static_cast<std::size_t>(slot)] = index;
+				}
+			}
+			if (next->nodes.empty()) {
+				// no slots are assigned yet, so any request is sent to this node
+				next->indexOf(nodeAt(source.host, source.port));
+			}
+			map = std::move(next);
+		}
+
+		// assign a slot to the node it was MOVED to
+		void moved(std::size_t slot, NodePtr const & node) {
+			std::lock_guard<std::mutex> lock{mutex};
+			if (map->owner(slot) == node) {
+				return;
+			}
+			auto next = std::make_shared<Map>(*map);
+			next->owners[slot] = next->indexOf(node);
+			map = std::move(next);
+		}
+
+		// send the node's pending requests until none are left (the node's connector)
+		static void connect(NodePtr node) {
+			std::vector<std::function<void()>> batch;
+			while (true) {
+				{
+					std::lock_guard<std::mutex> lock{node->mutex};
+					if (node->pending.empty()) {
+						node->connecting = false;
+						return;
+					}
+					batch.swap(node->pending);
+				}
+				for (auto& func: batch) {
+					try {
+						func();
+					} catch (...) {
+						// the other requests are sent anyway
+					}
+				}
+				batch.clear();
+			}
+		}
+
+		// call the given function right away if the node is connected, else by the node's connector
+		static void reach(NodePtr const & node, std::function<void()> func) {
+			if (node->connected.load()) {
+				func();
+				return;
+			}
+			std::lock_guard<std::mutex> lock{node->mutex};
+			// the function keeps the cluster alive
+			node->pending.push_back(std::move(func));
+			if (node->connecting) {
+				return;
+			}
+			node->connecting = true;
+			if (node->connector.joinable()) {
+				// the previous connector found nothing left to send, so it exits right away
+				node->connector.join();
+			}
+			node->connector = std::thread{&Cluster::connect, node};
+		}
+
+		// reload the slot map from the given node without blocking
+		void refreshFrom(NodePtr const & node) {
+			if (refreshing.exchange(true)) {
+				return;
+			}
+			auto self = this->shared_from_this();
+			reach(node, [self, node]() {
+				node->connection.async(Command{"CLUSTER", "SLOTS"}, [self, node](std::exception_ptr error, Reply reply) {
+					node->connected.store(error == nullptr);
+					if (error == nullptr) {
+						try {
+							self->install(reply, *node);
+						} catch (std::exception const &) {
+							// keep the current map
+						}
+					}
+					self->refreshing.store(false);
+				});
+			});
+		}
+
+		// reload the slot map from any node but the given (failed) one
+		void refreshAfterFailure(NodePtr const & failed) {
+			auto const current = getMap();
+			for (auto const & node: current->nodes) {
+				if (node != failed) {
+					refreshFrom(node);
+					return;
+				}
+			}
+			refreshFrom(failed);
+		}
+
+		template <typename Request>
+		void send(NodePtr const & node, std::shared_ptr<Attempt<Request>> const & attempt) {
+			auto self = this->shared_from_this();
+			node->connection.async(attempt->request, [self, node, attempt](std::exception_ptr error, Reply reply) {
+				self->complete(node, attempt, error, std::move(reply));
+			});
+		}
+
+		// resend a redirected command
+		template <typename Allocator>
+		void resend(NodePtr const & node, std::shared_ptr<Attempt<BasicCommand<Allocator>>> const & attempt,
+			Redirect const & redirect) {
+			if (!redirect.ask) {
+				send(node, attempt);
+				return;
+			}
+			// the slot is being migrated, so only this command is sent to the node
+			CommandList list{BatchType::Pipeline};
+			list << Command{"ASKING"} << attempt->request;
+			auto self = this->shared_from_this();
+			node->connection.async(list, [self, node, attempt](std::exception_ptr error, Reply reply) {
+				self->complete(node, attempt, error, (error == nullptr) ? reply[1] : Reply{});
+			});
+		}
+
+		// resend a transaction that was aborted due to MOVED
+		template <typename Allocator>
+		void resend(NodePtr const & node, std::shared_ptr<Attempt<BasicCommandList<Allocator>>> const & attempt,
+			Redirect const &) {
+			send(node, attempt);
+		}
+
+		// pass the reply on unless it redirects the request
+		template <typename Request>
+		void complete(NodePtr const & node, std::shared_ptr<Attempt<Request>> const & attempt,
+			std::exception_ptr error, Reply reply) {
+			node->connected.store(error == nullptr);
+			if (error != nullptr) {
+				// the node may have failed, so its slots may have been taken over
+				refreshAfterFailure(node);
+				attempt->callback(error, Reply{});
+				return;
+			}
+			Redirect redirect;
+			if (attempt->redirects < max_redirects && find_redirect(attempt->request, reply, redirect)) {
+				++attempt->redirects;
+				auto const target = getNode(redirect.host.empty() ? node->host : redirect.host, redirect.port);
+				if (!redirect.ask) {
+					moved(redirect.slot, target);
+					refreshFrom(target);
+				}
+				auto self = this->shared_from_this();
+				reach(target, [self, target, attempt, redirect]() {
+					self->resend(target, attempt, redirect);
+				});
+				return;
+			}
+			attempt->callback(nullptr, std::move(reply));
+		}
+
+		// pass the replies to a batch on, following redirects of single commands
+		void complete(NodeBatch const & batch, std::shared_ptr<Fanout> const & fanout, bool whole,
+			std::exception_ptr error, Reply reply) {
+			batch.target->connected.store(error == nullptr);
+			if (error != nullptr) {
+				refreshAfterFailure(batch.target);
+				fanout->set(batch.positions, error, reply);
+				return;
+			}
+			Redirect redirect;
+			if (whole) {
+				// the pipeline was not split, so its reply is passed on as it is
+				auto redirected = false;
+				for (auto const & element: reply) {
+					redirected = redirected || (element.isError() && parse_redirect(element.getString(), redirect));
+				}
+				if (!redirected) {
+					fanout->bypass(nullptr, std::move(reply));
+					return;
+				}
+			}
+			for (std::size_t i = 0u; i < batch.positions.size(); ++i) {
+				auto const pos = batch.positions[i];
+				auto element = reply[i];
+				if (!element.isError() || !parse_redirect(element.getString(), redirect)) {
+					fanout->set(pos, nullptr, std::move(element));
+					continue;
+				}
+				auto attempt = std::make_shared<Attempt<Command>>(
+					Command{std::allocator_arg, std::allocator<char>{}, batch.list.at(i)},
+					[fanout, pos](std::exception_ptr error, Reply reply) {
+						fanout->set(pos, error, std::move(reply));
+					});
+				complete(batch.target, attempt, nullptr, std::move(element));
+			}
+		}
+
+	public:
+		Cluster(std::string const & host, std::uint16_t port, PoolPolicy const & policy,
+			PipelinePolicy const & pipelining)
+			: policy{policy}
+			, pipelining{pipelining}
+			, mutex{}
+			, nodes{}
+			, map{std::make_shared<Map>()}
+			, refreshing{false} {
+			map->indexOf(nodeAt(host, port));
+		}
+
+		/// Return the current slot map
+		std::shared_ptr<Map> getMap() {
+			std::lock_guard<std::mutex> lock{mutex};
+			return map;
+		}
+
+		/// Load the slot map
+		/**
+		 *	The known nodes are asked one after another, until one of them
+		 *	replies to CLUSTER SLOTS.
+		 *
+		 *	@throw ConnectionError if no node could provide the slot map
+		 */
+		void refresh() {
+			std::vector<NodePtr> candidates;
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				candidates = map->nodes;
+				for (auto const & pair: nodes) {
+					candidates.push_back(pair.second);
+				}
+			}
+			std::exception_ptr error;
+			for (auto const & node: candidates) {
+				try {
+					auto reply = node->connection(Command{"CLUSTER", "SLOTS"}).get();
+					if (reply.isError()) {
+						throw ConnectionError{"Cannot load slot map: " + std::string{reply.getString()},
+							node->host, node->port};
+					}
+					node->connected.store(true);
+					install(reply, *node);
+					return;
+				} catch (ConnectionError const &) {
+					error = std::current_exception();
+				}
+			}
+			std::rethrow_exception(error);
+		}
+
+		/// Send a command to the node owning its key
+		/**
+		 *	The command is copied (including borrowed payloads), so it can be
+		 *	resent after a redirect.
+		 *
+		 *	@param cmd Command to send
+		 *	@param callback Called with the reply or the error
+		 */
+		template <typename Allocator>
+		void submit(BasicCommand<Allocator> const & cmd, Callback callback) {
+			auto const current = getMap();
+			auto attempt = std::make_shared<Attempt<Command>>(
+				Command{std::allocator_arg, std::allocator<char>{}, cmd}, std::move(callback));
+			attempt->request.own();
+			send(current->route(cmd), attempt);
+		}
+
+		/// Send a command list
+		/**
+		 *	A transaction is sent to the node owning the key of its first
+		 *	command that refers to a key, because all keys of a transaction
+		 *	need to belong to the same slot.
+		 *	A pipeline is split into one pipeline per node, which are sent
+		 *	right away, so all nodes work on their commands in parallel.
+		 *	Their replies are joined in the order of the commands. If a
+		 *	single node owns all keys, its reply is passed on as it is.
+		 *	Redirected commands are resent on their own.
+		 *
+		 *	@param list Commands to send
+		 *	@param callback Called with the array reply or the error
+		 */
+		template <typename Allocator>
+		void submit(BasicCommandList<Allocator> const & list, Callback callback) {
+			auto const current = getMap();
+			if (list.getBatchType() == BatchType::Transaction) {
+				NodePtr node = current->nodes.front();
+				StringView key;
+				for (std::size_t i = 0u; i < list.size(); ++i) {
+					if (key_of(list.at(i), key)) {
+						node = current->owner(hash_slot(key));
+						break;
+					}
+				}
+				CommandList copy{BatchType::Transaction};
+				copy.reserve(list.size());
+				for (std::size_t i = 0u; i < list.size(); ++i) {
+					copy << list.at(i);
+					copy.at(i).own();
+				}
+				send(node, std::make_shared<Attempt<CommandList>>(std::move(copy), std::move(callback)));
+				return;
+			}
+			if (list.empty()) {
+				invoke_callback(callback, nullptr, join_replies({}));
+				return;
+			}
+			// group the commands by node, which may need to resend them
+			auto const batches = split_pipeline<NodePtr>(list, [&current](BasicCommand<Allocator> const & cmd) {
+				return current->route(cmd);
+			});
+			for (auto const & batch: batches) {
+				for (std::size_t i = 0u; i < batch->list.size(); ++i) {
+					batch->list.at(i).own();
+				}
+			}
+			auto fanout = std::make_shared<Fanout>(list.size(), std::move(callback));
+			auto const whole = (batches.size() == 1u);
+			auto self = this->shared_from_this();
+			for (auto const & batch: batches) {
+				batch->target->connection.async(batch->list, [self, batch, fanout, whole](std::exception_ptr error, Reply reply) {
+					self->complete(*batch, fanout, whole, error, std::move(reply));
+				});
+			}
+		}
+};
+
+} // ::priv
+
+/// Connection to a redis cluster
+/**
+ *	The cluster's slot map is loaded from the given node (using CLUSTER
+ *	SLOTS) when the connection is created. Each key is hashed to its slot
+ *	using CRC16, respecting hash tags (e.g. "{user:42}.name", see
+ *	`priv::hash_tag()`), and each command is sent to the master node owning
+ *	the slot of its key (see `priv::key_of()`). Commands without a key are
+ *	sent to any node. Each node is reached by its own `Connection`, which
+ *	uses the given pool and pipeline policies.
+ *	If a node replies MOVED, the slot is assigned to the given node and the
+ *	request is resent there, while the slot map is reloaded in the
+ *	background. If it replies ASK (the slot is being migrated), the request
+ *	is resent to the given node, preceded by ASKING. Up to
+ *	`priv::max_redirects` redirects are followed per request, afterwards
+ *	the error is returned as reply. Redirected requests are resent by the
+ *	thread that received the redirect, unless the node they are redirected
+ *	to is not connected yet: a single thread per node opens its socket and
+ *	resends them, so no reply is delayed by connecting.
+ *	Copies of a cluster connection share the same nodes.
+ *
+ *	Example usage:
+ *	@code
+ *		redisxx::ClusterConnection<redisxx::BoostTcpSocket> conn{"10.0.0.1", 7000};
+ *		conn(redisxx::Command{"SET", "{user:42}.name", "max"});
+ *		auto name = conn(redisxx::Command{"GET", "{user:42}.name"}).get();
+ *	@endcode
+ */
+#if defined(REDISXX_BOOST_SOCKET)
+template <typename SocketImpl = BoostTcpSocket>
+#elif defined(REDISXX_SFML_SOCKET)
+template <typename SocketImpl = SfmlTcpSocket>
+#elif defined(REDISXX_SDLNET_SOCKET)
+template <typename SocketImpl = SdlNetTcpSocket>
+#else
+template <typename SocketImpl>
+#endif
+class ClusterConnection {
+	private:
+		std::shared_ptr<priv::Cluster<SocketImpl>> cluster;
+
+	public:
+		/// Create a new connection to the cluster the given node belongs to
+		/**
+		 *	@param host Host name of any node
+		 *	@param port Port number of that node
+		 *	@param policy Size and idle policy of each node's socket pool
+		 *	@param pipelining Automatic pipelining of each node's connection
+		 *	@throw ConnectionError if the slot map cannot be loaded
+		 */
+		ClusterConnection(std::string const & host, std::uint16_t port, PoolPolicy const & policy=PoolPolicy{},
+			PipelinePolicy const & pipelining=PipelinePolicy{})
+			: cluster{std::make_shared<priv::Cluster<SocketImpl>>(host, port, policy, pipelining)} {
+			cluster->refresh();
+		}
+
+		/// Execute the given request
+		/**
+		 *	This works like `Connection::operator()`, but the request is sent
+		 *	to the node(s) owning its keys. A pipelined `CommandList` is split
+		 *	into one pipeline per node, which are executed in parallel. The
+		 *	reply still contains one reply per command, in the order of the
+		 *	commands. All keys of a transaction need to belong to the same
+		 *	slot (e.g. by sharing a hash tag), as do the keys of a command
+		 *	referring to multiple keys (e.g. MGET).
+		 *	Requests are copied, including borrowed payloads, because they
+		 *	may need to be resent after a redirect.
+		 *
+		 *	Example usage:
+		 *	@code
+		 *		redisxx::CommandList list{redisxx::BatchType::Pipeline};
+		 *		list << redisxx::Command{"GET", "foo"} << redisxx::Command{"GET", "bar"};
+		 *		auto replies = conn(list).get();
+		 *		// replies[0] is foo's value, replies[1] is bar's value
+		 *	@endcode
+		 *
+		 *	@param request Command or command list
+		 *	@return Future reply
+		 */
+		template <typename Request>
+		std::future<Reply> operator()(Request const & request) {
+			auto promise = std::make_shared<std::promise<Reply>>();
+			auto future = promise->get_future();
+			cluster->submit(request, priv::fulfil(promise));
+			return future;
+		}
+
+		/// Execute the given request and pass its reply to the given handler
+		/**
+		 *	This works like `Connection::async()` (see `operator()`).
+		 *
+		 *	@param request Command or command list
+		 *	@param handler Callable as `void(std::exception_ptr, redisxx::Reply)`
+		 */
+		template <typename Request, typename Handler>
+		void async(Request const & request, Handler handler) {
+			cluster->submit(request, typename priv::Cluster<SocketImpl>::Callback{std::move(handler)});
+		}
+
+		/// Reload the slot map
+		/**
+		 *	This is done automatically after redirects and failures, so it is
+		 *	only needed if the cluster is known to have changed.
+		 *
+		 *	@throw ConnectionError if no node could provide the slot map
+		 */
+		void refresh() {
+			cluster->refresh();
+		}
+
+		/// Return the number of master nodes serving slots
+		std::size_t getNumNodes() const {
+			return cluster->getMap()->nodes.size();
+		}
+};
+
+} // ::redisxx
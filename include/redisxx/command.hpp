@@ -10,98 +10,228 @@
 #include <string>
 #include <vector>
 #include <cstddef>
-
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include <redisxx/arena.hpp>
+#include <redisxx/format.hpp>
+#include <redisxx/segments.hpp>
+#include <redisxx/small_buffer.hpp>
+#include <redisxx/string_view.hpp>
 #include <redisxx/type_traits.hpp>
 
 namespace redisxx {
-namespace priv {
 
-// ----------------------------------------------------------------------------
-// API to enable stringification of common non-nested types
+/// Payload that is referenced by a command instead of being copied
+/**
+ *	See `redisxx::borrow()`.
+ */
+class Borrowed {
+	private:
+		StringView view;
+
+	public:
+		explicit Borrowed(StringView view)
+			: view{view} {
+		}
+
+		inline char const * data() const {
+			return view.data();
+		}
+
+		inline std::size_t size() const {
+			return view.size();
+		}
+};
 
-// replace bad characters
-inline std::string stringify(std::string value) {
-	// tba: escape '\r' and '\n'
-	return value;
+/// Pass a payload to a command without copying it
+/**
+ *	Usually, each argument is copied into the command. A borrowed argument is
+ *	only referenced by the command instead, and it is sent right from the
+ *	given memory (see `Command::gather()`). This avoids copying large values.
+ *	The referenced memory is required to stay unchanged as long as the
+ *	command is used. Requests are written (or copied, if they are pipelined
+ *	automatically) before `Connection::operator()` returns.
+ *
+ *	Example usage:
+ *	@code
+ *		std::string huge = load_image();
+ *		conn(redisxx::Command{"SET", "image", redisxx::borrow(huge)});
+ *	@endcode
+ *
+ *	@param value Payload to reference
+ *	@return Argument referencing the payload
+ */
+inline Borrowed borrow(StringView value) {
+	return Borrowed{value};
 }
 
-// convert arithmetic type
-template <typename T>
-typename std::enable_if<std::is_arithmetic<T>::value, std::string>::type
-stringify(T value) {
-	return std::to_string(value);
+// a temporary would not outlive the command
+Borrowed borrow(std::string&& value) = delete;
+
+template <typename Allocator>
+class BasicCommand;
+
+/// Command using the heap
+using Command = BasicCommand<std::allocator<char>>;
+
+namespace priv {
+
+// payload that is sent from the caller's memory
+struct Borrow {
+	std::size_t position;	// offset inside the command's buffer
+	char const * data;
+	std::size_t size;
+};
+
+// number of bytes of encoded arguments that are stored inside a command (e.g. "GET <key>")
+static std::size_t const inline_command_size = 64u;
+
+// encoded size of a bulk string with a payload of the given size
+inline std::size_t bulk_size(std::size_t length) {
+	// "$<length>\r\n<payload>\r\n"
+	return 1u + num_digits(length) + 2u + length + 2u;
 }
 
 
+// ----------------------------------------------------------------------------
+// Sinks that are passed over the arguments of a command
+
+// determine the exact size of the encoded arguments
+struct SizeSink {
+	std::size_t size;	// number of bytes
+	std::size_t num;	// number of bulk strings
+
+	SizeSink()
+		: size{0u}
+		, num{0u} {
+	}
+
+	inline void bulk(char const * data, std::size_t length) {
+		size += bulk_size(length);
+		++num;
+	}
+
+	inline void borrow(char const * data, std::size_t length) {
+		// the payload itself is not part of the buffer
+		size += bulk_size(length) - length;
+		++num;
+	}
+
+	inline void null() {
+		size += 5u;
+		++num;
+	}
+};
+
+// write the encoded arguments to a buffer that is large enough
+template <typename Borrows>
+struct WriteSink {
+	char* ptr;					// position of the next byte
+	char const * const base;	// beginning of the buffer
+	Borrows& borrows;
+
+	WriteSink(char* ptr, char const * base, Borrows& borrows)
+		: ptr{ptr}
+		, base{base}
+		, borrows(borrows) {
+	}
+
+	inline void bulk(char const * data, std::size_t length) {
+		*ptr++ = '$';
+		ptr = format_unsigned(ptr, length);
+		*ptr++ = '\r';
+		*ptr++ = '\n';
+		std::memcpy(ptr, data, length);
+		ptr += length;
+		*ptr++ = '\r';
+		*ptr++ = '\n';
+	}
+
+	inline void borrow(char const * data, std::size_t length) {
+		*ptr++ = '$';
+		ptr = format_unsigned(ptr, length);
+		*ptr++ = '\r';
+		*ptr++ = '\n';
+		borrows.push_back(Borrow{static_cast<std::size_t>(ptr - base), data, length});
+		*ptr++ = '\r';
+		*ptr++ = '\n';
+	}
+
+	inline void null() {
+		std::memcpy(ptr, "$-1\r\n", 5u);
+		ptr += 5u;
+	}
+};
+
+
 // ----------------------------------------------------------------------------
 // API to apply protocol specifications to various types
 
 // map string to bulk string
-inline std::string protocolify(std::size_t& num, std::string const & value) {
-	++num;
-	return '$' + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+template <typename Sink>
+void protocolify(Sink& sink, StringView value) {
+	sink.bulk(value.data(), value.size());
+}
+
+// map char array to bulk string (up to its terminating zero, if any)
+template <typename Sink, std::size_t N>
+void protocolify(Sink& sink, char const (&value)[N]) {
+	auto end = static_cast<char const *>(std::memchr(value, '\0', N));
+	sink.bulk(value, (end == nullptr) ? N : static_cast<std::size_t>(end - value));
+}
+
+// map borrowed payload to bulk string (without copying it)
+template <typename Sink>
+void protocolify(Sink& sink, Borrowed const & value) {
+	sink.borrow(value.data(), value.size());
 }
 
 // map nullptr_t to null
-inline std::string protocolify(std::size_t& num, std::nullptr_t ptr) {
-	++num;
-	return "$-1\r\n";
+template <typename Sink>
+void protocolify(Sink& sink, std::nullptr_t ptr) {
+	sink.null();
+}
+
+// map integers to bulk string
+template <typename Sink, typename T>
+typename std::enable_if<std::is_integral<T>::value>::type
+protocolify(Sink& sink, T value) {
+	char tmp[max_integer_length];
+	auto end = format_integer(tmp, value);
+	sink.bulk(tmp, static_cast<std::size_t>(end - tmp));
 }
 
-// map numbers to bulk string
-template <typename T>
-typename std::enable_if<std::is_arithmetic<T>::value, std::string>::type
-protocolify(std::size_t& num, T value) {
-	auto tmp = std::to_string(value);
-	++num;
-	return '$' + std::to_string(tmp.size()) + "\r\n" + tmp + "\r\n";
+// map floating point numbers to bulk string
+template <typename Sink, typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type
+protocolify(Sink& sink, T value) {
+	char tmp[max_float_length];
+	auto end = format_float(tmp, value);
+	sink.bulk(tmp, static_cast<std::size_t>(end - tmp));
 }
 
-// map each set to bulk strings
-template <typename T>
-typename std::enable_if<is_set<T>::value, std::string>::type
-protocolify(std::size_t& num, T const & value) {
+// map each element of a set or sequence to bulk strings
+template <typename Sink, typename T>
+typename std::enable_if<is_set<T>::value || is_sequence<T>::value>::type
+protocolify(Sink& sink, T const & value) {
 	// <value0> <value1> ...
-	std::string buffer;
 	for (auto const & elem: value) {
-		// handle each item as simple string
-		auto const & tmp = stringify(elem);
-		buffer += '$' + std::to_string(tmp.size()) + "\r\n" + tmp + "\r\n";
+		protocolify(sink, elem);
 	}
-	num += value.size();
-	return buffer;
 }
 
 // map each map to bulk strings
-template <typename T>
-typename std::enable_if<is_map<T>::value, std::string>::type
-protocolify(std::size_t& num, T const & value) {
+template <typename Sink, typename T>
+typename std::enable_if<is_map<T>::value>::type
+protocolify(Sink& sink, T const & value) {
 	// <key0> <value0> <key1> <value1> ...
-	std::string buffer;
 	for (auto const & pair: value) {
-		// handle each key and value as simple strings
-		auto const & tmp_1 = stringify(pair.first);
-		auto const & tmp_2 = stringify(pair.second);
-		buffer += '$' + std::to_string(tmp_1.size()) + "\r\n" + tmp_1 + "\r\n"
-			+ '$' + std::to_string(tmp_2.size()) + "\r\n" + tmp_2 + "\r\n";
+		protocolify(sink, pair.first);
+		protocolify(sink, pair.second);
 	}
-	num += value.size() * 2u;
-	return buffer;
-}
-
-// map each sequence to bulk strings
-template <typename T>
-typename std::enable_if<is_sequence<T>::value, std::string>::type
-protocolify(std::size_t& num, T const & value) {
-	// <value0> <value1> ...
-	std::string buffer;
-	for (auto const & elem: value) {
-		// handle each item as simple string
-		auto const & tmp = stringify(elem);
-		buffer += '$' + std::to_string(tmp.size()) + "\r\n" + tmp + "\r\n";
-	}
-	num += value.size();
-	return buffer;
 }
 
 
@@ -116,11 +246,12 @@ struct Dump;
 template <typename Head, typename... Tail>
 struct Dump<Head, Tail...> {
 	
-	static inline void process(std::string& out, std::size_t& num, Head&& head, Tail&& ...tail) {
+	template <typename Sink>
+	static inline void process(Sink& sink, Head const & head, Tail const & ...tail) {
 		// push head to array
-		out += protocolify(num, std::forward<Head>(head));
+		protocolify(sink, head);
 		// process tail
-		Dump<Tail...>::process(out, num, std::forward<Tail>(tail)...);
+		Dump<Tail...>::process(sink, tail...);
 	}
 	
 };
@@ -129,20 +260,145 @@ struct Dump<Head, Tail...> {
 template <>
 struct Dump<> {
 	
-	static inline void process(std::string& out, std::size_t& num) {
+	template <typename Sink>
+	static inline void process(Sink& sink) {
 		// nothing left to append
 		return;
 	}
 	
 };
 
+// ----------------------------------------------------------------------------
+// API to encode fixed arguments at compile time
+
+// position after the digits starting at the given position
+constexpr std::size_t skip_digits(char const * data, std::size_t pos) {
+	return (data[pos] >= '0' && data[pos] <= '9') ? skip_digits(data, pos + 1u) : pos;
+}
+
+// value of the digits starting at the given position
+constexpr std::size_t parse_digits(char const * data, std::size_t pos, std::size_t value) {
+	return (data[pos] >= '0' && data[pos] <= '9')
+		? parse_digits(data, pos + 1u, value * 10u + static_cast<std::size_t>(data[pos] - '0'))
+		: value;
+}
+
+// position after the bulk string whose payload (of the given length) starts at the given position
+constexpr std::size_t bulk_end(char const * data, std::size_t size, std::size_t pos, std::size_t length) {
+	return (pos + length + 2u <= size && data[pos + length] == '\r' && data[pos + length + 1u] == '\n')
+		? pos + length + 2u
+		: throw std::logic_error{"Bulk string is shorter or longer than its length"};
+}
+
+// number of bulk strings between the given position and the end
+constexpr std::size_t count_bulks(char const * data, std::size_t size, std::size_t pos) {
+	return (pos == size) ? 0u
+		: (data[pos] == '$' && skip_digits(data, pos + 1u) > pos + 1u
+			&& data[skip_digits(data, pos + 1u)] == '\r' && data[skip_digits(data, pos + 1u) + 1u] == '\n')
+		? 1u + count_bulks(data, size, bulk_end(data, size, skip_digits(data, pos + 1u) + 2u,
+			parse_digits(data, pos + 1u, 0u)))
+		: throw std::logic_error{"Invalid bulk string header"};
+}
+
+/// Arguments that are encoded at compile time
+/**
+ *	A prefix consists of complete bulk strings (e.g. "$3\r\nGET\r\n"), which
+ *	are copied to a command instead of encoding them again. If a prefix is
+ *	constructed as a constant expression, its bulk strings are validated at
+ *	compile time: a malformed prefix does not compile. Use
+ *	`REDISXX_COMMAND_NAME` to write the bulk strings.
+ */
+struct Prefix {
+	char const * data;		// encoded bulk strings
+	std::size_t size;		// number of bytes
+	std::size_t num_bulks;	// number of bulk strings
+
+	constexpr Prefix()
+		: data{""}
+		, size{0u}
+		, num_bulks{0u} {
+	}
+
+	template <std::size_t N>
+	constexpr Prefix(char const (&data)[N])
+		: data{data}
+		, size{N - 1u}
+		, num_bulks{count_bulks(data, N - 1u, 0u)} {
+	}
+
+	/// Create a command starting with this prefix
+	/**
+	 *	Only the given arguments are encoded at runtime.
+	 *
+	 *	@param ...args Arguments following the prefix
+	 *	@return Command
+	 */
+	template <typename... Args>
+	Command operator()(Args const & ...args) const;
+};
+
+/// Append the given arguments as bulk strings
+/**
+ *	The exact size of the encoded arguments is determined first, so the
+ *	buffer grows at most once. Afterwards, the arguments are written to the
+ *	buffer without creating any temporary string.
+ *	Borrowed payloads are not written to the buffer, but recorded together
+ *	with their position inside the buffer.
+ *	If a prefix is given, its bulk strings are copied in front of the
+ *	arguments.
+ *
+ *	@param out Buffer to append to
+ *	@param num Number of bulk strings, which is increased
+ *	@param borrows Borrowed payloads, which are appended to
+ *	@param prefix Already encoded arguments
+ *	@param ...args Arguments to append
+ */
+template <typename String, typename Borrows, typename... Args>
+void dump_prefixed(String& out, std::size_t& num, Borrows& borrows, Prefix const & prefix,
+	Args const & ...args) {
+	SizeSink counter;
+	Dump<Args...>::process(counter, args...);
+	auto offset = out.size();
+	out.resize(offset + prefix.size + counter.size);
+	std::memcpy(&out[offset], prefix.data, prefix.size);
+	WriteSink<Borrows> writer{&out[offset + prefix.size], out.data(), borrows};
+	Dump<Args...>::process(writer, args...);
+	num += prefix.num_bulks + counter.num;
+}
+
+template <typename String, typename Borrows, typename... Args>
+void dump(String& out, std::size_t& num, Borrows& borrows, Args const & ...args) {
+	dump_prefixed(out, num, borrows, Prefix{}, args...);
+}
+
+// assume the arguments not to start with an allocator
+template <typename... Args>
+struct is_allocator_extended: std::false_type {
+};
+
+// assume arguments starting with `std::allocator_arg` to be followed by an allocator
+template <typename Head, typename... Tail>
+struct is_allocator_extended<Head, Tail...>: std::is_same<typename std::decay<Head>::type, std::allocator_arg_t> {
+};
+
+// assume the arguments not to be a single T
+template <typename T, typename... Args>
+struct is_single: std::false_type {
+};
+
+// assume a single argument of type T (of any value category) to be a single T
+template <typename T, typename Arg>
+struct is_single<T, Arg>: std::is_same<T, typename std::decay<Arg>::type> {
+};
+
 } // ::priv
 
 
 // ----------------------------------------------------------------------------
 
 /// CommandList
-class CommandList;
+template <typename Allocator>
+class BasicCommandList;
 
 /// Command
 /**
@@ -152,10 +408,22 @@ class CommandList;
  *	So "GET foo" as single argument will NOT work to GET the key "foo". Instead
  *	use two arguments "GET" and "foo.
  *	Different argument types are supported: primitive types (such as int, float
- *	and similar), std::string, std::vector<>, std::list<>, std::map<>,
+ *	and similar), std::string, redisxx::StringView, std::string_view (C++17),
+ *	C strings and char arrays, std::vector<>, std::list<>, std::map<>,
  *	std::unordered_map<>, std::set<>, std::unordered_set<>. Note that those
  *	containers can only contain primitive types or string. Nested types (e.g.
  *	a set of sequences) are NOT supported.
+ *	Arguments are encoded right away without copying them first: the exact
+ *	size of all arguments is determined before they are written to the
+ *	command's buffer, so adding any number of arguments at once allocates
+ *	at most once. Short commands (up to `priv::inline_command_size` bytes of
+ *	encoded arguments, e.g. "GET <key>") are stored inside the command
+ *	object, so they do not allocate at all. Large payloads can be borrowed
+ *	instead of being copied (see `redisxx::borrow()`).
+ *	The command's memory is provided by the given allocator. `redisxx::Command`
+ *	uses the heap, while `redisxx::ArenaCommand` uses an arena (see
+ *	`redisxx::Arena`), which is passed as `std::allocator_arg, arena` in front
+ *	of the arguments.
  *
  *	Example usage:
  *	@code
@@ -177,21 +445,78 @@ class CommandList;
  *		data["passwd"]	= "secret"
  *		cmd3 << "user:5" << data;
  *		// means: "HMSET user:5 name max passwd secret"
+ *
+ *		// using an arena
+ *		redisxx::Arena arena;
+ *		redisxx::ArenaCommand cmd4{std::allocator_arg, arena, "GET", "my_key"};
  *	@endcode
  */
-class Command {
+template <typename Allocator>
+class BasicCommand {
+	
+	template <typename OtherAllocator>
+	friend class BasicCommandList;
+	
+	template <typename OtherAllocator>
+	friend class BasicCommand;
 	
-	friend class CommandList;
+	friend struct priv::Prefix;
 	
-	template <typename T>
-	friend Command& operator<<(Command& cmd, T&& value);
+	template <typename OtherAllocator, typename T>
+	friend BasicCommand<OtherAllocator>& operator<<(BasicCommand<OtherAllocator>& cmd, T&& value);
 	
-	friend bool operator==(Command const & lhs, Command const & rhs);
-	friend bool operator!=(Command const & lhs, Command const & rhs);
+	template <typename OtherAllocator>
+	friend bool operator==(BasicCommand<OtherAllocator> const & lhs, BasicCommand<OtherAllocator> const & rhs);
+	
+	using String = priv::SmallBuffer<Allocator, priv::inline_command_size>;
+	using Borrows = std::vector<priv::Borrow,
+		typename std::allocator_traits<Allocator>::template rebind_alloc<priv::Borrow>>;
 	
 	private:
-		std::string buffer;		// preformatted bulk strings
+		String buffer;			// preformatted bulk strings
 		std::size_t num_bulks;	// number of bulk strings
+		Borrows borrows;		// payloads missing inside the buffer
+		
+		// size of the request (without array header)
+		inline std::size_t payloadSize() const {
+			auto size = buffer.size();
+			for (auto const & borrow: borrows) {
+				size += borrow.size;
+			}
+			return size;
+		}
+		
+		// append the request (without array header)
+		inline void appendPayload(std::string& out) const {
+			std::size_t offset = 0u;
+			for (auto const & borrow: borrows) {
+				out.append(buffer.data() + offset, borrow.position - offset);
+				out.append(borrow.data, borrow.size);
+				offset = borrow.position;
+			}
+			out.append(buffer.data() + offset, buffer.size() - offset);
+		}
+		
+		// append the array header
+		inline void appendHeader(priv::Segments& out) const {
+			char tmp[1u + priv::max_integer_length + 2u];
+			tmp[0] = '*';
+			auto end = priv::format_unsigned(tmp + 1, num_bulks);
+			*end++ = '\r';
+			*end++ = '\n';
+			out.append(tmp, static_cast<std::size_t>(end - tmp));
+		}
+		
+		// reference the request (without array header)
+		inline void gatherPayload(priv::Segments& out) const {
+			std::size_t offset = 0u;
+			for (auto const & borrow: borrows) {
+				out.borrow(buffer.data() + offset, borrow.position - offset);
+				out.borrow(borrow.data, borrow.size);
+				offset = borrow.position;
+			}
+			out.borrow(buffer.data() + offset, buffer.size() - offset);
+		}
 		
 	public:
 		/// Construct a new command
@@ -202,11 +527,43 @@ class Command {
 		 *
 		 *	@param ...args variadic list of arguments
 		 */
-		template <typename ...Args>
-		Command(Args&& ...args)
+		template <typename ...Args, typename = typename std::enable_if<
+			!priv::is_allocator_extended<Args...>::value && !priv::is_single<BasicCommand, Args...>::value>::type>
+		BasicCommand(Args&& ...args)
 			: buffer{}
-			, num_bulks{0} {
-			priv::Dump<Args...>::process(buffer, num_bulks, std::forward<Args>(args)...);
+			, num_bulks{0}
+			, borrows{} {
+			priv::dump(buffer, num_bulks, borrows, args...);
+		}
+		
+		/// Construct a new command using the given allocator
+		/**
+		 *	@param alloc Allocator providing the command's memory
+		 *	@param ...args variadic list of arguments
+		 */
+		template <typename ...Args>
+		BasicCommand(std::allocator_arg_t, Allocator const & alloc, Args&& ...args)
+			: buffer{alloc}
+			, num_bulks{0}
+			, borrows{alloc} {
+			priv::dump(buffer, num_bulks, borrows, args...);
+		}
+		
+		/// Copy a command using the given allocator
+		/**
+		 *	@param alloc Allocator providing the command's memory
+		 *	@param other Command to copy
+		 */
+		template <typename OtherAllocator>
+		BasicCommand(std::allocator_arg_t, Allocator const & alloc, BasicCommand<OtherAllocator> const & other)
+			: buffer{other.buffer.data(), other.buffer.size(), alloc}
+			, num_bulks{other.num_bulks}
+			, borrows{other.borrows.begin(), other.borrows.end(), alloc} {
+		}
+		
+		/// Return the allocator providing the command's memory
+		inline Allocator get_allocator() const {
+			return buffer.get_allocator();
 		}
 		
 		/// Return RESP-compliant request string
@@ -216,9 +573,108 @@ class Command {
 		 *	@return A ready-to-send request string
 		 */
 		inline std::string operator*() const {
-			return "*" + std::to_string(num_bulks) + "\r\n" + buffer;
+			std::string out;
+			out.reserve(1u + priv::num_digits(num_bulks) + 2u + payloadSize());
+			out += '*';
+			char tmp[priv::max_integer_length];
+			out.append(tmp, priv::format_unsigned(tmp, num_bulks));
+			out += "\r\n";
+			appendPayload(out);
+			return out;
 		}
 		
+		/// Reference the RESP-compliant request
+		/**
+		 *	This method appends the request to the given segments without
+		 *	copying it: the command's buffer and borrowed payloads are
+		 *	referenced, so they can be sent by a single vectored write. Only
+		 *	the array header is copied. The command is required to stay
+		 *	unchanged until the segments were written.
+		 *
+		 *	@param out Segments to append the request to
+		 */
+		inline void gather(priv::Segments& out) const {
+			appendHeader(out);
+			gatherPayload(out);
+		}
+
+		/// Return the number of arguments
+		inline std::size_t getNumArguments() const {
+			return num_bulks;
+		}
+
+		/// Return the given argument
+		/**
+		 *	The argument is read from the encoded bulk strings, so it is not
+		 *	copied. The first argument (at index zero) is the command's name.
+		 *	A null argument is returned as an empty string.
+		 *
+		 *	@param index Index of the argument
+		 *	@return View on the argument's payload
+		 *	@throw std::out_of_range if the command has fewer arguments
+		 */
+		StringView getArgument(std::size_t index) const {
+			if (index >= num_bulks) {
+				throw std::out_of_range{"Command has no argument #" + std::to_string(index)};
+			}
+			auto const data = buffer.data();
+			auto borrow = borrows.begin();
+			std::size_t offset = 0u;
+			for (std::size_t i = 0u; ; ++i) {
+				// "$<length>\r\n" OR "$-1\r\n"
+				++offset;
+				if (data[offset] == '-') {
+					if (i == index) {
+						return StringView{};
+					}
+					offset += 4u;
+					continue;
+				}
+				std::size_t length = 0u;
+				while (data[offset] != '\r') {
+					length = length * 10u + static_cast<std::size_t>(data[offset++] - '0');
+				}
+				offset += 2u;
+				auto const borrowed = (borrow != borrows.end() && borrow->position == offset);
+				if (i == index) {
+					return borrowed ? StringView{borrow->data, borrow->size} : StringView{data + offset, length};
+				}
+				if (borrowed) {
+					++borrow;
+				} else {
+					offset += length;
+				}
+				offset += 2u;
+			}
+		}
+
+		/// Copy borrowed payloads into the command
+		/**
+		 *	Afterwards, the command does not refer to any memory but its own.
+		 *	This is needed if the command is sent later on (e.g. if it is
+		 *	resent after a cluster redirect), when borrowed payloads may be
+		 *	gone already.
+		 */
+		void own() {
+			if (borrows.empty()) {
+				return;
+			}
+			String owned{get_allocator()};
+			owned.resize(payloadSize());
+			auto out = owned.data();
+			std::size_t offset = 0u;
+			for (auto const & borrow: borrows) {
+				std::memcpy(out, buffer.data() + offset, borrow.position - offset);
+				out += borrow.position - offset;
+				std::memcpy(out, borrow.data, borrow.size);
+				out += borrow.size;
+				offset = borrow.position;
+			}
+			std::memcpy(out, buffer.data() + offset, buffer.size() - offset);
+			buffer = std::move(owned);
+			borrows.clear();
+		}
+
 		/// Clear internal buffer
 		/**
 		 *	This method can be used to clear the internal command buffer. Note
@@ -227,6 +683,7 @@ class Command {
 		inline void clear() {
 			buffer.clear();
 			num_bulks = 0u;
+			borrows.clear();
 		}
 };
 
@@ -239,23 +696,27 @@ class Command {
  *	@param value Value to append to the command
  *	@param return The given command.
  */
-template <typename T>
-Command& operator<<(Command& cmd, T&& value) {
-	priv::Dump<T>::process(cmd.buffer, cmd.num_bulks, std::forward<T>(value));
+template <typename Allocator, typename T>
+BasicCommand<Allocator>& operator<<(BasicCommand<Allocator>& cmd, T&& value) {
+	priv::dump(cmd.buffer, cmd.num_bulks, cmd.borrows, value);
 	return cmd;
 }
 
 /// Check whether to commands equal
 /**
  *	Two commands equal if their buffers (and the number of bulk strings inside
- *	the buffers) equal.
+ *	the buffers) equal. Borrowed payloads are compared by their content.
  *
  *	@param lhs Left-hand-side command object
  *	@param rhs Right-hand-side command object
  *	@return True if both objects equal
  */
-inline bool operator==(Command const & lhs, Command const & rhs) {
-	return (lhs.buffer == rhs.buffer && lhs.num_bulks == rhs.num_bulks);
+template <typename Allocator>
+bool operator==(BasicCommand<Allocator> const & lhs, BasicCommand<Allocator> const & rhs) {
+	if (lhs.borrows.empty() && rhs.borrows.empty()) {
+		return (lhs.buffer == rhs.buffer && lhs.num_bulks == rhs.num_bulks);
+	}
+	return (lhs.num_bulks == rhs.num_bulks && *lhs == *rhs);
 }
 
 /// Check whether to commands do not equal
@@ -267,10 +728,22 @@ inline bool operator==(Command const & lhs, Command const & rhs) {
  *	@param rhs Right-hand-side command object
  *	@return True if both objects do not equal
  */
-inline bool operator!=(Command const & lhs, Command const & rhs) {
-	return (lhs.num_bulks != rhs.num_bulks || lhs.buffer != rhs.buffer);
+template <typename Allocator>
+bool operator!=(BasicCommand<Allocator> const & lhs, BasicCommand<Allocator> const & rhs) {
+	return !(lhs == rhs);
 }
 
+namespace priv {
+
+template <typename... Args>
+Command Prefix::operator()(Args const & ...args) const {
+	Command cmd;
+	dump_prefixed(cmd.buffer, cmd.num_bulks, cmd.borrows, *this, args...);
+	return cmd;
+}
+
+} // ::priv
+
 // ----------------------------------------------------------------------------
 
 /// Type of batch request used for a CommandList
@@ -282,12 +755,18 @@ enum class BatchType {
 /**
  *	A command list can be used to process multiple commands at once using
  *	pipelining or a transaction. This "batch type" can be modified during
- *	runtime.
+ *	runtime. In both cases, all commands are sent at once and their replies
+ *	are received as the elements of a single array reply.
  *	Only command objects can be appended to a command list. So the list can be
  *	used to produce a larger RESP-compliant request (either pipelined or using
  *	a transaction).
  *	A limited set of functionality is inherited from std::vector to allow more
  *	detailed access to the underlying container.
+ *	The list and its commands use the given allocator. Commands that are
+ *	appended are copied using the list's allocator, while `emplace_back()`
+ *	creates them in-place. So a `redisxx::ArenaCommandList` takes all of its
+ *	memory from an arena, which can be reused for the next list once the
+ *	list is destroyed (see `redisxx::Arena`).
  *
  *	Example usage:
  *	@code
@@ -302,13 +781,22 @@ enum class BatchType {
  *		redisxx::Command cmd{"PING"};
  *		list2 << cmd << cmd << cmd;
  *		list2.at(1) = redisxx::Command{"INFO"};
+ *
+ *		redisxx::Arena arena;
+ *		redisxx::ArenaCommandList list3{redisxx::BatchType::Pipeline, arena};
+ *		list3.emplace_back("INCR", "counter");
  *	@endcode
  */
-class CommandList: private std::vector<Command> {
+template <typename Allocator>
+class BasicCommandList: private std::vector<BasicCommand<Allocator>,
+	typename std::allocator_traits<Allocator>::template rebind_alloc<BasicCommand<Allocator>>> {
 
-	friend CommandList& operator<<(CommandList& list, Command const & cmd);
+	template <typename ListAllocator, typename CommandAllocator>
+	friend BasicCommandList<ListAllocator>& operator<<(BasicCommandList<ListAllocator>& list,
+		BasicCommand<CommandAllocator> const & cmd);
 
-	using Parent = std::vector<Command>;
+	using Parent = std::vector<BasicCommand<Allocator>,
+		typename std::allocator_traits<Allocator>::template rebind_alloc<BasicCommand<Allocator>>>;
 
 	private:
 		BatchType type;		// determines type of request batch
@@ -320,12 +808,31 @@ class CommandList: private std::vector<Command> {
 		 *	is optional. The default batch type is a transaction.
 		 *
 		 *	@param type BatchType to use for creating a request string
+		 *	@param alloc Allocator providing the memory of the list and its commands
 		 */
-		CommandList(BatchType type=BatchType::Transaction)
-			: Parent{}
+		BasicCommandList(BatchType type=BatchType::Transaction, Allocator const & alloc=Allocator{})
+			: Parent(alloc)
 			, type{type} {
 		}
 		
+		/// Return the allocator providing the list's memory
+		inline Allocator get_allocator() const {
+			return Allocator{Parent::get_allocator()};
+		}
+		
+		/// Create a command at the end of the list
+		/**
+		 *	The command is created using the list's allocator.
+		 *
+		 *	@param ...args Arguments of the command
+		 *	@return Created command
+		 */
+		template <typename... Args>
+		BasicCommand<Allocator>& emplace_back(Args&& ...args) {
+			Parent::emplace_back(std::allocator_arg, get_allocator(), std::forward<Args>(args)...);
+			return Parent::back();
+		}
+		
 		/// Returns current batch type
 		/**
 		 *	Returns whether the current batch type is pipelining or transaction.
@@ -349,45 +856,75 @@ class CommandList: private std::vector<Command> {
 		/// Return RESP-compliant request string
 		/**
 		 *	This method can be used to create a RESP-compliant request.
-		 *	Depending on the currently set batch type, this string will be a
-		 *	pipeline- or transaction-based request.
+		 *	Each command keeps its own framing, so the server replies to each
+		 *	command individually. Depending on the currently set batch type,
+		 *	the commands are pipelined or wrapped by MULTI and EXEC.
 		 *
 		 *	@return A ready-to-send request string
 		 */
-		inline std::string operator*() const {
+		std::string operator*() const {
+			static std::string const multi{"*1\r\n$5\r\nMULTI\r\n"};
+			static std::string const exec{"*1\r\n$4\r\nEXEC\r\n"};
+			// determine exact size of the batch
+			std::size_t size = 0u;
+			for (auto const & cmd: *this) {
+				// "*<num_bulks>\r\n<buffer>"
+				size += 1u + priv::num_digits(cmd.num_bulks) + 2u + cmd.payloadSize();
+			}
 			std::string out;
-			std::size_t num_bulks = 0u;
-			// start command batch
-			switch (type) {
-				case BatchType::Pipeline:
-					out = '*';
-					for (auto const & cmd: *this) {
-						num_bulks += cmd.num_bulks;
-					}
-					out += std::to_string(num_bulks) + "\r\n";
-					break;
-				
-				case BatchType::Transaction:
-					out = "$5\r\nMULTI\r\n";
-					break;
+			if (type == BatchType::Transaction) {
+				out.reserve(size + multi.size() + exec.size());
+				out = multi;
+			} else {
+				out.reserve(size);
 			}
 			// concatenate commands
+			char tmp[priv::max_integer_length];
 			for (auto const & cmd: *this) {
-				out += cmd.buffer;
+				out += '*';
+				out.append(tmp, priv::format_unsigned(tmp, cmd.num_bulks));
+				out += "\r\n";
+				cmd.appendPayload(out);
 			}
-			// finish command batch
-			switch (type) {
-				case BatchType::Pipeline:
-					// nothing to do
-					break;
-				
-				case BatchType::Transaction:
-					out += "$4\r\nEXEC\r\n";
-					break;
+			if (type == BatchType::Transaction) {
+				out += exec;
 			}
 			return out;
 		}
 		
+		/// Reference the RESP-compliant request
+		/**
+		 *	This method appends the request to the given segments without
+		 *	copying the commands (see `Command::gather()`). The command list
+		 *	is required to stay unchanged until the segments were written.
+		 *
+		 *	@param out Segments to append the request to
+		 */
+		void gather(priv::Segments& out) const {
+			static char const multi[] = "*1\r\n$5\r\nMULTI\r\n";
+			static char const exec[] = "*1\r\n$4\r\nEXEC\r\n";
+			if (type == BatchType::Transaction) {
+				out.borrow(multi, sizeof(multi) - 1u);
+			}
+			for (auto const & cmd: *this) {
+				cmd.gather(out);
+			}
+			if (type == BatchType::Transaction) {
+				out.borrow(exec, sizeof(exec) - 1u);
+			}
+		}
+		
+		/// Return number of replies to this request
+		/**
+		 *	The server replies to each command. A transaction also results in
+		 *	one reply to MULTI and one reply to EXEC.
+		 *
+		 *	@return Number of replies
+		 */
+		inline std::size_t getNumReplies() const {
+			return Parent::size() + ((type == BatchType::Transaction) ? 2u : 0u);
+		}
+		
 		// add some methods of std::vector to the public interface
 		using Parent::reserve;
 		using Parent::size;
@@ -401,16 +938,32 @@ class CommandList: private std::vector<Command> {
 /// Append another command to the list
 /**
  *	This method appends a command to the given command list without invalidating
- *	the RESP-compliance of the command list.
+ *	the RESP-compliance of the command list. The command is copied using the
+ *	list's allocator, so it may use another allocator than the list.
  *
  *	@param list CommandList to append the command to
  *	@param cmd Command to append to the list
  *	@param return The given command list.
  */
-inline CommandList& operator<<(CommandList& list, Command const & cmd) {
-	list.push_back(cmd);
+template <typename ListAllocator, typename CommandAllocator>
+BasicCommandList<ListAllocator>& operator<<(BasicCommandList<ListAllocator>& list,
+	BasicCommand<CommandAllocator> const & cmd) {
+	list.Parent::emplace_back(std::allocator_arg, list.get_allocator(), cmd);
 	return list;
 }
 
+/// CommandList using the heap
+using CommandList = BasicCommandList<std::allocator<char>>;
+
+/// Command using an arena
+using ArenaCommand = BasicCommand<ArenaAllocator<char>>;
+
+// commands are moved (rather than copied) while a command list grows
+static_assert(std::is_nothrow_move_constructible<Command>::value, "Command is required to be nothrow movable");
+static_assert(std::is_nothrow_move_constructible<ArenaCommand>::value, "ArenaCommand is required to be nothrow movable");
+
+/// CommandList using an arena
+using ArenaCommandList = BasicCommandList<ArenaAllocator<char>>;
+
 } // ::redisxx
 
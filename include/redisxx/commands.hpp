@@ -0,0 +1,371 @@
+/** @file commands.hpp
+ *
+ * RedisXX typed commands implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <redisxx/command.hpp>
+
+/// Encode a command name as bulk string literal
+/**
+ *	E.g. `REDISXX_COMMAND_NAME(3, "GET")` is "$3\r\nGET\r\n". A wrong length
+ *	is detected at compile time once the literal is used as constant
+ *	`redisxx::priv::Prefix`.
+ */
+#define REDISXX_COMMAND_NAME(length, name) "$" #length "\r\n" name "\r\n"
+
+namespace redisxx {
+
+/// Typed commands
+/**
+ *	Each function creates a `redisxx::Command` for the redis command of the
+ *	same name. The command's name is encoded at compile time, so only the
+ *	given arguments are encoded at runtime. Each function accepts exactly
+ *	the arguments of its command, so passing too few or too many arguments
+ *	does not compile. Commands that accept a variable number of arguments
+ *	(e.g. DEL) require at least one of them.
+ *	Arguments can be of any type supported by `redisxx::Command`. The
+ *	returned command can be extended (e.g. by optional arguments like EX),
+ *	used with a `redisxx::CommandList` or executed by a connection.
+ *
+ *	Example usage:
+ *	@code
+ *		auto reply = conn(redisxx::cmd::get("user:5"));
+ *
+ *		auto session = redisxx::cmd::set("session:5", token);
+ *		session << "EX" << 3600;
+ *		redisxx::CommandList list;
+ *		list << redisxx::cmd::hset("user:5", "name", "max") << session;
+ *	@endcode
+ */
+namespace cmd {
+
+// ----------------------------------------------------------------------------
+// Connection
+
+/// PING
+inline Command ping() {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "PING")};
+	return prefix();
+}
+
+/// ECHO message
+template <typename Message>
+Command echo(Message const & message) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "ECHO")};
+	return prefix(message);
+}
+
+// ----------------------------------------------------------------------------
+// Keys
+
+/// DEL key [key ...]
+template <typename Key, typename... Keys>
+Command del(Key const & key, Keys const & ...keys) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(3, "DEL")};
+	return prefix(key, keys...);
+}
+
+/// EXISTS key [key ...]
+template <typename Key, typename... Keys>
+Command exists(Key const & key, Keys const & ...keys) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "EXISTS")};
+	return prefix(key, keys...);
+}
+
+/// EXPIRE key seconds
+template <typename Key, typename Seconds>
+Command expire(Key const & key, Seconds const & seconds) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "EXPIRE")};
+	return prefix(key, seconds);
+}
+
+/// PEXPIRE key milliseconds
+template <typename Key, typename Milliseconds>
+Command pexpire(Key const & key, Milliseconds const & milliseconds) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(7, "PEXPIRE")};
+	return prefix(key, milliseconds);
+}
+
+/// PERSIST key
+template <typename Key>
+Command persist(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(7, "PERSIST")};
+	return prefix(key);
+}
+
+/// TTL key
+template <typename Key>
+Command ttl(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(3, "TTL")};
+	return prefix(key);
+}
+
+// ----------------------------------------------------------------------------
+// Strings
+
+/// GET key
+template <typename Key>
+Command get(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(3, "GET")};
+	return prefix(key);
+}
+
+/// SET key value
+template <typename Key, typename Value>
+Command set(Key const & key, Value const & value) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(3, "SET")};
+	return prefix(key, value);
+}
+
+/// SETEX key seconds value
+template <typename Key, typename Seconds, typename Value>
+Command setex(Key const & key, Seconds const & seconds, Value const & value) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(5, "SETEX")};
+	return prefix(key, seconds, value);
+}
+
+/// SETNX key value
+template <typename Key, typename Value>
+Command setnx(Key const & key, Value const & value) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(5, "SETNX")};
+	return prefix(key, value);
+}
+
+/// GETSET key value
+template <typename Key, typename Value>
+Command getset(Key const & key, Value const & value) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "GETSET")};
+	return prefix(key, value);
+}
+
+/// MGET key [key ...]
+template <typename Key, typename... Keys>
+Command mget(Key const & key, Keys const & ...keys) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "MGET")};
+	return prefix(key, keys...);
+}
+
+/// APPEND key value
+template <typename Key, typename Value>
+Command append(Key const & key, Value const & value) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "APPEND")};
+	return prefix(key, value);
+}
+
+/// STRLEN key
+template <typename Key>
+Command strlen(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "STRLEN")};
+	return prefix(key);
+}
+
+/// INCR key
+template <typename Key>
+Command incr(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "INCR")};
+	return prefix(key);
+}
+
+/// INCRBY key increment
+template <typename Key, typename Increment>
+Command incrby(Key const & key, Increment const & increment) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "INCRBY")};
+	return prefix(key, increment);
+}
+
+/// DECR key
+template <typename Key>
+Command decr(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "DECR")};
+	return prefix(key);
+}
+
+/// DECRBY key decrement
+template <typename Key, typename Decrement>
+Command decrby(Key const & key, Decrement const & decrement) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "DECRBY")};
+	return prefix(key, decrement);
+}
+
+// ----------------------------------------------------------------------------
+// Hashes
+
+/// HGET key field
+template <typename Key, typename Field>
+Command hget(Key const & key, Field const & field) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "HGET")};
+	return prefix(key, field);
+}
+
+/// HSET key field value
+template <typename Key, typename Field, typename Value>
+Command hset(Key const & key, Field const & field, Value const & value) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "HSET")};
+	return prefix(key, field, value);
+}
+
+/// HDEL key field [field ...]
+template <typename Key, typename Field, typename... Fields>
+Command hdel(Key const & key, Field const & field, Fields const & ...fields) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "HDEL")};
+	return prefix(key, field, fields...);
+}
+
+/// HEXISTS key field
+template <typename Key, typename Field>
+Command hexists(Key const & key, Field const & field) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(7, "HEXISTS")};
+	return prefix(key, field);
+}
+
+/// HGETALL key
+template <typename Key>
+Command hgetall(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(7, "HGETALL")};
+	return prefix(key);
+}
+
+/// HINCRBY key field increment
+template <typename Key, typename Field, typename Increment>
+Command hincrby(Key const & key, Field const & field, Increment const & increment) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(7, "HINCRBY")};
+	return prefix(key, field, increment);
+}
+
+// ----------------------------------------------------------------------------
+// Lists
+
+/// LPUSH key value [value ...]
+template <typename Key, typename Value, typename... Values>
+Command lpush(Key const & key, Value const & value, Values const & ...values) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(5, "LPUSH")};
+	return prefix(key, value, values...);
+}
+
+/// RPUSH key value [value ...]
+template <typename Key, typename Value, typename... Values>
+Command rpush(Key const & key, Value const & value, Values const & ...values) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(5, "RPUSH")};
+	return prefix(key, value, values...);
+}
+
+/// LPOP key
+template <typename Key>
+Command lpop(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "LPOP")};
+	return prefix(key);
+}
+
+/// RPOP key
+template <typename Key>
+Command rpop(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "RPOP")};
+	return prefix(key);
+}
+
+/// LLEN key
+template <typename Key>
+Command llen(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "LLEN")};
+	return prefix(key);
+}
+
+/// LRANGE key start stop
+template <typename Key, typename Start, typename Stop>
+Command lrange(Key const & key, Start const & start, Stop const & stop) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "LRANGE")};
+	return prefix(key, start, stop);
+}
+
+// ----------------------------------------------------------------------------
+// Sets
+
+/// SADD key member [member ...]
+template <typename Key, typename Member, typename... Members>
+Command sadd(Key const & key, Member const & member, Members const & ...members) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "SADD")};
+	return prefix(key, member, members...);
+}
+
+/// SREM key member [member ...]
+template <typename Key, typename Member, typename... Members>
+Command srem(Key const & key, Member const & member, Members const & ...members) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "SREM")};
+	return prefix(key, member, members...);
+}
+
+/// SISMEMBER key member
+template <typename Key, typename Member>
+Command sismember(Key const & key, Member const & member) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(9, "SISMEMBER")};
+	return prefix(key, member);
+}
+
+/// SMEMBERS key
+template <typename Key>
+Command smembers(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(8, "SMEMBERS")};
+	return prefix(key);
+}
+
+/// SCARD key
+template <typename Key>
+Command scard(Key const & key) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(5, "SCARD")};
+	return prefix(key);
+}
+
+// ----------------------------------------------------------------------------
+// Sorted sets
+
+/// ZADD key score member
+template <typename Key, typename Score, typename Member>
+Command zadd(Key const & key, Score const & score, Member const & member) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "ZADD")};
+	return prefix(key, score, member);
+}
+
+/// ZINCRBY key increment member
+template <typename Key, typename Increment, typename Member>
+Command zincrby(Key const & key, Increment const & increment, Member const & member) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(7, "ZINCRBY")};
+	return prefix(key, increment, member);
+}
+
+/// ZSCORE key member
+template <typename Key, typename Member>
+Command zscore(Key const & key, Member const & member) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "ZSCORE")};
+	return prefix(key, member);
+}
+
+/// ZREM key member [member ...]
+template <typename Key, typename Member, typename... Members>
+Command zrem(Key const & key, Member const & member, Members const & ...members) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(4, "ZREM")};
+	return prefix(key, member, members...);
+}
+
+/// ZRANGE key start stop
+template <typename Key, typename Start, typename Stop>
+Command zrange(Key const & key, Start const & start, Stop const & stop) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(6, "ZRANGE")};
+	return prefix(key, start, stop);
+}
+
+// ----------------------------------------------------------------------------
+// Pub/Sub
+
+/// PUBLISH channel message
+template <typename Channel, typename Message>
+Command publish(Channel const & channel, Message const & message) {
+	static constexpr priv::Prefix prefix{REDISXX_COMMAND_NAME(7, "PUBLISH")};
+	return prefix(channel, message);
+}
+
+} // ::cmd
+} // ::redisxx
@@ -8,23 +8,51 @@
  */
 #pragma once
 #include <string>
+#include <exception>
+#include <functional>
 #include <future>
+#include <memory>
+#include <stdexcept>
 
+#include <redisxx/command.hpp>
 #include <redisxx/socket.hpp>
-//#include <redisxx/reply.hpp>
+#include <redisxx/pool.hpp>
+#include <redisxx/reply.hpp>
+#include <redisxx/lazy_reply.hpp>
+#include <redisxx/pipeline.hpp>
+#include <redisxx/multiplexer.hpp>
 
 namespace redisxx {
 
-// tba: replace with actual reply implementation
-using Reply = std::string;
-
-
 /// Connection based on the given SocketImpl type
 /**
  *	This class manages all connections to the specified remote host or local
  *	stream using the given Socket implementation.
  *	The default socket implementation depends on which socket implementation
  *	is included.
+ *	Sockets are kept open and reused by subsequent requests. Copies of a
+ *	connection share the same sockets.
+ *	Requests are multiplexed onto up to as many sockets as the pool policy's
+ *	size allows. Each thread keeps using the socket it got with its first
+ *	request (as long as that one is not broken or closed for being idle), so
+ *	requests of the same thread are executed in the order of submission. A
+ *	thread gets the least loaded socket, another one is only opened if all
+ *	sockets have requests in flight.
+ *	Each request is written right away and its reply is received by an I/O
+ *	thread, which completes the request's future or calls its handler.
+ *	Handlers therefore run on the I/O thread and must not block (e.g. by
+ *	waiting for another reply). No thread is started per request. If the
+ *	socket implementation watches itself (`watch()` and `unwatch()`, e.g.
+ *	the io_uring sockets), it calls the reader once data was received. If it
+ *	supports asynchronous reads (e.g. the Boost.Asio sockets), replies are
+ *	received by the threads running its io_service. If it provides
+ *	`int native_handle()`, the socket is watched by an epoll-based event
+ *	loop shared by all connections (on Linux). Else, a reader thread is
+ *	dedicated to each socket. A handler may release the last copy of a
+ *	connection: requests that are still in flight are completed anyway.
+ *	If automatic pipelining is enabled, requests that are submitted at about
+ *	the same time (e.g. by multiple threads sharing this connection) are sent
+ *	as a single batch.
  */
 #if defined(REDISXX_UNIX_SOCKET)
 template <typename SocketImpl = BoostUnixSocket>
@@ -39,8 +67,40 @@ template <typename SocketImpl>
 #endif
 class Connection {
 	private:
-		std::string const host;
-		std::uint16_t const port;
+		std::shared_ptr<priv::SocketPool<SocketImpl>> pool;
+		std::shared_ptr<priv::AutoPipeline<SocketImpl>> pipeline;
+		std::shared_ptr<priv::Multiplexer<SocketImpl>> multiplexer;
+		
+		using Callback = std::function<void(std::exception_ptr, Reply)>;
+		
+		// policy of the multiplexer's pool, which leaves one socket to automatic pipelining
+		static PoolPolicy shared_policy(PoolPolicy policy, PipelinePolicy const & pipelining) {
+			if (pipelining.batch_size > 0u && policy.size > 0u) {
+				if (policy.size < 2u) {
+					throw std::invalid_argument{"Automatic pipelining requires a pool size of at least 2"};
+				}
+				--policy.size;
+			}
+			return policy;
+		}
+		
+		// submit the request, its reply (or error) is passed to the callback
+		template <typename Request>
+		void submit(Request const & request, Callback callback) {
+			auto layout = priv::layout_of(request);
+			if (layout.grouped && layout.num_replies == 0u) {
+				// an empty pipeline gets no reply to wait for
+				priv::invoke_callback(callback, nullptr, priv::join_replies({}));
+				return;
+			}
+			priv::Segments segments;
+			request.gather(segments);
+			if (pipeline != nullptr) {
+				pipeline->submit(segments, layout, std::move(callback));
+				return;
+			}
+			multiplexer->submit(segments, layout, std::move(callback));
+		}
 		
 	public:
 		/// Create a new connection to the given remote host or local stream
@@ -50,24 +110,56 @@ class Connection {
 		 *	implementation, the port is not used here. In this case the host
 		 *	parameter is used to describe which local stream should be used
 		 *	(e.g. by specifying its filename).
+		 *	No socket is opened here. Sockets are opened once they are needed
+		 *	and kept open according to the given pool policy.
+		 *	Automatic pipelining is disabled by default. If enabled, one of
+		 *	the pool's sockets is reserved for it, so lazy requests (which
+		 *	are never pipelined) use the others.
 		 *
 		 *	@param host remote host's name OR local stream's filename
-		 *	@param host remote host's port number OR not used
+		 *	@param port remote host's port number OR not used
+		 *	@param policy bounds of the socket pool (see above)
+		 *	@param pipelining batch size and time window of automatic pipelining
+		 *	@throw std::invalid_argument if pipelining is enabled, but the pool
+		 *		is limited to a single socket
 		 */
-		Connection(std::string const & host, std::uint16_t port=0u)
-			: host{host}
-			, port{port} {
+		Connection(std::string const & host, std::uint16_t port=0u, PoolPolicy const & policy=PoolPolicy{},
+			PipelinePolicy const & pipelining=PipelinePolicy{})
+			: pool{std::make_shared<priv::SocketPool<SocketImpl>>(host, port, shared_policy(policy, pipelining))}
+			, pipeline{}
+			, multiplexer{std::make_shared<priv::Multiplexer<SocketImpl>>(pool)} {
+			if (pipelining.batch_size > 0u) {
+				// the pipeline's socket is never taken by the multiplexer's channels (and vice versa)
+				PoolPolicy reserved{policy};
+				reserved.size = 1u;
+				pipeline = std::make_shared<priv::AutoPipeline<SocketImpl>>(
+					std::make_shared<priv::SocketPool<SocketImpl>>(host, port, reserved), pipelining);
+			}
 		}
 		
 		/// Execute the given request
 		/**
-		 *	This is used to execute the given request. The actual query is done
-		 *	asynchronously, so a `std::future<>` is returned. A request needs
-		 *	to be a `redisxx::Command` or `redisxx::CommandList` in order to
-		 *	guarantee, that the actual request is RESP-compliant.
+		 *	This is used to execute the given request. The request is written
+		 *	by the calling thread, but its reply is received asynchronously, so
+		 *	a `std::future<>` is returned. A request needs to be a
+		 *	`redisxx::Command` or `redisxx::CommandList` in order to guarantee,
+		 *	that the actual request is RESP-compliant.
 		 *	If the request needs to be synchronous, the returning future can
 		 *	be forced to block by using `get()` until the query is done.
-		 *	Each query will open, use and close the socket each time.
+		 *	All commands of a `redisxx::CommandList` are sent at once. The
+		 *	reply to a command list is an array, which contains the reply to
+		 *	each command in the order of the commands. An empty pipeline is
+		 *	not sent, its empty array is returned right away. For transactions,
+		 *	these are the results of EXEC (see `priv::unpack_transaction()`).
+		 *	If automatic pipelining is enabled, the request is queued and sent
+		 *	together with other requests. Else, it is written to the calling
+		 *	thread's socket, which is shared with other requests that are in
+		 *	flight. It is written right from the request's memory then
+		 *	(including borrowed payloads, see `redisxx::borrow()`), using a
+		 *	vectored write if the socket supports it.
+		 *	If the query failed, each request in flight on the same socket gets
+		 *	the exception. The socket is closed and replaced by a new one for
+		 *	the next query.
 		 *
 		 *	Example usage:
 		 *	@code
@@ -78,14 +170,89 @@ class Connection {
 		 *		// example 2: synchronous stream socket
 		 *		redisxx::Connection<MyStreamSocket> conn2{"/tmp/redis.sock"};
 		 *		auto sync_reply = conn2(redisxx::Command{"INFO"}).get();
+		 *		
+		 *		// example 3: pipelining
+		 *		redisxx::CommandList list{redisxx::BatchType::Pipeline};
+		 *		list << redisxx::Command{"INCR", "foo"} << redisxx::Command{"GET", "bar"};
+		 *		auto replies = conn2(list).get();
+		 *		// replies[0] is the reply to INCR, replies[1] the reply to GET
+		 *		
+		 *		// example 4: transaction
+		 *		list.setBatchType(redisxx::BatchType::Transaction);
+		 *		auto results = conn2(list).get();
+		 *		// results.isNull() if aborted, else one result per command
 		 *	@endcode
 		 */
 		template <typename Request>
 		std::future<Reply> operator()(Request const & request) {
-			auto string = *request;
-			return std::async(std::launch::async, [&, string]() {
-				return Reply{priv::execute_request<SocketImpl>(host, port, string)};
-			});
+			auto promise = std::make_shared<std::promise<Reply>>();
+			auto future = promise->get_future();
+			submit(request, priv::fulfil(promise));
+			return future;
+		}
+		
+		/// Execute the given request and pass its reply to the given handler
+		/**
+		 *	This works like `operator()`, but instead of completing a future,
+		 *	the handler is called with the reply (and a nullptr) or with the
+		 *	exception that failed the request (and an empty reply). So no
+		 *	shared state is allocated and no mutex or condition variable is
+		 *	involved in passing the reply on. Handlers capturing no more
+		 *	than a pointer or two are usually stored without allocating.
+		 *	The handler is called by the thread that received the reply (the
+		 *	I/O thread), so the reply can be processed right away. Handlers
+		 *	should not block, because no further replies are received
+		 *	meanwhile. Exceptions thrown by a handler are ignored, so they do
+		 *	not affect other requests. If no socket can be opened, the
+		 *	handler is called by the calling thread before this returns.
+		 *
+		 *	Example usage:
+		 *	@code
+		 *		conn.async(redisxx::Command{"GET", "foo"}, [](std::exception_ptr error, redisxx::Reply reply) {
+		 *			if (error == nullptr) {
+		 *				std::cout << reply.getString() << std::endl;
+		 *			}
+		 *		});
+		 *	@endcode
+		 *
+		 *	@param request Command or command list
+		 *	@param handler Callable as `void(std::exception_ptr, redisxx::Reply)`
+		 */
+		template <typename Request, typename Handler>
+		void async(Request const & request, Handler handler) {
+			submit(request, Callback{std::move(handler)});
+		}
+		
+		/// Execute the given request and decode its reply lazily
+		/**
+		 *	This works like `operator()`, but the reply's values are decoded
+		 *	once they are accessed. This is useful for huge array replies, of
+		 *	which only a few elements or just the number of elements is needed.
+		 *	Note that the replies to a transaction are not unpacked here, so
+		 *	the reply to MULTI, each QUEUED and the reply to EXEC are returned.
+		 *	Lazy requests are never pipelined automatically.
+		 *
+		 *	Example usage:
+		 *	@code
+		 *		auto reply = conn.lazy(redisxx::Command{"SMEMBERS", "huge"}).get();
+		 *		auto first = *reply.begin();
+		 *	@endcode
+		 */
+		template <typename Request>
+		std::future<LazyReply> lazy(Request const & request) {
+			auto promise = std::make_shared<std::promise<LazyReply>>();
+			auto future = promise->get_future();
+			auto layout = priv::layout_of(request);
+			if (layout.grouped && layout.num_replies == 0u) {
+				auto data = std::make_shared<priv::ReplyData>();
+				data->buffer = layout.header();
+				promise->set_value(LazyReply{std::move(data), 0u});
+				return future;
+			}
+			priv::Segments segments;
+			request.gather(segments);
+			multiplexer->submitLazy(segments, layout, priv::fulfil(promise));
+			return future;
 		}
 };
 
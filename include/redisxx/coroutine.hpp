@@ -0,0 +1,140 @@
+/** @file coroutine.hpp
+ *
+ * RedisXX C++20 coroutine support
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define REDISXX_COROUTINES 1
+#endif
+#endif
+
+#if defined(REDISXX_COROUTINES)
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#include <redisxx/connection.hpp>
+#include <redisxx/reply.hpp>
+
+namespace redisxx {
+
+/// Executor resuming coroutines right away
+/**
+ *	The coroutine continues on the thread that received the reply (e.g. the
+ *	event loop or a thread running the io_service). So it must not block,
+ *	because no further replies are received meanwhile.
+ */
+struct InlineExecutor {
+	void operator()(std::coroutine_handle<> handle) const {
+		handle.resume();
+	}
+};
+
+namespace priv {
+
+/// Awaitable reply to a request
+/**
+ *	The request is submitted once the coroutine suspends. The reply (or its
+ *	error) is stored in the awaitable, which lives in the coroutine frame, so
+ *	no shared state is allocated and no thread is blocked per request.
+ *	If the reply is received before the coroutine actually suspended (e.g. if
+ *	no socket could be opened), the coroutine does not suspend at all.
+ */
+template <typename SocketImpl, typename Request, typename Executor>
+class ReplyAwaitable {
+	private:
+		Connection<SocketImpl>& connection;
+		Request const & request;
+		Executor executor;
+		std::coroutine_handle<> handle;
+		std::exception_ptr error;
+		Reply reply;
+		std::atomic<bool> done;	// set by whichever of both sides comes first
+
+	public:
+		ReplyAwaitable(Connection<SocketImpl>& connection, Request const & request, Executor executor)
+			: connection{connection}
+			, request{request}
+			, executor{std::move(executor)}
+			, handle{}
+			, error{nullptr}
+			, reply{}
+			, done{false} {
+		}
+
+		bool await_ready() const noexcept {
+			return false;
+		}
+
+		bool await_suspend(std::coroutine_handle<> handle) {
+			this->handle = handle;
+			connection.async(request, [this](std::exception_ptr error, Reply reply) {
+				this->error = error;
+				this->reply = std::move(reply);
+				if (done.exchange(true, std::memory_order_acq_rel)) {
+					// the coroutine is suspended, the awaitable may be gone
+					// once it was resumed
+					auto resume = std::move(executor);
+					resume(this->handle);
+				}
+			});
+			// don't suspend if the reply is already there
+			return !done.exchange(true, std::memory_order_acq_rel);
+		}
+
+		Reply await_resume() {
+			if (error != nullptr) {
+				std::rethrow_exception(error);
+			}
+			return std::move(reply);
+		}
+};
+
+} // ::priv
+
+/// Await the reply to the given request
+/**
+ *	This works like the connection's `operator()`, but the calling coroutine
+ *	is suspended until the reply was received, instead of returning a future.
+ *	The request can be a `redisxx::Command` or a `redisxx::CommandList`. It
+ *	needs to be alive until the reply was received, which is the case for
+ *	temporaries in the `co_await` expression.
+ *	By default, the coroutine is resumed by the thread that received the
+ *	reply (see `InlineExecutor`). Another executor can be given in order to
+ *	resume it elsewhere, e.g. on a thread pool or the application's
+ *	reactor. It is called with the `std::coroutine_handle<>` to resume. If
+ *	the reply was received before the coroutine suspended, it just continues
+ *	on its current thread without calling the executor.
+ *	Errors are thrown by `co_await`.
+ *	Only available if compiled as C++20 (see `REDISXX_COROUTINES`).
+ *
+ *	Example usage:
+ *	@code
+ *		Task get_name(redisxx::Connection<redisxx::BoostTcpSocket>& conn) {
+ *			auto reply = co_await redisxx::await(conn, redisxx::Command{"GET", "name"});
+ *			// resume on the application's io_service
+ *			auto pong = co_await redisxx::await(conn, redisxx::Command{"PING"},
+ *				[&io](std::coroutine_handle<> h) { boost::asio::post(io, h); });
+ *		}
+ *	@endcode
+ *
+ *	@param connection Connection to submit the request to
+ *	@param request Command or command list
+ *	@param executor Callable resuming the coroutine
+ *	@return Awaitable yielding the reply
+ */
+template <typename SocketImpl, typename Request, typename Executor=InlineExecutor>
+priv::ReplyAwaitable<SocketImpl, Request, Executor> await(Connection<SocketImpl>& connection,
+	Request const & request, Executor executor=Executor{}) {
+	return {connection, request, std::move(executor)};
+}
+
+} // ::redisxx
+
+#endif
@@ -92,4 +92,37 @@ class ConnectionError: public std::runtime_error {
 		}
 };
 
+/// Exception for replies that violate the protocol
+/**
+ *	This exception is thrown if a reply received from the server is not
+ *	RESP-compliant. The connection that received such a reply cannot be used
+ *	any further.
+ */
+class ProtocolError: public std::runtime_error {
+	public:
+		/// Create a new error that was caused by a malformed reply
+		/**
+		 *	@param msg Detailed error message
+		 */
+		ProtocolError(std::string const & msg)
+			: std::runtime_error{msg} {
+		}
+};
+
+/// Exception for accessing a reply as the wrong type
+/**
+ *	This exception is thrown if a reply is accessed in a way that does not fit
+ *	its type, e.g. if the integer of a bulk string reply is queried.
+ */
+class TypeError: public std::runtime_error {
+	public:
+		/// Create a new error that was caused by accessing a reply
+		/**
+		 *	@param msg Detailed error message
+		 */
+		TypeError(std::string const & msg)
+			: std::runtime_error{msg} {
+		}
+};
+
 } // ::redisxx
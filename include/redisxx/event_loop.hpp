@@ -0,0 +1,206 @@
+/** @file event_loop.hpp
+ *
+ * RedisXX I/O event loop implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#define REDISXX_EPOLL 1
+#endif
+
+namespace redisxx {
+namespace priv {
+
+#if defined(REDISXX_EPOLL)
+
+/// Event loop waiting for readable sockets using epoll
+/**
+ *	A few I/O threads wait for any of the registered file descriptors to
+ *	become readable and call the handler of that descriptor. A descriptor is
+ *	reported to a single thread at a time (it is registered as one-shot and
+ *	re-armed after its handler returned), so a handler is never called
+ *	concurrently with itself, no matter how many threads the loop uses.
+ *	Handlers are expected to return quickly, because they block the thread
+ *	that called them.
+ *	Registrations are identified by a unique id rather than the descriptor,
+ *	so an event that was reported for a closed descriptor never reaches the
+ *	handler of a new socket that reuses the descriptor.
+ */
+class EventLoop {
+
+	using Handler = std::function<void()>;
+
+	private:
+		struct Entry {
+			int fd;
+			std::shared_ptr<Handler> handler;
+		};
+
+		int epoll_fd;
+		int wakeup_fd;
+		std::mutex mutex;
+		std::unordered_map<std::uint64_t, Entry> entries;
+		std::uint64_t next_id;		// 0 is used for the wakeup descriptor
+		std::vector<std::thread> threads;
+
+		void run() {
+			epoll_event events[64];
+			while (true) {
+				auto num_events = ::epoll_wait(epoll_fd, events, 64, -1);
+				if (num_events < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					return;
+				}
+				for (auto i = 0; i < num_events; ++i) {
+					auto id = events[i].data.u64;
+					if (id == 0u) {
+						// the wakeup descriptor is never reset, so each thread stops
+						return;
+					}
+					std::shared_ptr<Handler> handler;
+					{
+						std::lock_guard<std::mutex> lock{mutex};
+						auto it = entries.find(id);
+						if (it == entries.end()) {
+							continue;
+						}
+						handler = it->second.handler;
+					}
+					(*handler)();
+					// re-arm unless the handler was removed meanwhile
+					std::lock_guard<std::mutex> lock{mutex};
+					auto it = entries.find(id);
+					if (it != entries.end()) {
+						epoll_event event{};
+						event.events = EPOLLIN | EPOLLONESHOT;
+						event.data.u64 = id;
+						::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, it->second.fd, &event);
+					}
+				}
+			}
+		}
+
+	public:
+		/// Start an event loop
+		/**
+		 *	@throw std::system_error if epoll is not available
+		 *	@param num_threads Number of I/O threads
+		 */
+		EventLoop(std::size_t num_threads=1u)
+			: epoll_fd{::epoll_create1(EPOLL_CLOEXEC)}
+			, wakeup_fd{-1}
+			, mutex{}
+			, entries{}
+			, next_id{1u}
+			, threads{} {
+			if (epoll_fd < 0) {
+				throw std::system_error{errno, std::system_category(), "epoll_create1"};
+			}
+			wakeup_fd = ::eventfd(0u, EFD_CLOEXEC | EFD_NONBLOCK);
+			if (wakeup_fd < 0) {
+				auto error = errno;
+				::close(epoll_fd);
+				throw std::system_error{error, std::system_category(), "eventfd"};
+			}
+			epoll_event event{};
+			event.events = EPOLLIN;
+			event.data.u64 = 0u;
+			::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event);
+			threads.reserve(num_threads);
+			for (auto i = 0u; i < num_threads; ++i) {
+				threads.emplace_back(&EventLoop::run, this);
+			}
+		}
+
+		EventLoop(EventLoop const &) = delete;
+		EventLoop& operator=(EventLoop const &) = delete;
+
+		/// Stop the event loop
+		/**
+		 *	Handlers that are running are completed, but no further handler
+		 *	is called.
+		 */
+		~EventLoop() {
+			std::uint64_t one = 1u;
+			auto written = ::write(wakeup_fd, &one, sizeof one);
+			(void)written;
+			for (auto& thread: threads) {
+				thread.join();
+			}
+			::close(wakeup_fd);
+			::close(epoll_fd);
+		}
+
+		/// Call the given handler whenever the descriptor is readable
+		/**
+		 *	@throw std::system_error if the descriptor cannot be watched
+		 *	@param fd File descriptor to watch
+		 *	@param handler Function to call if the descriptor is readable
+		 *	@return Id of the registration
+		 */
+		std::uint64_t add(int fd, Handler handler) {
+			std::lock_guard<std::mutex> lock{mutex};
+			auto id = next_id++;
+			entries[id] = Entry{fd, std::make_shared<Handler>(std::move(handler))};
+			epoll_event event{};
+			event.events = EPOLLIN | EPOLLONESHOT;
+			event.data.u64 = id;
+			if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+				auto error = errno;
+				entries.erase(id);
+				throw std::system_error{error, std::system_category(), "epoll_ctl"};
+			}
+			return id;
+		}
+
+		/// Stop watching a descriptor
+		/**
+		 *	The handler is not called afterwards, unless it is running right
+		 *	now. This may be called by the handler itself.
+		 *
+		 *	@param id Id of the registration
+		 */
+		void remove(std::uint64_t id) {
+			std::lock_guard<std::mutex> lock{mutex};
+			auto it = entries.find(id);
+			if (it == entries.end()) {
+				return;
+			}
+			::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+			entries.erase(it);
+		}
+
+		/// Return the event loop shared by all connections
+		/**
+		 *	The loop is started once it is needed and uses a single thread.
+		 *
+		 *	@return Reference to the shared event loop
+		 */
+		static EventLoop& get() {
+			static EventLoop loop;
+			return loop;
+		}
+};
+
+#endif
+
+} // ::priv
+} // ::redisxx
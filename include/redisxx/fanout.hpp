@@ -0,0 +1,146 @@
+/** @file fanout.hpp
+ *
+ * RedisXX splitting of pipelines across multiple connections
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <redisxx/command.hpp>
+#include <redisxx/reply.hpp>
+
+namespace redisxx {
+namespace priv {
+
+/// Commands of a pipeline that are sent to the same target
+/**
+ *	@tparam Target Identifies the node or shard
+ */
+template <typename Target>
+struct Batch {
+	Target target;
+	CommandList list;
+	std::vector<std::size_t> positions;		// of the commands inside the pipeline
+
+	Batch(Target target)
+		: target{std::move(target)}
+		, list{BatchType::Pipeline}
+		, positions{} {
+	}
+};
+
+/// Split a pipeline into one pipeline per target
+/**
+ *	The commands are copied, keeping their order per target. Borrowed
+ *	payloads are still referenced.
+ *
+ *	@param list Pipeline to split
+ *	@param route Callable returning the target of a command
+ *	@return Batches in the order of their first commands
+ */
+template <typename Target, typename Allocator, typename Route>
+std::vector<std::shared_ptr<Batch<Target>>> split_pipeline(BasicCommandList<Allocator> const & list, Route route) {
+	std::vector<std::shared_ptr<Batch<Target>>> batches;
+	for (std::size_t i = 0u; i < list.size(); ++i) {
+		auto const & cmd = list.at(i);
+		Target target = route(cmd);
+		std::shared_ptr<Batch<Target>> batch;
+		for (auto const & other: batches) {
+			if (other->target == target) {
+				batch = other;
+				break;
+			}
+		}
+		if (batch == nullptr) {
+			batch = std::make_shared<Batch<Target>>(std::move(target));
+			batches.push_back(batch);
+		}
+		batch->list << cmd;
+		batch->positions.push_back(i);
+	}
+	return batches;
+}
+
+/// Replies to a pipeline that was split
+/**
+ *	Each reply is stored at its command's position. Once the last one was
+ *	set, the replies are joined and passed to the callback (see
+ *	`join_replies()`). If any command failed, the callback gets the first
+ *	error instead.
+ */
+class Fanout {
+	public:
+		using Callback = std::function<void(std::exception_ptr, Reply)>;
+
+	private:
+		std::vector<Reply> replies;
+		std::atomic<std::size_t> pending;	// number of missing replies
+		std::mutex mutex;
+		std::exception_ptr error;
+		Callback callback;
+
+	public:
+		Fanout(std::size_t num, Callback callback)
+			: replies(num)
+			, pending{num}
+			, mutex{}
+			, error{nullptr}
+			, callback{std::move(callback)} {
+		}
+
+		/// Set the reply (or error) of the command at the given position
+		void set(std::size_t pos, std::exception_ptr error, Reply reply) {
+			if (error != nullptr) {
+				std::lock_guard<std::mutex> lock{mutex};
+				if (this->error == nullptr) {
+					this->error = error;
+				}
+			} else {
+				replies[pos] = std::move(reply);
+			}
+			if (pending.fetch_sub(1u, std::memory_order_acq_rel) != 1u) {
+				return;
+			}
+			if (this->error != nullptr) {
+				callback(this->error, Reply{});
+			} else {
+				callback(nullptr, join_replies(replies));
+			}
+		}
+
+		/// Set the replies to a batch
+		/**
+		 *	@param positions Positions of the batch's commands
+		 *	@param error Error of the batch OR nullptr
+		 *	@param reply Array reply to the batch
+		 */
+		void set(std::vector<std::size_t> const & positions, std::exception_ptr error, Reply const & reply) {
+			for (std::size_t i = 0u; i < positions.size(); ++i) {
+				set(positions[i], error, (error == nullptr) ? reply[i] : Reply{});
+			}
+		}
+
+		/// Pass the reply to the unsplit pipeline on
+		/**
+		 *	If all commands were sent to the same target, their reply is
+		 *	passed on without joining it.
+		 *
+		 *	@param error Error of the pipeline OR nullptr
+		 *	@param reply Reply to the pipeline
+		 */
+		void bypass(std::exception_ptr error, Reply reply) {
+			callback(error, std::move(reply));
+		}
+};
+
+} // ::priv
+} // ::redisxx
@@ -0,0 +1,555 @@
+/** @file format.hpp
+ *
+ * RedisXX number formatting implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <clocale>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <charconv>
+#include <system_error>
+#endif
+
+namespace redisxx {
+namespace priv {
+
+// ----------------------------------------------------------------------------
+// API to format integers without allocating
+
+// decimal digits of all numbers below 100
+static char const digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// maximum number of characters of a formatted 64 bit integer (including the sign)
+static std::size_t const max_integer_length = 20u;
+
+// powers of ten that fit into 64 bits
+static std::uint64_t const powers_of_10[] = {
+	1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 1000000000u,
+	10000000000u, 100000000000u, 1000000000000u, 10000000000000u, 100000000000000u,
+	1000000000000000u, 10000000000000000u, 100000000000000000u, 1000000000000000000u,
+	10000000000000000000u
+};
+
+// number of leading zero bits of a non-zero value
+inline int count_leading_zeros(std::uint64_t value) {
+#if defined(__GNUC__)
+	return __builtin_clzll(value);
+#else
+	int num = 0;
+	while ((value & (std::uint64_t{1u} << 63)) == 0u) {
+		value <<= 1;
+		++num;
+	}
+	return num;
+#endif
+}
+
+// number of decimal digits of the given value
+inline std::size_t num_digits(std::uint64_t value) {
+	// estimate log10 from log2 (1233 / 4096 is about log10(2)), which is off by at most one
+	auto const log2 = 63 - count_leading_zeros(value | 1u);
+	auto const num = static_cast<std::size_t>((log2 * 1233) >> 12) + 1u;
+	return num + static_cast<std::size_t>(num < 20u && value >= powers_of_10[num]);
+}
+
+// write the decimal digits of the given value and return the end of them
+inline char* format_unsigned(char* out, std::uint64_t value) {
+	auto end = out + num_digits(value);
+	auto ptr = end;
+	// write two digits per division, starting with the last ones
+	while (value >= 100u) {
+		auto pos = static_cast<std::size_t>(value % 100u) * 2u;
+		value /= 100u;
+		*--ptr = digit_pairs[pos + 1u];
+		*--ptr = digit_pairs[pos];
+	}
+	if (value >= 10u) {
+		auto pos = static_cast<std::size_t>(value) * 2u;
+		*--ptr = digit_pairs[pos + 1u];
+		*--ptr = digit_pairs[pos];
+	} else {
+		*--ptr = static_cast<char>('0' + value);
+	}
+	return end;
+}
+
+// write the decimal digits (and sign) of the given value and return the end of them
+template <typename T>
+typename std::enable_if<std::is_signed<T>::value, char*>::type
+format_integer(char* out, T value) {
+	if (value < 0) {
+		*out++ = '-';
+		// negate as unsigned, so the minimum value does not overflow
+		return format_unsigned(out, 0u - static_cast<std::uint64_t>(value));
+	}
+	return format_unsigned(out, static_cast<std::uint64_t>(value));
+}
+
+template <typename T>
+typename std::enable_if<std::is_unsigned<T>::value, char*>::type
+format_integer(char* out, T value) {
+	return format_unsigned(out, static_cast<std::uint64_t>(value));
+}
+
+
+// ----------------------------------------------------------------------------
+// API to format floating point numbers without allocating
+
+// maximum number of characters of a formatted floating point number
+static std::size_t const max_float_length = 32u;
+
+// number f * 2^e with a 64 bit significand (see Grisu2 below)
+struct DiyFp {
+	std::uint64_t f;
+	int e;
+};
+
+// product of two numbers, whose significand is rounded to the upper 64 bits
+inline DiyFp multiply(DiyFp x, DiyFp y) {
+	std::uint64_t const mask = 0xFFFFFFFFu;
+	auto const a = x.f >> 32, b = x.f & mask, c = y.f >> 32, d = y.f & mask;
+	auto const ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	auto const mid = (bd >> 32) + (ad & mask) + (bc & mask) + (std::uint64_t{1u} << 31);
+	return DiyFp{ac + (ad >> 32) + (bc >> 32) + (mid >> 32), x.e + y.e + 64};
+}
+
+// shift the significand until its highest bit is set
+inline DiyFp normalize(DiyFp x) {
+	auto const shift = count_leading_zeros(x.f);
+	return DiyFp{x.f << shift, x.e - shift};
+}
+
+// significand and exponent of a finite, positive number
+inline DiyFp decompose(double value, std::uint64_t& hidden_bit) {
+	std::uint64_t bits;
+	std::memcpy(&bits, &value, sizeof bits);
+	hidden_bit = std::uint64_t{1u} << 52;
+	auto const fraction = bits & (hidden_bit - 1u);
+	auto const biased = static_cast<int>(bits >> 52) & 0x7FF;
+	return (biased == 0) ? DiyFp{fraction, 1 - 1075} : DiyFp{fraction | hidden_bit, biased - 1075};
+}
+
+inline DiyFp decompose(float value, std::uint64_t& hidden_bit) {
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, sizeof bits);
+	hidden_bit = std::uint64_t{1u} << 23;
+	auto const fraction = bits & (hidden_bit - 1u);
+	auto const biased = static_cast<int>(bits >> 23) & 0xFF;
+	return (biased == 0) ? DiyFp{fraction, 1 - 150} : DiyFp{fraction | hidden_bit, biased - 150};
+}
+
+// normalized powers 10^k for k = -348, -340, ..., 340 (significands rounded to nearest)
+static std::uint64_t const cached_powers_f[] = {
+	0xfa8fd5a0081c0288u, 0xbaaee17fa23ebf76u, 0x8b16fb203055ac76u, 0xcf42894a5dce35eau,
+	0x9a6bb0aa55653b2du, 0xe61acf033d1a45dfu, 0xab70fe17c79ac6cau, 0xff77b1fcbebcdc4fu,
+	0xbe5691ef416bd60cu, 0x8dd01fad907ffc3cu, 0xd3515c2831559a83u, 0x9d71ac8fada6c9b5u,
+	0xea9c227723ee8bcbu, 0xaecc49914078536du, 0x823c12795db6ce57u, 0xc21094364dfb5637u,
+	0x9096ea6f3848984fu, 0xd77485cb25823ac7u, 0xa086cfcd97bf97f4u, 0xef340a98172aace5u,
+	0xb23867fb2a35b28eu, 0x84c8d4dfd2c63f3bu, 0xc5dd44271ad3cdbau, 0x936b9fcebb25c996u,
+	0xdbac6c247d62a584u, 0xa3ab66580d5fdaf6u, 0xf3e2f893dec3f126u, 0xb5b5ada8aaff80b8u,
+	0x87625f056c7c4a8bu, 0xc9bcff6034c13053u, 0x964e858c91ba2655u, 0xdff9772470297ebdu,
+	0xa6dfbd9fb8e5b88fu, 0xf8a95fcf88747d94u, 0xb94470938fa89bcfu, 0x8a08f0f8bf0f156bu,
+	0xcdb02555653131b6u, 0x993fe2c6d07b7facu, 0xe45c10c42a2b3b06u, 0xaa242499697392d3u,
+	0xfd87b5f28300ca0eu, 0xbce5086492111aebu, 0x8cbccc096f5088ccu, 0xd1b71758e219652cu,
+	0x9c40000000000000u, 0xe8d4a51000000000u, 0xad78ebc5ac620000u, 0x813f3978f8940984u,
+	0xc097ce7bc90715b3u, 0x8f7e32ce7bea5c70u, 0xd5d238a4abe98068u, 0x9f4f2726179a2245u,
+	0xed63a231d4c4fb27u, 0xb0de65388cc8ada8u, 0x83c7088e1aab65dbu, 0xc45d1df942711d9au,
+	0x924d692ca61be758u, 0xda01ee641a708deau, 0xa26da3999aef774au, 0xf209787bb47d6b85u,
+	0xb454e4a179dd1877u, 0x865b86925b9bc5c2u, 0xc83553c5c8965d3du, 0x952ab45cfa97a0b3u,
+	0xde469fbd99a05fe3u, 0xa59bc234db398c25u, 0xf6c69a72a3989f5cu, 0xb7dcbf5354e9beceu,
+	0x88fcf317f22241e2u, 0xcc20ce9bd35c78a5u, 0x98165af37b2153dfu, 0xe2a0b5dc971f303au,
+	0xa8d9d1535ce3b396u, 0xfb9b7cd9a4a7443cu, 0xbb764c4ca7a44410u, 0x8bab8eefb6409c1au,
+	0xd01fef10a657842cu, 0x9b10a4e5e9913129u, 0xe7109bfba19c0c9du, 0xac2820d9623bf429u,
+	0x80444b5e7aa7cf85u, 0xbf21e44003acdd2du, 0x8e679c2f5e44ff8fu, 0xd433179d9c8cb841u,
+	0x9e19db92b4e31ba9u, 0xeb96bf6ebadf77d9u, 0xaf87023b9bf0ee6bu
+};
+
+static std::int16_t const cached_powers_e[] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+	-901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+	-582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+	-263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+	56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+	694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+	1013, 1039, 1066
+};
+
+// cached power whose product with a number of the given exponent has an exponent in [-60, -32]
+inline DiyFp cached_power(int e, int& k) {
+	// ceil((-61 - e) * log10(2)) + 347 is positive, so ceil is done by hand
+	auto const dk = (-61 - e) * 0.30102999566398114 + 347;
+	auto ik = static_cast<int>(dk);
+	if (dk - ik > 0.0) {
+		++ik;
+	}
+	auto const index = static_cast<std::size_t>((ik >> 3) + 1);
+	// the number is multiplied with 10^-k
+	k = 348 - static_cast<int>(index << 3);
+	return DiyFp{cached_powers_f[index], cached_powers_e[index]};
+}
+
+// move the last digit towards the exact value, as long as it stays within the boundaries
+inline void grisu_round(char* digits, int length, std::uint64_t delta, std::uint64_t rest,
+	std::uint64_t ten_kappa, std::uint64_t distance) {
+	while (rest < distance && delta - rest >= ten_kappa
+		&& (rest + ten_kappa < distance || distance - rest > rest + ten_kappa - distance)) {
+		--digits[length - 1];
+		rest += ten_kappa;
+	}
+}
+
+// generate the shortest digits within [upper - delta, upper], which are closest to w
+inline int grisu_digits(DiyFp w, DiyFp upper, std::uint64_t delta, char* digits, int& k) {
+	auto const shift = -upper.e;
+	auto const one = std::uint64_t{1u} << shift;
+	auto const distance = upper.f - w.f;
+	auto integral = static_cast<std::uint32_t>(upper.f >> shift);
+	auto fractional = upper.f & (one - 1u);
+	auto kappa = static_cast<int>(num_digits(integral));
+	int length = 0;
+	while (kappa > 0) {
+		auto const power = static_cast<std::uint32_t>(powers_of_10[kappa - 1]);
+		auto const digit = integral / power;
+		integral %= power;
+		if (digit != 0u || length > 0) {
+			digits[length++] = static_cast<char>('0' + digit);
+		}
+		--kappa;
+		auto const rest = (static_cast<std::uint64_t>(integral) << shift) + fractional;
+		if (rest <= delta) {
+			k += kappa;
+			grisu_round(digits, length, delta, rest, powers_of_10[kappa] << shift, distance);
+			return length;
+		}
+	}
+	while (true) {
+		fractional *= 10u;
+		delta *= 10u;
+		auto const digit = static_cast<char>(fractional >> shift);
+		if (digit != 0 || length > 0) {
+			digits[length++] = static_cast<char>('0' + digit);
+		}
+		fractional &= one - 1u;
+		--kappa;
+		if (fractional < delta) {
+			k += kappa;
+			grisu_round(digits, length, delta, fractional, one, (-kappa < 20) ? distance * powers_of_10[-kappa] : 0u);
+			return length;
+		}
+	}
+}
+
+/// Find the shortest digits of a floating point number using Grisu2
+/**
+ *	This implements Florian Loitsch's Grisu2 (as described in "Printing
+ *	Floating-Point Numbers Quickly and Accurately with Integers"): the digits
+ *	are generated using 64 bit integer arithmetic only. They always read
+ *	back as exactly the same value. In rare cases (e.g. for 1e23), they are
+ *	one digit longer than the shortest representation or their last digit
+ *	is not the closest one.
+ *
+ *	@param value Finite, positive number
+ *	@param digits Output for up to 20 digits
+ *	@param k Set to the exponent, so the number is digits * 10^k
+ *	@return Number of digits
+ */
+template <typename T>
+int grisu2(T value, char* digits, int& k) {
+	std::uint64_t hidden_bit;
+	auto const v = decompose(value, hidden_bit);
+	// boundaries of the numbers that read back as the value
+	auto const plus = normalize(DiyFp{(v.f << 1) + 1u, v.e - 1});
+	auto minus = (v.f == hidden_bit) ? DiyFp{(v.f << 2) - 1u, v.e - 2} : DiyFp{(v.f << 1) - 1u, v.e - 1};
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+	auto const power = cached_power(plus.e, k);
+	auto const w = multiply(normalize(v), power);
+	auto upper = multiply(plus, power);
+	auto lower = multiply(minus, power);
+	// stay inside the boundaries despite the rounding errors of the products
+	++lower.f;
+	--upper.f;
+	return grisu_digits(w, upper, upper.f - lower.f, digits, k);
+}
+
+/// Write the digits * 10^k like `std::to_chars` does
+/**
+ *	The number is written in fixed notation (e.g. "0.001" or "123.5") or in
+ *	scientific notation (e.g. "1e-05" or "1.25e+20"), whichever is shorter.
+ *	If both are equally long, fixed notation is used.
+ *
+ *	@param out Position to write to
+ *	@param digits Significant digits
+ *	@param length Number of digits
+ *	@param k Exponent of the last digit
+ *	@return End of the written number
+ */
+inline char* format_digits(char* out, char const * digits, int length, int k) {
+	auto const exponent = k + length - 1;
+	auto const magnitude = (exponent < 0) ? -exponent : exponent;
+	auto const scientific = length + (length > 1 ? 1 : 0) + (magnitude >= 100 ? 5 : 4);
+	auto const fixed = (k >= 0) ? length + k : (exponent >= 0) ? length + 1 : length + 1 - exponent;
+	auto const num = static_cast<std::size_t>(length);
+	if (fixed <= scientific) {
+		if (k >= 0) {
+			// e.g. "12300"
+			std::memcpy(out, digits, num);
+			std::memset(out + num, '0', static_cast<std::size_t>(k));
+			return out + fixed;
+		}
+		if (exponent >= 0) {
+			// e.g. "12.3"
+			auto const whole = static_cast<std::size_t>(exponent + 1);
+			std::memcpy(out, digits, whole);
+			out[whole] = '.';
+			std::memcpy(out + whole + 1u, digits + whole, num - whole);
+			return out + fixed;
+		}
+		// e.g. "0.0123"
+		auto const zeros = static_cast<std::size_t>(-exponent - 1);
+		out[0] = '0';
+		out[1] = '.';
+		std::memset(out + 2, '0', zeros);
+		std::memcpy(out + 2u + zeros, digits, num);
+		return out + fixed;
+	}
+	*out++ = digits[0];
+	if (length > 1) {
+		*out++ = '.';
+		std::memcpy(out, digits + 1, num - 1u);
+		out += num - 1u;
+	}
+	*out++ = 'e';
+	*out++ = (exponent < 0) ? '-' : '+';
+	if (magnitude >= 100) {
+		*out++ = static_cast<char>('0' + magnitude / 100);
+	}
+	auto const pos = static_cast<std::size_t>(magnitude % 100) * 2u;
+	*out++ = digit_pairs[pos];
+	*out++ = digit_pairs[pos + 1u];
+	return out;
+}
+
+// write a finite, non-zero number using the digits found by Grisu2
+inline char* format_shortest(char* out, double value) {
+	if (value < 0) {
+		*out++ = '-';
+		value = -value;
+	}
+	char digits[20];
+	int k = 0;
+	auto const length = grisu2(value, digits, k);
+	return format_digits(out, digits, length, k);
+}
+
+inline char* format_shortest(char* out, float value) {
+	if (value < 0) {
+		*out++ = '-';
+		value = -value;
+	}
+	char digits[20];
+	int k = 0;
+	auto const length = grisu2(value, digits, k);
+	return format_digits(out, digits, length, k);
+}
+
+inline char* format_shortest(char* out, long double value) {
+	// Grisu2 needs a significand of less than 64 bits, so the precision is raised until the number reads back
+	int length = 0;
+	for (auto precision = std::numeric_limits<long double>::digits10; precision <= std::numeric_limits<long double>::max_digits10; ++precision) {
+		length = std::snprintf(out, max_float_length, "%.*Lg", precision, value);
+		if (std::strtold(out, nullptr) == value) {
+			break;
+		}
+	}
+	// use '.' even if the locale does not
+	auto point = *std::localeconv()->decimal_point;
+	if (point != '.') {
+		auto pos = static_cast<char*>(std::memchr(out, point, static_cast<std::size_t>(length)));
+		if (pos != nullptr) {
+			*pos = '.';
+		}
+	}
+	return out + length;
+}
+
+// read a number as the given type
+inline float parse_float(char const * str, float, char** end=nullptr) {
+	return std::strtof(str, end);
+}
+
+inline double parse_float(char const * str, double, char** end=nullptr) {
+	return std::strtod(str, end);
+}
+
+inline long double parse_float(char const * str, long double, char** end=nullptr) {
+	return std::strtold(str, end);
+}
+
+/// Write a floating point number so it reads back as the same value
+/**
+ *	The written number has few significant digits while it still reads back
+ *	as exactly the same value (e.g. 0.1 is written as "0.1", not as
+ *	"0.100000" or "0.10000000000000001"). The decimal point is always a
+ *	'.', no matter which locale is used. Infinite values are written as
+ *	"inf" or "-inf", which is understood by redis (e.g. for ZADD scores).
+ *	Whole numbers that fit into 53 bits are written as integers (e.g. 1e6 as
+ *	"1000000"). Else, the digits are found by Grisu2 (see `grisu2()`) and
+ *	the number is written in fixed or in scientific notation, whichever is
+ *	shorter (e.g. "0.001", "1e-05" or "1e+20"). Grisu2 is used under every
+ *	standard, even if `std::to_chars` is available, so the same bytes are
+ *	written no matter how the caller was compiled (e.g. keys containing
+ *	numbers map to the same shard). In rare cases, one more digit than
+ *	needed is written (e.g. "9.999999999999999e+22" for 1e23).
+ *	The output is required to provide `max_float_length` bytes.
+ *
+ *	@param out Position to write to
+ *	@param value Number to write
+ *	@return End of the written number
+ */
+template <typename T>
+char* format_float(char* out, T value) {
+	static_assert(std::is_floating_point<T>::value, "Only floating point numbers are supported");
+	if (std::isnan(value)) {
+		std::memcpy(out, "nan", 3u);
+		return out + 3;
+	}
+	if (std::isinf(value)) {
+		if (value < 0) {
+			*out++ = '-';
+		}
+		std::memcpy(out, "inf", 3u);
+		return out + 3;
+	}
+	// whole numbers (e.g. counters or timestamps) are written as integers
+	if (std::fabs(value) < T{9007199254740992.0} && std::trunc(value) == value) {
+		if (value == 0 && std::signbit(value)) {
+			std::memcpy(out, "-0", 2u);
+			return out + 2;
+		}
+		return format_integer(out, static_cast<std::int64_t>(value));
+	}
+	return format_shortest(out, value);
+}
+
+
+// ----------------------------------------------------------------------------
+// API to parse numbers in place
+
+/// Parse the decimal integer stored in the given range
+/**
+ *	The range needs to contain exactly the digits (and an optional leading
+ *	'-'), as used by RESP integers and numeric bulk strings. Values that do
+ *	not fit into the given type are rejected.
+ *
+ *	@param first Begin of the number
+ *	@param last End of the number
+ *	@param value Number to write the result to
+ *	@return False if the range is no valid number of that type
+ */
+template <typename T>
+bool parse_integer(char const * first, char const * last, T& value) {
+	static_assert(std::is_integral<T>::value, "Only integers are supported");
+	bool negative = (first != last && *first == '-');
+	if (negative) {
+		if (!std::is_signed<T>::value) {
+			return false;
+		}
+		++first;
+	}
+	if (first == last) {
+		return false;
+	}
+	// accumulate as unsigned, so the minimum value does not overflow
+	std::uint64_t limit = static_cast<std::uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1u : 0u);
+	std::uint64_t result = 0u;
+	for (; first != last; ++first) {
+		auto digit = static_cast<unsigned>(*first - '0');
+		if (digit > 9u || result > (limit - digit) / 10u) {
+			return false;
+		}
+		result = result * 10u + digit;
+	}
+	value = negative ? static_cast<T>(0u - result) : static_cast<T>(result);
+	return true;
+}
+
+/// Parse the floating point number stored in the given range
+/**
+ *	The decimal point is a '.', no matter which locale is used. "inf" and
+ *	"-inf" (as written by redis, e.g. for scores) are understood.
+ *	If compiled as C++17, `std::from_chars` is used. Else, the number is
+ *	copied to the stack (unless it is unusually long) for `strtod()`.
+ *
+ *	@param first Begin of the number
+ *	@param last End of the number
+ *	@param value Number to write the result to
+ *	@return False if the range is no valid number
+ */
+template <typename T>
+bool parse_number(char const * first, char const * last, T& value) {
+	static_assert(std::is_floating_point<T>::value, "Only floating point numbers are supported");
+	if (first == last) {
+		return false;
+	}
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	// from_chars does not accept a leading '+'
+	if (*first == '+') {
+		++first;
+	}
+	auto result = std::from_chars(first, last, value);
+	return result.ec == std::errc{} && result.ptr == last;
+#else
+	auto length = static_cast<std::size_t>(last - first);
+	char local[max_float_length + 1u];
+	std::unique_ptr<char[]> heap;
+	auto str = local;
+	if (length > max_float_length) {
+		heap.reset(new char[length + 1u]);
+		str = heap.get();
+	}
+	std::memcpy(str, first, length);
+	str[length] = '\0';
+	// use the locale's decimal point, which is expected by strtod
+	auto point = *std::localeconv()->decimal_point;
+	if (point != '.') {
+		auto pos = static_cast<char*>(std::memchr(str, '.', length));
+		if (pos != nullptr) {
+			*pos = point;
+		}
+	}
+	char* end;
+	auto result = parse_float(str, T{}, &end);
+	if (end != str + length) {
+		return false;
+	}
+	value = result;
+	return true;
+#endif
+}
+
+} // ::priv
+} // ::redisxx
@@ -0,0 +1,944 @@
+/** @file io_uring.hpp
+ *
+ * RedisXX io_uring I/O engine implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define REDISXX_IO_URING 1
+#endif
+#endif
+
+#if defined(REDISXX_IO_URING)
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <redisxx/segments.hpp>
+
+namespace redisxx {
+namespace priv {
+
+/// Submission and completion queues shared with the kernel
+/**
+ *	Thin wrapper around the io_uring system calls, so liburing is not
+ *	required. Preparing submissions is not thread-safe, but any thread may
+ *	enter the ring at any time. Completions are expected to be reaped by a
+ *	single thread.
+ */
+class IoUring {
+	private:
+		int fd;
+		unsigned features;
+		void* sq_ring;
+		std::size_t sq_ring_size;
+		void* cq_ring;
+		std::size_t cq_ring_size;
+		io_uring_sqe* sqes;
+		std::size_t sqes_size;
+		unsigned* sq_head;
+		unsigned* sq_tail;
+		unsigned sq_mask;
+		unsigned sq_entries;
+		unsigned* cq_head;
+		unsigned* cq_tail;
+		unsigned cq_mask;
+		io_uring_cqe* cqes;
+
+		void* map(std::size_t size, off_t offset) {
+			auto ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+			if (ptr == MAP_FAILED) {
+				auto error = errno;
+				release();
+				throw std::system_error{error, std::system_category(), "mmap"};
+			}
+			return ptr;
+		}
+
+		void release() {
+			if (sqes != nullptr) {
+				::munmap(sqes, sqes_size);
+			}
+			if (cq_ring != nullptr && cq_ring != sq_ring) {
+				::munmap(cq_ring, cq_ring_size);
+			}
+			if (sq_ring != nullptr) {
+				::munmap(sq_ring, sq_ring_size);
+			}
+			::close(fd);
+		}
+
+		template <typename T>
+		static T* at(void* base, unsigned offset) {
+			return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+		}
+
+	public:
+		/// Set up a ring
+		/**
+		 *	@throw std::system_error if io_uring is not available
+		 *	@param entries Number of submission queue entries
+		 */
+		IoUring(unsigned entries)
+			: fd{-1}
+			, features{0u}
+			, sq_ring{nullptr}
+			, sq_ring_size{0u}
+			, cq_ring{nullptr}
+			, cq_ring_size{0u}
+			, sqes{nullptr}
+			, sqes_size{0u}
+			, sq_head{nullptr}
+			, sq_tail{nullptr}
+			, sq_mask{0u}
+			, sq_entries{0u}
+			, cq_head{nullptr}
+			, cq_tail{nullptr}
+			, cq_mask{0u}
+			, cqes{nullptr} {
+			io_uring_params params;
+			std::memset(&params, 0, sizeof(params));
+			fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+			if (fd < 0) {
+				throw std::system_error{errno, std::system_category(), "io_uring_setup"};
+			}
+			features = params.features;
+			sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			if (features & IORING_FEAT_SINGLE_MMAP) {
+				sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+			}
+			sq_ring = map(sq_ring_size, IORING_OFF_SQ_RING);
+			cq_ring = (features & IORING_FEAT_SINGLE_MMAP) ? sq_ring : map(cq_ring_size, IORING_OFF_CQ_RING);
+			sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+			sqes = static_cast<io_uring_sqe*>(map(sqes_size, IORING_OFF_SQES));
+			sq_head = at<unsigned>(sq_ring, params.sq_off.head);
+			sq_tail = at<unsigned>(sq_ring, params.sq_off.tail);
+			sq_mask = *at<unsigned>(sq_ring, params.sq_off.ring_mask);
+			sq_entries = params.sq_entries;
+			cq_head = at<unsigned>(cq_ring, params.cq_off.head);
+			cq_tail = at<unsigned>(cq_ring, params.cq_off.tail);
+			cq_mask = *at<unsigned>(cq_ring, params.cq_off.ring_mask);
+			cqes = at<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+			// each submission queue slot always refers to the entry with the same index
+			auto array = at<unsigned>(sq_ring, params.sq_off.array);
+			for (auto i = 0u; i < sq_entries; ++i) {
+				array[i] = i;
+			}
+		}
+
+		IoUring(IoUring const &) = delete;
+		IoUring& operator=(IoUring const &) = delete;
+
+		~IoUring() {
+			release();
+		}
+
+		/// Return the features supported by the kernel (IORING_FEAT_*)
+		inline unsigned getFeatures() const {
+			return features;
+		}
+
+		/// Return an empty submission queue entry
+		/**
+		 *	The entry is passed to the kernel by `enter()` after it was
+		 *	pushed using `push()`.
+		 *
+		 *	@return Pointer to the entry or nullptr if the queue is full
+		 */
+		io_uring_sqe* prepare() {
+			auto tail = *sq_tail;
+			if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+				return nullptr;
+			}
+			auto sqe = &sqes[tail & sq_mask];
+			std::memset(sqe, 0, sizeof(*sqe));
+			return sqe;
+		}
+
+		/// Make the prepared entry visible to the kernel
+		void push() {
+			__atomic_store_n(sq_tail, *sq_tail + 1u, __ATOMIC_RELEASE);
+		}
+
+		/// Submit entries and wait for completions
+		/**
+		 *	@param to_submit Number of pushed entries to submit
+		 *	@param min_complete Number of completions to wait for
+		 *	@return Number of submitted entries or -errno
+		 */
+		int enter(unsigned to_submit, unsigned min_complete) {
+			auto flags = (min_complete > 0u) ? IORING_ENTER_GETEVENTS : 0u;
+			auto ret = static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+			return (ret < 0) ? -errno : ret;
+		}
+
+		/// Pass each available completion to the given function
+		/**
+		 *	@param func Function taking the `io_uring_cqe const &`
+		 *	@return Number of completions
+		 */
+		template <typename Func>
+		unsigned reap(Func func) {
+			auto head = *cq_head;
+			auto tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+			for (auto i = head; i != tail; ++i) {
+				func(cqes[i & cq_mask]);
+			}
+			__atomic_store_n(cq_head, tail, __ATOMIC_RELEASE);
+			return tail - head;
+		}
+
+		/// Register buffers for fixed reads
+		/**
+		 *	@param buffers Buffers to register
+		 *	@param num Number of buffers
+		 *	@return True if registration succeeded (it might exceed RLIMIT_MEMLOCK)
+		 */
+		bool registerBuffers(iovec const * buffers, unsigned num) {
+			return ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers, num) == 0;
+		}
+};
+
+// ---------------------------------------------------------------------------
+
+/// Engine performing socket I/O using io_uring
+/**
+ *	A single I/O thread submits receives for all attached sockets and reaps
+ *	all completions. After passing on the completions of a single wait, the
+ *	receives of all sockets that were handled are re-armed and submitted
+ *	within the next wait, using one `io_uring_enter()` call for any number of
+ *	sockets. Receives use buffers that are registered with the kernel (as
+ *	long as registered buffers are available).
+ *	Sends are fire-and-forget: the data is copied to a buffer of the
+ *	socket, and the writing thread queues the send without waiting for its
+ *	completion. Hence a handler may write (e.g. submit another request)
+ *	without deadlocking. Only one send per socket is in flight, so data is
+ *	sent in order. Data that is written meanwhile is sent as a whole once the
+ *	previous send completed.
+ *	Entries are only submitted by the I/O thread, because the kernel cancels
+ *	the requests of a thread once it exits. Other threads queue entries and
+ *	wake the I/O thread using an eventfd, unless it was woken already. So
+ *	the sends and receives of any number of sockets and threads are
+ *	submitted using a single call as well. If the submission queue is full,
+ *	entries are kept aside until the I/O thread moves them into the queue,
+ *	so no thread waits for room.
+ *	Handlers are called by the I/O thread, one after another, like those of
+ *	the epoll-based event loop. A socket is identified by the id that was
+ *	returned when attaching it.
+ */
+class UringEngine {
+
+	using Handler = std::function<void()>;
+
+	// tags of user data (the upper bits contain a stream's id, which is never zero)
+	static std::uint64_t const send_tag = 0u;
+	static std::uint64_t const recv_tag = 1u;
+	static std::uint64_t const notify_tag = 2u;
+	static std::uint64_t const cancel_tag = 3u;
+
+	// user data of the entries that stop and wake the I/O thread (no stream has id zero)
+	static std::uint64_t const stop_data = 0u;
+	static std::uint64_t const wake_data = 1u;
+
+	static unsigned const num_entries = 256u;
+	static unsigned const num_slots = 64u;
+	static std::size_t const slot_size = 16384u;
+	static std::size_t const max_queued = 1u << 22;
+
+	// state of an attached socket
+	struct Stream {
+		int fd;								// duplicate owned by the engine
+		int slot;							// registered buffer, or -1
+		std::unique_ptr<char[]> memory;		// used if no registered buffer was available
+		char* buffer;
+		std::size_t begin, end;				// received bytes, which were not taken yet
+		int error;							// errno, -1 if closed by peer
+		int reported;						// error that was passed to the handler
+		bool armed;							// whether a receive is in flight
+		std::string sending;				// data of the send in flight
+		std::size_t sent;					// bytes of `sending` that were sent
+		std::string queued;					// data to send once the send in flight completed
+		bool writing;						// whether a send is in flight
+		int write_error;					// errno of a failed send
+		bool detached;						// waits for cancelled operations
+		std::shared_ptr<Handler> handler;
+	};
+
+	private:
+		IoUring ring;
+		std::unique_ptr<char[]> slots;
+		std::vector<int> free_slots;
+
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::unordered_map<std::uint64_t, Stream> streams;
+		std::uint64_t next_id;
+
+		std::mutex submit_mutex;
+		std::uint64_t queued, submitted;	// number of pushed and submitted entries
+		std::deque<io_uring_sqe> overflow;	// entries that didn't fit into the queue
+		bool signalled;						// whether the I/O thread was woken
+		int wake_fd;						// eventfd to wake the I/O thread
+		std::uint64_t wake_value;
+
+		std::thread thread;
+
+		// whether the calling thread is the I/O thread
+		static bool& onIoThread() {
+			static thread_local bool flag = false;
+			return flag;
+		}
+
+		// push an entry (requires submit_mutex), return whether the I/O thread has to be woken
+		template <typename Prepare>
+		bool push(Prepare prepare) {
+			io_uring_sqe* sqe = nullptr;
+			if (overflow.empty()) {
+				sqe = ring.prepare();
+			}
+			if (sqe == nullptr) {
+				// the queue is full: the I/O thread moves the entry once the kernel consumed the queue
+				overflow.emplace_back();
+				sqe = &overflow.back();
+				std::memset(sqe, 0, sizeof(*sqe));
+				prepare(*sqe);
+			} else {
+				prepare(*sqe);
+				ring.push();
+				++queued;
+			}
+			if (onIoThread() || signalled) {
+				return false;
+			}
+			signalled = true;
+			return true;
+		}
+
+		// move overflowed entries into the queue while it has room (requires submit_mutex)
+		void drain() {
+			io_uring_sqe* sqe;
+			while (!overflow.empty() && (sqe = ring.prepare()) != nullptr) {
+				*sqe = overflow.front();
+				overflow.pop_front();
+				ring.push();
+				++queued;
+			}
+		}
+
+		// submit claimed entries, return the number of entries that were not submitted
+		unsigned submit(unsigned num, unsigned min_complete) {
+			auto ret = ring.enter(num, min_complete);
+			if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+				throw std::system_error{-ret, std::system_category(), "io_uring_enter"};
+			}
+			return (ret > 0) ? num - static_cast<unsigned>(ret) : num;
+		}
+
+		// submit all pushed entries and wait for the given number of completions (I/O thread only)
+		void flush(unsigned min_complete) {
+			while (true) {
+				unsigned num;
+				bool more;
+				{
+					std::lock_guard<std::mutex> lock{submit_mutex};
+					drain();
+					num = static_cast<unsigned>(queued - submitted);
+					submitted = queued;
+					more = !overflow.empty();
+				}
+				// don't wait while overflowed entries are left
+				num = submit(num, more ? 0u : min_complete);
+				if (num > 0u) {
+					// submitted later (e.g. once the completion queue has room)
+					std::lock_guard<std::mutex> lock{submit_mutex};
+					submitted -= num;
+					return;
+				}
+				if (!more) {
+					return;
+				}
+			}
+		}
+
+		// wake the I/O thread, so it submits the pushed entries
+		void interrupt() {
+			std::uint64_t value = 1u;
+			while (::write(wake_fd, &value, sizeof(value)) < 0 && errno == EINTR) {
+			}
+		}
+
+		// queue a read of the eventfd, which completes once the I/O thread is woken (I/O thread only)
+		void listen() {
+			std::lock_guard<std::mutex> lock{submit_mutex};
+			signalled = false;
+			push([&](io_uring_sqe& sqe) {
+				sqe.opcode = IORING_OP_READ;
+				sqe.fd = wake_fd;
+				sqe.addr = reinterpret_cast<std::uint64_t>(&wake_value);
+				sqe.len = sizeof(wake_value);
+				sqe.user_data = wake_data;
+			});
+		}
+
+		// queue a receive for the given stream (requires mutex), return whether to wake the I/O thread
+		bool arm(std::uint64_t id, Stream& stream) {
+			stream.armed = true;
+			stream.begin = stream.end = 0u;
+			std::lock_guard<std::mutex> lock{submit_mutex};
+			return push([&](io_uring_sqe& sqe) {
+				sqe.fd = stream.fd;
+				sqe.addr = reinterpret_cast<std::uint64_t>(stream.buffer);
+				sqe.len = slot_size;
+				sqe.user_data = (id << 2u) | recv_tag;
+				if (stream.slot >= 0) {
+					sqe.opcode = IORING_OP_READ_FIXED;
+					sqe.buf_index = static_cast<std::uint16_t>(stream.slot);
+				} else {
+					sqe.opcode = IORING_OP_RECV;
+				}
+			});
+		}
+
+		// queue a send of the data that was not sent yet (requires mutex), return whether to wake the I/O thread
+		bool transmit(std::uint64_t id, Stream& stream) {
+			stream.writing = true;
+			std::lock_guard<std::mutex> lock{submit_mutex};
+			return push([&](io_uring_sqe& sqe) {
+				sqe.opcode = IORING_OP_SEND;
+				sqe.fd = stream.fd;
+				sqe.addr = reinterpret_cast<std::uint64_t>(stream.sending.data() + stream.sent);
+				sqe.len = static_cast<std::uint32_t>(std::min<std::size_t>(stream.sending.size() - stream.sent, 1u << 30));
+				sqe.msg_flags = MSG_NOSIGNAL;
+				sqe.user_data = (id << 2u) | send_tag;
+			});
+		}
+
+		// queue a no-op to call the stream's handler (requires mutex), return whether to wake the I/O thread
+		bool notify(std::uint64_t id) {
+			std::lock_guard<std::mutex> lock{submit_mutex};
+			return push([&](io_uring_sqe& sqe) {
+				sqe.opcode = IORING_OP_NOP;
+				sqe.user_data = (id << 2u) | notify_tag;
+			});
+		}
+
+		// cancel the stream's operations in flight (requires mutex), return whether to wake the I/O thread
+		bool cancel(std::uint64_t id, Stream& stream) {
+			// the buffers are kept until the operations completed
+			stream.detached = true;
+			stream.handler.reset();
+			stream.queued.clear();
+			bool wake = false;
+			std::lock_guard<std::mutex> lock{submit_mutex};
+			for (auto tag: {recv_tag, send_tag}) {
+				if (tag == recv_tag ? stream.armed : stream.writing) {
+					wake = push([&](io_uring_sqe& sqe) {
+						sqe.opcode = IORING_OP_ASYNC_CANCEL;
+						sqe.addr = (id << 2u) | tag;
+						sqe.user_data = (id << 2u) | cancel_tag;
+					}) || wake;
+				}
+			}
+			return wake;
+		}
+
+		// whether the stream has something to pass on (requires mutex)
+		static bool isPending(Stream const & stream) {
+			return stream.begin < stream.end || stream.error != 0;
+		}
+
+		// handle a receive's completion (requires mutex), return whether to call the handler
+		bool received(Stream& stream, int result) {
+			stream.armed = false;
+			if (result > 0) {
+				stream.end = static_cast<std::size_t>(result);
+			} else if (result == 0) {
+				stream.error = -1;
+			} else if (result != -ECANCELED) {
+				stream.error = -result;
+			}
+			return stream.handler != nullptr && isPending(stream);
+		}
+
+		// handle a send's completion (requires mutex), return whether to call the handler
+		bool written(std::uint64_t id, Stream& stream, int result) {
+			stream.writing = false;
+			if (result < 0) {
+				// later writes fail, and so do reads (unless there is data left)
+				stream.write_error = -result;
+				if (stream.error == 0) {
+					stream.error = -result;
+				}
+				stream.sending.clear();
+				stream.queued.clear();
+				stream.sent = 0u;
+				return stream.handler != nullptr && isPending(stream);
+			}
+			stream.sent += static_cast<std::size_t>(result);
+			if (stream.sent == stream.sending.size()) {
+				// send everything that was written meanwhile at once
+				stream.sending.clear();
+				stream.sending.swap(stream.queued);
+				stream.sent = 0u;
+			}
+			if (stream.sent < stream.sending.size()) {
+				transmit(id, stream);
+			}
+			return false;
+		}
+
+		void release(Stream& stream) {
+			if (stream.slot >= 0) {
+				free_slots.push_back(stream.slot);
+			}
+			::close(stream.fd);
+		}
+
+		// call the handler while it has something to take, then re-arm
+		void dispatch(std::uint64_t id, std::shared_ptr<Handler> const & handler) {
+			while (true) {
+				{
+					std::lock_guard<std::mutex> lock{mutex};
+					auto it = streams.find(id);
+					if (it == streams.end() || it->second.handler != handler) {
+						// removed meanwhile, or another handler took over
+						return;
+					}
+					auto& stream = it->second;
+					if (stream.begin == stream.end) {
+						if (stream.error == 0) {
+							if (!stream.armed) {
+								arm(id, stream);
+							}
+							return;
+						}
+						if (stream.error == stream.reported) {
+							return;
+						}
+						// pass the error on once
+						stream.reported = stream.error;
+					}
+				}
+				(*handler)();
+			}
+		}
+
+		void run() {
+			std::vector<io_uring_cqe> completions;
+			std::vector<std::pair<std::uint64_t, std::shared_ptr<Handler>>> ready;
+			onIoThread() = true;
+			listen();
+			bool listening = true;		// whether the eventfd is read
+			while (true) {
+				// submit the entries of all threads (e.g. re-armed receives and sends) and wait using a single call
+				flush(1u);
+				completions.clear();
+				ring.reap([&](io_uring_cqe const & cqe) {
+					completions.push_back(cqe);
+				});
+				bool stop = false, woken = false;
+				{
+					std::lock_guard<std::mutex> lock{mutex};
+					for (auto const & cqe: completions) {
+						if (cqe.user_data == stop_data) {
+							stop = true;
+							continue;
+						}
+						if (cqe.user_data == wake_data) {
+							woken = true;
+							listening = false;
+							continue;
+						}
+						auto tag = cqe.user_data & 3u;
+						auto it = streams.find(cqe.user_data >> 2u);
+						if (it == streams.end() || tag == cancel_tag) {
+							continue;
+						}
+						auto& stream = it->second;
+						if (stream.detached) {
+							stream.armed = stream.armed && tag != recv_tag;
+							stream.writing = stream.writing && tag != send_tag;
+							if (!stream.armed && !stream.writing) {
+								release(stream);
+								streams.erase(it);
+							}
+							continue;
+						}
+						bool call;
+						if (tag == recv_tag) {
+							call = received(stream, cqe.res);
+						} else if (tag == send_tag) {
+							call = written(it->first, stream, cqe.res);
+						} else {
+							call = stream.handler != nullptr && isPending(stream);
+						}
+						if (call) {
+							ready.emplace_back(it->first, stream.handler);
+						}
+					}
+				}
+				changed.notify_all();
+				if (stop) {
+					// the kernel must not write to the engine's memory once it is destroyed
+					if (listening) {
+						std::lock_guard<std::mutex> lock{submit_mutex};
+						push([](io_uring_sqe& sqe) {
+							sqe.opcode = IORING_OP_ASYNC_CANCEL;
+							sqe.addr = wake_data;
+							sqe.user_data = cancel_tag;
+						});
+					}
+					while (listening) {
+						flush(1u);
+						ring.reap([&](io_uring_cqe const & cqe) {
+							listening = listening && cqe.user_data != wake_data;
+						});
+					}
+					return;
+				}
+				if (woken) {
+					listen();
+					listening = true;
+				}
+				for (auto const & pair: ready) {
+					dispatch(pair.first, pair.second);
+				}
+				ready.clear();
+			}
+		}
+
+	public:
+		// error reported by `receive()` if waiting timed out (errno values are positive)
+		static int const timed_out = -2;
+
+		/// Start the engine
+		/**
+		 *	@throw std::system_error if io_uring is not (fully) available
+		 */
+		UringEngine()
+			: ring{num_entries}
+			, slots{new char[num_slots * slot_size]}
+			, free_slots{}
+			, mutex{}
+			, changed{}
+			, streams{}
+			, next_id{1u}
+			, submit_mutex{}
+			, queued{0u}
+			, submitted{0u}
+			, overflow{}
+			, signalled{false}
+			, wake_fd{-1}
+			, wake_value{0u}
+			, thread{} {
+			if (!(ring.getFeatures() & IORING_FEAT_FAST_POLL)) {
+				// older kernels would block a worker thread per receive
+				throw std::system_error{ENOTSUP, std::system_category(), "io_uring without fast poll"};
+			}
+			std::vector<iovec> buffers(num_slots);
+			for (auto i = 0u; i < num_slots; ++i) {
+				buffers[i] = iovec{slots.get() + i * slot_size, slot_size};
+			}
+			if (ring.registerBuffers(buffers.data(), num_slots)) {
+				for (auto i = num_slots; i > 0u; --i) {
+					free_slots.push_back(static_cast<int>(i - 1u));
+				}
+			} else {
+				slots.reset();
+			}
+			wake_fd = ::eventfd(0u, EFD_CLOEXEC);
+			if (wake_fd < 0) {
+				throw std::system_error{errno, std::system_category(), "eventfd"};
+			}
+			thread = std::thread{&UringEngine::run, this};
+		}
+
+		UringEngine(UringEngine const &) = delete;
+		UringEngine& operator=(UringEngine const &) = delete;
+
+		/// Stop the engine
+		/**
+		 *	Operations in flight are cancelled, and the I/O thread is stopped
+		 *	once they completed. So the kernel doesn't write to buffers that
+		 *	were released meanwhile.
+		 */
+		~UringEngine() {
+			bool wake = false;
+			{
+				std::unique_lock<std::mutex> lock{mutex};
+				for (auto it = streams.begin(); it != streams.end(); ) {
+					auto& stream = it->second;
+					if (!stream.armed && !stream.writing) {
+						release(stream);
+						it = streams.erase(it);
+						continue;
+					}
+					if (cancel(it->first, stream)) {
+						wake = true;
+					}
+					++it;
+				}
+				if (wake) {
+					lock.unlock();
+					interrupt();
+					lock.lock();
+				}
+				// detached streams are removed by the I/O thread once their operations completed
+				changed.wait(lock, [&]() {
+					return streams.empty();
+				});
+			}
+			{
+				std::lock_guard<std::mutex> lock{submit_mutex};
+				wake = push([](io_uring_sqe& sqe) {
+					sqe.opcode = IORING_OP_NOP;
+					sqe.user_data = stop_data;
+				});
+			}
+			if (wake) {
+				interrupt();
+			}
+			thread.join();
+			::close(wake_fd);
+		}
+
+		/// Attach a connected socket
+		/**
+		 *	Nothing is received until the socket is watched or data is
+		 *	received explicitly. The engine uses a duplicate of the file
+		 *	descriptor, so queued entries never refer to a descriptor that
+		 *	was closed (or even reused) meanwhile.
+		 *
+		 *	@throw std::system_error if the descriptor cannot be duplicated
+		 *	@param fd File descriptor of the socket
+		 *	@return Id of the socket
+		 */
+		std::uint64_t attach(int fd) {
+			auto copy = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+			if (copy < 0) {
+				throw std::system_error{errno, std::system_category(), "fcntl"};
+			}
+			std::lock_guard<std::mutex> lock{mutex};
+			auto id = next_id++;
+			auto& stream = streams[id];
+			stream.fd = copy;
+			stream.slot = -1;
+			if (!free_slots.empty()) {
+				stream.slot = free_slots.back();
+				free_slots.pop_back();
+				stream.buffer = slots.get() + stream.slot * slot_size;
+			} else {
+				stream.memory.reset(new char[slot_size]);
+				stream.buffer = stream.memory.get();
+			}
+			stream.begin = stream.end = 0u;
+			stream.error = stream.reported = 0;
+			stream.sent = 0u;
+			stream.write_error = 0;
+			stream.armed = stream.writing = stream.detached = false;
+			return id;
+		}
+
+		/// Detach a socket
+		/**
+		 *	A receive or send in flight is cancelled, and data that was not
+		 *	sent yet is dropped. The socket may be closed right away. This may
+		 *	be called by the socket's handler.
+		 *
+		 *	@param id Id of the socket
+		 */
+		void detach(std::uint64_t id) {
+			bool wake = false;
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				auto it = streams.find(id);
+				if (it == streams.end()) {
+					return;
+				}
+				auto& stream = it->second;
+				if (!stream.armed && !stream.writing) {
+					release(stream);
+					streams.erase(it);
+					return;
+				}
+				wake = cancel(id, stream);
+			}
+			if (wake) {
+				interrupt();
+			}
+		}
+
+		/// Call the given handler whenever data was received
+		/**
+		 *	The handler is expected to take the data using `receive()`.
+		 *
+		 *	@param id Id of the socket
+		 *	@param handler Function to call
+		 */
+		void watch(std::uint64_t id, Handler handler) {
+			bool wake = false;
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				auto& stream = streams.at(id);
+				stream.handler = std::make_shared<Handler>(std::move(handler));
+				stream.reported = 0;
+				if (isPending(stream)) {
+					wake = notify(id);
+				} else if (!stream.armed) {
+					wake = arm(id, stream);
+				}
+			}
+			if (wake) {
+				interrupt();
+			}
+		}
+
+		/// Stop calling the socket's handler
+		/**
+		 *	The handler is not called afterwards, unless it is running right
+		 *	now. This may be called by the handler itself.
+		 *
+		 *	@param id Id of the socket
+		 */
+		void unwatch(std::uint64_t id) {
+			std::lock_guard<std::mutex> lock{mutex};
+			auto it = streams.find(id);
+			if (it != streams.end()) {
+				it->second.handler.reset();
+			}
+		}
+
+		/// Take received data
+		/**
+		 *	The receive stays in flight if waiting timed out, so data that
+		 *	arrives later is taken by the next call.
+		 *
+		 *	@param id Id of the socket
+		 *	@param data Buffer to copy the data to
+		 *	@param num_bytes Maximum number of bytes
+		 *	@param wait Whether to wait for data if nothing was received yet
+		 *	@param error Set to errno (-1 if closed by peer, `timed_out` if waiting timed out) if nothing was received
+		 *	@param timeout Maximum time to wait (negative waits forever)
+		 *	@return Number of bytes
+		 */
+		std::size_t receive(std::uint64_t id, char* data, std::size_t num_bytes, bool wait, int& error,
+			std::chrono::milliseconds timeout=std::chrono::milliseconds{-1}) {
+			std::unique_lock<std::mutex> lock{mutex};
+			auto& stream = streams.at(id);
+			if (wait && !isPending(stream)) {
+				if (!stream.armed && arm(id, stream)) {
+					lock.unlock();
+					interrupt();
+					lock.lock();
+				}
+				auto ready = [&]() {
+					return isPending(stream);
+				};
+				if (timeout.count() < 0) {
+					changed.wait(lock, ready);
+				} else if (!changed.wait_for(lock, timeout, ready)) {
+					error = timed_out;
+					return 0u;
+				}
+			}
+			error = 0;
+			if (stream.begin == stream.end) {
+				error = stream.error;
+				return 0u;
+			}
+			auto size = std::min(num_bytes, stream.end - stream.begin);
+			std::memcpy(data, stream.buffer + stream.begin, size);
+			stream.begin += size;
+			return size;
+		}
+
+		/// Send data without waiting for the kernel
+		/**
+		 *	The data is copied, so the segments may be released once this
+		 *	returned. If too much data was queued (because the peer does not
+		 *	receive it), the calling thread waits until it was sent, unless
+		 *	it is the I/O thread.
+		 *
+		 *	@param id Id of the socket
+		 *	@param segments Segments to send
+		 *	@param num Number of segments
+		 *	@return errno of a previous send that failed, or zero
+		 */
+		int send(std::uint64_t id, iovec const * segments, std::size_t num) {
+			bool wake = false;
+			{
+				std::unique_lock<std::mutex> lock{mutex};
+				auto& stream = streams.at(id);
+				if (stream.queued.size() >= max_queued && !onIoThread()) {
+					changed.wait(lock, [&]() {
+						return stream.queued.size() < max_queued || stream.write_error != 0;
+					});
+				}
+				if (stream.write_error != 0) {
+					return stream.write_error;
+				}
+				auto& buffer = stream.writing ? stream.queued : stream.sending;
+				for (std::size_t i = 0u; i < num; ++i) {
+					buffer.append(static_cast<char const *>(segments[i].iov_base), segments[i].iov_len);
+				}
+				if (!stream.writing && !stream.sending.empty()) {
+					wake = transmit(id, stream);
+				}
+			}
+			if (wake) {
+				interrupt();
+			}
+			return 0;
+		}
+
+		/// Return the engine shared by all sockets
+		/**
+		 *	The engine is started once it is needed.
+		 *
+		 *	@return Pointer to the engine or nullptr if io_uring is not available
+		 */
+		static UringEngine* get() {
+			static std::unique_ptr<UringEngine> engine{create()};
+			return engine.get();
+		}
+
+	private:
+		static UringEngine* create() {
+			try {
+				return new UringEngine{};
+			} catch (std::system_error const &) {
+				// e.g. old kernel or disabled by seccomp
+				return nullptr;
+			}
+		}
+};
+
+} // ::priv
+} // ::redisxx
+
+#endif
@@ -0,0 +1,250 @@
+/** @file keys.hpp
+ *
+ * RedisXX key extraction and hashing
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include <redisxx/command.hpp>
+#include <redisxx/string_view.hpp>
+
+namespace redisxx {
+namespace priv {
+
+// number of hash slots of a redis cluster
+static std::size_t const num_hash_slots = 16384u;
+
+// compare ASCII strings ignoring the case (the second one being upper case)
+inline bool equals_upper(StringView lhs, char const * rhs) {
+	std::size_t i = 0u;
+	for (; i < lhs.size() && rhs[i] != '\0'; ++i) {
+		auto c = lhs[i];
+		if (c >= 'a' && c <= 'z') {
+			c = static_cast<char>(c - 'a' + 'A');
+		}
+		if (c != rhs[i]) {
+			return false;
+		}
+	}
+	return i == lhs.size() && rhs[i] == '\0';
+}
+
+/// Find the key of a command
+/**
+ *	Usually, the key is the first argument following the command's name
+ *	(e.g. "GET <key>"). Commands that don't refer to a key (e.g. PING or
+ *	INFO) have none. Scripts (EVAL, EVALSHA, FCALL) refer to the first key
+ *	following the number of keys, streams read by XREAD(GROUP) follow the
+ *	STREAMS argument. Container commands (OBJECT, MEMORY, XINFO, XGROUP)
+ *	refer to the key following their subcommand (e.g. "OBJECT ENCODING
+ *	<key>"), subcommands without arguments (e.g. "MEMORY STATS") to none.
+ *	BITOP refers to its destination key following the operation. Commands
+ *	taking the number of keys first (e.g. "ZINTER <numkeys> <key>...") refer
+ *	to the first key following it, BLMPOP and BZMPOP to the first key
+ *	following their timeout and number of keys.
+ *	Commands referring to multiple keys (e.g. MGET) are identified by their
+ *	first key.
+ *
+ *	@param cmd Command to inspect
+ *	@param key Assigned the command's key
+ *	@return False if the command does not refer to a key
+ */
+template <typename Allocator>
+bool key_of(BasicCommand<Allocator> const & cmd, StringView& key) {
+	static char const * const keyless[] = {
+		"AUTH", "BGREWRITEAOF", "BGSAVE", "CLIENT", "CLUSTER", "COMMAND", "CONFIG", "DBSIZE",
+		"DISCARD", "ECHO", "EXEC", "FLUSHALL", "FLUSHDB", "FUNCTION", "HELLO", "INFO", "KEYS",
+		"LASTSAVE", "MULTI", "PING", "PUBLISH", "QUIT", "RANDOMKEY", "READONLY", "READWRITE",
+		"SAVE", "SCAN", "SCRIPT", "SELECT", "SLOWLOG", "TIME", "UNWATCH", "WAIT"
+	};
+	auto const num = cmd.getNumArguments();
+	if (num < 2u) {
+		return false;
+	}
+	auto const name = cmd.getArgument(0u);
+	for (auto other: keyless) {
+		if (equals_upper(name, other)) {
+			return false;
+		}
+	}
+	if (equals_upper(name, "EVAL") || equals_upper(name, "EVALSHA") || equals_upper(name, "EVAL_RO")
+		|| equals_upper(name, "EVALSHA_RO") || equals_upper(name, "FCALL") || equals_upper(name, "FCALL_RO")) {
+		// "EVAL <script> <numkeys> <key>..."
+		if (num < 4u) {
+			return false;
+		}
+		auto const numkeys = cmd.getArgument(2u);
+		if (numkeys.empty() || numkeys == "0") {
+			return false;
+		}
+		key = cmd.getArgument(3u);
+		return true;
+	}
+	if (equals_upper(name, "XREAD") || equals_upper(name, "XREADGROUP")) {
+		for (auto i = 1u; i + 1u < num; ++i) {
+			if (equals_upper(cmd.getArgument(i), "STREAMS")) {
+				key = cmd.getArgument(i + 1u);
+				return true;
+			}
+		}
+		return false;
+	}
+	if (equals_upper(name, "OBJECT") || equals_upper(name, "MEMORY") || equals_upper(name, "XINFO")
+		|| equals_upper(name, "XGROUP")) {
+		// "OBJECT <subcommand> <key>..."
+		if (num < 3u) {
+			return false;
+		}
+		key = cmd.getArgument(2u);
+		return true;
+	}
+	if (equals_upper(name, "BITOP")) {
+		// "BITOP <operation> <destkey> <key>..."
+		if (num < 3u) {
+			return false;
+		}
+		key = cmd.getArgument(2u);
+		return true;
+	}
+	std::size_t numkeys = 0u;
+	if (equals_upper(name, "ZUNION") || equals_upper(name, "ZINTER") || equals_upper(name, "ZDIFF")
+		|| equals_upper(name, "ZINTERCARD") || equals_upper(name, "SINTERCARD") || equals_upper(name, "LMPOP")
+		|| equals_upper(name, "ZMPOP")) {
+		// "ZINTER <numkeys> <key>..."
+		numkeys = 1u;
+	} else if (equals_upper(name, "BLMPOP") || equals_upper(name, "BZMPOP")) {
+		// "BLMPOP <timeout> <numkeys> <key>..."
+		numkeys = 2u;
+	}
+	if (numkeys > 0u) {
+		auto const count = cmd.getArgument(numkeys);
+		if (numkeys + 1u >= num || count.empty() || count == "0") {
+			return false;
+		}
+		key = cmd.getArgument(numkeys + 1u);
+		return true;
+	}
+	key = cmd.getArgument(1u);
+	return true;
+}
+
+/// Return the part of a key that is hashed
+/**
+ *	If the key contains a hash tag (a non-empty substring between the first
+ *	'{' and the first '}' following it), only the tag is hashed. So keys
+ *	sharing a tag (e.g. "{user:42}.name" and "{user:42}.mail") are stored
+ *	together.
+ *
+ *	@param key Key to hash
+ *	@return Hash tag or the entire key
+ */
+inline StringView hash_tag(StringView key) {
+	auto const data = key.data();
+	auto const size = key.size();
+	for (std::size_t open = 0u; open < size; ++open) {
+		if (data[open] != '{') {
+			continue;
+		}
+		for (auto close = open + 1u; close < size; ++close) {
+			if (data[close] == '}') {
+				return (close > open + 1u) ? StringView{data + open + 1u, close - open - 1u} : key;
+			}
+		}
+		return key;
+	}
+	return key;
+}
+
+/// CRC16 (XMODEM) of the given bytes
+/**
+ *	This is the checksum redis cluster uses to assign keys to hash slots.
+ *
+ *	@param data Bytes to hash
+ *	@param size Number of bytes
+ *	@return Checksum
+ */
+inline std::uint16_t crc16(char const * data, std::size_t size) {
+	static std::uint16_t const table[256] = {
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+		0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+		0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+		0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+		0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+		0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+		0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+		0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+		0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+		0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+		0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+		0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+		0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+		0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+		0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+		0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+		0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+		0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+		0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+		0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+		0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+		0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+		0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+		0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+		0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+		0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+		0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+		0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+		0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+		0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+		0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+		0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+	};
+	std::uint16_t crc = 0u;
+	for (std::size_t i = 0u; i < size; ++i) {
+		auto const byte = static_cast<unsigned char>(data[i]);
+		crc = static_cast<std::uint16_t>((crc << 8) ^ table[((crc >> 8) ^ byte) & 0xffu]);
+	}
+	return crc;
+}
+
+/// Return the hash slot of the given key
+/**
+ *	@param key Key (respecting its hash tag)
+ *	@return Hash slot between 0 and 16383
+ */
+inline std::size_t hash_slot(StringView key) {
+	auto const tag = hash_tag(key);
+	return crc16(tag.data(), tag.size()) % num_hash_slots;
+}
+
+/// 64-bit hash of the given bytes
+/**
+ *	FNV-1a, followed by the finalizer of MurmurHash3, so that similar
+ *	inputs (e.g. "user:1" and "user:2") are spread evenly. This is used to
+ *	place keys and shards on a hash ring, which is why it needs to be
+ *	stable across processes and platforms.
+ *
+ *	@param data Bytes to hash
+ *	@param size Number of bytes
+ *	@return Hash
+ */
+inline std::uint64_t hash64(char const * data, std::size_t size) {
+	std::uint64_t hash = 14695981039346656037ull;
+	for (std::size_t i = 0u; i < size; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 1099511628211ull;
+	}
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+} // ::priv
+} // ::redisxx
@@ -0,0 +1,503 @@
+/** @file lazy_reply.hpp
+ *
+ * RedisXX lazily decoded Reply implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <redisxx/error.hpp>
+#include <redisxx/format.hpp>
+#include <redisxx/reply.hpp>
+#include <redisxx/string_view.hpp>
+
+namespace redisxx {
+namespace priv {
+
+// decode a number terminated by CRLF (framing was already validated)
+inline std::int64_t decode_number(char const *& ptr) {
+	auto first = ptr;
+	while (*ptr != '\r') {
+		++ptr;
+	}
+	std::int64_t number = 0;
+	parse_integer(first, ptr, number);
+	ptr += 2;
+	return number;
+}
+
+// return the position after the value at the given position
+inline std::size_t skip_value(std::string const & buffer, std::size_t offset) {
+	auto ptr = buffer.data() + offset;
+	std::size_t pending = 1u;
+	while (pending > 0u) {
+		--pending;
+		switch (*ptr++) {
+			case '+':
+			case '-':
+			case ',':
+			case '(':
+			case '#':
+			case '_':
+				ptr = static_cast<char const *>(std::memchr(ptr, '\r', buffer.data() + buffer.size() - ptr)) + 2;
+				break;
+
+			case '$':
+			case '!':
+			case '=': {
+				auto length = decode_number(ptr);
+				if (length >= 0) {
+					ptr += length + 2;
+				}
+				break;
+			}
+
+			case '*':
+			case '~':
+			case '>': {
+				auto length = decode_number(ptr);
+				if (length > 0) {
+					pending += static_cast<std::size_t>(length);
+				}
+				break;
+			}
+
+			case '%':
+				// keys and values
+				pending += 2u * static_cast<std::size_t>(decode_number(ptr));
+				break;
+
+			default:
+				// integer
+				decode_number(ptr);
+				break;
+		}
+	}
+	return static_cast<std::size_t>(ptr - buffer.data());
+}
+
+// return the position of the first value at the given position that is no push frame
+inline std::size_t skip_pushes(std::string const & buffer, std::size_t offset) {
+	while (offset < buffer.size() && buffer[offset] == '>') {
+		offset = skip_value(buffer, offset);
+	}
+	return offset;
+}
+
+} // ::priv
+
+/// Lazily decoded Reply
+/**
+ *	This class provides the same typed access as `redisxx::Reply`, but nothing
+ *	is decoded in advance. The framing of the reply was validated while it was
+ *	received, but only the position of the reply is known. Each value is
+ *	decoded once it is accessed, so querying the number of elements of a huge
+ *	array or reading its first elements does not touch the remaining ones.
+ *	Elements are best accessed sequentially using iterators. Accessing them
+ *	by index walks the array from its start, unless a random-access index was
+ *	built using `buildIndex()`.
+ *	Push frames (RESP3) that were received in front of the reply (or in front
+ *	of a reply grouped as an array element) are skipped.
+ *
+ *	Example usage:
+ *	@code
+ *		auto reply = conn.lazy(redisxx::Command{"LRANGE", "huge", 0, -1}).get();
+ *		std::cout << reply.size() << " elements, starting with:\n";
+ *		auto it = reply.begin();
+ *		for (auto i = 0u; i < 10u && it != reply.end(); ++i, ++it) {
+ *			std::cout << (*it).getString() << "\n";
+ *		}
+ *	@endcode
+ */
+class LazyReply {
+	private:
+		std::shared_ptr<priv::ReplyData const> data;
+		std::size_t offset;									// position of the type byte
+		std::shared_ptr<std::vector<std::size_t> const> index;	// positions of the elements
+
+		inline char const * header() const {
+			return data->buffer.data() + offset;
+		}
+
+		// position of the first element of an array
+		inline std::size_t first() const {
+			auto ptr = header() + 1;
+			priv::decode_number(ptr);
+			return priv::skip_pushes(data->buffer, static_cast<std::size_t>(ptr - data->buffer.data()));
+		}
+
+		// view of a value that ends with its first line
+		inline StringView line() const {
+			auto begin = header() + 1;
+			auto end = static_cast<char const *>(std::memchr(begin, '\r', data->buffer.data() + data->buffer.size() - begin));
+			return StringView{begin, static_cast<std::size_t>(end - begin)};
+		}
+
+	public:
+		/// Forward iterator over the elements of an array reply
+		/**
+		 *	The iterator shares the receive buffer, so it stays valid after
+		 *	the reply it was taken from was destroyed (e.g. a temporary
+		 *	element).
+		 */
+		class const_iterator {
+			private:
+				std::shared_ptr<priv::ReplyData const> data;
+				std::size_t offset;	// position of the current element
+				std::size_t left;	// number of elements left
+
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = LazyReply;
+				using difference_type = std::ptrdiff_t;
+				using pointer = LazyReply const *;
+				using reference = LazyReply;
+
+				const_iterator()
+					: data{}
+					, offset{0u}
+					, left{0u} {
+				}
+
+				const_iterator(std::shared_ptr<priv::ReplyData const> data, std::size_t offset, std::size_t left)
+					: data{std::move(data)}
+					, offset{offset}
+					, left{left} {
+				}
+
+				inline LazyReply operator*() const {
+					return LazyReply{data, offset};
+				}
+
+				inline const_iterator& operator++() {
+					--left;
+					offset = priv::skip_value(data->buffer, offset);
+					if (left > 0u) {
+						offset = priv::skip_pushes(data->buffer, offset);
+					}
+					return *this;
+				}
+
+				inline const_iterator operator++(int) {
+					auto tmp = *this;
+					++*this;
+					return tmp;
+				}
+
+				inline bool operator==(const_iterator const & other) const {
+					return left == other.left;
+				}
+
+				inline bool operator!=(const_iterator const & other) const {
+					return left != other.left;
+				}
+		};
+
+		/// Create a null reply
+		LazyReply()
+			: data{}
+			, offset{0u}
+			, index{} {
+		}
+
+		/// Create a reply referring to a value inside the given receive buffer
+		/**
+		 *	@param data Shared receive buffer
+		 *	@param offset Position of the value inside the buffer
+		 */
+		LazyReply(std::shared_ptr<priv::ReplyData const> data, std::size_t offset)
+			: data{std::move(data)}
+			, offset{priv::skip_pushes(this->data->buffer, offset)}
+			, index{} {
+		}
+
+		/// Returns the type of this reply
+		/**
+		 *	@return Type of the reply
+		 */
+		inline ReplyType getType() const {
+			if (data == nullptr) {
+				return ReplyType::Null;
+			}
+			switch (*header()) {
+				case '+':
+					return ReplyType::Status;
+				case '-':
+					return ReplyType::Error;
+				case ':':
+					return ReplyType::Integer;
+				case ',':
+					return ReplyType::Double;
+				case '(':
+					return ReplyType::BigNumber;
+				case '#':
+					return ReplyType::Boolean;
+				case '_':
+					return ReplyType::Null;
+				case '!':
+					return ReplyType::Error;
+				case '=':
+					return ReplyType::Verbatim;
+				case '%':
+					return ReplyType::Map;
+				case '~':
+					return ReplyType::Set;
+				case '>':
+					return ReplyType::Push;
+				default:
+					// bulk string or array
+					return (header()[1] == '-') ? ReplyType::Null
+						: (*header() == '$') ? ReplyType::Bulk : ReplyType::Array;
+			}
+		}
+
+		inline bool isStatus() const {
+			return getType() == ReplyType::Status;
+		}
+
+		inline bool isError() const {
+			return getType() == ReplyType::Error;
+		}
+
+		inline bool isInteger() const {
+			return getType() == ReplyType::Integer;
+		}
+
+		inline bool isBulk() const {
+			return getType() == ReplyType::Bulk;
+		}
+
+		inline bool isNull() const {
+			return getType() == ReplyType::Null;
+		}
+
+		inline bool isArray() const {
+			return getType() == ReplyType::Array;
+		}
+
+		inline bool isMap() const {
+			return getType() == ReplyType::Map;
+		}
+
+		inline bool isSet() const {
+			return getType() == ReplyType::Set;
+		}
+
+		inline bool isPush() const {
+			return getType() == ReplyType::Push;
+		}
+
+		inline bool isDouble() const {
+			return getType() == ReplyType::Double;
+		}
+
+		inline bool isBoolean() const {
+			return getType() == ReplyType::Boolean;
+		}
+
+		inline bool isBigNumber() const {
+			return getType() == ReplyType::BigNumber;
+		}
+
+		inline bool isVerbatim() const {
+			return getType() == ReplyType::Verbatim;
+		}
+
+		/// Query whether the reply has elements (array, map, set or push)
+		/**
+		 *	@return True if the reply is an aggregate
+		 */
+		inline bool isAggregate() const {
+			return priv::is_aggregate(getType());
+		}
+
+		/// Returns the string of a reply
+		/**
+		 *	This works for status, error and bulk string replies, as well as
+		 *	doubles, booleans ("t" or "f"), big numbers and verbatim strings.
+		 *	The returned view refers to the receive buffer. It is valid as long
+		 *	as this reply (or any other reply sharing the buffer) is alive.
+		 *
+		 *	@throw TypeError if the reply is no string
+		 *	@return View of the string
+		 */
+		inline StringView getString() const {
+			switch (getType()) {
+				case ReplyType::Status:
+				case ReplyType::Error:
+				case ReplyType::Double:
+				case ReplyType::Boolean:
+				case ReplyType::BigNumber:
+				case ReplyType::Bulk:
+				case ReplyType::Verbatim:
+					break;
+				default:
+					throw TypeError{"Reply is not a string"};
+			}
+			if (*header() != '$' && *header() != '!' && *header() != '=') {
+				return line();
+			}
+			auto ptr = header() + 1;
+			auto length = priv::decode_number(ptr);
+			if (*header() == '=') {
+				// skip the format (e.g. "txt:")
+				return StringView{ptr + 4, static_cast<std::size_t>(length) - 4u};
+			}
+			return StringView{ptr, static_cast<std::size_t>(length)};
+		}
+
+		/// Returns the value of a double reply
+		/**
+		 *	Integers and numeric strings (e.g. scores replied by RESP2
+		 *	servers) are converted, too.
+		 *
+		 *	@throw TypeError if the reply is no number
+		 *	@return Value of the double
+		 */
+		inline double getDouble() const {
+			if (isInteger()) {
+				return static_cast<double>(getInteger());
+			}
+			auto str = getString();
+			double value;
+			if (!priv::parse_number(str.data(), str.data() + str.size(), value)) {
+				throw TypeError{"Reply is not a number"};
+			}
+			return value;
+		}
+
+		/// Returns the value of a boolean reply
+		/**
+		 *	The integers 0 and 1 (as replied by RESP2 servers) are converted,
+		 *	too.
+		 *
+		 *	@throw TypeError if the reply is no boolean
+		 *	@return Value of the boolean
+		 */
+		inline bool getBoolean() const {
+			if (isBoolean()) {
+				return header()[1] == 't';
+			}
+			if (isInteger()) {
+				auto value = getInteger();
+				if (value == 0 || value == 1) {
+					return value == 1;
+				}
+			}
+			throw TypeError{"Reply is not a boolean"};
+		}
+
+		/// Returns the value of an integer reply
+		/**
+		 *	@throw TypeError if the reply is no integer
+		 *	@return Value of the integer
+		 */
+		inline std::int64_t getInteger() const {
+			if (!isInteger()) {
+				throw TypeError{"Reply is not an integer"};
+			}
+			auto ptr = header() + 1;
+			return priv::decode_number(ptr);
+		}
+
+		/// Returns the number of elements of an aggregate reply
+		/**
+		 *	Only the aggregate's header is decoded here. A map has twice as
+		 *	many elements as entries: its keys and values in turn.
+		 *
+		 *	@return Number of elements OR 0 if the reply is not an aggregate
+		 */
+		inline std::size_t size() const {
+			if (!isAggregate()) {
+				return 0u;
+			}
+			auto ptr = header() + 1;
+			auto num = static_cast<std::size_t>(priv::decode_number(ptr));
+			return isMap() ? 2u * num : num;
+		}
+
+		/// Query whether an array reply has no elements
+		/**
+		 *	@return True if the reply has no elements or is not an array
+		 */
+		inline bool empty() const {
+			return size() == 0u;
+		}
+
+		/// Build an index for random access to the elements
+		/**
+		 *	This walks the array once and records the position of each element.
+		 *	Afterwards, accessing an element by index takes constant time. The
+		 *	index is shared with copies of this reply that are made afterwards.
+		 *	Nothing is done if the index was already built.
+		 */
+		void buildIndex() {
+			if (index != nullptr || !isAggregate()) {
+				return;
+			}
+			auto tmp = std::make_shared<std::vector<std::size_t>>();
+			tmp->reserve(size());
+			for (auto it = begin(); it != end(); ++it) {
+				tmp->push_back((*it).offset);
+			}
+			index = std::move(tmp);
+		}
+
+		/// Query whether an index for random access was built
+		/**
+		 *	@return True if accessing elements by index takes constant time
+		 */
+		inline bool hasIndex() const {
+			return index != nullptr;
+		}
+
+		/// Returns an element of an array reply
+		/**
+		 *	Without an index, this walks the array up to the given element.
+		 *
+		 *	@throw TypeError if the reply is not an array
+		 *	@throw std::out_of_range if the index exceeds the array
+		 *	@param pos Index of the element
+		 *	@return Element reply
+		 */
+		LazyReply at(std::size_t pos) const {
+			if (!isAggregate()) {
+				throw TypeError{"Reply is not an array"};
+			}
+			if (pos >= size()) {
+				throw std::out_of_range{"Index " + std::to_string(pos) + " exceeds array of size " + std::to_string(size())};
+			}
+			if (index != nullptr) {
+				return LazyReply{data, (*index)[pos]};
+			}
+			auto it = begin();
+			for (; pos > 0u; --pos) {
+				++it;
+			}
+			return *it;
+		}
+
+		inline LazyReply operator[](std::size_t pos) const {
+			return at(pos);
+		}
+
+		inline const_iterator begin() const {
+			return isAggregate() ? const_iterator{data, first(), size()} : const_iterator{};
+		}
+
+		inline const_iterator end() const {
+			return const_iterator{};
+		}
+};
+
+} // ::redisxx
@@ -0,0 +1,818 @@
+/** @file multiplexer.hpp
+ *
+ * RedisXX request multiplexing implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <redisxx/error.hpp>
+#include <redisxx/event_loop.hpp>
+#include <redisxx/lazy_reply.hpp>
+#include <redisxx/parser.hpp>
+#include <redisxx/pipeline.hpp>
+#include <redisxx/pool.hpp>
+#include <redisxx/reply.hpp>
+#include <redisxx/segments.hpp>
+#include <redisxx/socket.hpp>
+#include <redisxx/type_traits.hpp>
+
+namespace redisxx {
+namespace priv {
+
+// whether sockets of the given type are watched by the event loop
+template <typename SocketImpl>
+struct uses_event_loop: std::integral_constant<bool,
+#if defined(REDISXX_EPOLL)
+	has_native_handle<SocketImpl>::value && !has_watch<SocketImpl>::value && !has_async_read<SocketImpl>::value
+#else
+	false
+#endif
+	> {
+};
+
+// whether the calling thread runs a channel's reader (e.g. the event loop's thread)
+inline bool& on_reader_thread() {
+	static thread_local bool reading = false;
+	return reading;
+}
+
+// marks the calling thread as a reader while it exists
+class ReaderScope {
+	private:
+		bool const previous;
+
+	public:
+		ReaderScope()
+			: previous{on_reader_thread()} {
+			on_reader_thread() = true;
+		}
+
+		ReaderScope(ReaderScope const &) = delete;
+
+		~ReaderScope() {
+			on_reader_thread() = previous;
+		}
+};
+
+// how replies are received (see `Channel`)
+struct WatchReader {};
+struct AsyncReader {};
+struct EventLoopReader {};
+struct ThreadReader {};
+
+template <typename SocketImpl>
+using reader_of = typename std::conditional<has_watch<SocketImpl>::value, WatchReader,
+	typename std::conditional<has_async_read<SocketImpl>::value, AsyncReader,
+	typename std::conditional<uses_event_loop<SocketImpl>::value, EventLoopReader,
+	ThreadReader>::type>::type>::type;
+
+/// Socket that is shared by many in-flight requests
+/**
+ *	Requests are written by the submitting threads right away, one after
+ *	another, and their completions are queued in the same order. Because the
+ *	server replies in order, each received reply completes the oldest queued
+ *	request. So any number of requests can be in flight at the same time
+ *	without waiting for each other.
+ *	Replies are received by a single reader: if the socket watches itself
+ *	(e.g. using io_uring), it calls the reader once data was received. If the
+ *	socket supports asynchronous reads (e.g. using Boost.Asio), a read is
+ *	always pending and its handler is the reader. If the socket provides its
+ *	native handle, the shared event loop calls the reader once the socket is
+ *	readable. Else, a reader thread is dedicated to the channel, which only
+ *	reads while replies are expected. In neither case a thread is started
+ *	per request.
+ *	All replies that are completed by the same read share one receive buffer.
+ *	A buffer is never modified after one of its replies was completed.
+ *	If reading or writing fails, the channel is broken: each queued request
+ *	gets the exception and further requests are rejected. The socket is
+ *	closed once the channel is destroyed.
+ *	A channel that is closed by a reader (e.g. because a callback released
+ *	the last connection) keeps itself alive until its queue drained, so the
+ *	reader gives the socket back instead of waiting for itself.
+ *	Push frames (RESP3) are passed to the pool's push handler by the reader,
+ *	no matter whether they precede a reply or arrive while no request is in
+ *	flight. A dedicated reader thread only reads while requests are in
+ *	flight, though, so it delivers those frames with the next reply.
+ *	Note that a blocking command (e.g. BLPOP) delays all requests that were
+ *	submitted after it.
+ */
+template <typename SocketImpl>
+class Channel: public std::enable_shared_from_this<Channel<SocketImpl>> {
+
+	using Lease = typename SocketPool<SocketImpl>::Lease;
+	using Clock = std::chrono::steady_clock;
+
+	public:
+		using Callback = std::function<void(std::exception_ptr, Reply)>;
+		using LazyCallback = std::function<void(std::exception_ptr, LazyReply)>;
+
+	private:
+		struct InFlight {
+			ReplyLayout layout;
+			Callback callback;			// set if values are recorded
+			LazyCallback lazy_callback;	// set if the reply is decoded lazily
+		};
+
+		// reply that was received but not passed on yet
+		struct Finished {
+			InFlight request;
+			std::size_t root;	// index of the first value OR offset of the first byte
+		};
+
+		std::shared_ptr<SocketPool<SocketImpl>> const pool;
+		Lease socket;
+
+		std::mutex write_mutex;		// keeps writes in the order of the queue
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<InFlight> in_flight;
+		bool broken, closing;
+		Clock::time_point drained;		// when the last queued request was completed
+		std::uint64_t registration;
+		std::shared_ptr<Channel> lingering;		// keeps a channel closed by a reader alive
+
+		// receive state (only used by the reader)
+		std::shared_ptr<ReplyData> data;
+		ReplyParser parser;
+		std::size_t parsed, received;
+		bool receiving;		// whether the oldest request's reply was started
+		bool pushing;		// whether push frames are parsed while no reply was started
+		std::size_t start;	// first byte of the current reply
+		std::size_t root;	// first value of the current reply
+
+		// start parsing the reply to the oldest request
+		void begin(InFlight const & request, bool insert_header) {
+			if (insert_header && request.layout.grouped) {
+				auto header = request.layout.header();
+				data->buffer.insert(parsed, header);
+				received += header.size();
+			}
+			start = parsed;
+			root = data->nodes.size();
+			parser = ReplyParser{request.callback ? &data->nodes : nullptr, parsed, &pool->getPolicy().push_handler};
+			receiving = true;
+		}
+
+		// parse push frames received while no reply was started, return whether they are complete
+		bool push(std::unique_lock<std::mutex>& lock) {
+			if (!pushing) {
+				parser = ReplyParser{nullptr, parsed, &pool->getPolicy().push_handler};
+				parser.idle();
+				pushing = true;
+			}
+			lock.unlock();
+			auto consumed = parser.feed(data->buffer.data() + parsed, received - parsed);
+			if (consumed == 0u) {
+				throw ProtocolError{"Received data without a pending request"};
+			}
+			parsed += consumed;
+			pushing = !parser.done();
+			return !pushing;
+		}
+
+		// parse received bytes and pass on each completed reply
+		void complete() {
+			std::vector<Finished> finished;
+			while (true) {
+				std::unique_lock<std::mutex> lock{mutex};
+				if (broken) {
+					// queued requests already got the exception
+					return;
+				}
+				if (!receiving) {
+					if (pushing || in_flight.empty()) {
+						// the current push frame is finished before the next reply begins
+						if (parsed == received || !push(lock)) {
+							break;
+						}
+						continue;
+					}
+					begin(in_flight.front(), true);
+				}
+				lock.unlock();
+				parsed += parser.feed(data->buffer.data() + parsed, received - parsed);
+				if (!parser.done()) {
+					break;
+				}
+				receiving = false;
+				lock.lock();
+				auto position = in_flight.front().callback ? root : start;
+				finished.push_back(Finished{std::move(in_flight.front()), position});
+				in_flight.pop_front();
+				if (in_flight.empty()) {
+					drained = Clock::now();
+				}
+			}
+			if (finished.empty()) {
+				return;
+			}
+			changed.notify_all();
+			// move the pending rest to a new buffer, so the finished one is not modified anymore
+			auto next = std::make_shared<ReplyData>();
+			auto rest = receiving ? start : parsed;
+			next->buffer.assign(data->buffer, rest, received - rest);
+			data->buffer.resize(rest);
+			auto done = std::move(data);
+			data = std::move(next);
+			received -= rest;
+			parsed = 0u;
+			if (receiving) {
+				// parse the incomplete reply again (its header was already inserted)
+				{
+					std::lock_guard<std::mutex> lock{mutex};
+					begin(in_flight.front(), false);
+				}
+				// push frames were already passed on
+				parser.replay(received);
+				parsed += parser.feed(data->buffer.data(), received);
+			}
+			// build all replies before any of them is passed on
+			std::vector<Reply> replies;
+			replies.reserve(finished.size());
+			for (auto& item: finished) {
+				replies.push_back(item.request.callback ? make_reply(item.request.layout, done, item.root) : Reply{});
+			}
+			for (auto i = 0u; i < finished.size(); ++i) {
+				auto& request = finished[i].request;
+				if (request.callback) {
+					invoke_callback(request.callback, nullptr, std::move(replies[i]));
+				} else {
+					invoke_callback(request.lazy_callback, nullptr, LazyReply{done, finished[i].root});
+				}
+			}
+			settle();
+		}
+
+		// give the socket back once the queue of a channel closed by a reader drained
+		void settle() {
+			std::shared_ptr<Channel> self;
+			std::lock_guard<std::mutex> lock{mutex};
+			if (lingering != nullptr && (broken || in_flight.empty())) {
+				if (!broken) {
+					socket.recycle();
+				}
+				// the reader still holds the channel, so it is not destroyed here
+				self = std::move(lingering);
+			}
+		}
+
+		// make room for the next read, return the number of bytes that fit
+		std::size_t prepare() {
+			auto& buffer = data->buffer;
+			auto needed = received + std::max(receiving ? parser.expected() : 0u, read_chunk_size);
+			if (buffer.size() < needed) {
+				if (buffer.capacity() < needed) {
+					buffer.reserve(std::max(needed, 2u * buffer.capacity()));
+				}
+				buffer.resize(buffer.capacity());
+			}
+			return buffer.size() - received;
+		}
+
+		// read once and pass on completed replies
+		void pump(bool blocking) {
+			ReaderScope scope;
+			try {
+				auto size = prepare();
+				auto& buffer = data->buffer;
+				auto num_bytes = socket->read_some(&buffer[received], size);
+				if (num_bytes == 0u) {
+					if (!blocking) {
+						return;
+					}
+					socket->read_block(&buffer[received], 1u);
+					num_bytes = 1u;
+				}
+				received += num_bytes;
+				complete();
+			} catch (...) {
+				fail(std::current_exception());
+			}
+		}
+
+		// break the channel and pass the exception to each queued request
+		void fail(std::exception_ptr error) {
+			std::deque<InFlight> failed;
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				if (broken) {
+					return;
+				}
+				broken = true;
+				failed.swap(in_flight);
+			}
+			changed.notify_all();
+			unregister(reader_of<SocketImpl>{});
+			for (auto& request: failed) {
+				if (request.callback) {
+					invoke_callback(request.callback, error, Reply{});
+				} else {
+					invoke_callback(request.lazy_callback, error, LazyReply{});
+				}
+			}
+			settle();
+		}
+
+		// read while replies are expected (used without event loop)
+		void read_loop() {
+			while (true) {
+				{
+					std::unique_lock<std::mutex> lock{mutex};
+					changed.wait(lock, [&]() {
+						return broken || closing || !in_flight.empty();
+					});
+					if (broken || in_flight.empty()) {
+						return;
+					}
+				}
+				pump(true);
+			}
+		}
+
+		// start the next asynchronous read (used with asynchronous sockets)
+		void read_async() {
+			auto size = prepare();
+			std::weak_ptr<Channel> weak = this->shared_from_this();
+			// the buffer stays alive until the read completed
+			auto buffer = data;
+			socket->async_read_some(&buffer->buffer[received], size, [weak, buffer](std::exception_ptr error, std::size_t num_bytes) {
+				auto self = weak.lock();
+				if (self != nullptr) {
+					self->on_read(error, num_bytes);
+				}
+			});
+		}
+
+		// pass on completed replies and continue reading
+		void on_read(std::exception_ptr error, std::size_t num_bytes) {
+			ReaderScope scope;
+			try {
+				if (error != nullptr) {
+					std::rethrow_exception(error);
+				}
+				received += num_bytes;
+				complete();
+				if (!isBroken()) {
+					read_async();
+				}
+			} catch (...) {
+				fail(std::current_exception());
+			}
+		}
+
+		void start_reader(WatchReader) {
+			std::weak_ptr<Channel> weak = this->shared_from_this();
+			socket->watch([weak]() {
+				auto self = weak.lock();
+				if (self != nullptr) {
+					self->pump(false);
+				}
+			});
+		}
+
+		void start_reader(AsyncReader) {
+			read_async();
+		}
+
+		void start_reader(EventLoopReader) {
+#if defined(REDISXX_EPOLL)
+			std::weak_ptr<Channel> weak = this->shared_from_this();
+			registration = EventLoop::get().add(socket->native_handle(), [weak]() {
+				auto self = weak.lock();
+				if (self != nullptr) {
+					self->pump(false);
+				}
+			});
+#endif
+		}
+
+		void start_reader(ThreadReader) {
+			// the thread keeps the channel alive until it is closed
+			auto self = this->shared_from_this();
+			std::thread{[self]() {
+				self->read_loop();
+			}}.detach();
+		}
+
+		void unregister(WatchReader) {
+			socket->unwatch();
+		}
+
+		void unregister(AsyncReader) {
+			// the pending read must not take data from the socket's next user
+			socket->cancel();
+		}
+
+		void unregister(EventLoopReader) {
+#if defined(REDISXX_EPOLL)
+			EventLoop::get().remove(registration);
+#endif
+		}
+
+		void unregister(ThreadReader) {
+			// the reader thread stops by itself
+		}
+
+		Channel(std::shared_ptr<SocketPool<SocketImpl>> pool, Lease socket)
+			: pool{std::move(pool)}
+			, socket{std::move(socket)}
+			, write_mutex{}
+			, mutex{}
+			, changed{}
+			, in_flight{}
+			, broken{false}
+			, closing{false}
+			, drained{Clock::now()}
+			, registration{0u}
+			, lingering{}
+			, data{std::make_shared<ReplyData>()}
+			, parser{}
+			, parsed{0u}
+			, received{0u}
+			, receiving{false}
+			, pushing{false}
+			, start{0u}
+			, root{0u} {
+		}
+
+	public:
+		/// Open a channel on a socket leased from the given pool
+		/**
+		 *	@param pool Pool the socket was leased from
+		 *	@param socket Lease of the socket
+		 *	@return Shared pointer to the channel
+		 */
+		static std::shared_ptr<Channel> open(std::shared_ptr<SocketPool<SocketImpl>> pool, Lease socket) {
+			std::shared_ptr<Channel> channel{new Channel{std::move(pool), std::move(socket)}};
+			channel->start_reader(reader_of<SocketImpl>{});
+			return channel;
+		}
+
+		~Channel() {
+			unregister(reader_of<SocketImpl>{});
+		}
+
+		/// Query whether the channel is broken
+		/**
+		 *	@return True if the channel rejects further requests
+		 */
+		inline bool isBroken() {
+			std::lock_guard<std::mutex> lock{mutex};
+			return broken;
+		}
+
+		/// Query whether the channel accepts requests
+		/**
+		 *	@param load Set to the number of requests in flight
+		 *	@return False if the channel is broken or closing
+		 */
+		inline bool isUsable(std::size_t& load) {
+			std::lock_guard<std::mutex> lock{mutex};
+			load = in_flight.size();
+			return !broken && !closing;
+		}
+
+		/// Stop accepting requests if the channel is idle for too long
+		/**
+		 *	A channel is idle if no request is in flight. Once it was idle
+		 *	for longer than the given time, further requests are rejected
+		 *	and its socket is closed once the channel is destroyed (as the
+		 *	server might have closed it already).
+		 *
+		 *	@param now Current time
+		 *	@param max_idle Max. idle time
+		 *	@return True if the channel was retired
+		 */
+		bool retire(Clock::time_point now, std::chrono::milliseconds max_idle) {
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				if (broken || closing || !in_flight.empty() || now - drained <= max_idle) {
+					return false;
+				}
+				closing = true;
+			}
+			changed.notify_all();
+			return true;
+		}
+
+		/// Send a request and call the given function once its reply arrived
+		/**
+		 *	The request is written by the calling thread. The callback is
+		 *	called by the reader, either with the reply or with the exception
+		 *	that broke the channel. Exceptions thrown by the callback are
+		 *	ignored. It is only moved from if the request was accepted, so a
+		 *	rejected request can be retried without copying it.
+		 *
+		 *	@param request Segments of the RESP-compliant request
+		 *	@param layout Layout of the request's replies
+		 *	@param callback Function to pass the reply to
+		 *	@return False if the channel is broken or closing and the request
+		 *		was rejected
+		 */
+		bool submit(Segments const & request, ReplyLayout const & layout, Callback& callback) {
+			InFlight pending{layout, std::move(callback), LazyCallback{}};
+			if (!send(request, pending)) {
+				callback = std::move(pending.callback);
+				return false;
+			}
+			return true;
+		}
+
+		/// Send a request and call the given function once its lazy reply arrived
+		/**
+		 *	Equivalent to `submit()`, but the reply's values are not recorded.
+		 *	Transactions are not unpacked.
+		 *
+		 *	@param request Segments of the RESP-compliant request
+		 *	@param layout Layout of the request's replies
+		 *	@param callback Function to pass the reply to
+		 *	@return False if the channel is broken or closing and the request
+		 *		was rejected
+		 */
+		bool submitLazy(Segments const & request, ReplyLayout const & layout, LazyCallback& callback) {
+			InFlight pending{layout, Callback{}, std::move(callback)};
+			if (!send(request, pending)) {
+				callback = std::move(pending.lazy_callback);
+				return false;
+			}
+			return true;
+		}
+
+		/// Wait for all queued requests and give the socket back
+		/**
+		 *	If the channel is not broken afterwards, its socket is returned to
+		 *	the pool once the channel is destroyed.
+		 *	If this is called by a reader (e.g. inside a callback), it does
+		 *	not wait, because the queued requests might need this reader.
+		 *	The channel is kept alive instead, until the reader passed on
+		 *	the last queued reply.
+		 */
+		void close() {
+			std::unique_lock<std::mutex> lock{mutex};
+			closing = true;
+			changed.notify_all();
+			if (on_reader_thread()) {
+				if (!broken && !in_flight.empty()) {
+					lingering = this->shared_from_this();
+				} else if (!broken) {
+					socket.recycle();
+				}
+				return;
+			}
+			changed.wait(lock, [&]() {
+				return broken || in_flight.empty();
+			});
+			if (!broken) {
+				socket.recycle();
+			}
+		}
+
+	private:
+		// queue the pending request (moved from unless rejected) and write it
+		bool send(Segments const & request, InFlight& pending) {
+			auto segments = request.gather();
+			std::lock_guard<std::mutex> guard{write_mutex};
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				if (broken || closing) {
+					return false;
+				}
+				in_flight.push_back(std::move(pending));
+			}
+			changed.notify_all();
+			try {
+				_write_segments(*socket, segments.data(), segments.size());
+			} catch (...) {
+				fail(std::current_exception());
+			}
+			return true;
+		}
+};
+
+// create a callback that fulfils the given promise
+template <typename Result>
+std::function<void(std::exception_ptr, Result)> fulfil(std::shared_ptr<std::promise<Result>> promise) {
+	return [promise](std::exception_ptr error, Result result) {
+		if (error != nullptr) {
+			promise->set_exception(error);
+		} else {
+			promise->set_value(std::move(result));
+		}
+	};
+}
+
+/// Multiplexing of requests onto shared channels
+/**
+ *	Requests are spread over up to as many channels as the pool policy's
+ *	size allows. Each thread submits to the channel it was bound to with its
+ *	first request, so requests of the same thread are executed in the order
+ *	of submission. A thread is bound to the least loaded channel. If that one
+ *	has requests in flight, another channel is opened instead (unless the
+ *	pool is exhausted). A thread is bound again once its channel broke or
+ *	was closed.
+ *	A channel is opened with the first request that needs it and replaced by
+ *	a new one once it broke. So a failure only affects the requests that were
+ *	in flight on that channel. If the pool policy limits the idle time, a
+ *	channel that was idle for longer is closed about then (while requests
+ *	are submitted) and its threads are bound again.
+ */
+template <typename SocketImpl>
+class Multiplexer {
+
+	using ChannelPtr = std::shared_ptr<Channel<SocketImpl>>;
+	using Clock = std::chrono::steady_clock;
+
+	private:
+		// channel the calling thread submits to
+		struct Binding {
+			Multiplexer const * owner;
+			std::weak_ptr<Channel<SocketImpl>> channel;
+		};
+
+		std::shared_ptr<SocketPool<SocketImpl>> const pool;
+		std::mutex mutex;
+		std::vector<ChannelPtr> channels;
+		Clock::time_point expired;		// when idle channels were retired last
+
+		// return the calling thread's binding
+		Binding& bind() {
+			static thread_local std::vector<Binding> bindings;
+			for (auto& binding: bindings) {
+				if (binding.owner == this) {
+					// note: a channel of a destroyed multiplexer at the same address was closed
+					return binding;
+				}
+			}
+			bindings.erase(std::remove_if(bindings.begin(), bindings.end(), [](Binding const & binding) {
+				return binding.channel.expired();
+			}), bindings.end());
+			bindings.push_back(Binding{this, {}});
+			return bindings.back();
+		}
+
+		// retire channels that exceed the idle time
+		void expire() {
+			auto const max_idle = pool->getPolicy().max_idle;
+			auto const now = Clock::now();
+			std::vector<ChannelPtr> retired;
+			std::lock_guard<std::mutex> lock{mutex};
+			if (now - expired < max_idle / 2) {
+				return;
+			}
+			expired = now;
+			for (auto it = channels.begin(); it != channels.end(); ) {
+				if ((*it)->retire(now, max_idle)) {
+					// close the socket after releasing the lock
+					retired.push_back(std::move(*it));
+					it = channels.erase(it);
+				} else {
+					++it;
+				}
+			}
+		}
+
+		// add a channel that was opened without holding the lock
+		ChannelPtr publish(ChannelPtr channel) {
+			std::lock_guard<std::mutex> lock{mutex};
+			channels.push_back(channel);
+			return channel;
+		}
+
+		// return the least loaded channel or a new one if it is busy
+		ChannelPtr pick() {
+			ChannelPtr best;
+			{
+				std::lock_guard<std::mutex> lock{mutex};
+				std::size_t best_load = 0u;
+				for (auto it = channels.begin(); it != channels.end(); ) {
+					std::size_t load = 0u;
+					if (!(*it)->isUsable(load)) {
+						it = channels.erase(it);
+						continue;
+					}
+					if (best == nullptr || load < best_load) {
+						best = *it;
+						best_load = load;
+					}
+					++it;
+				}
+				auto const size = pool->getPolicy().size;
+				if (best != nullptr && (best_load == 0u || (size > 0u && channels.size() >= size))) {
+					return best;
+				}
+			}
+			// leasing may wait for the pool or connect (and handshake), so other threads are not blocked meanwhile
+			if (best == nullptr) {
+				return publish(Channel<SocketImpl>::open(pool, pool->acquire()));
+			}
+			try {
+				auto socket = pool->tryAcquire();
+				if (socket == nullptr) {
+					return best;
+				}
+				return publish(Channel<SocketImpl>::open(pool, std::move(*socket)));
+			} catch (ConnectionError const &) {
+				// keep using the busy channel
+				return best;
+			}
+		}
+
+		// return a usable channel for the calling thread
+		ChannelPtr acquire() {
+			if (pool->getPolicy().max_idle.count() > 0) {
+				expire();
+			}
+			auto& binding = bind();
+			auto channel = binding.channel.lock();
+			std::size_t load = 0u;
+			if (channel == nullptr || !channel->isUsable(load)) {
+				// drop the broken channel first, so its socket can be replaced
+				channel.reset();
+				channel = pick();
+				binding.channel = channel;
+			}
+			return channel;
+		}
+
+	public:
+		/// Create a multiplexer using the given pool
+		/**
+		 *	@param pool Pool to lease the channels' sockets from
+		 */
+		Multiplexer(std::shared_ptr<SocketPool<SocketImpl>> pool)
+			: pool{std::move(pool)}
+			, mutex{}
+			, channels{}
+			, expired{Clock::now()} {
+		}
+
+		/// Wait for all queued requests
+		/**
+		 *	If the multiplexer is destroyed by a reader (e.g. a callback
+		 *	released the last connection), the queued requests are
+		 *	completed after this returned (see `Channel::close()`).
+		 */
+		~Multiplexer() {
+			for (auto& channel: channels) {
+				channel->close();
+			}
+		}
+
+		/// Submit a request
+		/**
+		 *	If no channel can be opened, the callback gets the exception.
+		 *	The request is written before this returns. Exceptions thrown by
+		 *	the callback are ignored (see `priv::invoke_callback()`).
+		 *
+		 *	@param request Segments of the RESP-compliant request
+		 *	@param layout Layout of the request's replies
+		 *	@param callback Function to pass the reply to
+		 */
+		void submit(Segments const & request, ReplyLayout const & layout,
+			typename Channel<SocketImpl>::Callback callback) {
+			try {
+				while (!acquire()->submit(request, layout, callback)) {
+					// channel broke meanwhile, so retry using a new one
+				}
+			} catch (...) {
+				invoke_callback(callback, std::current_exception(), Reply{});
+			}
+		}
+
+		/// Submit a request whose reply is decoded lazily
+		/**
+		 *	@param request Segments of the RESP-compliant request
+		 *	@param layout Layout of the request's replies
+		 *	@param callback Function to pass the reply to
+		 */
+		void submitLazy(Segments const & request, ReplyLayout const & layout,
+			typename Channel<SocketImpl>::LazyCallback callback) {
+			try {
+				while (!acquire()->submitLazy(request, layout, callback)) {
+					// channel broke meanwhile, so retry using a new one
+				}
+			} catch (...) {
+				invoke_callback(callback, std::current_exception(), LazyReply{});
+			}
+		}
+};
+
+} // ::priv
+} // ::redisxx
@@ -0,0 +1,672 @@
+/** @file parser.hpp
+ *
+ * RedisXX reply parser implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <redisxx/error.hpp>
+#include <redisxx/reply.hpp>
+#include <redisxx/simd.hpp>
+
+namespace redisxx {
+
+/// Handler of push frames (RESP3)
+/**
+ *	Push frames are sent by the server on its own (e.g. invalidations of
+ *	keys tracked by CLIENT TRACKING), so they don't belong to any request.
+ *	The handler is called by the thread that received the frame, so it
+ *	should neither block nor throw.
+ */
+using PushHandler = std::function<void(Reply)>;
+
+namespace priv {
+
+/// Resumable parser for the framing of RESP replies
+/**
+ *	The parser is fed with arbitrary chunks of a reply stream and determines
+ *	where a reply ends, including nested arrays, bulk strings and null values.
+ *	It keeps its state between two chunks, so each byte is inspected at most
+ *	once and a reply can be split at any position. Bulk payloads are skipped
+ *	without being inspected.
+ *	Instead of a stack of nested arrays, the parser only counts the values
+ *	that are left until the current reply is complete.
+ *	Values that are completely contained in a chunk (which is the common
+ *	case) are parsed at once: the line of an integer or a length is located
+ *	and validated using a SIMD kernel (see `ScanKernel`), which is chosen at
+ *	runtime, and bulk payloads are skipped without entering the byte-wise
+ *	state machine. Values that are split between chunks (and anything the
+ *	fast path does not accept) are handled byte by byte.
+ *	Optionally, the parser records each value while it passes by. Offsets of
+ *	those values refer to the position inside the fed stream, so the stream
+ *	is expected to be stored contiguously (e.g. in a receive buffer).
+ *	Both RESP2 and RESP3 are understood. Push frames (RESP3) are sent out of
+ *	band, so they may precede any reply (or any reply grouped as an array).
+ *	They are neither recorded nor counted as a reply, but copied and passed
+ *	to the push handler (if any) once they are complete.
+ *
+ *	Example usage:
+ *	@code
+ *		redisxx::priv::ReplyParser parser;
+ *		std::size_t used = parser.feed("*2\r\n$3\r\nfo", 11u);	// used == 11
+ *		used = parser.feed("o\r\n:5\r\n+OK\r\n", 13u);			// used == 8
+ *		// parser.done() == true, "+OK\r\n" belongs to the next reply
+ *	@endcode
+ */
+class ReplyParser {
+	private:
+		enum class State {
+			Type,		// expecting the type byte of the next value
+			Line,		// reading a simple string, error, double etc. until CR
+			Number,		// reading an integer or a length until CR
+			LineFeed,	// expecting LF after a line
+			Payload,	// skipping the payload of a bulk string
+			PayloadCR,	// expecting CR after a bulk string's payload
+			PayloadLF	// expecting LF after a bulk string's payload
+		};
+
+		State state;
+		ScanKernel kernel;		// used by the fast path
+		char type;				// type byte of the current value
+		bool negative;			// whether the current number is negative
+		bool has_digits;		// whether the current number has any digit
+		std::uint64_t number;	// absolute value of the current number
+		std::int64_t remaining;	// bytes of the current bulk payload left
+		std::size_t pending;	// values left until the reply is complete
+		std::size_t position;	// stream position of the next fed byte
+		std::size_t line_start;	// stream position of the current line
+
+		// arrays whose elements are recorded
+		struct Level {
+			std::size_t next;	// index of the next element
+			std::size_t left;	// number of elements left
+		};
+		std::vector<ReplyNode>* nodes;
+		std::vector<Level> levels;
+
+		// push frames
+		PushHandler const * handler;
+		bool keep_pushes;			// whether push frames are parsed like replies
+		bool idling;				// whether push frames are expected after the reply
+		bool in_push;				// whether a push frame is being parsed
+		std::size_t saved_pending;	// values left after the push frame
+		std::vector<ReplyNode>* saved_nodes;
+		std::string push_bytes;		// of the current push frame
+		std::size_t replayed;		// end of the stream that was fed before
+
+		// whether the type byte starts a value that ends with its first line
+		static inline bool is_line(char type) {
+			return type == '+' || type == '-' || type == ',' || type == '(' || type == '#' || type == '_';
+		}
+
+		// whether the type byte starts a value whose first line is a number
+		static inline bool is_header(char type) {
+			return type == ':' || type == '$' || type == '*' || type == '%' || type == '~' || type == '>'
+				|| type == '!' || type == '=';
+		}
+
+		// record a value at its slot
+		void record(ReplyType type, std::size_t offset, std::int64_t value) {
+			if (nodes == nullptr) {
+				return;
+			}
+			std::size_t slot;
+			if (levels.empty()) {
+				slot = nodes->size();
+				nodes->emplace_back();
+			} else {
+				slot = levels.back().next++;
+				if (--levels.back().left == 0u) {
+					levels.pop_back();
+				}
+			}
+			if (is_aggregate(type)) {
+				// reserve contiguous slots for the elements
+				offset = nodes->size();
+				nodes->resize(offset + static_cast<std::size_t>(value));
+				if (value > 0) {
+					levels.push_back(Level{offset, static_cast<std::size_t>(value)});
+				}
+			}
+			(*nodes)[slot] = ReplyNode{type, offset, value};
+		}
+
+		// handle a complete simple string, error, double, big number, boolean or null
+		void line(std::size_t start, std::size_t size) {
+			switch (type) {
+				case '+':
+					record(ReplyType::Status, start, static_cast<std::int64_t>(size));
+					break;
+				case '-':
+					record(ReplyType::Error, start, static_cast<std::int64_t>(size));
+					break;
+				case ',':
+					record(ReplyType::Double, start, static_cast<std::int64_t>(size));
+					break;
+				case '(':
+					record(ReplyType::BigNumber, start, static_cast<std::int64_t>(size));
+					break;
+				case '#':
+					// characters were checked while passing by
+					if (size != 1u) {
+						throw ProtocolError{"Invalid boolean"};
+					}
+					record(ReplyType::Boolean, start, 1);
+					break;
+				default:
+					if (size != 0u) {
+						throw ProtocolError{"Null carries a value"};
+					}
+					record(ReplyType::Null, 0u, 0);
+					break;
+			}
+			--pending;
+		}
+
+		// handle a complete integer, blob header or aggregate header
+		void header(std::size_t offset) {
+			// -2^63 is negated without overflowing
+			auto value = (negative && number > 0u)
+				? -static_cast<std::int64_t>(number - 1u) - 1
+				: static_cast<std::int64_t>(number);
+			switch (type) {
+				case '$':
+				case '!':
+				case '=':
+					if (value >= 0) {
+						if (type == '=') {
+							// skip the format (e.g. "txt:")
+							if (value < 4) {
+								throw ProtocolError{"Verbatim string lacks its format"};
+							}
+							record(ReplyType::Verbatim, offset + 4u, value - 4);
+						} else {
+							record((type == '$') ? ReplyType::Bulk : ReplyType::Error, offset, value);
+						}
+						remaining = value;
+						state = (value > 0) ? State::Payload : State::PayloadCR;
+						return;
+					}
+					if (value != -1 || type != '$') {
+						throw ProtocolError{"Invalid bulk string length " + std::to_string(value)};
+					}
+					record(ReplyType::Null, 0u, 0);
+					break;
+
+				case '*':
+				case '%':
+				case '~':
+				case '>': {
+					if (value < -1 || (value == -1 && type != '*')
+						|| value > std::numeric_limits<std::int64_t>::max() / 2) {
+						throw ProtocolError{"Invalid array length " + std::to_string(value)};
+					}
+					if (value == -1) {
+						record(ReplyType::Null, 0u, 0);
+						break;
+					}
+					auto aggregate = ReplyType::Array;
+					if (type == '%') {
+						// a map is recorded as its keys and values in turn
+						aggregate = ReplyType::Map;
+						value *= 2;
+					} else if (type == '~') {
+						aggregate = ReplyType::Set;
+					} else if (type == '>') {
+						aggregate = ReplyType::Push;
+					}
+					record(aggregate, 0u, value);
+					if (value > 0) {
+						// replace aggregate by its elements
+						pending += static_cast<std::size_t>(value) - 1u;
+						return;
+					}
+					// empty aggregate
+					break;
+				}
+
+				default:
+					record(ReplyType::Integer, 0u, value);
+					break;
+			}
+			--pending;
+		}
+
+		// parse all values that are completely contained in the chunk at once
+		// (stops at the first value that is not, which is left to feed())
+		template <typename Scanner>
+		REDISXX_ALWAYS_INLINE char const * scan(char const * begin, char const * data, char const * end) {
+			while (pending > 0u && data != end) {
+				auto first = *data;
+				if (is_line(first)) {
+					auto cr = static_cast<char const *>(std::memchr(data + 1, '\r', end - data - 1));
+					if (cr == nullptr || end - cr < 2 || cr[1] != '\n') {
+						return data;
+					}
+					if (first == '#' && (cr - data != 2 || (data[1] != 't' && data[1] != 'f'))) {
+						// reported byte by byte
+						return data;
+					}
+					type = first;
+					line(position + (data + 1 - begin), static_cast<std::size_t>(cr - data - 1));
+					data = cr + 2;
+					continue;
+				}
+				if (!is_header(first) || first == '>') {
+					// push frames are diverted byte by byte
+					return data;
+				}
+				auto length = Scanner::header(data + 1, end);
+				if (length < 0) {
+					return data;
+				}
+				auto digits = data + 1;
+				auto cr = digits + length;
+				if (end - cr < 2 || cr[1] != '\n') {
+					return data;
+				}
+				negative = (*digits == '-');
+				if (negative) {
+					++digits;
+				}
+				if (cr - digits > 18) {
+					// might exceed 64 bits, which is checked byte by byte
+					return data;
+				}
+				number = 0;
+				for (; digits != cr; ++digits) {
+					number = number * 10u + static_cast<std::uint64_t>(*digits - '0');
+				}
+				type = first;
+				state = State::Type;
+				data = cr + 2;
+				header(position + (data - begin));
+				if (state == State::Payload || state == State::PayloadCR) {
+					if (end - data < remaining + 2) {
+						return data;
+					}
+					data += remaining;
+					remaining = 0;
+					state = State::PayloadCR;
+					if (data[0] != '\r' || data[1] != '\n') {
+						// reported byte by byte
+						return data;
+					}
+					data += 2;
+					state = State::Type;
+					--pending;
+				}
+			}
+			return data;
+		}
+
+#if defined(REDISXX_SIMD_X86)
+		char const * scan_sse2(char const * begin, char const * data, char const * end) {
+			return scan<Sse2Scanner>(begin, data, end);
+		}
+
+		REDISXX_TARGET_AVX2
+		char const * scan_avx2(char const * begin, char const * data, char const * end) {
+			return scan<Avx2Scanner>(begin, data, end);
+		}
+#endif
+
+		// parse complete values using the selected kernel
+		char const * fast(char const * begin, char const * data, char const * end) {
+			switch (kernel) {
+#if defined(REDISXX_SIMD_X86)
+				case ScanKernel::Avx2:
+					return scan_avx2(begin, data, end);
+				case ScanKernel::Sse2:
+					return scan_sse2(begin, data, end);
+#endif
+				default:
+					return scan<ScalarScanner>(begin, data, end);
+			}
+		}
+
+		// pass a complete push frame to the handler and resume the reply
+		void deliver(std::size_t end_position) {
+			in_push = false;
+			pending = saved_pending;
+			nodes = saved_nodes;
+			std::string frame;
+			frame.swap(push_bytes);
+			if (handler != nullptr && *handler && end_position > replayed) {
+				auto data = std::make_shared<ReplyData>();
+				data->buffer = std::move(frame);
+				ReplyParser parser{&data->nodes};
+				parser.keep_pushes = true;
+				parser.feed(data->buffer.data(), data->buffer.size());
+				(*handler)(Reply{std::move(data), 0u});
+			}
+		}
+
+	public:
+		/// Create a parser that expects a single reply
+		/**
+		 *	If a vector of nodes is given, each value is appended to it. The
+		 *	elements of an array are stored contiguously right after all values
+		 *	that were recorded before the array. So the first value of a reply
+		 *	is recorded at the size of the vector before the reply was fed.
+		 *	If the stream does not start at the beginning of its buffer (e.g.
+		 *	because previous replies were parsed by another parser), the
+		 *	position of the first fed byte can be given.
+		 *
+		 *	Push frames are passed to the given handler, which has to outlive
+		 *	the parser. Without a handler, they are dropped.
+		 *
+		 *	@param nodes Optional vector to record the values to
+		 *	@param position Buffer position of the first fed byte
+		 *	@param handler Optional handler of push frames
+		 */
+		ReplyParser(std::vector<ReplyNode>* nodes=nullptr, std::size_t position=0u,
+			PushHandler const * handler=nullptr)
+			: kernel{getScanKernel()}
+			, position{position}
+			, nodes{nodes}
+			, levels{}
+			, handler{handler}
+			, keep_pushes{false}
+			, replayed{0u} {
+			reset();
+		}
+
+		/// Expect the next reply
+		/**
+		 *	Prepares the parser for the next reply. This is necessary after a
+		 *	reply was completed. Otherwise the parser stops consuming bytes.
+		 *	The stream position is kept, so the next reply is expected to be
+		 *	stored right after the previous one.
+		 */
+		inline void reset() {
+			state = State::Type;
+			type = '\0';
+			negative = false;
+			has_digits = false;
+			number = 0;
+			remaining = 0;
+			pending = 1u;
+			line_start = 0u;
+			levels.clear();
+			idling = false;
+			in_push = false;
+			saved_pending = 0u;
+			saved_nodes = nullptr;
+			push_bytes.clear();
+		}
+
+		/// Expect push frames only
+		/**
+		 *	Prepares the parser for a stream that contains no reply, such as
+		 *	the bytes that were received while no request was pending. Push
+		 *	frames are consumed until anything else is encountered. Since
+		 *	no reply is expected, the parser is done whenever it is not in
+		 *	the middle of a push frame.
+		 */
+		inline void idle() {
+			reset();
+			pending = 0u;
+			idling = true;
+		}
+
+		/// Skip push frames that were fed before
+		/**
+		 *	If the stream is fed again (e.g. after it was moved to another
+		 *	buffer), push frames would be passed to the handler twice. Those
+		 *	frames that end within the given number of bytes (counted from
+		 *	the current stream position) are not passed again.
+		 *
+		 *	@param num_bytes Number of bytes that were fed before
+		 */
+		inline void replay(std::size_t num_bytes) {
+			replayed = position + num_bytes;
+		}
+
+		/// Expect a number of replies grouped as an array
+		/**
+		 *	Prepares the parser for the given number of replies, which are
+		 *	treated as the elements of a single array reply. This has the same
+		 *	effect as feeding an array header, but nothing is fed.
+		 *
+		 *	@param num_replies Number of expected replies
+		 */
+		inline void group(std::size_t num_replies) {
+			reset();
+			record(ReplyType::Array, 0u, static_cast<std::int64_t>(num_replies));
+			pending = num_replies;
+		}
+
+		/// Query whether the current reply is complete
+		/**
+		 *	@return True if the reply was completely parsed
+		 */
+		inline bool done() const {
+			return pending == 0u && !in_push;
+		}
+
+		/// Query the minimum number of bytes that are missing
+		/**
+		 *	This can be used to size the receive buffer: the current reply will
+		 *	not be complete before at least this number of bytes was fed. This
+		 *	is the size of the remaining payload while inside a bulk string.
+		 *
+		 *	@return Lower bound of the bytes that are missing
+		 */
+		inline std::size_t expected() const {
+			if (done()) {
+				return 0u;
+			}
+			switch (state) {
+				case State::Payload:
+					return static_cast<std::size_t>(remaining) + 2u;
+				case State::PayloadCR:
+					return 2u;
+				default:
+					return 1u;
+			}
+		}
+
+		/// Feed the next chunk of the reply stream
+		/**
+		 *	Consumes the given bytes until the current reply is complete. If
+		 *	the reply is completed by this chunk, the remaining bytes are not
+		 *	consumed. They belong to the next reply. Push frames are consumed
+		 *	as well, and passed to the push handler once they are complete.
+		 *
+		 *	@throw ProtocolError if the chunk violates the protocol
+		 *	@throw ... whatever the push handler throws
+		 *	@param data Pointer to the chunk
+		 *	@param num_bytes Size of the chunk
+		 *	@return Number of consumed bytes
+		 */
+		std::size_t feed(char const * data, std::size_t num_bytes) {
+			auto const begin = data;
+			auto const end = data + num_bytes;
+			auto push_from = data;	// first byte of the push frame inside the chunk
+			while (data != end) {
+				if (pending == 0u) {
+					if (in_push) {
+						push_bytes.append(push_from, data);
+						deliver(position + (data - begin));
+						continue;
+					}
+					if (!idling || *data != '>') {
+						break;
+					}
+				} else if (state == State::Type) {
+					data = fast(begin, data, end);
+					if (data == end || pending == 0u) {
+						continue;
+					}
+				}
+				switch (state) {
+					case State::Type:
+						type = *data++;
+						switch (type) {
+							case '+':
+							case '-':
+							case ',':
+							case '(':
+							case '#':
+							case '_':
+								line_start = position + (data - begin);
+								state = State::Line;
+								break;
+
+							case '>':
+								if (!in_push && !keep_pushes) {
+									// parse the frame without recording it
+									in_push = true;
+									push_from = data - 1;
+									saved_pending = pending;
+									saved_nodes = nodes;
+									pending = 1u;
+									nodes = nullptr;
+								}
+								// fall through
+							case ':':
+							case '$':
+							case '*':
+							case '%':
+							case '~':
+							case '!':
+							case '=':
+								negative = false;
+								has_digits = false;
+								number = 0;
+								state = State::Number;
+								break;
+
+							case '|':
+								throw ProtocolError{"Attributes are not supported"};
+
+							default:
+								throw ProtocolError{std::string{"Invalid type byte '"} + type + "'"};
+						}
+						break;
+
+					case State::Line: {
+						auto cr = static_cast<char const *>(std::memchr(data, '\r', end - data));
+						auto last = (cr == nullptr) ? end : cr;
+						if (type == '#' && std::any_of(data, last, [](char c) { return c != 't' && c != 'f'; })) {
+							throw ProtocolError{"Invalid boolean"};
+						}
+						if (cr == nullptr) {
+							data = end;
+						} else {
+							data = cr + 1;
+							state = State::LineFeed;
+						}
+						break;
+					}
+
+					case State::Number:
+						for (; data != end; ++data) {
+							auto c = *data;
+							if (c >= '0' && c <= '9') {
+								// limited to 2^63 - 1, or 2^63 if negative
+								auto digit = static_cast<std::uint64_t>(c - '0');
+								auto limit = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) + (negative ? 1u : 0u);
+								if (number > (limit - digit) / 10u) {
+									throw ProtocolError{"Number exceeds 64 bits"};
+								}
+								number = number * 10u + digit;
+								has_digits = true;
+							} else if (c == '-' && !has_digits && !negative) {
+								negative = true;
+							} else if (c == '\r' && has_digits) {
+								++data;
+								state = State::LineFeed;
+								break;
+							} else {
+								throw ProtocolError{std::string{"Invalid character '"} + c + "' in number"};
+							}
+						}
+						break;
+
+					case State::LineFeed: {
+						if (*data++ != '\n') {
+							throw ProtocolError{"Line is not terminated by CRLF"};
+						}
+						auto offset = position + (data - begin);
+						state = State::Type;
+						if (is_line(type)) {
+							line(line_start, offset - 2u - line_start);
+						} else {
+							header(offset);
+						}
+						break;
+					}
+
+					case State::Payload: {
+						auto n = std::min<std::int64_t>(remaining, end - data);
+						data += n;
+						remaining -= n;
+						if (remaining == 0) {
+							state = State::PayloadCR;
+						}
+						break;
+					}
+
+					case State::PayloadCR:
+						if (*data++ != '\r') {
+							throw ProtocolError{"Bulk string exceeds its length"};
+						}
+						state = State::PayloadLF;
+						break;
+
+					case State::PayloadLF:
+						if (*data++ != '\n') {
+							throw ProtocolError{"Bulk string is not terminated by CRLF"};
+						}
+						state = State::Type;
+						--pending;
+						break;
+				}
+			}
+			if (in_push) {
+				push_bytes.append(push_from, data);
+				if (pending == 0u) {
+					deliver(position + (data - begin));
+				}
+			}
+			auto consumed = static_cast<std::size_t>(data - begin);
+			position += consumed;
+			return consumed;
+		}
+};
+
+/// Parse a complete reply
+/**
+ *	The given string is expected to contain exactly one reply.
+ *
+ *	@throw ProtocolError if the string is no single RESP-compliant reply
+ *	@param buffer String containing the reply
+ *	@return Parsed reply referring into the string
+ */
+inline Reply parse_reply(std::string buffer) {
+	auto data = std::make_shared<ReplyData>();
+	data->buffer = std::move(buffer);
+	ReplyParser parser{&data->nodes};
+	auto consumed = parser.feed(data->buffer.data(), data->buffer.size());
+	if (!parser.done() || consumed != data->buffer.size()) {
+		throw ProtocolError{"String does not contain a single reply"};
+	}
+	return Reply{std::move(data), 0u};
+}
+
+} // ::priv
+} // ::redisxx
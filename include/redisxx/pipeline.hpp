@@ -0,0 +1,378 @@
+/** @file pipeline.hpp
+ *
+ * RedisXX automatic pipelining implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <redisxx/command.hpp>
+#include <redisxx/error.hpp>
+#include <redisxx/parser.hpp>
+#include <redisxx/pool.hpp>
+#include <redisxx/reply.hpp>
+#include <redisxx/segments.hpp>
+#include <redisxx/socket.hpp>
+
+namespace redisxx {
+
+/// Policy of automatic pipelining
+/**
+ *	If automatic pipelining is enabled, requests that are submitted at about
+ *	the same time (e.g. by different threads) are sent using a single write
+ *	and their replies are received in a single pass. A batch is sent once
+ *	`batch_size` requests were submitted or the first request of the batch
+ *	waited for `window`. While a batch is processed, the next batch is
+ *	gathered. A `batch_size` of zero disables automatic pipelining.
+ *	The batches are sent on a socket of their own, which counts towards the
+ *	size of the connection's pool. So a bounded pool needs room for at least
+ *	two sockets.
+ */
+struct PipelinePolicy {
+	std::size_t batch_size;				// max. number of requests per batch
+	std::chrono::microseconds window;	// max. time to wait for more requests
+
+	PipelinePolicy(std::size_t batch_size=0u, std::chrono::microseconds window=std::chrono::microseconds{0})
+		: batch_size{batch_size}
+		, window{window} {
+	}
+};
+
+namespace priv {
+
+// describes how the replies to a request are received
+struct ReplyLayout {
+	bool grouped;				// whether the replies are grouped as an array
+	std::size_t num_replies;	// number of replies
+	bool transaction;			// whether the replies belong to a transaction
+
+	// array header grouping the replies
+	inline std::string header() const {
+		return grouped ? '*' + std::to_string(num_replies) + "\r\n" : std::string{};
+	}
+};
+
+// a single command results in a single reply
+template <typename Allocator>
+ReplyLayout layout_of(BasicCommand<Allocator> const & cmd) {
+	return ReplyLayout{false, 1u, false};
+}
+
+// the replies to a command list are grouped as elements of an array
+template <typename Allocator>
+ReplyLayout layout_of(BasicCommandList<Allocator> const & list) {
+	return ReplyLayout{true, list.getNumReplies(), list.getBatchType() == BatchType::Transaction};
+}
+
+/// Unpack the replies to a transaction
+/**
+ *	The given replies are expected to be grouped as an array of the reply to
+ *	MULTI, one reply to each queued command and the reply to EXEC. They are
+ *	unpacked to an array containing one reply per command: the command's
+ *	result from EXEC, or the error that occured while queueing the command.
+ *	If EXEC failed (e.g. EXECABORT due to queueing errors), each command that
+ *	was queued successfully gets EXEC's error. If the transaction was aborted
+ *	(EXEC returned null because a WATCHed key was modified), the returned reply
+ *	is null. If MULTI failed, its error is returned.
+ *	The unpacked array refers to the existing values, so nothing is copied
+ *	except for one value per command.
+ *
+ *	@param data Receive buffer and values of all replies
+ *	@param index Index of the array grouping the replies
+ *	@return Unpacked reply
+ */
+inline Reply unpack_transaction(std::shared_ptr<ReplyData> data, std::size_t index) {
+	auto& nodes = data->nodes;
+	auto const first = nodes[index].offset;
+	auto const num = static_cast<std::size_t>(nodes[index].value) - 2u;
+	auto const multi = first;
+	auto const exec = first + num + 1u;
+	if (nodes[multi].type == ReplyType::Error) {
+		return Reply{std::move(data), multi};
+	}
+	if (nodes[exec].type == ReplyType::Null) {
+		return Reply{std::move(data), exec};
+	}
+	// results of the successfully queued commands
+	std::size_t result = 0u, num_results = 0u;
+	if (nodes[exec].type == ReplyType::Array) {
+		result = nodes[exec].offset;
+		num_results = static_cast<std::size_t>(nodes[exec].value);
+	}
+	auto const root = nodes.size();
+	nodes.reserve(root + 1u + num);
+	nodes.push_back(ReplyNode{ReplyType::Array, root + 1u, static_cast<std::int64_t>(num)});
+	for (auto i = 0u; i < num; ++i) {
+		auto const queued = first + 1u + i;
+		if (nodes[queued].type == ReplyType::Error) {
+			nodes.push_back(nodes[queued]);
+		} else if (num_results > 0u) {
+			nodes.push_back(nodes[result++]);
+			--num_results;
+		} else {
+			nodes.push_back(nodes[exec]);
+		}
+	}
+	return Reply{std::move(data), root};
+}
+
+/// Create the reply to a request
+/**
+ *	@param layout Layout of the request's replies
+ *	@param data Receive buffer and values of the replies
+ *	@param index Index of the (grouped) reply
+ *	@return Reply to the request
+ */
+inline Reply make_reply(ReplyLayout const & layout, std::shared_ptr<ReplyData> data, std::size_t index) {
+	if (layout.transaction) {
+		return unpack_transaction(std::move(data), index);
+	}
+	return Reply{std::move(data), index};
+}
+
+/// Call a request's callback
+/**
+ *	Exceptions thrown by the callback are ignored, so neither the thread
+ *	calling it nor the other requests are affected (e.g. those completed by
+ *	the same read).
+ *
+ *	@param callback Function to pass the reply to
+ *	@param error Exception that failed the request or nullptr
+ *	@param value Reply to the request
+ */
+template <typename Func, typename Value>
+void invoke_callback(Func& callback, std::exception_ptr error, Value value) {
+	try {
+		callback(error, std::move(value));
+	} catch (...) {
+		// the callback's exception must not escape to the caller
+	}
+}
+
+/// Automatic pipelining of requests
+/**
+ *	Requests are submitted by any thread and queued. A dedicated thread takes
+ *	batches of queued requests, sends each batch using a single write on a
+ *	socket leased from the given pool, and receives all replies of the batch
+ *	into a single receive buffer. Each reply is passed to the future of its
+ *	request, in the order the requests were submitted.
+ *	If a batch fails, each of its requests gets the exception and the socket
+ *	is closed. The next batch uses a new socket.
+ *	Push frames (RESP3) are passed to the pool's push handler by the worker
+ *	thread while it receives the replies of a batch.
+ */
+template <typename SocketImpl>
+class AutoPipeline {
+
+	using Lease = typename SocketPool<SocketImpl>::Lease;
+
+	public:
+		using Callback = std::function<void(std::exception_ptr, Reply)>;
+
+	private:
+		struct Pending {
+			std::size_t size;	// of the request inside the outgoing bytes
+			ReplyLayout layout;
+			Callback callback;
+		};
+
+		// shared by the pipeline and its thread, which may outlive the pipeline
+		struct State {
+			std::shared_ptr<SocketPool<SocketImpl>> const pool;
+			PipelinePolicy const policy;
+
+			std::mutex mutex;
+			std::condition_variable submitted;
+			std::deque<Pending> queue;
+			std::string outgoing;	// queued requests in order
+			bool stopping;
+
+			State(std::shared_ptr<SocketPool<SocketImpl>> pool, PipelinePolicy const & policy)
+				: pool{std::move(pool)}
+				, policy{policy}
+				, mutex{}
+				, submitted{}
+				, queue{}
+				, outgoing{}
+				, stopping{false} {
+			}
+		};
+
+		std::shared_ptr<State> const state;
+		std::thread worker;
+
+		// send a batch and receive its replies
+		static void process(State& state, std::unique_ptr<Lease>& socket, std::vector<Pending>& batch, std::string const & out) {
+			std::vector<Reply> replies;
+			try {
+				if (socket == nullptr) {
+					socket.reset(new Lease{state.pool->acquire()});
+				}
+				// send all requests at once
+				(*socket)->write(out.data(), out.size());
+				// receive all replies into the same buffer
+				auto data = std::make_shared<ReplyData>();
+				ReplyParser parser{&data->nodes, 0u, &state.pool->getPolicy().push_handler};
+				std::size_t parsed = 0u, received = 0u;
+				std::vector<std::size_t> roots;
+				roots.reserve(batch.size());
+				for (auto const & pending: batch) {
+					roots.push_back(data->nodes.size());
+					if (pending.layout.grouped) {
+						parser.group(pending.layout.num_replies);
+					} else {
+						parser.reset();
+					}
+					_receive(**socket, parser, data->buffer, parsed, received);
+				}
+				if (parsed < received) {
+					// complete push frames that were received along with the last reply
+					parser.idle();
+					_receive(**socket, parser, data->buffer, parsed, received);
+				}
+				if (parsed < received) {
+					throw ProtocolError{"Received more data than the replies contain"};
+				}
+				data->buffer.resize(received);
+				// finish all replies before any of them is passed on
+				replies.reserve(batch.size());
+				for (auto i = 0u; i < batch.size(); ++i) {
+					replies.push_back(make_reply(batch[i].layout, data, roots[i]));
+				}
+			} catch (...) {
+				// close socket, the next batch will reconnect
+				socket.reset();
+				auto error = std::current_exception();
+				for (auto& pending: batch) {
+					invoke_callback(pending.callback, error, Reply{});
+				}
+				return;
+			}
+			for (auto i = 0u; i < batch.size(); ++i) {
+				invoke_callback(batch[i].callback, nullptr, std::move(replies[i]));
+			}
+		}
+
+		// the thread keeps the state alive, so the pipeline may be destroyed by a callback
+		static void run(std::shared_ptr<State> state) {
+			auto const & policy = state->policy;
+			std::unique_ptr<Lease> socket;
+			std::vector<Pending> batch;
+			std::string out;
+			while (true) {
+				{
+					std::unique_lock<std::mutex> lock{state->mutex};
+					auto& queue = state->queue;
+					state->submitted.wait(lock, [&]() {
+						return state->stopping || !queue.empty();
+					});
+					if (queue.empty()) {
+						break;
+					}
+					if (policy.window.count() > 0 && queue.size() < policy.batch_size) {
+						// wait a moment for more requests
+						state->submitted.wait_for(lock, policy.window, [&]() {
+							return state->stopping || queue.size() >= policy.batch_size;
+						});
+					}
+					auto num = std::min(queue.size(), policy.batch_size);
+					batch.reserve(num);
+					std::size_t size = 0u;
+					for (auto i = 0u; i < num; ++i) {
+						size += queue.front().size;
+						batch.push_back(std::move(queue.front()));
+						queue.pop_front();
+					}
+					// take the batch's bytes, which are usually all queued bytes
+					out.clear();
+					if (size == state->outgoing.size()) {
+						out.swap(state->outgoing);
+					} else {
+						out.assign(state->outgoing, 0u, size);
+						state->outgoing.erase(0u, size);
+					}
+				}
+				process(*state, socket, batch, out);
+				batch.clear();
+			}
+			if (socket != nullptr) {
+				socket->recycle();
+			}
+		}
+
+	public:
+		/// Start automatic pipelining
+		/**
+		 *	@param pool Pool to lease the socket from (not shared with other
+		 *		users, as the socket is kept until the pipeline stops)
+		 *	@param policy Batch size and time window of the pipelining
+		 */
+		AutoPipeline(std::shared_ptr<SocketPool<SocketImpl>> pool, PipelinePolicy const & policy)
+			: state{std::make_shared<State>(std::move(pool), policy)}
+			, worker{} {
+			worker = std::thread{&AutoPipeline::run, state};
+		}
+
+		/// Stop automatic pipelining
+		/**
+		 *	All requests that were already submitted are processed before.
+		 *	If the pipeline is destroyed by its own thread (e.g. because a
+		 *	callback released the last connection), it doesn't wait for
+		 *	itself: the thread processes the remaining requests and exits.
+		 */
+		~AutoPipeline() {
+			{
+				std::lock_guard<std::mutex> lock{state->mutex};
+				state->stopping = true;
+			}
+			state->submitted.notify_one();
+			if (std::this_thread::get_id() == worker.get_id()) {
+				worker.detach();
+			} else {
+				worker.join();
+			}
+		}
+
+		/// Submit a request
+		/**
+		 *	The callback is called by the pipeline's thread, either with the
+		 *	reply or with the exception that failed the batch. Exceptions
+		 *	thrown by the callback are ignored (see `invoke_callback()`).
+		 *
+		 *	The request is copied right behind the previously queued ones,
+		 *	so a batch is sent without copying its requests again.
+		 *
+		 *	@param request Segments of the RESP-compliant request
+		 *	@param layout Layout of the request's replies
+		 *	@param callback Function to pass the reply to
+		 */
+		void submit(Segments const & request, ReplyLayout const & layout, Callback callback) {
+			auto segments = request.gather();
+			{
+				std::lock_guard<std::mutex> lock{state->mutex};
+				auto& outgoing = state->outgoing;
+				for (auto i = 0u; i < segments.size(); ++i) {
+					outgoing.append(static_cast<char const *>(segments[i].iov_base), segments[i].iov_len);
+				}
+				state->queue.push_back(Pending{request.size(), layout, std::move(callback)});
+			}
+			state->submitted.notify_one();
+		}
+};
+
+} // ::priv
+} // ::redisxx
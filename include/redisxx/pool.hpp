@@ -0,0 +1,307 @@
+/** @file pool.hpp
+ *
+ * RedisXX socket pool implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <iterator>
+
+#include <redisxx/socket.hpp>
+
+namespace redisxx {
+
+/// Version of the protocol spoken on each socket
+enum class Protocol {
+	Resp2, Resp3
+};
+
+/// Policy of the socket pool used by a connection
+/**
+ *	The policy describes how many sockets may be open at the same time and
+ *	how long an unused socket is kept open. A connection spreads requests of
+ *	different threads over up to `size` sockets (see `Connection`). A socket
+ *	that was idle for longer than `max_idle` is closed and replaced by a new
+ *	one the next time it is needed. A `max_idle` of zero keeps idle sockets
+ *	open forever.
+ *	Choosing `max_idle` below the server's `timeout` setting avoids using
+ *	sockets that were already closed by the server.
+ *	With `Protocol::Resp3`, each socket sends "HELLO 3" right after it was
+ *	opened (which requires Redis 6 or newer). Replies may then be maps, sets,
+ *	doubles etc., and push frames (e.g. invalidations of keys tracked by
+ *	CLIENT TRACKING) are passed to the `push_handler` if one is set.
+ */
+struct PoolPolicy {
+	std::size_t size;						// max. number of open sockets (0 = unbounded)
+	std::chrono::milliseconds max_idle;		// max. idle time per socket
+	Protocol protocol;						// spoken on each socket
+	PushHandler push_handler;				// called for each push frame (RESP3)
+
+	PoolPolicy(std::size_t size=4u, std::chrono::milliseconds max_idle=std::chrono::milliseconds{0},
+		Protocol protocol=Protocol::Resp2)
+		: size{size}
+		, max_idle{max_idle}
+		, protocol{protocol}
+		, push_handler{} {
+	}
+};
+
+namespace priv {
+
+/// Pool of long-lived sockets to the same remote host or local stream
+/**
+ *	Sockets are created on demand, leased by `acquire()` and returned to the
+ *	pool by their lease. A lease that was not recycled (e.g. because its
+ *	request threw an exception) closes its socket, so a broken socket is
+ *	never reused and the next lease reconnects. If all sockets are leased,
+ *	`acquire()` blocks until one is returned.
+ */
+template <typename SocketImpl>
+class SocketPool {
+
+	using Clock = std::chrono::steady_clock;
+
+	private:
+		struct Idle {
+			std::unique_ptr<SocketImpl> socket;
+			Clock::time_point since;
+		};
+
+		std::string const host;
+		std::uint16_t const port;
+		PoolPolicy const policy;
+
+		std::mutex mutex;
+		std::condition_variable returned;
+		std::vector<Idle> idle;		// most recently used socket at the back
+		std::size_t num_open;		// number of idle and leased sockets
+
+		void put(std::unique_ptr<SocketImpl> socket) {
+			std::lock_guard<std::mutex> lock{mutex};
+			if (socket != nullptr) {
+				idle.push_back(Idle{std::move(socket), Clock::now()});
+			} else {
+				--num_open;
+			}
+			returned.notify_one();
+		}
+
+		// open a new socket speaking the policy's protocol
+		std::unique_ptr<SocketImpl> open() {
+			auto socket = priv::create_socket<SocketImpl>(host, port);
+			if (policy.protocol == Protocol::Resp3) {
+				Reply reply = _execute_request(*socket, "*2\r\n$5\r\nHELLO\r\n$1\r\n3\r\n");
+				if (reply.isError()) {
+					throw ConnectionError{"Cannot switch to RESP3: " + reply.as<std::string>(), host, port};
+				}
+			}
+			return socket;
+		}
+
+		// take an idle socket or reserve a slot for a new one, return false if exhausted and not waiting
+		bool take(std::unique_ptr<SocketImpl>& socket, bool wait) {
+			std::unique_lock<std::mutex> lock{mutex};
+			while (true) {
+				if (policy.max_idle.count() > 0) {
+					auto expired = expire();
+					if (!expired.empty()) {
+						// close sockets without holding the lock
+						lock.unlock();
+						expired.clear();
+						lock.lock();
+						continue;
+					}
+				}
+				if (!idle.empty()) {
+					socket = std::move(idle.back().socket);
+					idle.pop_back();
+					return true;
+				}
+				if (policy.size == 0u || num_open < policy.size) {
+					++num_open;
+					return true;
+				}
+				if (!wait) {
+					return false;
+				}
+				returned.wait(lock);
+			}
+		}
+
+		// remove idle sockets that exceed the idle time (requires lock)
+		std::vector<Idle> expire() {
+			std::vector<Idle> expired;
+			auto now = Clock::now();
+			auto end = idle.begin();
+			while (end != idle.end() && now - end->since > policy.max_idle) {
+				++end;
+			}
+			if (end != idle.begin()) {
+				expired.assign(std::make_move_iterator(idle.begin()), std::make_move_iterator(end));
+				idle.erase(idle.begin(), end);
+				num_open -= expired.size();
+				returned.notify_all();
+			}
+			return expired;
+		}
+
+	public:
+		/// Lease of a pooled socket
+		/**
+		 *	The leased socket is closed when the lease is destroyed, unless
+		 *	`recycle()` was called before. In that case the socket is returned
+		 *	to the pool.
+		 */
+		class Lease {
+
+			friend class SocketPool;
+
+			private:
+				SocketPool* pool;
+				std::unique_ptr<SocketImpl> socket;
+				bool reusable;
+
+				Lease(SocketPool& pool, std::unique_ptr<SocketImpl> socket)
+					: pool{&pool}
+					, socket{std::move(socket)}
+					, reusable{false} {
+				}
+
+			public:
+				Lease(Lease&& other)
+					: pool{other.pool}
+					, socket{std::move(other.socket)}
+					, reusable{other.reusable} {
+					other.pool = nullptr;
+				}
+
+				Lease(Lease const &) = delete;
+				Lease& operator=(Lease const &) = delete;
+
+				~Lease() {
+					if (pool == nullptr) {
+						return;
+					}
+					if (!reusable) {
+						// close socket before freeing its slot
+						socket.reset();
+					}
+					pool->put(std::move(socket));
+				}
+
+				/// Mark the socket as reusable
+				/**
+				 *	Call this after the socket was used successfully, so it is
+				 *	returned to the pool instead of being closed.
+				 */
+				inline void recycle() {
+					reusable = true;
+				}
+
+				inline SocketImpl& operator*() const {
+					return *socket;
+				}
+
+				inline SocketImpl* operator->() const {
+					return socket.get();
+				}
+		};
+
+	private:
+		// lease the given idle socket or open a new one (whose slot was reserved)
+		Lease lease(std::unique_ptr<SocketImpl> socket) {
+			if (socket != nullptr) {
+				return Lease{*this, std::move(socket)};
+			}
+			// connect without holding the lock
+			try {
+				return Lease{*this, open()};
+			} catch (...) {
+				put(nullptr);
+				throw;
+			}
+		}
+
+	public:
+		/// Create a new socket pool
+		/**
+		 *	No socket is opened here. Sockets are opened by `acquire()` once
+		 *	they are needed.
+		 *
+		 *	@param host remote host's name OR local stream's filename
+		 *	@param port remote host's port number OR not used
+		 *	@param policy pool size and idle policy
+		 */
+		SocketPool(std::string const & host, std::uint16_t port, PoolPolicy const & policy)
+			: host{host}
+			, port{port}
+			, policy{policy}
+			, mutex{}
+			, returned{}
+			, idle{}
+			, num_open{0u} {
+			idle.reserve(policy.size);
+		}
+
+		/// Lease a socket
+		/**
+		 *	Returns the most recently used idle socket. Sockets that exceed the
+		 *	idle time of the policy are closed. If no idle socket is left, a
+		 *	new socket is opened unless the pool is exhausted. In that case,
+		 *	this blocks until another lease returns its socket. A new socket
+		 *	is switched to RESP3 if the policy asks for it.
+		 *
+		 *	@throw ConnectionError if a new socket cannot be opened or switched
+		 *	@return Lease of the socket
+		 */
+		Lease acquire() {
+			std::unique_ptr<SocketImpl> socket;
+			take(socket, true);
+			return lease(std::move(socket));
+		}
+
+		/// Lease a socket unless the pool is exhausted
+		/**
+		 *	Works like `acquire()`, but does not wait for another lease to
+		 *	return its socket.
+		 *
+		 *	@throw ConnectionError if a new socket cannot be opened or switched
+		 *	@return Lease of the socket or nullptr if the pool is exhausted
+		 */
+		std::unique_ptr<Lease> tryAcquire() {
+			std::unique_ptr<SocketImpl> socket;
+			if (!take(socket, false)) {
+				return nullptr;
+			}
+			return std::unique_ptr<Lease>{new Lease{lease(std::move(socket))}};
+		}
+
+		/// Return the number of currently open sockets
+		/**
+		 *	@return Number of idle and leased sockets
+		 */
+		inline std::size_t size() {
+			std::lock_guard<std::mutex> lock{mutex};
+			return num_open;
+		}
+
+		/// Return the policy of this pool
+		/**
+		 *	@return const-reference to the pool policy
+		 */
+		inline PoolPolicy const & getPolicy() const {
+			return policy;
+		}
+};
+
+} // ::priv
+} // ::redisxx
@@ -10,7 +10,14 @@
 
 // include entire public API
 #include <redisxx/error.hpp>
+#include <redisxx/arena.hpp>
 #include <redisxx/command.hpp>
-//#include <redisxx/reply.hpp>
+#include <redisxx/commands.hpp>
+#include <redisxx/reply.hpp>
+#include <redisxx/lazy_reply.hpp>
 #include <redisxx/connection.hpp>
+#include <redisxx/coroutine.hpp>
+#include <redisxx/cluster.hpp>
+#include <redisxx/sharding.hpp>
+#include <redisxx/cache.hpp>
 
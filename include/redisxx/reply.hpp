@@ -0,0 +1,632 @@
+/** @file reply.hpp
+ *
+ * RedisXX Reply implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <redisxx/error.hpp>
+#include <redisxx/format.hpp>
+#include <redisxx/string_view.hpp>
+#include <redisxx/type_traits.hpp>
+
+namespace redisxx {
+
+/// Type of a reply value
+/**
+ *	The types following `Array` are only sent by servers speaking RESP3
+ *	(see `Protocol`).
+ */
+enum class ReplyType {
+	Status, Error, Integer, Bulk, Null, Array,
+	Map, Set, Push, Double, Boolean, BigNumber, Verbatim
+};
+
+namespace priv {
+
+// single value of a reply
+struct ReplyNode {
+	ReplyType type;
+	std::size_t offset;		// payload offset (strings) OR first element's index (arrays)
+	std::int64_t value;		// payload size (strings) OR integer OR number of elements (arrays)
+};
+
+// receive buffer of replies and the values that refer into it
+struct ReplyData {
+	std::string buffer;
+	std::vector<ReplyNode> nodes;	// elements of an array are stored contiguously
+};
+
+// whether values of the given type have elements
+inline bool is_aggregate(ReplyType type) {
+	switch (type) {
+		case ReplyType::Array:
+		case ReplyType::Map:
+		case ReplyType::Set:
+		case ReplyType::Push:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// payload of a status, error, bulk string, double, boolean ("t" or "f"), big number or
+// verbatim string (without its format)
+inline StringView payload_of(ReplyData const * data, ReplyNode const & node) {
+	switch (node.type) {
+		case ReplyType::Status:
+		case ReplyType::Error:
+		case ReplyType::Bulk:
+		case ReplyType::Double:
+		case ReplyType::Boolean:
+		case ReplyType::BigNumber:
+		case ReplyType::Verbatim:
+			return StringView{data->buffer.data() + node.offset, static_cast<std::size_t>(node.value)};
+		default:
+			throw TypeError{"Reply is not a string"};
+	}
+}
+
+// reserve capacity for the given number of elements if supported
+template <typename T>
+auto reserve(T& container, std::size_t num, int) -> decltype(container.reserve(num), void()) {
+	container.reserve(num);
+}
+
+template <typename T>
+void reserve(T&, std::size_t, long) {
+}
+
+// ---------------------------------------------------------------------------
+
+// decode a reply value into T (see `Reply::as()`), undefined for unsupported types
+template <typename T, typename = void>
+struct Decoder;
+
+template <>
+struct Decoder<StringView> {
+	static void decode(ReplyData const * data, ReplyNode const & node, StringView& value) {
+		value = payload_of(data, node);
+	}
+};
+
+template <>
+struct Decoder<std::string> {
+	static void decode(ReplyData const * data, ReplyNode const & node, std::string& value) {
+		if (node.type == ReplyType::Integer) {
+			char tmp[max_integer_length];
+			value.assign(tmp, format_integer(tmp, node.value));
+			return;
+		}
+		auto str = payload_of(data, node);
+		value.assign(str.data(), str.size());
+	}
+};
+
+template <typename T>
+struct Decoder<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+	static void decode(ReplyData const * data, ReplyNode const & node, T& value) {
+		if (node.type == ReplyType::Boolean) {
+			value = static_cast<T>(payload_of(data, node) == "t");
+			return;
+		}
+		if (node.type == ReplyType::Integer) {
+			value = static_cast<T>(node.value);
+			if (static_cast<std::int64_t>(value) != node.value || (node.value < 0 && !std::is_signed<T>::value)) {
+				throw TypeError{"Integer reply is out of range"};
+			}
+			return;
+		}
+		auto str = payload_of(data, node);
+		if (!parse_integer(str.data(), str.data() + str.size(), value)) {
+			throw TypeError{"Reply is not an integer"};
+		}
+	}
+};
+
+template <typename T>
+struct Decoder<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+	static void decode(ReplyData const * data, ReplyNode const & node, T& value) {
+		if (node.type == ReplyType::Integer) {
+			value = static_cast<T>(node.value);
+			return;
+		}
+		auto str = payload_of(data, node);
+		if (!parse_number(str.data(), str.data() + str.size(), value)) {
+			throw TypeError{"Reply is not a number"};
+		}
+	}
+};
+
+template <typename T>
+struct Decoder<T, typename std::enable_if<is_set<T>::value || is_sequence<T>::value>::type> {
+	using Element = typename T::value_type;
+
+	static void decode(ReplyData const * data, ReplyNode const & node, T& value) {
+		value.clear();
+		if (node.type == ReplyType::Null) {
+			return;
+		}
+		if (!is_aggregate(node.type)) {
+			throw TypeError{"Reply is not an array"};
+		}
+		auto num = static_cast<std::size_t>(node.value);
+		reserve(value, num, 0);
+		for (auto i = 0u; i < num; ++i) {
+			Element elem{};
+			Decoder<Element>::decode(data, data->nodes[node.offset + i], elem);
+			value.insert(value.end(), std::move(elem));
+		}
+	}
+};
+
+template <typename T>
+struct Decoder<T, typename std::enable_if<is_map<T>::value>::type> {
+	using Key = typename T::key_type;
+	using Mapped = typename T::mapped_type;
+
+	static void decode(ReplyData const * data, ReplyNode const & node, T& value) {
+		value.clear();
+		if (node.type == ReplyType::Null) {
+			return;
+		}
+		if (!is_aggregate(node.type) || node.value % 2 != 0) {
+			throw TypeError{"Reply is not an array of key-value pairs"};
+		}
+		auto num = static_cast<std::size_t>(node.value);
+		reserve(value, num / 2u, 0);
+		for (auto i = 0u; i < num; i += 2u) {
+			Key key{};
+			Mapped mapped{};
+			Decoder<Key>::decode(data, data->nodes[node.offset + i], key);
+			Decoder<Mapped>::decode(data, data->nodes[node.offset + i + 1u], mapped);
+			value.emplace_hint(value.end(), std::move(key), std::move(mapped));
+		}
+	}
+};
+
+} // ::priv
+
+/// Reply
+/**
+ *	This class provides typed access to a reply (or one of its elements). A
+ *	reply is either a status, an error, an integer, a bulk string, null or an
+ *	array of replies.
+ *	Servers speaking RESP3 also reply maps, sets, doubles, booleans, big
+ *	numbers and verbatim strings. Maps, sets (and push frames) provide their
+ *	elements like arrays do, a map's keys and values being alternating
+ *	elements. So code expecting flat arrays (e.g. the reply to HGETALL)
+ *	works with both protocols. Doubles, booleans, big numbers and verbatim
+ *	strings (without their format) are provided as strings, too.
+ *	A reply does not copy any payload. Strings are views into the receive
+ *	buffer, which is shared by the reply, all of its elements and all copies
+ *	of them. Copying a reply is cheap and the buffer is alive as long as any
+ *	of them is. Each array stores its elements contiguously, so a reply with
+ *	thousands of elements costs a single allocation besides the buffer.
+ *	Note that an error reply is not thrown but returned like any other reply.
+ *
+ *	Example usage:
+ *	@code
+ *		auto reply = conn(redisxx::Command{"HGETALL", "user:5"}).get();
+ *		if (reply.isError()) {
+ *			std::cerr << reply.getString() << std::endl;
+ *		}
+ *		for (std::size_t i = 0u; i + 1u < reply.size(); i += 2u) {
+ *			std::cout << reply[i].getString() << ": " << reply[i + 1u].getString() << "\n";
+ *		}
+ *	@endcode
+ */
+class Reply {
+	private:
+		std::shared_ptr<priv::ReplyData const> data;
+		std::size_t index;
+
+		inline priv::ReplyNode const & node() const {
+			return data->nodes[index];
+		}
+
+	public:
+		/// Iterator over the elements of an array reply
+		/**
+		 *	The iterator shares the reply data, so it stays valid after the
+		 *	reply it was taken from was destroyed (e.g. a temporary element).
+		 */
+		class const_iterator {
+			private:
+				std::shared_ptr<priv::ReplyData const> data;
+				std::size_t index;
+
+			public:
+				using iterator_category = std::random_access_iterator_tag;
+				using value_type = Reply;
+				using difference_type = std::ptrdiff_t;
+				using pointer = Reply const *;
+				using reference = Reply;
+
+				const_iterator()
+					: data{}
+					, index{0u} {
+				}
+
+				const_iterator(std::shared_ptr<priv::ReplyData const> data, std::size_t index)
+					: data{std::move(data)}
+					, index{index} {
+				}
+
+				inline Reply operator*() const {
+					return Reply{data, index};
+				}
+
+				inline Reply operator[](std::ptrdiff_t n) const {
+					return Reply{data, index + n};
+				}
+
+				inline const_iterator& operator++() {
+					++index;
+					return *this;
+				}
+
+				inline const_iterator operator++(int) {
+					auto tmp = *this;
+					++index;
+					return tmp;
+				}
+
+				inline const_iterator& operator--() {
+					--index;
+					return *this;
+				}
+
+				inline const_iterator operator--(int) {
+					auto tmp = *this;
+					--index;
+					return tmp;
+				}
+
+				inline const_iterator& operator+=(std::ptrdiff_t n) {
+					index += n;
+					return *this;
+				}
+
+				inline const_iterator& operator-=(std::ptrdiff_t n) {
+					index -= n;
+					return *this;
+				}
+
+				inline const_iterator operator+(std::ptrdiff_t n) const {
+					return const_iterator{data, index + n};
+				}
+
+				inline const_iterator operator-(std::ptrdiff_t n) const {
+					return const_iterator{data, index - n};
+				}
+
+				inline std::ptrdiff_t operator-(const_iterator const & other) const {
+					return static_cast<std::ptrdiff_t>(index) - static_cast<std::ptrdiff_t>(other.index);
+				}
+
+				inline bool operator==(const_iterator const & other) const {
+					return index == other.index;
+				}
+
+				inline bool operator!=(const_iterator const & other) const {
+					return index != other.index;
+				}
+
+				inline bool operator<(const_iterator const & other) const {
+					return index < other.index;
+				}
+		};
+
+		/// Create a null reply
+		Reply()
+			: data{}
+			, index{0u} {
+		}
+
+		/// Create a reply referring to a value of the given reply data
+		/**
+		 *	@param data Shared receive buffer and values
+		 *	@param index Index of the value
+		 */
+		Reply(std::shared_ptr<priv::ReplyData const> data, std::size_t index)
+			: data{std::move(data)}
+			, index{index} {
+		}
+
+		/// Returns the type of this reply
+		/**
+		 *	@return Type of the reply
+		 */
+		inline ReplyType getType() const {
+			return (data == nullptr) ? ReplyType::Null : node().type;
+		}
+
+		inline bool isStatus() const {
+			return getType() == ReplyType::Status;
+		}
+
+		inline bool isError() const {
+			return getType() == ReplyType::Error;
+		}
+
+		inline bool isInteger() const {
+			return getType() == ReplyType::Integer;
+		}
+
+		inline bool isBulk() const {
+			return getType() == ReplyType::Bulk;
+		}
+
+		inline bool isNull() const {
+			return getType() == ReplyType::Null;
+		}
+
+		inline bool isArray() const {
+			return getType() == ReplyType::Array;
+		}
+
+		inline bool isMap() const {
+			return getType() == ReplyType::Map;
+		}
+
+		inline bool isSet() const {
+			return getType() == ReplyType::Set;
+		}
+
+		inline bool isPush() const {
+			return getType() == ReplyType::Push;
+		}
+
+		inline bool isDouble() const {
+			return getType() == ReplyType::Double;
+		}
+
+		inline bool isBoolean() const {
+			return getType() == ReplyType::Boolean;
+		}
+
+		inline bool isBigNumber() const {
+			return getType() == ReplyType::BigNumber;
+		}
+
+		inline bool isVerbatim() const {
+			return getType() == ReplyType::Verbatim;
+		}
+
+		/// Query whether the reply has elements
+		/**
+		 *	@return True if the reply is an array, map, set or push frame
+		 */
+		inline bool isAggregate() const {
+			return priv::is_aggregate(getType());
+		}
+
+		/// Returns the string of a reply
+		/**
+		 *	This works for status, error and bulk string replies, as well as
+		 *	doubles, booleans ("t" or "f"), big numbers and verbatim strings.
+		 *	The returned view refers to the receive buffer. It is valid as long
+		 *	as this reply (or any other reply sharing the buffer) is alive.
+		 *
+		 *	@throw TypeError if the reply is no string
+		 *	@return View of the string
+		 */
+		inline StringView getString() const {
+			if (data == nullptr) {
+				throw TypeError{"Reply is not a string"};
+			}
+			return priv::payload_of(data.get(), node());
+		}
+
+		/// Returns the value of a double reply
+		/**
+		 *	Integers and numeric strings (e.g. scores replied by RESP2
+		 *	servers) are converted, too.
+		 *
+		 *	@throw TypeError if the reply is no number
+		 *	@return Value of the double
+		 */
+		inline double getDouble() const {
+			return as<double>();
+		}
+
+		/// Returns the value of a boolean reply
+		/**
+		 *	The integers 0 and 1 (as replied by RESP2 servers) are converted,
+		 *	too.
+		 *
+		 *	@throw TypeError if the reply is no boolean
+		 *	@return Value of the boolean
+		 */
+		inline bool getBoolean() const {
+			auto const type = getType();
+			if (type == ReplyType::Boolean) {
+				return getString() == "t";
+			}
+			if (type == ReplyType::Integer && (node().value == 0 || node().value == 1)) {
+				return node().value == 1;
+			}
+			throw TypeError{"Reply is not a boolean"};
+		}
+
+		/// Returns the value of an integer reply
+		/**
+		 *	@throw TypeError if the reply is no integer
+		 *	@return Value of the integer
+		 */
+		inline std::int64_t getInteger() const {
+			if (!isInteger()) {
+				throw TypeError{"Reply is not an integer"};
+			}
+			return node().value;
+		}
+
+		/// Returns the number of elements of an array reply
+		/**
+		 *	The number of elements of a map is twice its number of entries.
+		 *
+		 *	@return Number of elements OR 0 if the reply has no elements
+		 */
+		inline std::size_t size() const {
+			return isAggregate() ? static_cast<std::size_t>(node().value) : 0u;
+		}
+
+		/// Query whether an array reply has no elements
+		/**
+		 *	@return True if the reply has no elements or is not an array
+		 */
+		inline bool empty() const {
+			return size() == 0u;
+		}
+
+		/// Returns an element of an array reply without range check
+		/**
+		 *	@param pos Index of the element
+		 *	@return Element reply
+		 */
+		inline Reply operator[](std::size_t pos) const {
+			return Reply{data, node().offset + pos};
+		}
+
+		/// Returns an element of an array reply
+		/**
+		 *	@throw TypeError if the reply is not an array
+		 *	@throw std::out_of_range if the index exceeds the array
+		 *	@param pos Index of the element
+		 *	@return Element reply
+		 */
+		inline Reply at(std::size_t pos) const {
+			if (!isAggregate()) {
+				throw TypeError{"Reply is not an array"};
+			}
+			if (pos >= size()) {
+				throw std::out_of_range{"Index " + std::to_string(pos) + " exceeds array of size " + std::to_string(size())};
+			}
+			return (*this)[pos];
+		}
+
+		/// Decode the reply into the given type
+		/**
+		 *	Supported types are those that can be passed as command arguments:
+		 *	strings, integers and floating point numbers as well as sequences
+		 *	(`std::vector<>`, `std::list<>`), sets and maps (including their
+		 *	unordered versions) of them. Nested containers are supported, too.
+		 *	Numbers are parsed right from the receive buffer, so integer
+		 *	replies and numeric strings (e.g. scores) can be decoded alike.
+		 *	Containers reserve capacity for the number of elements in advance
+		 *	(if they support it). Maps are decoded from arrays of alternating
+		 *	keys and values (e.g. the reply to HGETALL). A null reply results
+		 *	in an empty container.
+		 *
+		 *	Example usage:
+		 *	@code
+		 *		auto ids = conn(redisxx::Command{"LRANGE", "ids", 0, -1}).get().as<std::vector<std::int64_t>>();
+		 *		auto user = conn(redisxx::Command{"HGETALL", "user:5"}).get().as<std::unordered_map<std::string, std::string>>();
+		 *	@endcode
+		 *
+		 *	@throw TypeError if the reply (or one of its elements) does not fit
+		 *		into the type (e.g. a non-numeric string or an integer out of
+		 *		range)
+		 *	@return Decoded value
+		 */
+		template <typename T>
+		T as() const {
+			static priv::ReplyNode const null{ReplyType::Null, 0u, 0};
+			T value{};
+			priv::Decoder<T>::decode(data.get(), (data == nullptr) ? null : node(), value);
+			return value;
+		}
+
+		inline const_iterator begin() const {
+			return isAggregate() ? const_iterator{data, node().offset} : const_iterator{};
+		}
+
+		inline const_iterator end() const {
+			return isAggregate() ? const_iterator{data, node().offset + size()} : const_iterator{};
+		}
+};
+
+namespace priv {
+
+// copy the given value (and its elements) to the given node
+inline void copy_value(ReplyData& out, std::size_t index, Reply const & value) {
+	auto const type = value.getType();
+	switch (type) {
+		case ReplyType::Null:
+			out.nodes[index] = ReplyNode{type, 0u, 0};
+			break;
+		case ReplyType::Integer:
+			out.nodes[index] = ReplyNode{type, 0u, value.getInteger()};
+			break;
+		case ReplyType::Array:
+		case ReplyType::Map:
+		case ReplyType::Set:
+		case ReplyType::Push: {
+			// elements are stored contiguously
+			auto const num = value.size();
+			auto const first = out.nodes.size();
+			out.nodes.resize(first + num);
+			out.nodes[index] = ReplyNode{type, first, static_cast<std::int64_t>(num)};
+			for (auto i = 0u; i < num; ++i) {
+				copy_value(out, first + i, value[i]);
+			}
+			break;
+		}
+		default: {
+			auto const payload = value.getString();
+			out.nodes[index] = ReplyNode{type, out.buffer.size(), static_cast<std::int64_t>(payload.size())};
+			out.buffer.append(payload.data(), payload.size());
+		}
+	}
+}
+
+/// Copy a reply into a new receive buffer
+/**
+ *	The copy does not keep the reply's receive buffer alive, which may hold
+ *	many other replies (e.g. those of a pipeline). So it is used to keep a
+ *	single reply for a long time.
+ *
+ *	@param value Reply to copy
+ *	@return Copy of the reply
+ */
+inline Reply copy_reply(Reply const & value) {
+	auto data = std::make_shared<ReplyData>();
+	data->nodes.resize(1u);
+	copy_value(*data, 0u, value);
+	return Reply{std::move(data), 0u};
+}
+
+/// Join replies as the elements of an array reply
+/**
+ *	This is used to merge replies that were received separately (e.g. from
+ *	different nodes) into a single reply. The values are copied into a
+ *	new receive buffer, which is not shared with the given replies.
+ *
+ *	@param elements Replies to join
+ *	@return Array reply
+ */
+inline Reply join_replies(std::vector<Reply> const & elements) {
+	auto data = std::make_shared<ReplyData>();
+	auto const num = elements.size();
+	data->nodes.resize(1u + num);
+	data->nodes[0] = ReplyNode{ReplyType::Array, 1u, static_cast<std::int64_t>(num)};
+	for (auto i = 0u; i < num; ++i) {
+		copy_value(*data, 1u + i, elements[i]);
+	}
+	return Reply{std::move(data), 0u};
+}
+
+} // ::priv
+
+} // ::redisxx
@@ -0,0 +1,147 @@
+/** @file segments.hpp
+ *
+ * RedisXX scatter/gather request implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#if defined(_WIN32)
+namespace redisxx {
+
+// same layout as POSIX' struct iovec
+struct iovec {
+	void* iov_base;
+	std::size_t iov_len;
+};
+
+} // ::redisxx
+#else
+#include <sys/uio.h>
+
+namespace redisxx {
+
+// segment of a vectored write, as used by writev() and sendmsg()
+using ::iovec;
+
+} // ::redisxx
+#endif
+
+#include <redisxx/small_buffer.hpp>
+
+namespace redisxx {
+namespace priv {
+
+// segments of a request with up to eight segments are stored inline
+using IoVector = SmallBuffer<std::allocator<iovec>, 8u>;
+
+/// Request that is written from several buffers at once
+/**
+ *	A request consists of segments: small parts that are copied into the
+ *	request (e.g. array headers) and borrowed parts that are referenced
+ *	without copying them (e.g. the encoded arguments of a command or a
+ *	borrowed payload). Borrowed memory is required to stay unchanged until
+ *	the request was written.
+ *	Adjacent copied parts are merged into a single segment. Small requests
+ *	(e.g. a single command) are described without allocating any memory.
+ */
+class Segments {
+
+	// part of the request: either a range of `owned` or a borrowed range
+	struct Part {
+		char const * data;	// nullptr if owned
+		std::size_t offset;	// position inside `owned` (if owned)
+		std::size_t size;
+	};
+
+	private:
+		SmallBuffer<std::allocator<char>, 32u> owned;
+		SmallBuffer<std::allocator<Part>, 8u> parts;
+		std::size_t num_bytes;
+
+	public:
+		Segments()
+			: owned{}
+			, parts{}
+			, num_bytes{0u} {
+		}
+
+		/// Append a copy of the given bytes
+		/**
+		 *	@param data Bytes to copy
+		 *	@param size Number of bytes
+		 */
+		inline void append(char const * data, std::size_t size) {
+			if (size == 0u) {
+				return;
+			}
+			if (!parts.empty() && parts.back().data == nullptr) {
+				parts.back().size += size;
+			} else {
+				parts.push_back(Part{nullptr, owned.size(), size});
+			}
+			auto offset = owned.size();
+			owned.resize(offset + size);
+			std::memcpy(owned.data() + offset, data, size);
+			num_bytes += size;
+		}
+
+		/// Append a reference to the given bytes
+		/**
+		 *	@param data Bytes to reference, which must outlive the write
+		 *	@param size Number of bytes
+		 */
+		inline void borrow(char const * data, std::size_t size) {
+			if (size == 0u) {
+				return;
+			}
+			parts.push_back(Part{data, 0u, size});
+			num_bytes += size;
+		}
+
+		/// Return the total number of bytes
+		inline std::size_t size() const {
+			return num_bytes;
+		}
+
+		/// Return the segments to be written
+		/**
+		 *	The segments point into this object, so they become invalid once
+		 *	more bytes are appended.
+		 *
+		 *	@return Segments in order of the request
+		 */
+		IoVector gather() const {
+			IoVector out;
+			out.resize(parts.size());
+			for (auto i = 0u; i < parts.size(); ++i) {
+				auto const & part = parts[i];
+				auto data = (part.data == nullptr) ? owned.data() + part.offset : part.data;
+				out[i] = iovec{const_cast<char*>(data), part.size};
+			}
+			return out;
+		}
+
+		/// Return a copy of the entire request
+		/**
+		 *	@return Request string
+		 */
+		std::string str() const {
+			std::string out;
+			out.reserve(num_bytes);
+			for (auto i = 0u; i < parts.size(); ++i) {
+				auto const & part = parts[i];
+				out.append((part.data == nullptr) ? owned.data() + part.offset : part.data, part.size);
+			}
+			return out;
+		}
+};
+
+} // ::priv
+} // ::redisxx
@@ -0,0 +1,285 @@
+/** @file sharding.hpp
+ *
+ * RedisXX Sharded Connection implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <string>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <redisxx/command.hpp>
+#include <redisxx/connection.hpp>
+#include <redisxx/fanout.hpp>
+#include <redisxx/keys.hpp>
+#include <redisxx/reply.hpp>
+
+namespace redisxx {
+
+/// Address of a shard
+struct Shard {
+	std::string host;		// remote host's name OR local stream's filename
+	std::uint16_t port;		// remote host's port number OR zero
+
+	Shard(std::string const & host, std::uint16_t port=0u)
+		: host{host}
+		, port{port} {
+	}
+
+	/// Return the name identifying the shard on the hash ring
+	inline std::string getName() const {
+		return (port == 0u) ? host : host + ':' + std::to_string(port);
+	}
+};
+
+namespace priv {
+
+// number of points per shard on a hash ring
+static std::size_t const default_ring_points = 160u;
+
+/// Consistent hash ring
+/**
+ *	Each shard is placed on the ring at several points (virtual nodes), which
+ *	are derived from its name. A key belongs to the shard owning the next
+ *	point following the key's hash. So adding or removing a shard only moves
+ *	the keys between that shard and its neighbours, about 1/n of all keys,
+ *	no matter in which order the shards are given. More points per shard
+ *	spread the keys more evenly, but make the ring larger.
+ */
+class HashRing {
+	private:
+		std::vector<std::pair<std::uint64_t, std::size_t>> points;	// position and shard, sorted
+
+	public:
+		/// Create a ring for the given shards
+		/**
+		 *	@param names Names of the shards
+		 *	@param num_points Number of points per shard
+		 */
+		HashRing(std::vector<std::string> const & names, std::size_t num_points=default_ring_points)
+			: points{} {
+			points.reserve(names.size() * num_points);
+			for (std::size_t shard = 0u; shard < names.size(); ++shard) {
+				for (std::size_t i = 0u; i < num_points; ++i) {
+					auto const point = names[shard] + '#' + std::to_string(i);
+					points.emplace_back(hash64(point.data(), point.size()), shard);
+				}
+			}
+			std::sort(points.begin(), points.end());
+		}
+
+		/// Return the shard the given key belongs to
+		/**
+		 *	Keys sharing a hash tag (see `hash_tag()`) belong to the same
+		 *	shard.
+		 *
+		 *	@param key Key to locate
+		 *	@return Index of the shard
+		 */
+		std::size_t locate(StringView key) const {
+			auto const tag = hash_tag(key);
+			auto const hash = hash64(tag.data(), tag.size());
+			auto it = std::upper_bound(points.begin(), points.end(), hash,
+				[](std::uint64_t hash, std::pair<std::uint64_t, std::size_t> const & point) {
+					return hash < point.first;
+				});
+			return (it == points.end()) ? points.front().second : it->second;
+		}
+};
+
+} // ::priv
+
+/// Connection to multiple independent redis instances (shards)
+/**
+ *	Each key belongs to one shard, which is determined by a consistent hash
+ *	ring (see `priv::HashRing`). Each command is sent to the shard its key
+ *	belongs to (see `priv::key_of()`), commands without a key are sent to
+ *	the first shard. Keys sharing a hash tag (e.g. "{user:42}.name" and
+ *	"{user:42}.mail") belong to the same shard. Each shard is reached by its
+ *	own `Connection`, which uses the given pool and pipeline policies.
+ *	Copies of a sharded connection share the same sockets.
+ *
+ *	Example usage:
+ *	@code
+ *		redisxx::ShardedConnection<redisxx::BoostTcpSocket> conn{{
+ *			{"cache1", 6379}, {"cache2", 6379}, {"cache3", 6379}
+ *		}};
+ *		conn(redisxx::Command{"SET", "user:42", "max"});
+ *	@endcode
+ */
+#if defined(REDISXX_UNIX_SOCKET)
+template <typename SocketImpl = BoostUnixSocket>
+#elif defined(REDISXX_BOOST_SOCKET)
+template <typename SocketImpl = BoostTcpSocket>
+#elif defined(REDISXX_SFML_SOCKET)
+template <typename SocketImpl = SfmlTcpSocket>
+#elif defined(REDISXX_SDLNET_SOCKET)
+template <typename SocketImpl = SdlNetTcpSocket>
+#else
+template <typename SocketImpl>
+#endif
+class ShardedConnection {
+
+	using Callback = std::function<void(std::exception_ptr, Reply)>;
+
+	private:
+		std::vector<Connection<SocketImpl>> shards;
+		std::shared_ptr<priv::HashRing const> ring;
+
+		// shard of the given command
+		template <typename Allocator>
+		std::size_t route(BasicCommand<Allocator> const & cmd) const {
+			StringView key;
+			return priv::key_of(cmd, key) ? ring->locate(key) : 0u;
+		}
+
+		template <typename Allocator>
+		void submit(BasicCommand<Allocator> const & cmd, Callback callback) {
+			shards[route(cmd)].async(cmd, std::move(callback));
+		}
+
+		template <typename Allocator>
+		void submit(BasicCommandList<Allocator> const & list, Callback callback) {
+			if (list.getBatchType() == BatchType::Transaction) {
+				// all keys of a transaction are expected to belong to the same shard
+				std::size_t shard = 0u;
+				StringView key;
+				for (std::size_t i = 0u; i < list.size(); ++i) {
+					if (priv::key_of(list.at(i), key)) {
+						shard = ring->locate(key);
+						break;
+					}
+				}
+				shards[shard].async(list, std::move(callback));
+				return;
+			}
+			if (list.empty()) {
+				priv::invoke_callback(callback, nullptr, priv::join_replies({}));
+				return;
+			}
+			auto const batches = priv::split_pipeline<std::size_t>(list, [this](BasicCommand<Allocator> const & cmd) {
+				return route(cmd);
+			});
+			if (batches.size() == 1u) {
+				shards[batches.front()->target].async(batches.front()->list, std::move(callback));
+				return;
+			}
+			auto fanout = std::make_shared<priv::Fanout>(list.size(), std::move(callback));
+			for (auto const & batch: batches) {
+				shards[batch->target].async(batch->list, [fanout, batch](std::exception_ptr error, Reply reply) {
+					fanout->set(batch->positions, error, reply);
+				});
+			}
+		}
+
+	public:
+		/// Create a new connection to the given shards
+		/**
+		 *	No socket is opened here (see `Connection`). A shard's position on
+		 *	the hash ring depends on its address (see `Shard::getName()`), so
+		 *	the order of the shards does not matter.
+		 *
+		 *	@param shards Addresses of the shards
+		 *	@param policy Size and idle policy of each shard's socket pool
+		 *	@param pipelining Automatic pipelining of each shard's connection
+		 *	@param num_points Number of points per shard on the hash ring
+		 *	@throw std::invalid_argument if no shard is given
+		 */
+		ShardedConnection(std::vector<Shard> const & shards, PoolPolicy const & policy=PoolPolicy{},
+			PipelinePolicy const & pipelining=PipelinePolicy{}, std::size_t num_points=priv::default_ring_points)
+			: shards{}
+			, ring{} {
+			if (shards.empty() || num_points == 0u) {
+				throw std::invalid_argument{"Sharding requires at least one shard and point"};
+			}
+			std::vector<std::string> names;
+			for (auto const & shard: shards) {
+				this->shards.emplace_back(shard.host, shard.port, policy, pipelining);
+				names.push_back(shard.getName());
+			}
+			ring = std::make_shared<priv::HashRing const>(names, num_points);
+		}
+
+		/// Execute the given request
+		/**
+		 *	This works like `Connection::operator()`, but the request is sent
+		 *	to the shard(s) its keys belong to. A pipelined `CommandList` is
+		 *	split into one pipeline per shard, which are executed in parallel.
+		 *	The reply still contains one reply per command, in the order of
+		 *	the commands. A transaction is sent to the shard of its first key,
+		 *	so all of its keys should share a hash tag. So should the keys of
+		 *	a command referring to multiple keys (e.g. MGET), which is sent to
+		 *	the shard of its first key.
+		 *
+		 *	Example usage:
+		 *	@code
+		 *		redisxx::CommandList list{redisxx::BatchType::Pipeline};
+		 *		for (auto const & id: ids) {
+		 *			list << redisxx::Command{"GET", "user:" + id};
+		 *		}
+		 *		auto users = conn(list).get();
+		 *		// users[i] is the reply to the i-th GET
+		 *	@endcode
+		 *
+		 *	@param request Command or command list
+		 *	@return Future reply
+		 */
+		template <typename Request>
+		std::future<Reply> operator()(Request const & request) {
+			auto promise = std::make_shared<std::promise<Reply>>();
+			auto future = promise->get_future();
+			submit(request, priv::fulfil(promise));
+			return future;
+		}
+
+		/// Execute the given request and pass its reply to the given handler
+		/**
+		 *	This works like `Connection::async()` (see `operator()`).
+		 *
+		 *	@param request Command or command list
+		 *	@param handler Callable as `void(std::exception_ptr, redisxx::Reply)`
+		 */
+		template <typename Request, typename Handler>
+		void async(Request const & request, Handler handler) {
+			submit(request, Callback{std::move(handler)});
+		}
+
+		/// Return the number of shards
+		inline std::size_t getNumShards() const {
+			return shards.size();
+		}
+
+		/// Return the shard the given key belongs to
+		/**
+		 *	@param key Key to locate
+		 *	@return Index of the shard (in the order they were given)
+		 */
+		inline std::size_t getShardOf(StringView key) const {
+			return ring->locate(key);
+		}
+
+		/// Return the connection to the given shard
+		/**
+		 *	This can be used to send commands to a specific shard, e.g. to
+		 *	run INFO or FLUSHDB on each shard.
+		 *
+		 *	@param index Index of the shard
+		 *	@return Connection to the shard
+		 */
+		inline Connection<SocketImpl>& getShard(std::size_t index) {
+			return shards.at(index);
+		}
+};
+
+} // ::redisxx
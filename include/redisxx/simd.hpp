@@ -0,0 +1,184 @@
+/** @file simd.hpp
+ *
+ * RedisXX SIMD kernels for scanning replies
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__)
+#include <immintrin.h>
+#define REDISXX_SIMD_X86 1
+#define REDISXX_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// code that is parametrized by a kernel is inlined into the function that is
+// compiled for that kernel, so the kernel can be inlined in turn
+#if defined(__GNUC__)
+#define REDISXX_ALWAYS_INLINE __attribute__((always_inline)) inline
+#else
+#define REDISXX_ALWAYS_INLINE inline
+#endif
+
+namespace redisxx {
+namespace priv {
+
+/// Kernel used to scan reply headers
+enum class ScanKernel {
+	Scalar, Sse2, Avx2
+};
+
+// longest header that is scanned at once ("-9223372036854775808")
+static std::size_t const max_header_length = 20u;
+
+/// Scalar header scan
+/**
+ *	Scans the line after a type byte (e.g. "123\r\n" of "$123\r\n"). The line
+ *	is valid if it consists of digits (at least one), optionally preceded by
+ *	a '-', and is terminated by a CR.
+ *
+ *	@param data Begin of the line
+ *	@param end End of the available data
+ *	@return Position of the CR OR -1 if the line is invalid or not complete
+ */
+struct ScalarScanner {
+	static inline int header(char const * data, char const * end) {
+		auto last = (static_cast<std::size_t>(end - data) > max_header_length) ? data + max_header_length + 1 : end;
+		auto ptr = data;
+		if (ptr != last && *ptr == '-') {
+			++ptr;
+		}
+		auto digits = ptr;
+		while (ptr != last && static_cast<unsigned>(*ptr - '0') <= 9u) {
+			++ptr;
+		}
+		if (ptr == digits || ptr == last || *ptr != '\r') {
+			return -1;
+		}
+		return static_cast<int>(ptr - data);
+	}
+};
+
+#if defined(REDISXX_SIMD_X86)
+
+// check the CR and digit masks of a loaded window
+inline int check_header(char const * data, unsigned cr, unsigned digits) {
+	if (cr == 0u) {
+		return -1;
+	}
+	auto pos = __builtin_ctz(cr);
+	auto expected = (1u << pos) - 1u;
+	if (data[0] == '-') {
+		digits |= 1u;
+		if (pos == 1) {
+			return -1;
+		}
+	}
+	if (pos == 0 || (digits & expected) != expected) {
+		return -1;
+	}
+	return pos;
+}
+
+/// Header scan inspecting 16 bytes at once
+/**
+ *	Locates the CR and validates all digits in front of it with a single
+ *	comparison each. Falls back to the scalar scan at the end of the data.
+ */
+struct Sse2Scanner {
+	static inline int header(char const * data, char const * end) {
+		if (end - data < 16) {
+			return ScalarScanner::header(data, end);
+		}
+		auto bytes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data));
+		auto cr = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'))));
+		// bytes above 0x7f are negative, so they are no digits either
+		auto digits = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpgt_epi8(bytes, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(bytes, _mm_set1_epi8('9' + 1)))));
+		return check_header(data, cr, digits);
+	}
+};
+
+/// Header scan inspecting 32 bytes at once
+/**
+ *	Equivalent to the SSE2 scan, but each window covers the longest header.
+ *	Only used inside functions compiled for AVX2 (see REDISXX_TARGET_AVX2).
+ */
+struct Avx2Scanner {
+	REDISXX_TARGET_AVX2
+	static inline int header(char const * data, char const * end) {
+		if (end - data < 32) {
+			return ScalarScanner::header(data, end);
+		}
+		auto bytes = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(data));
+		auto cr = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r'))));
+		auto digits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(
+			_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), bytes))));
+		return check_header(data, cr, digits);
+	}
+};
+
+#endif
+
+/// Query whether the CPU supports the given kernel
+/**
+ *	@param kernel Kernel to check
+ *	@return True if the kernel was compiled in and can be run
+ */
+inline bool supports_scan_kernel(ScanKernel kernel) {
+	switch (kernel) {
+#if defined(REDISXX_SIMD_X86)
+		case ScanKernel::Avx2:
+			return __builtin_cpu_supports("avx2");
+		case ScanKernel::Sse2:
+			return true;
+#endif
+		case ScanKernel::Scalar:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/// Detect the kernel to use by default
+/**
+ *	SSE2 is used wherever it is available. Headers rarely exceed 15 bytes,
+ *	so the wider AVX2 windows don't pay off: they are split across cache
+ *	lines more often, which made them slightly slower on the parser
+ *	benchmark (see benchmark_suite/parser.cpp).
+ */
+inline ScanKernel detect_scan_kernel() {
+	return supports_scan_kernel(ScanKernel::Sse2) ? ScanKernel::Sse2 : ScanKernel::Scalar;
+}
+
+// kernel used by parsers that are created afterwards
+inline std::atomic<ScanKernel>& active_scan_kernel() {
+	static std::atomic<ScanKernel> kernel{detect_scan_kernel()};
+	return kernel;
+}
+
+/// Query the kernel used to scan replies
+inline ScanKernel getScanKernel() {
+	return active_scan_kernel().load(std::memory_order_relaxed);
+}
+
+/// Change the kernel used to scan replies
+/**
+ *	This is meant for testing and benchmarking. The kernel is detected at
+ *	startup, a kernel that is not supported by the CPU (or not compiled in)
+ *	is replaced by the default one.
+ *
+ *	@param kernel Kernel to use for parsers that are created afterwards
+ */
+inline void setScanKernel(ScanKernel kernel) {
+	if (!supports_scan_kernel(kernel)) {
+		kernel = detect_scan_kernel();
+	}
+	active_scan_kernel().store(kernel, std::memory_order_relaxed);
+}
+
+} // ::priv
+} // ::redisxx
@@ -0,0 +1,199 @@
+/** @file small_buffer.hpp
+ *
+ * RedisXX buffer with inline storage implementation
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace redisxx {
+namespace priv {
+
+/// Buffer storing up to N elements inline
+/**
+ *	As long as the content fits into the inline storage, the buffer does not
+ *	allocate at all. Larger content is stored using the given allocator.
+ *	Only the operations that are needed to encode and write commands are
+ *	provided (similar to those of `std::string`). The elements (usually
+ *	bytes) are required to be trivially copyable. Note that growing the
+ *	buffer does not initialize the new elements.
+ *	Moving never allocates, so it is `noexcept` (e.g. a vector of commands
+ *	moves them while growing). Allocated memory is moved along with the
+ *	allocator owning it.
+ */
+template <typename Allocator, std::size_t N>
+class SmallBuffer {
+
+	using Traits = std::allocator_traits<Allocator>;
+	using T = typename Traits::value_type;
+
+	static_assert(std::is_trivial<T>::value, "Only trivial elements are supported");
+
+	private:
+		Allocator alloc;
+		T* ptr;				// either `storage` or allocated memory
+		std::size_t length;
+		std::size_t cap;
+		T storage[N];
+
+		inline bool isInline() const {
+			return ptr == storage;
+		}
+
+		void release() {
+			if (!isInline()) {
+				Traits::deallocate(alloc, ptr, cap);
+				ptr = storage;
+				cap = N;
+			}
+		}
+
+	public:
+		explicit SmallBuffer(Allocator const & alloc=Allocator{})
+			: alloc(alloc)
+			, ptr{storage}
+			, length{0u}
+			, cap{N} {
+		}
+
+		SmallBuffer(T const * data, std::size_t size, Allocator const & alloc)
+			: SmallBuffer{alloc} {
+			resize(size);
+			std::memcpy(ptr, data, size * sizeof(T));
+		}
+
+		SmallBuffer(SmallBuffer const & other)
+			: SmallBuffer{other.data(), other.size(), Traits::select_on_container_copy_construction(other.alloc)} {
+		}
+
+		SmallBuffer(SmallBuffer&& other) noexcept
+			: alloc(std::move(other.alloc))
+			, ptr{storage}
+			, length{other.length}
+			, cap{N} {
+			if (other.isInline()) {
+				std::memcpy(storage, other.storage, other.length * sizeof(T));
+			} else {
+				// take the allocated memory
+				ptr = other.ptr;
+				cap = other.cap;
+				other.ptr = other.storage;
+				other.cap = N;
+			}
+			other.length = 0u;
+		}
+
+		~SmallBuffer() {
+			release();
+		}
+
+		SmallBuffer& operator=(SmallBuffer const & other) {
+			if (this != &other) {
+				resize(other.length);
+				std::memcpy(ptr, other.ptr, other.length * sizeof(T));
+			}
+			return *this;
+		}
+
+		SmallBuffer& operator=(SmallBuffer&& other) noexcept {
+			if (this == &other) {
+				return *this;
+			}
+			if (other.isInline()) {
+				// fits into the current memory, which holds at least N elements
+				std::memcpy(ptr, other.storage, other.length * sizeof(T));
+				length = other.length;
+				other.length = 0u;
+				return *this;
+			}
+			// take the allocated memory along with its allocator
+			release();
+			alloc = std::move(other.alloc);
+			ptr = other.ptr;
+			cap = other.cap;
+			length = other.length;
+			other.ptr = other.storage;
+			other.cap = N;
+			other.length = 0u;
+			return *this;
+		}
+
+		/// Change the size, keeping the current content
+		/**
+		 *	@param size New number of elements
+		 */
+		void resize(std::size_t size) {
+			if (size > cap) {
+				auto capacity = std::max(size, 2u * cap);
+				auto memory = Traits::allocate(alloc, capacity);
+				std::memcpy(memory, ptr, length * sizeof(T));
+				release();
+				ptr = memory;
+				cap = capacity;
+			}
+			length = size;
+		}
+
+		inline void push_back(T const & value) {
+			resize(length + 1u);
+			ptr[length - 1u] = value;
+		}
+
+		inline void clear() {
+			length = 0u;
+		}
+
+		inline bool empty() const {
+			return length == 0u;
+		}
+
+		inline T* data() {
+			return ptr;
+		}
+
+		inline T const * data() const {
+			return ptr;
+		}
+
+		inline T& back() {
+			return ptr[length - 1u];
+		}
+
+		inline std::size_t size() const {
+			return length;
+		}
+
+		inline std::size_t capacity() const {
+			return cap;
+		}
+
+		inline T& operator[](std::size_t pos) {
+			return ptr[pos];
+		}
+
+		inline T const & operator[](std::size_t pos) const {
+			return ptr[pos];
+		}
+
+		inline Allocator get_allocator() const {
+			return alloc;
+		}
+
+		inline bool operator==(SmallBuffer const & other) const {
+			return length == other.length && std::memcmp(ptr, other.ptr, length * sizeof(T)) == 0;
+		}
+
+		inline bool operator!=(SmallBuffer const & other) const {
+			return !(*this == other);
+		}
+};
+
+} // ::priv
+} // ::redisxx
@@ -8,7 +8,13 @@
  */
 #pragma once
 #include <string>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
 
+#include <redisxx/error.hpp>
+#include <redisxx/parser.hpp>
+#include <redisxx/reply.hpp>
 #include <redisxx/type_traits.hpp>
 
 // note: user needs to explicitly include a socket wrapper to enable it
@@ -16,81 +22,186 @@
 namespace redisxx {
 namespace priv {
 
+// minimum number of bytes requested by a single read
+static std::size_t const read_chunk_size = 4096u;
+
+// minimum size of a segment that is written without copying it first
+static std::size_t const direct_write_size = 16384u;
+
+/// Write the given segments at once
+/**
+ *	The socket writes all segments using a single vectored write.
+ *
+ *	@throw ConnectionError if an error occured
+ *	@param socket Reference to a socket wrapper
+ *	@param segments Segments to write
+ *	@param num Number of segments
+ */
+template <typename SocketImpl>
+typename std::enable_if<has_vectored_write<SocketImpl>::value>::type
+_write_segments(SocketImpl& socket, iovec const * segments, std::size_t num) {
+	socket.write(segments, num);
+}
+
+/// Write the given segments one after another
+/**
+ *	The socket does not support vectored writes. So small segments are
+ *	concatenated and written at once, while large segments are written
+ *	without copying them.
+ *
+ *	@throw ConnectionError if an error occured
+ *	@param socket Reference to a socket wrapper
+ *	@param segments Segments to write
+ *	@param num Number of segments
+ */
+template <typename SocketImpl>
+typename std::enable_if<!has_vectored_write<SocketImpl>::value>::type
+_write_segments(SocketImpl& socket, iovec const * segments, std::size_t num) {
+	std::string pending;
+	for (auto i = 0u; i < num; ++i) {
+		auto data = static_cast<char const *>(segments[i].iov_base);
+		auto size = segments[i].iov_len;
+		if (size < direct_write_size) {
+			pending.append(data, size);
+			continue;
+		}
+		if (!pending.empty()) {
+			socket.write(pending.data(), pending.size());
+			pending.clear();
+		}
+		socket.write(data, size);
+	}
+	if (!pending.empty()) {
+		socket.write(pending.data(), pending.size());
+	}
+}
+
+/// Continue receiving the current reply
+/**
+ *	This function feeds the given parser with received bytes until the parser
+ *	completed its current reply. Bytes that were received before but were not
+ *	parsed yet are fed first. Further bytes are read from the socket, which
+ *	blocks until they are available. Bytes that were received beyond the end
+ *	of the reply remain unparsed inside the buffer.
+ *	The end of the reply is determined by parsing its framing while it is
+ *	received. So the reply is neither truncated nor rescanned, no matter how
+ *	large it is or how it is split up by the socket. The buffer grows as
+ *	needed, so its size may exceed the number of received bytes.
+ *
+ *	@throw ConnectionError if an error occured
+ *	@throw ProtocolError if the reply is not RESP-compliant
+ *	@param socket Reference to a socket wrapper
+ *	@param parser Parser expecting the current reply
+ *	@param buffer Receive buffer
+ *	@param parsed Number of parsed bytes inside the buffer
+ *	@param received Number of received bytes inside the buffer
+ */
+template <typename SocketImpl>
+void _receive(SocketImpl& socket, ReplyParser& parser, std::string& buffer, std::size_t& parsed, std::size_t& received) {
+	parsed += parser.feed(buffer.data() + parsed, received - parsed);
+	while (!parser.done()) {
+		// provide space for (at least) the bytes known to be missing
+		auto needed = received + std::max(parser.expected(), read_chunk_size);
+		if (buffer.size() < needed) {
+			if (buffer.capacity() < needed) {
+				buffer.reserve(std::max(needed, 2u * buffer.capacity()));
+			}
+			buffer.resize(buffer.capacity());
+		}
+		auto num_bytes = socket.read_some(&buffer[received], buffer.size() - received);
+		if (num_bytes == 0u) {
+			// nothing available yet, so block until the reply continues
+			socket.read_block(&buffer[received], 1u);
+			num_bytes = 1u;
+		}
+		received += num_bytes;
+		parsed += parser.feed(&buffer[parsed], received - parsed);
+	}
+}
+
+/// Receive a reply
+/**
+ *	This function reads an entire reply from the given socket. If no reply is
+ *	available yet, this function will block until the reply is available.
+ *	If requested, the reply's values are recorded while parsing.
+ *	The replies of a batch of requests are received as the elements of a
+ *	single array reply. Therefore, the given header (e.g. "*3\r\n" for a
+ *	batch of three requests) is treated as if it was received first.
+ *
+ *	@throw ConnectionError if an error occured
+ *	@throw ProtocolError if the reply is not RESP-compliant
+ *	@param socket Reference to a socket wrapper
+ *	@param record Whether to record the reply's values
+ *	@param header Optional array header grouping the replies of a batch
+ *	@return Receive buffer containing the reply
+ */
+template <typename SocketImpl>
+std::shared_ptr<ReplyData> _receive_reply(SocketImpl& socket, bool record, std::string const & header=std::string{}) {
+	auto data = std::make_shared<ReplyData>();
+	ReplyParser parser{record ? &data->nodes : nullptr};
+	data->buffer = header;
+	std::size_t parsed = 0u, received = header.size();
+	_receive(socket, parser, data->buffer, parsed, received);
+	if (parsed < received) {
+		throw ProtocolError{"Received more data than the reply contains"};
+	}
+	// strip unused chars
+	data->buffer.resize(received);
+	return data;
+}
+
 /// Continue processing a request
 /**
  *	This function processes the given request using the given socket. It reads
- *	the entire reply string and returns it. If no reply is available yet, this
+ *	the entire reply and returns it. If no reply is available yet, this
  *	function will block until the reply is available.
  *
  *	@throw ConnectionError if an error occured
+ *	@throw ProtocolError if the reply is not RESP-compliant
  *	@param socket Reference to a socket wrapper
  *	@param request RESP-compliant Request string
- *	@return Entire reply string
+ *	@param header Optional array header grouping the replies of a batch
+ *	@return Entire reply
  */
 template <typename SocketImpl>
-std::string _execute_request(SocketImpl& socket, std::string const & request) {
+Reply _execute_request(SocketImpl& socket, std::string const & request, std::string const & header=std::string{}) {
 	// write request
 	socket.write(request.c_str(), request.size());
-	// read chunks of the reply
-	std::string buffer;
-	char byte;
-	socket.read_block(&byte, 1u);
-	buffer += byte;
-	std::size_t chunk_size = 256u;
-	std::size_t pos = 1u;
-	while (true) {
-		// resize buffer
-		buffer.resize(buffer.size() + chunk_size);
-		// read chunk
-		auto received = socket.read_some(&buffer[pos], chunk_size);
-		pos += received;
-		if (received < chunk_size) {
-			// strip unused chars
-			buffer.resize(buffer.size() - (chunk_size - received));
-			break;
-		}
-	}
-	return buffer;
+	// read reply
+	return Reply{_receive_reply(socket, true, header), 0u};
 }
 
-/// Process a request using the specified Streaming Socket
+/// Open a Streaming Socket of the given SocketImpl type
 /**
- *	This function creates a new Streaming Socket of the given SocketImpl type
- *	and use it to process the given request.
+ *	This function creates a new Streaming Socket of the given SocketImpl type,
+ *	which is connected to the given local stream.
  *
- *	@throw ConnectionError if an error occured (see _execute_request)
+ *	@throw ConnectionError if the socket cannot be connected
  *	@param host filename of the streaming socket
  *	@param port not used here (necessary for API reasons)
- *	@param request RESP-compliant Request string
- *	@return Entire reply string
+ *	@return Connected socket
  */
 template <typename SocketImpl>
-typename std::enable_if<is_stream_socket<SocketImpl>::value, std::string>::type
-execute_request(std::string const & host, std::uint16_t port, std::string const & request) {
-	// create dedicated socket for this request
-	SocketImpl socket{host}; // host contains filename
-	// process request using this socket
-	return priv::_execute_request(socket, request);
+typename std::enable_if<is_stream_socket<SocketImpl>::value, std::unique_ptr<SocketImpl>>::type
+create_socket(std::string const & host, std::uint16_t port) {
+	// host contains filename
+	return std::unique_ptr<SocketImpl>{new SocketImpl{host}};
 }
 
-/// Process a request using the specified TCP Socket
+/// Open a TCP Socket of the given SocketImpl type
 /**
- *	This function creates a new TCP Socket of the given SocketImpl type and use
- *	it to process the given request.
+ *	This function creates a new TCP Socket of the given SocketImpl type, which
+ *	is connected to the given remote host.
  *
- *	@throw ConnectionError if an error occured (see _execute_request)
+ *	@throw ConnectionError if the socket cannot be connected
  *	@param host remote host name to access
  *	@param port remote host's port number to access
- *	@param request RESP-compliant Request string
- *	@return Entire reply string
+ *	@return Connected socket
  */
 template <typename SocketImpl>
-typename std::enable_if<is_tcp_socket<SocketImpl>::value, std::string>::type
-execute_request(std::string const & host, std::uint16_t port, std::string const & request) {
-	// create dedicated socket for this request
-	SocketImpl socket{host, port};
-	// process request using this socket
-	return priv::_execute_request(socket, request);
+typename std::enable_if<is_tcp_socket<SocketImpl>::value, std::unique_ptr<SocketImpl>>::type
+create_socket(std::string const & host, std::uint16_t port) {
+	return std::unique_ptr<SocketImpl>{new SocketImpl{host, port}};
 }
 
 } // ::priv
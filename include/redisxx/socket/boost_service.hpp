@@ -0,0 +1,118 @@
+/** @file boost_service.hpp
+ *
+ * RedisXX io_service management for the Boost.Asio socket wrappers
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+
+#include <redisxx/error.hpp>
+
+namespace redisxx {
+namespace priv {
+
+/// io_service used by the sockets of a Boost.Asio wrapper
+/**
+ *	Sockets use the io_service that was passed to `setService()` before they
+ *	were created, so asynchronous operations are completed by the threads
+ *	that run it (e.g. the application's existing reactor). Else, they use an
+ *	internal io_service, which is run by a single thread once the first
+ *	asynchronous operation is started.
+ *	Each wrapper (given as template argument) has its own instance.
+ */
+template <typename SocketImpl>
+class BoostService {
+	private:
+		boost::asio::io_service internal;
+		boost::asio::io_service* external;
+		std::unique_ptr<boost::asio::io_service::work> work;
+		std::thread thread;
+		std::mutex mutex;
+
+		BoostService()
+			: internal{}
+			, external{nullptr}
+			, work{}
+			, thread{}
+			, mutex{} {
+		}
+
+	public:
+		~BoostService() {
+			if (thread.joinable()) {
+				work.reset();
+				internal.stop();
+				thread.join();
+			}
+		}
+
+		/// Use the given io_service for sockets that are created afterwards
+		/**
+		 *	@param service io_service, which must outlive those sockets, or
+		 *		nullptr to use the internal one
+		 */
+		void setService(boost::asio::io_service* service) {
+			std::lock_guard<std::mutex> lock{mutex};
+			external = service;
+		}
+
+		/// Return the io_service for a new socket
+		boost::asio::io_service& getService() {
+			std::lock_guard<std::mutex> lock{mutex};
+			return (external != nullptr) ? *external : internal;
+		}
+
+		/// Make sure the given io_service is run
+		/**
+		 *	Starts the thread running the internal io_service if needed.
+		 *	An external io_service is run by its owner.
+		 *
+		 *	@param service io_service of a socket
+		 */
+		void run(boost::asio::io_service& service) {
+			if (&service != &internal) {
+				return;
+			}
+			std::lock_guard<std::mutex> lock{mutex};
+			if (!thread.joinable()) {
+				work.reset(new boost::asio::io_service::work{internal});
+				thread = std::thread{[this]() {
+					internal.run();
+				}};
+			}
+		}
+
+		/// Return the instance of the wrapper
+		static BoostService& get() {
+			static BoostService instance;
+			return instance;
+		}
+};
+
+/// Wrap an error code of an asynchronous operation
+/**
+ *	@param error Error code passed to the completion handler
+ *	@param host Remote host name (or filename of a unix domain socket)
+ *	@param port Remote port (zero for unix domain sockets)
+ *	@return ConnectionError as exception_ptr or nullptr on success
+ */
+inline std::exception_ptr wrap_error(boost::system::error_code const & error, std::string const & host, std::uint16_t port) {
+	if (!error) {
+		return nullptr;
+	}
+	if (port == 0u) {
+		return std::make_exception_ptr(ConnectionError{error.message(), host});
+	}
+	return std::make_exception_ptr(ConnectionError{error.message(), host, port});
+}
+
+} // ::priv
+} // ::redisxx
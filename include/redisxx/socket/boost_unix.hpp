@@ -8,10 +8,16 @@
  */
 #pragma once
 #include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 #include <boost/asio.hpp>
 
 #include <redisxx/error.hpp>
+#include <redisxx/segments.hpp>
+#include <redisxx/socket/boost_service.hpp>
 
 #if not defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
 #error UnixDomainSocket is not available through Boost.
@@ -22,18 +28,48 @@
 namespace redisxx {
 
 /// Socket wrapper using Boost for Unix Domain Socket
+/**
+ *	Besides blocking operations, the socket provides asynchronous ones. A
+ *	connection uses them to receive replies, so no thread is blocked while
+ *	waiting for them. They are completed by the threads running the socket's
+ *	io_service (see `setService()`).
+ *	Asynchronous operations are started, cancelled and completed within a
+ *	strand, so the threads running the io_service and the threads calling
+ *	`cancel()` never access the Asio socket concurrently. Blocking writes
+ *	are issued by the calling thread, which may overlap a pending read: the
+ *	socket is switched to non-blocking mode once connected (blocking
+ *	operations are emulated by Asio), so neither modifies the socket's state.
+ */
 class BoostUnixSocket {
 	private:
-		static boost::asio::io_service service;
-		boost::asio::local::stream_protocol::socket socket;
-		std::string const filename;
+		boost::asio::io_service& service;
+		std::shared_ptr<boost::asio::local::stream_protocol::socket> const socket;	// shared with pending operations
+		std::shared_ptr<boost::asio::io_service::strand> const strand;
+		std::shared_ptr<std::string const> const filename;	// shared with pending handlers
 	
 	public:
+		/// Use the given io_service for all sockets that are created afterwards
+		/**
+		 *	Asynchronous operations are completed by the threads that run the
+		 *	given io_service (e.g. by calling `run()` from N threads). By
+		 *	default, an internal io_service run by a single thread is used.
+		 *
+		 *	@param service io_service, which must outlive the sockets, or
+		 *		nullptr to use the internal one
+		 */
+		static void setService(boost::asio::io_service* service) {
+			priv::BoostService<BoostUnixSocket>::get().setService(service);
+		}
+
 		BoostUnixSocket(std::string const & filename)
-			: socket{BoostUnixSocket::service}
-			, filename{filename} {
+			: service(priv::BoostService<BoostUnixSocket>::get().getService())
+			, socket{std::make_shared<boost::asio::local::stream_protocol::socket>(service)}
+			, strand{std::make_shared<boost::asio::io_service::strand>(service)}
+			, filename{std::make_shared<std::string const>(filename)} {
 			try {
-				socket.connect(boost::asio::local::stream_protocol::endpoint(filename));
+				socket->connect(boost::asio::local::stream_protocol::endpoint(filename));
+				// otherwise, the first asynchronous read switches the mode while a write might use the socket
+				socket->native_non_blocking(true);
 			} catch (boost::system::system_error const & e) {
 				// wrap to general exception
 				throw ConnectionError{e.what(), filename};
@@ -42,34 +78,116 @@ class BoostUnixSocket {
 		
 		void write(char const * data, std::size_t num_bytes) {
 			try {
-				socket.send(boost::asio::buffer(data, num_bytes));
+				// loops until all bytes were sent, as the socket is non-blocking
+				boost::asio::write(*socket, boost::asio::buffer(data, num_bytes));
 			} catch (boost::system::system_error const & e) {
 				// wrap to general exception
-				throw ConnectionError{e.what(), filename};
+				throw ConnectionError{e.what(), *filename};
+			}
+		}
+
+		// sends all segments using a single sendmsg()
+		void write(iovec const * segments, std::size_t num) {
+			std::vector<boost::asio::const_buffer> buffers;
+			buffers.reserve(num);
+			for (auto i = 0u; i < num; ++i) {
+				buffers.emplace_back(segments[i].iov_base, segments[i].iov_len);
+			}
+			try {
+				boost::asio::write(*socket, buffers);
+			} catch (boost::system::system_error const & e) {
+				// wrap to general exception
+				throw ConnectionError{e.what(), *filename};
 			}
 		}
 
 		void read_block(char* data, std::size_t num_bytes) {
 			try {
-				boost::asio::read(socket, (boost::asio::buffer(data, num_bytes)));
+				boost::asio::read(*socket, (boost::asio::buffer(data, num_bytes)));
 			} catch (boost::system::system_error const & e) {
 				// wrap to general exception
-				throw ConnectionError{e.what(), filename};
+				throw ConnectionError{e.what(), *filename};
 			}
 		}
 
 		std::size_t read_some(char* data, std::size_t num_bytes) {
 			try {
-				return socket.read_some(boost::asio::buffer(data, num_bytes));
+				return socket->read_some(boost::asio::buffer(data, num_bytes));
 			} catch (boost::system::system_error const & e) {
 				// wrap to general exception
-				throw ConnectionError{e.what(), filename};
+				throw ConnectionError{e.what(), *filename};
 			}
 		}
-};
 
-// let's have one io_service for all of our socket
-boost::asio::io_service BoostUnixSocket::service;
+		/// Write all segments asynchronously
+		/**
+		 *	The segments are required to stay unchanged until the handler
+		 *	was called.
+		 *
+		 *	@param segments Segments to write
+		 *	@param num Number of segments
+		 *	@param handler Function called with nullptr or a ConnectionError
+		 */
+		void async_write(iovec const * segments, std::size_t num, std::function<void(std::exception_ptr)> handler) {
+			std::vector<boost::asio::const_buffer> buffers;
+			buffers.reserve(num);
+			for (auto i = 0u; i < num; ++i) {
+				buffers.emplace_back(segments[i].iov_base, segments[i].iov_len);
+			}
+			priv::BoostService<BoostUnixSocket>::get().run(service);
+			auto filename = this->filename;
+			auto socket = this->socket;
+			auto strand = this->strand;
+			strand->dispatch([socket, strand, buffers, filename, handler]() {
+				boost::asio::async_write(*socket, buffers, strand->wrap([filename, handler](boost::system::error_code const & error, std::size_t) {
+					handler(priv::wrap_error(error, *filename, 0u));
+				}));
+			});
+		}
+
+		/// Read some bytes asynchronously
+		/**
+		 *	The buffer is required to stay valid until the handler was called
+		 *	or the operation was cancelled.
+		 *
+		 *	@param data Buffer to read to
+		 *	@param num_bytes Maximum number of bytes
+		 *	@param handler Function called with nullptr (or a ConnectionError)
+		 *		and the number of bytes
+		 */
+		void async_read_some(char* data, std::size_t num_bytes, std::function<void(std::exception_ptr, std::size_t)> handler) {
+			priv::BoostService<BoostUnixSocket>::get().run(service);
+			auto filename = this->filename;
+			auto socket = this->socket;
+			auto strand = this->strand;
+			auto buffer = boost::asio::buffer(data, num_bytes);
+			strand->dispatch([socket, strand, buffer, filename, handler]() {
+				socket->async_read_some(buffer, strand->wrap([filename, handler](boost::system::error_code const & error, std::size_t num_bytes) {
+					handler(priv::wrap_error(error, *filename, 0u), num_bytes);
+				}));
+			});
+		}
+
+		/// Cancel all asynchronous operations
+		/**
+		 *	Their handlers are called with an error. Like starting an
+		 *	operation, cancelling is done within the socket's strand, so it
+		 *	may be called by any thread. Hence an operation might still
+		 *	complete normally until its cancellation was processed.
+		 */
+		void cancel() {
+			auto socket = this->socket;
+			strand->dispatch([socket]() {
+				boost::system::error_code ignored;
+				socket->cancel(ignored);
+			});
+		}
+
+		// allows the socket to be watched by the event loop
+		int native_handle() {
+			return socket->native_handle();
+		}
+};
 
 } // ::redisxx
 
@@ -0,0 +1,188 @@
+/** @file io_uring.hpp
+ *
+ * RedisXX Socket wrappers using io_uring
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include <redisxx/event_loop.hpp>
+#include <redisxx/io_uring.hpp>
+#include <redisxx/socket/posix.hpp>
+
+#if !defined(REDISXX_IO_URING)
+#error "io_uring sockets require Linux"
+#endif
+
+#define REDISXX_IO_URING_SOCKET 1
+
+namespace redisxx {
+namespace priv {
+
+/// POSIX socket performing its I/O using the shared io_uring engine
+/**
+ *	Received data is taken from the engine's (registered) buffers. The
+ *	socket watches itself: once data was received, the engine's I/O thread
+ *	calls the handler, which is expected to read it. Writes are queued
+ *	without waiting for the I/O thread, so they may be issued by the handler
+ *	as well. A failed send is reported by the next write.
+ *	If io_uring is not available (e.g. on older kernels or if it was disabled
+ *	by seccomp), the socket falls back to plain system calls and is watched
+ *	by the epoll-based event loop instead. Blocking and non-blocking reads
+ *	behave as with the POSIX socket. Blocking reads obey the I/O timeout.
+ */
+template <typename Base>
+class UringSocket: public Base {
+	private:
+		UringEngine* const engine;	// nullptr if io_uring is not available
+		std::uint64_t id;			// id of the engine's stream
+		std::uint64_t registration;	// id of the event loop's registration
+
+		// throw the error that was reported by the engine
+		void raise(int error) {
+			if (error == UringEngine::timed_out) {
+				throw this->error("Timeout", 0);
+			}
+			if (error < 0) {
+				throw this->error("Connection closed by peer", 0);
+			}
+			throw this->error("Cannot read", error);
+		}
+
+	protected:
+		template <typename... Args>
+		UringSocket(Args&&... args)
+			: Base{std::forward<Args>(args)...}
+			, engine{UringEngine::get()}
+			, id{0u}
+			, registration{0u} {
+			if (engine != nullptr) {
+				id = engine->attach(this->native_handle());
+			}
+		}
+
+	public:
+		~UringSocket() {
+			if (engine != nullptr) {
+				engine->detach(id);
+			} else {
+				unwatch();
+			}
+		}
+
+		/// Query whether io_uring is used
+		/**
+		 *	@return False if the socket fell back to plain system calls
+		 */
+		inline bool isUsingUring() const {
+			return engine != nullptr;
+		}
+
+		void write(char const * data, std::size_t num_bytes) {
+			iovec segment{const_cast<char*>(data), num_bytes};
+			write(&segment, 1u);
+		}
+
+		void write(iovec const * segments, std::size_t num) {
+			if (engine == nullptr) {
+				Base::write(segments, num);
+				return;
+			}
+			auto error = engine->send(id, segments, num);
+			if (error != 0) {
+				throw this->error("Cannot write", error);
+			}
+		}
+
+		void read_block(char* data, std::size_t num_bytes) {
+			if (engine == nullptr) {
+				Base::read_block(data, num_bytes);
+				return;
+			}
+			while (num_bytes > 0u) {
+				int error;
+				auto received = engine->receive(id, data, num_bytes, true, error, this->getIoTimeout());
+				if (error != 0) {
+					raise(error);
+				}
+				data += received;
+				num_bytes -= received;
+			}
+		}
+
+		std::size_t read_some(char* data, std::size_t num_bytes) {
+			if (engine == nullptr) {
+				return Base::read_some(data, num_bytes);
+			}
+			int error;
+			auto received = engine->receive(id, data, num_bytes, false, error);
+			if (error != 0) {
+				raise(error);
+			}
+			return received;
+		}
+
+		/// Call the given handler whenever data was received
+		/**
+		 *	@param handler Function to call, which reads the data
+		 */
+		void watch(std::function<void()> handler) {
+			if (engine != nullptr) {
+				engine->watch(id, std::move(handler));
+			} else {
+				registration = EventLoop::get().add(this->native_handle(), std::move(handler));
+			}
+		}
+
+		/// Stop calling the handler
+		void unwatch() {
+			if (engine != nullptr) {
+				engine->unwatch(id);
+			} else if (registration != 0u) {
+				EventLoop::get().remove(registration);
+				registration = 0u;
+			}
+		}
+};
+
+} // ::priv
+
+/// Socket wrapper using a TCP socket driven by io_uring
+/**
+ *	Sends and receives of all sockets are submitted and completed in
+ *	batches by a single I/O thread, which saves system calls if many
+ *	connections are in use. Falls back to plain system calls if io_uring is not available.
+ *	The options are those of `PosixTcpSocket`, except for non-blocking mode,
+ *	which is not needed.
+ */
+class UringTcpSocket: public priv::UringSocket<PosixTcpSocket> {
+	public:
+		UringTcpSocket(std::string const & host, std::uint16_t port)
+			: UringSocket{host, port} {
+		}
+
+		UringTcpSocket(std::string const & host, std::uint16_t port, SocketOptions const & options)
+			: UringSocket{host, port, options} {
+		}
+};
+
+/// Socket wrapper using a unix domain socket driven by io_uring
+class UringUnixSocket: public priv::UringSocket<PosixUnixSocket> {
+	public:
+		UringUnixSocket(std::string const & filename)
+			: UringSocket{filename} {
+		}
+
+		UringUnixSocket(std::string const & filename, SocketOptions const & options)
+			: UringSocket{filename, options} {
+		}
+};
+
+} // ::redisxx
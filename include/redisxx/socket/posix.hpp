@@ -0,0 +1,383 @@
+/** @file posix.hpp
+ *
+ * RedisXX Socket wrappers using plain POSIX sockets
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <redisxx/error.hpp>
+#include <redisxx/segments.hpp>
+
+#if !defined(MSG_NOSIGNAL)
+// e.g. macOS: SIGPIPE is disabled per socket using SO_NOSIGPIPE instead
+#define MSG_NOSIGNAL 0
+#endif
+
+#define REDISXX_POSIX_SOCKET 1
+
+namespace redisxx {
+
+/// Options of a POSIX socket
+/**
+ *	The default options are used by all sockets that are created by a
+ *	connection (see `PosixTcpSocket::defaults()`). Buffer sizes of zero keep
+ *	the system's defaults. A negative timeout waits forever.
+ *	In non-blocking mode, `read_some()` returns immediately if no data is
+ *	available, which fits the event loop best. Blocking operations (e.g.
+ *	`read_block()` or a write to a full send buffer) wait for readiness using
+ *	poll(), so they also obey the I/O timeout. In blocking mode, the I/O
+ *	timeout is applied using SO_RCVTIMEO and SO_SNDTIMEO instead.
+ */
+struct SocketOptions {
+	bool no_delay;							// disable Nagle's algorithm (TCP only)
+	bool keep_alive;						// detect dead peers (TCP only)
+	bool non_blocking;						// use non-blocking mode
+	int send_buffer_size;					// SO_SNDBUF in bytes
+	int receive_buffer_size;				// SO_RCVBUF in bytes
+	std::chrono::milliseconds connect_timeout;
+	std::chrono::milliseconds io_timeout;
+
+	explicit SocketOptions(bool no_delay=true, bool keep_alive=true, bool non_blocking=false,
+		int send_buffer_size=0, int receive_buffer_size=0,
+		std::chrono::milliseconds connect_timeout=std::chrono::milliseconds{-1},
+		std::chrono::milliseconds io_timeout=std::chrono::milliseconds{-1})
+		: no_delay{no_delay}
+		, keep_alive{keep_alive}
+		, non_blocking{non_blocking}
+		, send_buffer_size{send_buffer_size}
+		, receive_buffer_size{receive_buffer_size}
+		, connect_timeout{connect_timeout}
+		, io_timeout{io_timeout} {
+	}
+};
+
+namespace priv {
+
+/// Connected POSIX stream socket
+/**
+ *	Implements the socket API using recv(), sendmsg() and poll(). Signals
+ *	(EINTR) are retried. Writing to a closed connection does not raise
+ *	SIGPIPE but throws a ConnectionError.
+ */
+class PosixSocket {
+	private:
+		int fd;
+		std::string const host;		// host name or filename
+		std::uint16_t const port;	// zero for unix domain sockets
+		SocketOptions const options;
+
+	protected:
+		PosixSocket(std::string const & host, std::uint16_t port, SocketOptions const & options)
+			: fd{-1}
+			, host{host}
+			, port{port}
+			, options{options} {
+		}
+
+		// create an error referring to this socket
+		ConnectionError error(std::string const & msg, int code) const {
+			auto what = (code != 0) ? msg + ": " + std::strerror(code) : msg;
+			if (port == 0u) {
+				return ConnectionError{what, host};
+			}
+			return ConnectionError{what, host, port};
+		}
+
+		// timeout of reads and writes (negative waits forever)
+		inline std::chrono::milliseconds getIoTimeout() const {
+			return options.io_timeout;
+		}
+
+		// wait until the socket is ready for the given events
+		void wait(short events, std::chrono::milliseconds timeout) {
+			pollfd entry{fd, events, 0};
+			while (true) {
+				auto ret = ::poll(&entry, 1u, static_cast<int>(timeout.count() < 0 ? -1 : timeout.count()));
+				if (ret > 0) {
+					return;
+				}
+				if (ret == 0) {
+					throw error("Timeout", 0);
+				}
+				if (errno != EINTR) {
+					throw error("Cannot poll", errno);
+				}
+			}
+		}
+
+		// set an integer option
+		void setOption(int level, int name, int value) {
+			if (::setsockopt(fd, level, name, &value, sizeof(value)) != 0) {
+				throw error("Cannot set socket option", errno);
+			}
+		}
+
+		// set a timeout option (a zero timeval would wait forever)
+		void setTimeout(int name, std::chrono::milliseconds timeout) {
+			auto usec = std::max<std::chrono::microseconds::rep>(
+				std::chrono::duration_cast<std::chrono::microseconds>(timeout).count(), 1);
+			timeval value;
+			value.tv_sec = static_cast<decltype(value.tv_sec)>(usec / 1000000);
+			value.tv_usec = static_cast<decltype(value.tv_usec)>(usec % 1000000);
+			if (::setsockopt(fd, SOL_SOCKET, name, &value, sizeof(value)) != 0) {
+				throw error("Cannot set socket option", errno);
+			}
+		}
+
+		// create a socket and connect it to the given address
+		bool open(sockaddr const * address, socklen_t length, int& code) {
+			fd = ::socket(address->sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (fd < 0) {
+				code = errno;
+				return false;
+			}
+#if defined(SO_NOSIGPIPE)
+			setOption(SOL_SOCKET, SO_NOSIGPIPE, 1);
+#endif
+			if (options.send_buffer_size > 0) {
+				setOption(SOL_SOCKET, SO_SNDBUF, options.send_buffer_size);
+			}
+			if (options.receive_buffer_size > 0) {
+				setOption(SOL_SOCKET, SO_RCVBUF, options.receive_buffer_size);
+			}
+			if (address->sa_family != AF_UNIX) {
+				setOption(IPPROTO_TCP, TCP_NODELAY, options.no_delay ? 1 : 0);
+				setOption(SOL_SOCKET, SO_KEEPALIVE, options.keep_alive ? 1 : 0);
+			}
+			// connect in non-blocking mode, so the timeout can be obeyed
+			auto flags = ::fcntl(fd, F_GETFL, 0);
+			::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+			code = 0;
+			if (::connect(fd, address, length) != 0) {
+				if (errno != EINPROGRESS && errno != EINTR) {
+					code = errno;
+				} else {
+					try {
+						wait(POLLOUT, options.connect_timeout);
+					} catch (ConnectionError const &) {
+						code = ETIMEDOUT;
+					}
+					socklen_t size = sizeof(code);
+					if (code == 0 && ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &code, &size) != 0) {
+						code = errno;
+					}
+				}
+			}
+			if (code != 0) {
+				close();
+				return false;
+			}
+			if (!options.non_blocking) {
+				::fcntl(fd, F_SETFL, flags);
+				// poll() is not used in blocking mode, so the kernel obeys the timeout
+				if (options.io_timeout.count() >= 0) {
+					setTimeout(SO_RCVTIMEO, options.io_timeout);
+					setTimeout(SO_SNDTIMEO, options.io_timeout);
+				}
+			}
+			return true;
+		}
+
+		void close() {
+			if (fd >= 0) {
+				::close(fd);
+				fd = -1;
+			}
+		}
+
+	public:
+		PosixSocket(PosixSocket const &) = delete;
+		PosixSocket& operator=(PosixSocket const &) = delete;
+
+		~PosixSocket() {
+			close();
+		}
+
+		void write(char const * data, std::size_t num_bytes) {
+			iovec segment{const_cast<char*>(data), num_bytes};
+			write(&segment, 1u);
+		}
+
+		// sends all segments, using a single sendmsg() if possible
+		void write(iovec const * segments, std::size_t num) {
+			// skip written segments (the caller's array is not modified)
+			IoVector pending{segments, num, std::allocator<iovec>{}};
+			auto first = pending.data();
+			auto left = num;
+			while (left > 0u) {
+				msghdr message;
+				std::memset(&message, 0, sizeof(message));
+				message.msg_iov = first;
+				message.msg_iovlen = std::min<std::size_t>(left, IOV_MAX);
+				auto sent = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+				if (sent < 0) {
+					if (errno == EAGAIN || errno == EWOULDBLOCK) {
+						if (!options.non_blocking) {
+							// SO_SNDTIMEO expired
+							throw error("Timeout", 0);
+						}
+						wait(POLLOUT, options.io_timeout);
+					} else if (errno != EINTR) {
+						throw error("Cannot write", errno);
+					}
+					continue;
+				}
+				auto num_bytes = static_cast<std::size_t>(sent);
+				while (left > 0u && num_bytes >= first->iov_len) {
+					num_bytes -= first->iov_len;
+					++first;
+					--left;
+				}
+				if (left > 0u) {
+					first->iov_base = static_cast<char*>(first->iov_base) + num_bytes;
+					first->iov_len -= num_bytes;
+				}
+			}
+		}
+
+		void read_block(char* data, std::size_t num_bytes) {
+			while (num_bytes > 0u) {
+				auto received = read_some(data, num_bytes);
+				if (received == 0u) {
+					wait(POLLIN, options.io_timeout);
+				}
+				data += received;
+				num_bytes -= received;
+			}
+		}
+
+		std::size_t read_some(char* data, std::size_t num_bytes) {
+			while (true) {
+				auto received = ::recv(fd, data, num_bytes, 0);
+				if (received > 0) {
+					return static_cast<std::size_t>(received);
+				}
+				if (received == 0) {
+					throw error("Connection closed by peer", 0);
+				}
+				if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					if (!options.non_blocking) {
+						// SO_RCVTIMEO expired
+						throw error("Timeout", 0);
+					}
+					return 0u;
+				}
+				if (errno != EINTR) {
+					throw error("Cannot read", errno);
+				}
+			}
+		}
+
+		// allows the socket to be watched by the event loop
+		int native_handle() {
+			return fd;
+		}
+};
+
+} // ::priv
+
+/// Socket wrapper using a plain POSIX TCP socket
+/**
+ *	No third-party library is required. TCP_NODELAY and SO_KEEPALIVE are
+ *	enabled by default. All host names are resolved using getaddrinfo() and
+ *	each address is tried until a connection is established.
+ */
+class PosixTcpSocket: public priv::PosixSocket {
+	public:
+		/// Return the options used by sockets created by a connection
+		/**
+		 *	Change them before the connection opens its sockets.
+		 */
+		static SocketOptions& defaults() {
+			static SocketOptions options;
+			return options;
+		}
+
+		PosixTcpSocket(std::string const & host, std::uint16_t port)
+			: PosixTcpSocket{host, port, defaults()} {
+		}
+
+		PosixTcpSocket(std::string const & host, std::uint16_t port, SocketOptions const & options)
+			: priv::PosixSocket{host, port, options} {
+			addrinfo hints;
+			std::memset(&hints, 0, sizeof(hints));
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			addrinfo* result = nullptr;
+			auto ret = ::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result);
+			if (ret != 0) {
+				throw ConnectionError{std::string{"Cannot resolve host: "} + ::gai_strerror(ret), host, port};
+			}
+			int code = 0;
+			bool connected = false;
+			for (auto ptr = result; ptr != nullptr && !connected; ptr = ptr->ai_next) {
+				try {
+					connected = open(ptr->ai_addr, ptr->ai_addrlen, code);
+				} catch (...) {
+					::freeaddrinfo(result);
+					throw;
+				}
+			}
+			::freeaddrinfo(result);
+			if (!connected) {
+				throw error("Cannot connect", code);
+			}
+		}
+};
+
+/// Socket wrapper using a plain POSIX unix domain socket
+class PosixUnixSocket: public priv::PosixSocket {
+	public:
+		/// Return the options used by sockets created by a connection
+		/**
+		 *	Change them before the connection opens its sockets. TCP options
+		 *	are ignored.
+		 */
+		static SocketOptions& defaults() {
+			static SocketOptions options;
+			return options;
+		}
+
+		PosixUnixSocket(std::string const & filename)
+			: PosixUnixSocket{filename, defaults()} {
+		}
+
+		PosixUnixSocket(std::string const & filename, SocketOptions const & options)
+			: priv::PosixSocket{filename, 0u, options} {
+			sockaddr_un address;
+			std::memset(&address, 0, sizeof(address));
+			if (filename.size() >= sizeof(address.sun_path)) {
+				throw ConnectionError{"Filename is too long", filename};
+			}
+			address.sun_family = AF_UNIX;
+			std::memcpy(address.sun_path, filename.c_str(), filename.size() + 1u);
+			int code = 0;
+			if (!open(reinterpret_cast<sockaddr const *>(&address), sizeof(address), code)) {
+				throw error("Cannot connect", code);
+			}
+		}
+};
+
+} // ::redisxx
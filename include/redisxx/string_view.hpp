@@ -0,0 +1,126 @@
+/** @file string_view.hpp
+ *
+ * RedisXX non-owning string reference
+ *
+ * For the full copyright and license information, please view the LICENSE file
+ * that was distributed with this project source code.
+ *
+ */
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+namespace redisxx {
+
+/// Non-owning reference to a sequence of characters
+/**
+ *	A string view refers to characters that are owned by someone else (e.g.
+ *	the receive buffer of a reply). It is only valid as long as its owner is
+ *	alive. Use `std::string{view}` to get an owning copy.
+ *	If compiled as C++17, a view converts from and to `std::string_view`.
+ */
+class StringView {
+	private:
+		char const * ptr;
+		std::size_t length;
+
+	public:
+		using const_iterator = char const *;
+
+		StringView()
+			: ptr{""}
+			, length{0u} {
+		}
+
+		StringView(char const * data, std::size_t size)
+			: ptr{data}
+			, length{size} {
+		}
+
+		StringView(char const * str)
+			: ptr{str}
+			, length{std::strlen(str)} {
+		}
+
+		StringView(std::string const & str)
+			: ptr{str.data()}
+			, length{str.size()} {
+		}
+
+#if __cplusplus >= 201703L
+		StringView(std::string_view str)
+			: ptr{str.data()}
+			, length{str.size()} {
+		}
+#endif
+
+		inline char const * data() const {
+			return ptr;
+		}
+
+		inline std::size_t size() const {
+			return length;
+		}
+
+		inline bool empty() const {
+			return length == 0u;
+		}
+
+		inline char operator[](std::size_t pos) const {
+			return ptr[pos];
+		}
+
+		inline const_iterator begin() const {
+			return ptr;
+		}
+
+		inline const_iterator end() const {
+			return ptr + length;
+		}
+
+		/// Create an owning copy of the referenced characters
+		explicit operator std::string() const {
+			return std::string{ptr, length};
+		}
+
+#if __cplusplus >= 201703L
+		operator std::string_view() const {
+			return std::string_view{ptr, length};
+		}
+#endif
+};
+
+inline bool operator==(StringView const & lhs, StringView const & rhs) {
+	return lhs.size() == rhs.size() && std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+inline bool operator!=(StringView const & lhs, StringView const & rhs) {
+	return !(lhs == rhs);
+}
+
+inline bool operator==(StringView const & lhs, std::string const & rhs) {
+	return lhs == StringView{rhs};
+}
+
+inline bool operator!=(StringView const & lhs, std::string const & rhs) {
+	return !(lhs == StringView{rhs});
+}
+
+inline bool operator==(StringView const & lhs, char const * rhs) {
+	return lhs == StringView{rhs};
+}
+
+inline bool operator!=(StringView const & lhs, char const * rhs) {
+	return !(lhs == StringView{rhs});
+}
+
+inline std::ostream& operator<<(std::ostream& stream, StringView const & view) {
+	return stream.write(view.data(), view.size());
+}
+
+} // ::redisxx
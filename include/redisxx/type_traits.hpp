@@ -7,7 +7,10 @@
  *
  */
 #pragma once
+#include <exception>
+#include <functional>
 #include <type_traits>
+#include <utility>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -16,6 +19,8 @@
 #include <map>
 #include <set>
 
+#include <redisxx/segments.hpp>
+
 namespace redisxx {
 namespace priv {
 
@@ -80,6 +85,61 @@ template <typename T>
 struct is_tcp_socket: std::is_constructible<T, std::string const &, std::uint16_t> {
 };
 
+// ---------------------------------------------------------------------------
+
+// assume T not to provide its native handle
+template <typename T, typename = void>
+struct has_native_handle: std::false_type {
+};
+
+// assume each class with `native_handle()` returning a file descriptor to provide it
+template <typename T>
+struct has_native_handle<T, typename std::enable_if<std::is_convertible<
+	decltype(std::declval<T&>().native_handle()), int>::value>::type>: std::true_type {
+};
+
+// ---------------------------------------------------------------------------
+
+// assume T not to support vectored writes
+template <typename T, typename = void>
+struct has_vectored_write: std::false_type {
+};
+
+// assume each class with `write(iovec const *, std::size_t)` to support them
+template <typename T>
+struct has_vectored_write<T, decltype(static_cast<void>(
+	std::declval<T&>().write(std::declval<iovec const *>(), std::size_t{})))>: std::true_type {
+};
+
+// ---------------------------------------------------------------------------
+
+// assume T not to call a handler on received data by itself
+template <typename T, typename = void>
+struct has_watch: std::false_type {
+};
+
+// assume each class with `watch(std::function<void()>)` and `unwatch()` to do so
+template <typename T>
+struct has_watch<T, decltype(static_cast<void>(
+	std::declval<T&>().watch(std::declval<std::function<void()>>())), static_cast<void>(
+	std::declval<T&>().unwatch()))>: std::true_type {
+};
+
+// ---------------------------------------------------------------------------
+
+// assume T not to support asynchronous reads
+template <typename T, typename = void>
+struct has_async_read: std::false_type {
+};
+
+// assume each class with `async_read_some(char*, std::size_t, handler)` and `cancel()` to do so
+template <typename T>
+struct has_async_read<T, decltype(static_cast<void>(
+	std::declval<T&>().async_read_some(std::declval<char*>(), std::size_t{},
+		std::declval<std::function<void(std::exception_ptr, std::size_t)>>())), static_cast<void>(
+	std::declval<T&>().cancel()))>: std::true_type {
+};
+
 } // ::priv
 } // ::redisxx
 
@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/arena.hpp>
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_arena)
+
+BOOST_AUTO_TEST_CASE(arena_aligns_allocations) {
+	redisxx::Arena arena{64u};
+	auto a = arena.allocate(3u, 1u);
+	auto b = arena.allocate(8u, 8u);
+	BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(b) % 8u, 0u);
+	BOOST_CHECK(static_cast<char*>(b) >= static_cast<char*>(a) + 3);
+	BOOST_CHECK_GE(arena.size(), 11u);
+	// exceeding the chunk continues in a new one
+	auto c = arena.allocate(1000u, 1u);
+	BOOST_CHECK(c != nullptr);
+	BOOST_CHECK_GE(arena.capacity(), 1064u);
+}
+
+BOOST_AUTO_TEST_CASE(arena_reuses_memory_after_reset) {
+	redisxx::Arena arena{16u};
+	for (auto i = 0u; i < 100u; ++i) {
+		arena.allocate(100u, 8u);
+	}
+	auto capacity = arena.capacity();
+	arena.reset();
+	BOOST_CHECK_EQUAL(arena.size(), 0u);
+	BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+	// the chunks were merged, so the same allocations fit into one chunk
+	auto first = static_cast<char*>(arena.allocate(100u, 8u));
+	for (auto i = 1u; i < 100u; ++i) {
+		auto next = static_cast<char*>(arena.allocate(100u, 8u));
+		BOOST_REQUIRE(next == first + i * 104u);
+	}
+	BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+}
+
+BOOST_AUTO_TEST_CASE(arena_allocator_with_containers) {
+	redisxx::Arena arena;
+	redisxx::ArenaAllocator<int> alloc{arena};
+	std::vector<int, redisxx::ArenaAllocator<int>> numbers{alloc};
+	for (auto i = 0; i < 1000; ++i) {
+		numbers.push_back(i);
+	}
+	BOOST_CHECK_EQUAL(numbers[999], 999);
+	BOOST_CHECK_GE(arena.size(), 1000u * sizeof(int));
+	BOOST_CHECK(numbers.get_allocator() == redisxx::ArenaAllocator<char>{arena});
+
+	// without arena, the heap is used
+	std::vector<int, redisxx::ArenaAllocator<int>> heap;
+	heap.assign(100u, 5);
+	BOOST_CHECK(heap.get_allocator().getArena() == nullptr);
+	BOOST_CHECK_EQUAL(heap[99], 5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
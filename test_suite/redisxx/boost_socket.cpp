@@ -0,0 +1,249 @@
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <redisxx/connection.hpp>
+#include <redisxx/multiplexer.hpp>
+#include <redisxx/socket/boost_tcp.hpp>
+#include <redisxx/socket/boost_unix.hpp>
+#include <redisxx/socket/posix.hpp>
+
+#include "loopback.hpp"
+
+// io_service run by a few threads, used by the sockets created meanwhile
+template <typename SocketImpl>
+struct ServicePool {
+	boost::asio::io_service service;
+	std::unique_ptr<boost::asio::io_service::work> work;
+	std::vector<std::thread> threads;
+
+	ServicePool(std::size_t num_threads)
+		: service{}
+		, work{new boost::asio::io_service::work{service}}
+		, threads{} {
+		for (auto i = 0u; i < num_threads; ++i) {
+			threads.emplace_back([this]() {
+				service.run();
+			});
+		}
+		SocketImpl::setService(&service);
+	}
+
+	~ServicePool() {
+		SocketImpl::setService(nullptr);
+		work.reset();
+		for (auto& thread: threads) {
+			thread.join();
+		}
+	}
+};
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_boost_socket)
+
+BOOST_AUTO_TEST_CASE(boost_sockets_read_asynchronously) {
+	BOOST_CHECK(redisxx::priv::has_async_read<redisxx::BoostTcpSocket>::value);
+	BOOST_CHECK(redisxx::priv::has_async_read<redisxx::BoostUnixSocket>::value);
+	BOOST_CHECK(!redisxx::priv::has_async_read<redisxx::PosixTcpSocket>::value);
+	BOOST_CHECK(!redisxx::priv::uses_event_loop<redisxx::BoostTcpSocket>::value);
+	BOOST_CHECK((std::is_same<redisxx::priv::reader_of<redisxx::BoostTcpSocket>, redisxx::priv::AsyncReader>::value));
+}
+
+BOOST_AUTO_TEST_CASE(boost_tcp_async_write_and_read) {
+	ServicePool<redisxx::BoostTcpSocket> pool{2u};
+	Listener listener;
+	redisxx::BoostTcpSocket socket{"127.0.0.1", listener.port};
+	auto peer = listener.accept();
+
+	std::promise<void> written;
+	char const payload[] = "$4\r\nPING\r\n";
+	redisxx::iovec segments[] = {
+		{const_cast<char*>("*1\r\n"), 4u},
+		{const_cast<char*>(payload), std::strlen(payload)}
+	};
+	socket.async_write(segments, 2u, [&](std::exception_ptr error) {
+		BOOST_CHECK(error == nullptr);
+		written.set_value();
+	});
+	written.get_future().get();
+	BOOST_CHECK_EQUAL(receive(peer, 14u), "*1\r\n$4\r\nPING\r\n");
+
+	std::promise<std::string> received;
+	char buffer[16];
+	socket.async_read_some(buffer, 16u, [&](std::exception_ptr error, std::size_t num_bytes) {
+		BOOST_CHECK(error == nullptr);
+		received.set_value(std::string(buffer, num_bytes));
+	});
+	::send(peer, "+PONG\r\n", 7u, 0);
+	BOOST_CHECK_EQUAL(received.get_future().get(), "+PONG\r\n");
+
+	// closed by peer
+	std::promise<std::exception_ptr> failed;
+	socket.async_read_some(buffer, 16u, [&](std::exception_ptr error, std::size_t) {
+		failed.set_value(error);
+	});
+	::close(peer);
+	BOOST_CHECK_THROW(std::rethrow_exception(failed.get_future().get()), redisxx::ConnectionError);
+}
+
+BOOST_AUTO_TEST_CASE(boost_tcp_cancel) {
+	ServicePool<redisxx::BoostTcpSocket> pool{1u};
+	Listener listener;
+	redisxx::BoostTcpSocket socket{"127.0.0.1", listener.port};
+	auto peer = listener.accept();
+	std::promise<std::exception_ptr> cancelled;
+	char buffer[16];
+	socket.async_read_some(buffer, 16u, [&](std::exception_ptr error, std::size_t) {
+		cancelled.set_value(error);
+	});
+	socket.cancel();
+	BOOST_CHECK(cancelled.get_future().get() != nullptr);
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(boost_tcp_connections_on_shared_service) {
+	std::size_t const num_connections = 8u, num_requests = 200u;
+	ServicePool<redisxx::BoostTcpSocket> pool{4u};
+	PingServer server{num_connections};
+	std::vector<std::thread> clients;
+	std::vector<std::size_t> num_pongs(num_connections, 0u);
+	for (auto i = 0u; i < num_connections; ++i) {
+		clients.emplace_back([&, i]() {
+			redisxx::Connection<redisxx::BoostTcpSocket> conn{"127.0.0.1", server.listener.port, {1u}};
+			std::vector<std::future<redisxx::Reply>> replies;
+			for (auto j = 0u; j < num_requests; ++j) {
+				replies.push_back(conn(redisxx::Command{"PING"}));
+			}
+			for (auto& reply: replies) {
+				if (reply.get().getString() == "PONG") {
+					++num_pongs[i];
+				}
+			}
+		});
+	}
+	for (auto& client: clients) {
+		client.join();
+	}
+	for (auto num: num_pongs) {
+		BOOST_CHECK_EQUAL(num, num_requests);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(boost_tcp_cancel_while_reads_are_rearmed) {
+	ServicePool<redisxx::BoostTcpSocket> pool{4u};
+	Listener listener;
+	redisxx::BoostTcpSocket socket{"127.0.0.1", listener.port};
+	auto peer = listener.accept();
+	std::atomic<bool> stopping{false};
+	std::atomic<std::size_t> num_reads{0u};
+	std::promise<std::exception_ptr> cancelled;
+	char buffer[16];
+	// re-armed by the threads running the service, cancelled by this one
+	std::function<void(std::exception_ptr, std::size_t)> on_read;
+	on_read = [&](std::exception_ptr error, std::size_t) {
+		if (error != nullptr || stopping) {
+			cancelled.set_value(error);
+			return;
+		}
+		++num_reads;
+		socket.async_read_some(buffer, 16u, on_read);
+	};
+	socket.async_read_some(buffer, 16u, on_read);
+	for (auto i = 0u; i < 100u; ++i) {
+		::send(peer, "+OK\r\n", 5u, 0);
+	}
+	while (num_reads == 0u) {
+		std::this_thread::yield();
+	}
+	stopping = true;
+	socket.cancel();
+	auto future = cancelled.get_future();
+	BOOST_REQUIRE(future.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(boost_tcp_connection_on_internal_service) {
+	PingServer server{1u};
+	redisxx::Connection<redisxx::BoostTcpSocket> conn{"127.0.0.1", server.listener.port, {1u}};
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"PING"}).get().getString(), "PONG");
+}
+
+BOOST_AUTO_TEST_CASE(boost_tcp_write_exceeding_send_buffer) {
+	ServicePool<redisxx::BoostTcpSocket> pool{1u};
+	Listener listener;
+	std::string data;
+	std::future<std::string> received;
+	{
+		redisxx::BoostTcpSocket socket{"127.0.0.1", listener.port};
+		auto peer = listener.accept();
+		int send_buffer = 0;
+		socklen_t length = sizeof(send_buffer);
+		::getsockopt(socket.native_handle(), SOL_SOCKET, SO_SNDBUF, &send_buffer, &length);
+		data.assign(4u * static_cast<std::size_t>(send_buffer) + (16u << 20), 'x');
+		data.back() = 'y';
+
+		// the peer starts reading once the send buffer is full and stops once the socket is closed
+		received = std::async(std::launch::async, [peer]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds{100});
+			std::string out;
+			char buffer[65536];
+			ssize_t n;
+			while ((n = ::recv(peer, buffer, sizeof(buffer), 0)) > 0) {
+				out.append(buffer, static_cast<std::size_t>(n));
+			}
+			::close(peer);
+			return out;
+		});
+		socket.write(data.data(), data.size());
+	}
+	BOOST_CHECK(received.get() == data);
+}
+
+BOOST_AUTO_TEST_CASE(boost_unix_async_write_and_read) {
+	std::string filename = "/tmp/redisxx_boost_" + std::to_string(::getpid()) + ".sock";
+	::unlink(filename.c_str());
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, filename.c_str());
+	BOOST_REQUIRE_EQUAL(::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+	BOOST_REQUIRE_EQUAL(::listen(fd, 1), 0);
+	{
+		ServicePool<redisxx::BoostUnixSocket> pool{2u};
+		redisxx::BoostUnixSocket socket{filename};
+		auto peer = ::accept(fd, nullptr, nullptr);
+		std::promise<void> written;
+		redisxx::iovec segment{const_cast<char*>("hello"), 5u};
+		socket.async_write(&segment, 1u, [&](std::exception_ptr error) {
+			BOOST_CHECK(error == nullptr);
+			written.set_value();
+		});
+		written.get_future().get();
+		BOOST_CHECK_EQUAL(receive(peer, 5u), "hello");
+
+		std::promise<std::string> received;
+		char buffer[16];
+		socket.async_read_some(buffer, 16u, [&](std::exception_ptr error, std::size_t num_bytes) {
+			BOOST_CHECK(error == nullptr);
+			received.set_value(std::string(buffer, num_bytes));
+		});
+		::send(peer, "world", 5u, 0);
+		BOOST_CHECK_EQUAL(received.get_future().get(), "world");
+		::close(peer);
+	}
+	::close(fd);
+	::unlink(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
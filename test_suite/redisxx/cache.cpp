@@ -0,0 +1,257 @@
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/cache.hpp>
+
+#include "mock_server.hpp"
+
+using MockCachingConnection = redisxx::CachingConnection<MockServerFdSocket>;
+
+// wait up to a second for the given condition
+inline bool eventually(std::function<bool()> condition) {
+	for (auto i = 0u; i < 1000u; ++i) {
+		if (condition()) {
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds{1});
+	}
+	return condition();
+}
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_cache)
+
+BOOST_AUTO_TEST_CASE(cache_read_detection) {
+	redisxx::priv::CacheRead read;
+	BOOST_REQUIRE(redisxx::priv::cache_read_of(redisxx::Command{"get", "foo"}, read));
+	BOOST_CHECK_EQUAL(read.key, "foo");
+	BOOST_CHECK(!read.hash);
+	BOOST_REQUIRE(redisxx::priv::cache_read_of(redisxx::Command{"HGET", "user:1", "name"}, read));
+	BOOST_CHECK_EQUAL(read.key, "user:1");
+	BOOST_CHECK_EQUAL(read.field, "name");
+	BOOST_CHECK(read.hash);
+	BOOST_CHECK(!redisxx::priv::cache_read_of(redisxx::Command{"MGET", "foo", "bar"}, read));
+	BOOST_CHECK(!redisxx::priv::cache_read_of(redisxx::Command{"HGETALL", "user:1"}, read));
+
+	BOOST_CHECK(redisxx::priv::may_modify(redisxx::Command{"SET", "foo", "bar"}));
+	BOOST_CHECK(redisxx::priv::may_modify(redisxx::Command{"hset", "user:1", "name", "max"}));
+	BOOST_CHECK(!redisxx::priv::may_modify(redisxx::Command{"HGETALL", "user:1"}));
+	BOOST_CHECK(!redisxx::priv::may_modify(redisxx::Command{"PING"}));
+}
+
+BOOST_AUTO_TEST_CASE(cache_shard_evicts_least_recently_used) {
+	redisxx::priv::CacheShard shard;
+	auto const epoch = shard.getEpoch();
+	auto const value = redisxx::priv::parse_reply("$5\r\nhello\r\n");
+	auto const size = 2u * redisxx::priv::cache_entry_overhead + 1u + 5u;
+	std::size_t evicted = 0u;
+	for (auto key: {"a", "b", "c"}) {
+		evicted += shard.insert(redisxx::priv::CacheRead{key, "", false}, value, epoch, 3u * size);
+	}
+	BOOST_CHECK_EQUAL(evicted, 0u);
+	BOOST_CHECK_EQUAL(shard.getNumBytes(), 3u * size);
+
+	// "a" was used recently, so "b" is evicted
+	redisxx::Reply found;
+	BOOST_CHECK(shard.find(redisxx::priv::CacheRead{"a", "", false}, found));
+	BOOST_CHECK_EQUAL(found.getString(), "hello");
+	evicted = shard.insert(redisxx::priv::CacheRead{"d", "", false}, value, epoch, 3u * size);
+	BOOST_CHECK_EQUAL(evicted, 1u);
+	BOOST_CHECK(!shard.find(redisxx::priv::CacheRead{"b", "", false}, found));
+	BOOST_CHECK(shard.find(redisxx::priv::CacheRead{"a", "", false}, found));
+	BOOST_CHECK(shard.find(redisxx::priv::CacheRead{"d", "", false}, found));
+	BOOST_CHECK_EQUAL(shard.getNumBytes(), 3u * size);
+}
+
+BOOST_AUTO_TEST_CASE(cache_shard_rejects_racing_replies) {
+	redisxx::priv::CacheShard shard;
+	auto const value = redisxx::priv::parse_reply("$3\r\nold\r\n");
+	redisxx::priv::CacheRead const read{"foo", "", false};
+	auto const epoch = shard.getEpoch();
+	// the key was modified while the reply was in flight
+	BOOST_CHECK(!shard.invalidate("foo"));
+	shard.insert(read, value, epoch, 1024u);
+	redisxx::Reply found;
+	BOOST_CHECK(!shard.find(read, found));
+	shard.insert(read, value, shard.getEpoch(), 1024u);
+	BOOST_CHECK(shard.find(read, found));
+	BOOST_CHECK(shard.invalidate("foo"));
+	BOOST_CHECK(!shard.find(read, found));
+	BOOST_CHECK_EQUAL(shard.getNumBytes(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(cache_serves_hits_without_socket) {
+	MockServerSocket::flush();
+	MockCachingConnection conn{"localhost", 6379};
+	conn(redisxx::Command{"SET", "foo", "bar"}).get();
+	conn(redisxx::Command{"HSET", "user:1", "name", "max"}).get();
+
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "bar");
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"HGET", "user:1", "name"}).get().getString(), "max");
+	BOOST_CHECK(conn(redisxx::Command{"GET", "missing"}).get().isNull());
+	auto const num_writes = MockServerSocket::getNumWrites();
+	for (auto i = 0u; i < 10u; ++i) {
+		BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "bar");
+		BOOST_CHECK_EQUAL(conn(redisxx::Command{"HGET", "user:1", "name"}).get().getString(), "max");
+		BOOST_CHECK(conn(redisxx::Command{"GET", "missing"}).get().isNull());
+	}
+	BOOST_CHECK_EQUAL(MockServerSocket::getNumWrites(), num_writes);
+
+	auto const stats = conn.getStats();
+	BOOST_CHECK_EQUAL(stats.hits, 30u);
+	BOOST_CHECK_EQUAL(stats.misses, 3u);
+	BOOST_CHECK(stats.num_bytes > 0u);
+}
+
+BOOST_AUTO_TEST_CASE(cache_reads_own_writes) {
+	MockServerSocket::flush();
+	MockCachingConnection conn{"localhost", 6379};
+	conn(redisxx::Command{"SET", "foo", "1"}).get();
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "1");
+	conn(redisxx::Command{"INCR", "foo"}).get();
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "2");
+
+	redisxx::CommandList list{redisxx::BatchType::Pipeline};
+	list << redisxx::Command{"SET", "foo", "3"} << redisxx::Command{"GET", "foo"};
+	BOOST_CHECK_EQUAL(conn(list).get()[1].getString(), "3");
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "3");
+}
+
+BOOST_AUTO_TEST_CASE(cache_reads_own_writes_with_concurrent_readers) {
+	MockServerSocket::flush();
+	MockCachingConnection conn{"localhost", 6379};
+	std::size_t const num_readers = 4u, num_rounds = 1000u;
+	std::atomic<bool> done{false};
+	// keep caching the key, their reads might reach the server before a write
+	std::vector<std::thread> readers;
+	for (auto i = 0u; i < num_readers; ++i) {
+		readers.emplace_back([&]() {
+			while (!done) {
+				conn(redisxx::Command{"GET", "foo"}).get();
+			}
+		});
+	}
+	for (auto i = 1u; i <= num_rounds; ++i) {
+		conn(redisxx::Command{"SET", "foo", i}).get();
+		BOOST_REQUIRE_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), std::to_string(i));
+	}
+	done = true;
+	for (auto& reader: readers) {
+		reader.join();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(cache_invalidated_by_other_clients) {
+	MockServerSocket::flush();
+	MockCachingConnection conn{"localhost", 6379};
+	redisxx::Connection<MockServerFdSocket> other{"localhost", 6379};
+	other(redisxx::Command{"SET", "foo", "old"}).get();
+	other(redisxx::Command{"HSET", "user:1", "name", "max"}).get();
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "old");
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"HGET", "user:1", "name"}).get().getString(), "max");
+
+	other(redisxx::Command{"SET", "foo", "new"}).get();
+	other(redisxx::Command{"HSET", "user:1", "name", "moritz"}).get();
+	BOOST_REQUIRE(eventually([&]() { return conn.getStats().invalidations == 2u; }));
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "new");
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"HGET", "user:1", "name"}).get().getString(), "moritz");
+
+	// flushing drops all keys
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "new");
+	other(redisxx::Command{"FLUSHALL"}).get();
+	BOOST_REQUIRE(eventually([&]() { return conn.getStats().num_bytes == 0u; }));
+	BOOST_CHECK(conn(redisxx::Command{"GET", "foo"}).get().isNull());
+}
+
+BOOST_AUTO_TEST_CASE(cache_respects_prefixes) {
+	MockServerSocket::flush();
+	MockCachingConnection conn{"localhost", 6379, redisxx::CachePolicy{1u << 20u, 4u, {"user:"}}};
+	conn(redisxx::Command{"SET", "user:1", "max"}).get();
+	conn(redisxx::Command{"SET", "session:1", "abc"}).get();
+	for (auto i = 0u; i < 3u; ++i) {
+		conn(redisxx::Command{"GET", "user:1"}).get();
+		conn(redisxx::Command{"GET", "session:1"}).get();
+	}
+	auto const stats = conn.getStats();
+	BOOST_CHECK_EQUAL(stats.hits, 2u);
+	BOOST_CHECK_EQUAL(stats.misses, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(cache_bounds_memory) {
+	MockServerSocket::flush();
+	std::size_t const max_bytes = 4096u;
+	MockCachingConnection conn{"localhost", 6379, redisxx::CachePolicy{max_bytes, 2u}};
+	std::string const value(100u, 'x');
+	for (auto i = 0u; i < 100u; ++i) {
+		conn(redisxx::Command{"SET", "key:" + std::to_string(i), value}).get();
+		conn(redisxx::Command{"GET", "key:" + std::to_string(i)}).get();
+	}
+	auto const stats = conn.getStats();
+	BOOST_CHECK(stats.evictions > 50u);
+	BOOST_CHECK(stats.num_bytes <= max_bytes);
+	BOOST_CHECK(stats.num_bytes > max_bytes / 2u);
+}
+
+BOOST_AUTO_TEST_CASE(cache_survives_lost_invalidations) {
+	MockServerSocket::flush();
+	MockCachingConnection conn{"localhost", 6379, redisxx::CachePolicy{1u << 20u, 4u, {},
+		std::chrono::milliseconds{10}}};
+	redisxx::Connection<MockServerFdSocket> other{"localhost", 6379};
+	other(redisxx::Command{"SET", "foo", "old"}).get();
+	conn(redisxx::Command{"GET", "foo"}).get();
+	BOOST_CHECK_EQUAL(conn.getStats().num_bytes > 0u, true);
+
+	// invalidations that are sent meanwhile are lost, so the cache is dropped
+	MockServerSocket::dropSubscribers();
+	BOOST_REQUIRE(eventually([&]() { return conn.getStats().num_bytes == 0u; }));
+	other(redisxx::Command{"SET", "foo", "new"}).get();
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "new");
+
+	// the cache is used again once the socket was reopened
+	BOOST_REQUIRE(eventually([]() { return MockServerSocket::getNumSubscribers() == 1u; }));
+	conn(redisxx::Command{"GET", "foo"}).get();
+	auto const hits = conn.getStats().hits;
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "new");
+	BOOST_CHECK_EQUAL(conn.getStats().hits, hits + 1u);
+}
+
+BOOST_AUTO_TEST_CASE(cache_concurrent_reads_and_writes) {
+	MockServerSocket::flush();
+	MockCachingConnection conn{"localhost", 6379, redisxx::CachePolicy{1u << 20u, 4u}};
+	redisxx::Connection<MockServerFdSocket> other{"localhost", 6379};
+	std::size_t const num_keys = 8u, num_rounds = 50u;
+	for (auto i = 0u; i < num_keys; ++i) {
+		other(redisxx::Command{"SET", "key:" + std::to_string(i), 0}).get();
+	}
+	std::vector<std::thread> readers;
+	for (auto i = 0u; i < 4u; ++i) {
+		readers.emplace_back([&]() {
+			for (auto j = 0u; j < num_rounds * num_keys; ++j) {
+				conn(redisxx::Command{"GET", "key:" + std::to_string(j % num_keys)}).get();
+			}
+		});
+	}
+	for (auto j = 1u; j <= num_rounds; ++j) {
+		for (auto i = 0u; i < num_keys; ++i) {
+			other(redisxx::Command{"SET", "key:" + std::to_string(i), j}).get();
+		}
+	}
+	for (auto& reader: readers) {
+		reader.join();
+	}
+	// all invalidations were received, so each key's latest value is read
+	BOOST_REQUIRE(eventually([&]() {
+		for (auto i = 0u; i < num_keys; ++i) {
+			if (conn(redisxx::Command{"GET", "key:" + std::to_string(i)}).get().getString() != std::to_string(num_rounds)) {
+				return false;
+			}
+		}
+		return true;
+	}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
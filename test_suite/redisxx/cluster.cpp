@@ -0,0 +1,256 @@
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/cluster.hpp>
+
+#include "mock_cluster.hpp"
+
+using MockClusterConnection = redisxx::ClusterConnection<MockClusterSocket>;
+
+// node owning the given key
+inline std::size_t owner_of(std::string const & key) {
+	return MockClusterState::get().owners[redisxx::priv::hash_slot(redisxx::StringView{key})];
+}
+
+// number of threads of this process
+inline std::size_t num_threads() {
+	std::ifstream status{"/proc/self/status"};
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.compare(0u, 8u, "Threads:") == 0) {
+			return std::stoul(line.substr(8u));
+		}
+	}
+	return 0u;
+}
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_cluster)
+
+BOOST_AUTO_TEST_CASE(cluster_parse_redirect) {
+	redisxx::priv::Redirect redirect;
+	BOOST_REQUIRE(redisxx::priv::parse_redirect(redisxx::StringView{"MOVED 3999 127.0.0.1:6381"}, redirect));
+	BOOST_CHECK(!redirect.ask);
+	BOOST_CHECK_EQUAL(redirect.slot, 3999u);
+	BOOST_CHECK_EQUAL(redirect.host, "127.0.0.1");
+	BOOST_CHECK_EQUAL(redirect.port, 6381u);
+	BOOST_REQUIRE(redisxx::priv::parse_redirect(redisxx::StringView{"ASK 12 ::1:7000"}, redirect));
+	BOOST_CHECK(redirect.ask);
+	BOOST_CHECK_EQUAL(redirect.host, "::1");
+	BOOST_REQUIRE(redisxx::priv::parse_redirect(redisxx::StringView{"MOVED 1 :7001"}, redirect));
+	BOOST_CHECK(redirect.host.empty());
+	BOOST_CHECK_EQUAL(redirect.port, 7001u);
+	BOOST_CHECK(!redisxx::priv::parse_redirect(redisxx::StringView{"ERR wrong"}, redirect));
+	BOOST_CHECK(!redisxx::priv::parse_redirect(redisxx::StringView{"MOVED 16384 127.0.0.1:7000"}, redirect));
+	BOOST_CHECK(!redisxx::priv::parse_redirect(redisxx::StringView{"MOVED 1 127.0.0.1"}, redirect));
+}
+
+BOOST_AUTO_TEST_CASE(cluster_loads_slot_map) {
+	MockClusterState::reset(3u);
+	MockClusterConnection conn{"127.0.0.1", MockClusterState::port(1u)};
+	BOOST_CHECK_EQUAL(conn.getNumNodes(), 3u);
+	BOOST_CHECK_THROW(MockClusterConnection("127.0.0.1", 6379u), redisxx::ConnectionError);
+}
+
+BOOST_AUTO_TEST_CASE(cluster_routes_commands_by_slot) {
+	MockClusterState::reset(3u);
+	MockClusterConnection conn{"127.0.0.1", MockClusterState::port(0u)};
+	std::vector<std::future<redisxx::Reply>> replies;
+	for (auto i = 0u; i < 30u; ++i) {
+		replies.push_back(conn(redisxx::Command{"SET", "key:" + std::to_string(i), i}));
+	}
+	for (auto& reply: replies) {
+		BOOST_CHECK_EQUAL(reply.get().getString(), "OK");
+	}
+	for (auto i = 0u; i < 30u; ++i) {
+		auto const key = "key:" + std::to_string(i);
+		BOOST_CHECK_EQUAL(MockClusterState::value(owner_of(key), key), std::to_string(i));
+		BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", key}).get().getString(), std::to_string(i));
+	}
+	for (auto num: MockClusterState::get().num_writes) {
+		BOOST_CHECK(num > 0u);
+	}
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_moved, 0u);
+	// keys sharing a hash tag are stored together
+	conn(redisxx::Command{"SET", "{user:42}.name", "max"}).get();
+	conn(redisxx::Command{"SET", "{user:42}.mail", "max@example.com"}).get();
+	BOOST_CHECK_EQUAL(MockClusterState::value(owner_of("user:42"), "{user:42}.mail"), "max@example.com");
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"PING"}).get().getString(), "PONG");
+}
+
+BOOST_AUTO_TEST_CASE(cluster_follows_moved) {
+	MockClusterState::reset(3u);
+	MockClusterConnection conn{"127.0.0.1", MockClusterState::port(0u)};
+	conn(redisxx::Command{"SET", "foo", "bar"}).get();
+	auto const target = (owner_of("foo") + 1u) % 3u;
+	MockClusterState::move("foo", target);
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "bar");
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_moved, 1u);
+	// the slot was assigned to its new owner
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "bar");
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_moved, 1u);
+	conn.refresh();
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"INCR", "counter"}).get().getInteger(), 1);
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_moved, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(cluster_connects_without_blocking_the_reader) {
+	MockClusterState::reset(2u);
+	auto const source = owner_of("foo");
+	auto const target = (source + 1u) % 2u;
+	std::string other{"other"};
+	while (owner_of(other) != source) {
+		other += '+';
+	}
+	MockClusterConnection conn{"127.0.0.1", MockClusterState::port(source)};
+	conn(redisxx::Command{"SET", "foo", "bar"}).get();
+	conn(redisxx::Command{"SET", other, "baz"}).get();
+	// the target was not connected yet, and connecting to it takes a while
+	MockClusterState::move("foo", target);
+	MockClusterState::block(target);
+	auto redirected = conn(redisxx::Command{"GET", "foo"});
+	auto next = conn(redisxx::Command{"GET", other});
+	// the reply to the next request is passed on while the redirected one is waiting
+	BOOST_REQUIRE(next.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	BOOST_CHECK_EQUAL(next.get().getString(), "baz");
+	BOOST_CHECK(redirected.wait_for(std::chrono::milliseconds{0}) != std::future_status::ready);
+	MockClusterState::unblock();
+	BOOST_CHECK_EQUAL(redirected.get().getString(), "bar");
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_moved, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(cluster_connects_once_per_node) {
+	MockClusterState::reset(2u);
+	std::size_t const num_keys = 20u;
+	auto const source = owner_of("key:0");
+	auto const target = (source + 1u) % 2u;
+	std::vector<std::string> keys;
+	for (auto i = 0u; keys.size() < num_keys + 1u; ++i) {
+		auto key = "key:" + std::to_string(i);
+		if (owner_of(key) == source) {
+			keys.push_back(key);
+		}
+	}
+	// the last key stays on the source
+	auto const other = keys.back();
+	keys.pop_back();
+	MockClusterConnection conn{"127.0.0.1", MockClusterState::port(source)};
+	for (auto const & key: keys) {
+		conn(redisxx::Command{"SET", key, key}).get();
+	}
+	// each request is redirected to the target, which cannot be connected to yet
+	auto const before = num_threads();
+	MockClusterState::block(target);
+	for (auto const & key: keys) {
+		MockClusterState::move(key, target);
+	}
+	std::vector<std::future<redisxx::Reply>> replies;
+	for (auto const & key: keys) {
+		replies.push_back(conn(redisxx::Command{"GET", key}));
+	}
+	// the redirects were handled once the reply to the next request arrived
+	BOOST_CHECK(conn(redisxx::Command{"GET", other}).get().isNull());
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_moved, num_keys);
+	// a single thread waits for the connection
+	BOOST_CHECK_LE(num_threads(), before + 1u);
+	MockClusterState::unblock();
+	for (std::size_t i = 0u; i < num_keys; ++i) {
+		BOOST_CHECK_EQUAL(replies[i].get().getString(), keys[i]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(cluster_follows_ask) {
+	MockClusterState::reset(3u);
+	MockClusterConnection conn{"127.0.0.1", MockClusterState::port(0u)};
+	conn(redisxx::Command{"SET", "foo", "bar"}).get();
+	auto const source = owner_of("foo");
+	auto const target = (source + 1u) % 3u;
+	MockClusterState::migrate("foo", target);
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "bar");
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_ask, 1u);
+	// the slot still belongs to the source, so the next request is asked again
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", "foo"}).get().getString(), "bar");
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_ask, 2u);
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_moved, 0u);
+	BOOST_CHECK_EQUAL(owner_of("foo"), source);
+}
+
+BOOST_AUTO_TEST_CASE(cluster_splits_pipelines) {
+	MockClusterState::reset(3u);
+	MockClusterConnection conn{"127.0.0.1", MockClusterState::port(2u)};
+	auto& writes = MockClusterState::get().num_writes;
+	writes.assign(3u, 0u);
+	redisxx::CommandList list{redisxx::BatchType::Pipeline};
+	for (auto i = 0u; i < 20u; ++i) {
+		list << redisxx::Command{"INCR", "counter:" + std::to_string(i % 10u)};
+	}
+	auto reply = conn(list).get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 20u);
+	for (auto i = 0u; i < 20u; ++i) {
+		BOOST_CHECK_EQUAL(reply[i].getInteger(), (i < 10u) ? 1 : 2);
+	}
+	// one pipeline per node
+	for (auto num: writes) {
+		BOOST_CHECK_EQUAL(num, 1u);
+	}
+
+	// redirected commands are resent on their own
+	MockClusterState::move("counter:3", (owner_of("counter:3") + 1u) % 3u);
+	reply = conn(list).get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 20u);
+	for (auto i = 0u; i < 20u; ++i) {
+		BOOST_CHECK_EQUAL(reply[i].getInteger(), (i < 10u) ? 3 : 4);
+	}
+	BOOST_CHECK_EQUAL(MockClusterState::get().num_moved, 2u);
+
+	// a pipeline to a single node is not split
+	redisxx::CommandList tagged{redisxx::BatchType::Pipeline};
+	tagged << redisxx::Command{"SET", "{t}a", 1} << redisxx::Command{"GET", "{t}a"};
+	reply = conn(tagged).get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK_EQUAL(reply[1].getString(), "1");
+	BOOST_CHECK(conn(redisxx::CommandList{redisxx::BatchType::Pipeline}).get().empty());
+}
+
+BOOST_AUTO_TEST_CASE(cluster_transactions) {
+	MockClusterState::reset(3u);
+	MockClusterConnection conn{"127.0.0.1", MockClusterState::port(0u)};
+	redisxx::CommandList list{redisxx::BatchType::Transaction};
+	list << redisxx::Command{"INCR", "{t}a"} << redisxx::Command{"INCR", "{t}b"} << redisxx::Command{"INCR", "{t}a"};
+	auto reply = conn(list).get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 3u);
+	BOOST_CHECK_EQUAL(reply[2].getInteger(), 2);
+
+	// an aborted transaction is resent to the slot's new owner
+	auto const target = (owner_of("t") + 1u) % 3u;
+	MockClusterState::move("{t}a", target);
+	reply = conn(list).get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 3u);
+	BOOST_CHECK_EQUAL(reply[0].getInteger(), 3);
+	BOOST_CHECK_EQUAL(reply[1].getInteger(), 2);
+	BOOST_CHECK_EQUAL(reply[2].getInteger(), 4);
+	BOOST_CHECK_EQUAL(MockClusterState::value(target, "{t}a"), "4");
+}
+
+BOOST_AUTO_TEST_CASE(cluster_async_with_borrowed_payload) {
+	MockClusterState::reset(2u);
+	MockClusterConnection conn{"127.0.0.1", MockClusterState::port(0u)};
+	MockClusterState::move("foo", (owner_of("foo") + 1u) % 2u);
+	std::promise<std::string> done;
+	{
+		// the payload is gone once the command is redirected
+		std::string value{"borrowed"};
+		conn.async(redisxx::Command{"SET", "foo", redisxx::borrow(value)}, [&](std::exception_ptr error, redisxx::Reply reply) {
+			done.set_value((error == nullptr) ? std::string{reply.getString()} : "error");
+		});
+		value = "changed";
+	}
+	BOOST_CHECK_EQUAL(done.get_future().get(), "OK");
+	BOOST_CHECK_EQUAL(MockClusterState::value(owner_of("foo"), "foo"), "borrowed");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,10 +2,39 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <limits>
+#include <cstdint>
 #include <boost/test/unit_test.hpp>
 
 #include <redisxx/command.hpp>
 
+// allocator counting its allocations
+template <typename T>
+struct CountingAllocator: std::allocator<T> {
+	using value_type = T;
+
+	template <typename U>
+	struct rebind {
+		using other = CountingAllocator<U>;
+	};
+
+	static std::size_t& num_allocations() {
+		static std::size_t num = 0u;
+		return num;
+	}
+
+	CountingAllocator() = default;
+
+	template <typename U>
+	CountingAllocator(CountingAllocator<U> const &) {
+	}
+
+	T* allocate(std::size_t num) {
+		++num_allocations();
+		return std::allocator<T>::allocate(num);
+	}
+};
+
 BOOST_AUTO_TEST_SUITE(redisxx_test_command)
 
 BOOST_AUTO_TEST_CASE(command_string_api) {
@@ -16,6 +45,118 @@ BOOST_AUTO_TEST_CASE(command_string_api) {
 	BOOST_CHECK_EQUAL(*cmd, "*0\r\n");
 }
 
+BOOST_AUTO_TEST_CASE(command_string_types) {
+	char buffer[16] = "GET";
+	char const * key = "foo";
+	std::string value{"bar"};
+	redisxx::StringView view{value};
+	redisxx::Command cmd{buffer, key, view, std::move(value), std::string{"baz"}, nullptr};
+	BOOST_CHECK_EQUAL(*cmd, "*6\r\n$3\r\nGET\r\n$3\r\nfoo\r\n$3\r\nbar\r\n$3\r\nbar\r\n$3\r\nbaz\r\n$-1\r\n");
+
+	// char arrays are not required to be terminated
+	char raw[3] = {'a', 'b', 'c'};
+	cmd.clear();
+	cmd << raw;
+	BOOST_CHECK_EQUAL(*cmd, "*1\r\n$3\r\nabc\r\n");
+#if __cplusplus >= 201703L
+	cmd.clear();
+	cmd << std::string_view{"hello world"}.substr(6u);
+	BOOST_CHECK_EQUAL(*cmd, "*1\r\n$5\r\nworld\r\n");
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(command_integer_types) {
+	redisxx::Command cmd{std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::uint64_t>::max(), 0, true, -7};
+	BOOST_CHECK_EQUAL(*cmd, "*5\r\n$20\r\n-9223372036854775808\r\n$20\r\n18446744073709551615\r\n$1\r\n0\r\n$1\r\n1\r\n$2\r\n-7\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(command_exact_size) {
+	std::map<std::string, std::string> data;
+	for (auto i = 0u; i < 1000u; ++i) {
+		data["field" + std::to_string(i)] = std::string(i % 20u, 'x');
+	}
+	std::string expected;
+	for (auto const & pair: data) {
+		expected += "$" + std::to_string(pair.first.size()) + "\r\n" + pair.first + "\r\n";
+		expected += "$" + std::to_string(pair.second.size()) + "\r\n" + pair.second + "\r\n";
+	}
+	redisxx::priv::SizeSink counter;
+	redisxx::priv::protocolify(counter, data);
+	BOOST_CHECK_EQUAL(counter.num, 2000u);
+	BOOST_CHECK_EQUAL(counter.size, expected.size());
+
+	std::string out;
+	std::size_t num = 0u;
+	std::vector<redisxx::priv::Borrow> borrows;
+	redisxx::priv::dump(out, num, borrows, data);
+	BOOST_CHECK_EQUAL(num, 2000u);
+	BOOST_CHECK(borrows.empty());
+	BOOST_CHECK_EQUAL(out, expected);
+	redisxx::Command cmd{"HMSET", "user:5", data};
+	BOOST_CHECK_EQUAL(*cmd, "*2002\r\n$5\r\nHMSET\r\n$6\r\nuser:5\r\n" + expected);
+}
+
+BOOST_AUTO_TEST_CASE(command_borrowed_payload) {
+	std::string value{"large value"}, key{"foo"};
+	redisxx::Command cmd{"SET", redisxx::borrow(key), redisxx::borrow(value)};
+	cmd << "EX" << 10;
+	std::string expected{"*5\r\n$3\r\nSET\r\n$3\r\nfoo\r\n$11\r\nlarge value\r\n$2\r\nEX\r\n$2\r\n10\r\n"};
+	BOOST_CHECK_EQUAL(*cmd, expected);
+	BOOST_CHECK(cmd == (redisxx::Command{"SET", "foo", "large value", "EX", 10}));
+
+	// the payloads are referenced, not copied
+	redisxx::priv::Segments segments;
+	cmd.gather(segments);
+	BOOST_CHECK_EQUAL(segments.size(), expected.size());
+	BOOST_CHECK_EQUAL(segments.str(), expected);
+	auto gathered = segments.gather();
+	BOOST_REQUIRE_EQUAL(gathered.size(), 6u);
+	BOOST_CHECK(gathered[2].iov_base == key.data());
+	BOOST_CHECK(gathered[4].iov_base == value.data());
+	value[0] = 'L';
+	BOOST_CHECK_EQUAL(segments.str(), "*5\r\n$3\r\nSET\r\n$3\r\nfoo\r\n$11\r\nLarge value\r\n$2\r\nEX\r\n$2\r\n10\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(command_arguments) {
+	std::string value{"large value"};
+	redisxx::Command cmd{"SET", "foo", redisxx::borrow(value), nullptr};
+	cmd << "EX" << 10;
+	BOOST_REQUIRE_EQUAL(cmd.getNumArguments(), 6u);
+	BOOST_CHECK_EQUAL(cmd.getArgument(0u), "SET");
+	BOOST_CHECK_EQUAL(cmd.getArgument(1u), "foo");
+	BOOST_CHECK(cmd.getArgument(2u).data() == value.data());
+	BOOST_CHECK(cmd.getArgument(3u).empty());
+	BOOST_CHECK_EQUAL(cmd.getArgument(4u), "EX");
+	BOOST_CHECK_EQUAL(cmd.getArgument(5u), "10");
+	BOOST_CHECK_THROW(cmd.getArgument(6u), std::out_of_range);
+
+	// owned payloads are copied
+	auto copy = cmd;
+	copy.own();
+	BOOST_CHECK(copy == cmd);
+	BOOST_CHECK(copy.getArgument(2u).data() != value.data());
+	value[0] = 'L';
+	BOOST_CHECK_EQUAL(copy.getArgument(2u), "large value");
+	BOOST_CHECK_EQUAL(copy.getArgument(4u), "EX");
+}
+
+BOOST_AUTO_TEST_CASE(command_short_commands_do_not_allocate) {
+	using CountingCommand = redisxx::BasicCommand<CountingAllocator<char>>;
+	auto& num = CountingAllocator<char>::num_allocations();
+	num = 0u;
+	CountingCommand get{"GET", "user:12345:session"}, expire{"EXPIRE", "user:12345:session", 30};
+	CountingCommand copy{get};
+	BOOST_CHECK_EQUAL(num, 0u);
+	BOOST_CHECK_EQUAL(*expire, "*3\r\n$6\r\nEXPIRE\r\n$18\r\nuser:12345:session\r\n$2\r\n30\r\n");
+
+	// large commands are stored using the allocator
+	CountingCommand set{"SET", "foo", std::string(redisxx::priv::inline_command_size, 'x')};
+	BOOST_CHECK_EQUAL(num, 1u);
+	get << std::string(redisxx::priv::inline_command_size, 'x');
+	BOOST_CHECK_EQUAL(num, 2u);
+	BOOST_CHECK_EQUAL(*get, "*3\r\n$3\r\nGET\r\n$18\r\nuser:12345:session\r\n$64\r\n" + std::string(64u, 'x') + "\r\n");
+}
+
 BOOST_AUTO_TEST_CASE(command_map_api) {
 	std::map<std::string, int> data;
 	data["asdf"] = 12;
@@ -30,10 +171,10 @@ BOOST_AUTO_TEST_CASE(command_map_api) {
 BOOST_AUTO_TEST_CASE(command_sequence_api) {
 	std::vector<float> data{3.14f, 1.414f, -0.234f};
 	redisxx::Command cmd{"sadd", "new", data};
-	BOOST_REQUIRE_EQUAL(*cmd, "*5\r\n$4\r\nsadd\r\n$3\r\nnew\r\n$8\r\n3.140000\r\n$8\r\n1.414000\r\n$9\r\n-0.234000\r\n");
+	BOOST_REQUIRE_EQUAL(*cmd, "*5\r\n$4\r\nsadd\r\n$3\r\nnew\r\n$4\r\n3.14\r\n$5\r\n1.414\r\n$6\r\n-0.234\r\n");
 
 	cmd << 12l << "helloWorld" << 0;
-	BOOST_CHECK_EQUAL(*cmd, "*8\r\n$4\r\nsadd\r\n$3\r\nnew\r\n$8\r\n3.140000\r\n$8\r\n1.414000\r\n$9\r\n-0.234000\r\n$2\r\n12\r\n$10\r\nhelloWorld\r\n$1\r\n0\r\n");
+	BOOST_CHECK_EQUAL(*cmd, "*8\r\n$4\r\nsadd\r\n$3\r\nnew\r\n$4\r\n3.14\r\n$5\r\n1.414\r\n$6\r\n-0.234\r\n$2\r\n12\r\n$10\r\nhelloWorld\r\n$1\r\n0\r\n");
 }
 
 BOOST_AUTO_TEST_CASE(command_set_api) {
@@ -84,18 +225,69 @@ BOOST_AUTO_TEST_CASE(commandlist_pipeline_api) {
 	list << cmd1;
 	BOOST_CHECK_EQUAL(*list, *cmd1);
 	
+	BOOST_CHECK_EQUAL(list.getNumReplies(), 1u);
+	
 	list << cmd2;
-	BOOST_CHECK_EQUAL(*list, "*6\r\n$3\r\nset\r\n$7\r\nfoulish\r\n$5\r\nbarrr\r\n$3\r\nset\r\n$6\r\nlolish\r\n$7\r\nroflish\r\n");
+	BOOST_CHECK_EQUAL(*list, "*3\r\n$3\r\nset\r\n$7\r\nfoulish\r\n$5\r\nbarrr\r\n*3\r\n$3\r\nset\r\n$6\r\nlolish\r\n$7\r\nroflish\r\n");
+	BOOST_CHECK_EQUAL(list.getNumReplies(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(commandlist_gather) {
+	std::string value{"barrr"};
+	redisxx::Command cmd1{"set", "foulish", redisxx::borrow(value)}, cmd2{"get", "lolish"};
+	redisxx::CommandList list{redisxx::BatchType::Transaction};
+	list << cmd1 << cmd2;
+	redisxx::priv::Segments segments;
+	list.gather(segments);
+	BOOST_CHECK_EQUAL(segments.str(), *list);
+	list.setBatchType(redisxx::BatchType::Pipeline);
+	redisxx::priv::Segments pipelined;
+	list.gather(pipelined);
+	BOOST_CHECK_EQUAL(pipelined.str(), *list);
+}
+
+BOOST_AUTO_TEST_CASE(commandlist_arena_api) {
+	redisxx::Arena arena;
+	std::size_t capacity = 0u;
+	for (auto tick = 0u; tick < 3u; ++tick) {
+		{
+			redisxx::ArenaCommandList list{redisxx::BatchType::Pipeline, arena};
+			redisxx::CommandList expected{redisxx::BatchType::Pipeline};
+			for (auto i = 0u; i < 1000u; ++i) {
+				list.emplace_back("SET", "key:" + std::to_string(i), i);
+				expected << redisxx::Command{"SET", "key:" + std::to_string(i), i};
+			}
+			// commands using another allocator are copied into the arena
+			list << redisxx::Command{"PING"};
+			expected << redisxx::Command{"PING"};
+			BOOST_CHECK(list.get_allocator().getArena() == &arena);
+			BOOST_CHECK(list.at(0).get_allocator().getArena() == &arena);
+			BOOST_CHECK(list.at(1000).get_allocator().getArena() == &arena);
+			BOOST_REQUIRE_EQUAL(*list, *expected);
+		}
+		if (tick > 0u) {
+			// the memory of the previous tick is sufficient
+			BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+		}
+		capacity = arena.capacity();
+		arena.reset();
+	}
+
+	redisxx::ArenaCommand cmd{std::allocator_arg, arena, "GET", "foo"};
+	BOOST_CHECK_EQUAL(*cmd, "*2\r\n$3\r\nGET\r\n$3\r\nfoo\r\n");
+	BOOST_CHECK(cmd == (redisxx::ArenaCommand{"GET", "foo"}));
 }
 
 BOOST_AUTO_TEST_CASE(commandlist_transaction_api) {
 	redisxx::Command cmd1{"set", "foulish", "barrr"}, cmd2{"set", "lolish", "roflish"};
 	redisxx::CommandList list{redisxx::BatchType::Transaction};
 	list << cmd1;
-	BOOST_CHECK_EQUAL(*list, "$5\r\nMULTI\r\n$3\r\nset\r\n$7\r\nfoulish\r\n$5\r\nbarrr\r\n$4\r\nEXEC\r\n");
+	BOOST_CHECK_EQUAL(*list, "*1\r\n$5\r\nMULTI\r\n*3\r\n$3\r\nset\r\n$7\r\nfoulish\r\n$5\r\nbarrr\r\n*1\r\n$4\r\nEXEC\r\n");
+	BOOST_CHECK_EQUAL(list.getNumReplies(), 3u);
 	
 	list << cmd2;
-	BOOST_CHECK_EQUAL(*list, "$5\r\nMULTI\r\n$3\r\nset\r\n$7\r\nfoulish\r\n$5\r\nbarrr\r\n$3\r\nset\r\n$6\r\nlolish\r\n$7\r\nroflish\r\n$4\r\nEXEC\r\n");
+	BOOST_CHECK_EQUAL(*list, "*1\r\n$5\r\nMULTI\r\n*3\r\n$3\r\nset\r\n$7\r\nfoulish\r\n$5\r\nbarrr\r\n*3\r\n$3\r\nset\r\n$6\r\nlolish\r\n$7\r\nroflish\r\n*1\r\n$4\r\nEXEC\r\n");
+	BOOST_CHECK_EQUAL(list.getNumReplies(), 4u);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,57 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/commands.hpp>
+
+// the prefix is validated and counted at compile time
+static_assert(redisxx::priv::Prefix{REDISXX_COMMAND_NAME(3, "GET")}.num_bulks == 1u, "GET is one bulk string");
+static_assert(redisxx::priv::Prefix{REDISXX_COMMAND_NAME(6, "CLIENT") REDISXX_COMMAND_NAME(7, "SETNAME")}.num_bulks == 2u,
+	"CLIENT SETNAME are two bulk strings");
+
+// whether GET can be called with the given arguments
+template <typename... Args>
+struct accepts_get {
+	template <typename... T>
+	static std::true_type test(decltype(redisxx::cmd::get(std::declval<T>()...))*);
+	template <typename... T>
+	static std::false_type test(...);
+
+	static bool const value = decltype(test<Args...>(nullptr))::value;
+};
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_commands)
+
+BOOST_AUTO_TEST_CASE(commands_equal_generic_commands) {
+	BOOST_CHECK(redisxx::cmd::ping() == redisxx::Command{"PING"});
+	BOOST_CHECK(redisxx::cmd::get("foo") == (redisxx::Command{"GET", "foo"}));
+	BOOST_CHECK(redisxx::cmd::set("foo", 3.5) == (redisxx::Command{"SET", "foo", 3.5}));
+	BOOST_CHECK(redisxx::cmd::hset("user:5", "name", "max") == (redisxx::Command{"HSET", "user:5", "name", "max"}));
+	BOOST_CHECK(redisxx::cmd::del("a", "b", std::string{"c"}) == (redisxx::Command{"DEL", "a", "b", "c"}));
+	std::vector<int> members{1, 2, 3};
+	BOOST_CHECK(redisxx::cmd::sadd("ids", members) == (redisxx::Command{"SADD", "ids", members}));
+	BOOST_CHECK_EQUAL(*redisxx::cmd::expire("foo", 30), "*3\r\n$6\r\nEXPIRE\r\n$3\r\nfoo\r\n$2\r\n30\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(commands_can_be_extended) {
+	std::string token{"secret"};
+	auto cmd = redisxx::cmd::set("session:5", redisxx::borrow(token));
+	cmd << "EX" << 3600;
+	BOOST_CHECK_EQUAL(*cmd, "*5\r\n$3\r\nSET\r\n$9\r\nsession:5\r\n$6\r\nsecret\r\n$2\r\nEX\r\n$4\r\n3600\r\n");
+
+	redisxx::CommandList list{redisxx::BatchType::Pipeline};
+	list << redisxx::cmd::incr("counter") << cmd;
+	BOOST_CHECK_EQUAL(list.getNumReplies(), 2u);
+	BOOST_CHECK_EQUAL(*list, "*2\r\n$4\r\nINCR\r\n$7\r\ncounter\r\n" + *cmd);
+}
+
+BOOST_AUTO_TEST_CASE(commands_check_arity) {
+	BOOST_CHECK(accepts_get<char const *>::value);
+	BOOST_CHECK(!accepts_get<>::value);
+	BOOST_CHECK(!(accepts_get<char const *, char const *>::value));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
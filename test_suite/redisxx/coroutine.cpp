@@ -0,0 +1,149 @@
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/coroutine.hpp>
+
+#if defined(REDISXX_COROUTINES)
+#include <redisxx/socket/posix.hpp>
+
+#include "loopback.hpp"
+#include "mock_server.hpp"
+
+using MockConnection = redisxx::Connection<MockServerSocket>;
+
+// eagerly started coroutine, whose completion is reported by a future
+// note: a lambda defining a coroutine must outlive it, so it is never a temporary
+struct Task {
+	struct promise_type {
+		std::promise<void> done;
+
+		Task get_return_object() {
+			return Task{done.get_future()};
+		}
+		std::suspend_never initial_suspend() noexcept {
+			return {};
+		}
+		std::suspend_never final_suspend() noexcept {
+			return {};
+		}
+		void return_void() {
+			done.set_value();
+		}
+		void unhandled_exception() {
+			done.set_exception(std::current_exception());
+		}
+	};
+
+	std::future<void> future;
+};
+
+// ----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_coroutine)
+
+BOOST_AUTO_TEST_CASE(coroutine_awaits_commands) {
+	MockServerSocket::flush();
+	MockConnection conn{"localhost", 6379};
+	std::vector<std::string> values;
+	auto coroutine = [&]() -> Task {
+		auto reply = co_await redisxx::await(conn, redisxx::Command{"SET", "foo", "bar"});
+		values.emplace_back(reply.getString());
+		reply = co_await redisxx::await(conn, redisxx::Command{"GET", "foo"});
+		values.emplace_back(reply.getString());
+	};
+	auto task = coroutine();
+	task.future.get();
+	BOOST_REQUIRE_EQUAL(values.size(), 2u);
+	BOOST_CHECK_EQUAL(values[0], "OK");
+	BOOST_CHECK_EQUAL(values[1], "bar");
+}
+
+BOOST_AUTO_TEST_CASE(coroutine_awaits_command_list) {
+	MockServerSocket::flush();
+	MockConnection conn{"localhost", 6379};
+	redisxx::Reply reply;
+	auto coroutine = [&]() -> Task {
+		redisxx::CommandList list{redisxx::BatchType::Transaction};
+		list << redisxx::Command{"INCR", "foo"} << redisxx::Command{"INCR", "foo"};
+		reply = co_await redisxx::await(conn, list);
+	};
+	auto task = coroutine();
+	task.future.get();
+	BOOST_REQUIRE(reply.isArray());
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK_EQUAL(reply[0].getInteger(), 1);
+	BOOST_CHECK_EQUAL(reply[1].getInteger(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(coroutine_awaits_pipelined_commands) {
+	MockServerSocket::flush();
+	MockConnection conn{"localhost", 6379, redisxx::PoolPolicy{},
+		redisxx::PipelinePolicy{16u, std::chrono::microseconds{500}}};
+	std::string value;
+	auto coroutine = [&]() -> Task {
+		auto reply = co_await redisxx::await(conn, redisxx::Command{"ECHO", "hello"});
+		value = std::string{reply.getString()};
+	};
+	auto task = coroutine();
+	task.future.get();
+	BOOST_CHECK_EQUAL(value, "hello");
+}
+
+BOOST_AUTO_TEST_CASE(coroutine_resumed_by_executor) {
+	std::size_t const num_requests = 100u;
+	PingServer server{1u};
+	redisxx::Connection<redisxx::PosixTcpSocket> conn{"127.0.0.1", server.listener.port, {1u}};
+	// resume on a dedicated thread
+	std::atomic<std::size_t> num_resumed{0u};
+	auto executor = [&](std::coroutine_handle<> handle) {
+		++num_resumed;
+		std::thread{[handle]() {
+			handle.resume();
+		}}.detach();
+	};
+	std::size_t num_pongs = 0u;
+	auto coroutine = [&]() -> Task {
+		for (auto i = 0u; i < num_requests; ++i) {
+			auto reply = co_await redisxx::await(conn, redisxx::Command{"PING"}, executor);
+			if (reply.getString() == "PONG") {
+				++num_pongs;
+			}
+		}
+	};
+	auto task = coroutine();
+	task.future.get();
+	BOOST_CHECK_EQUAL(num_pongs, num_requests);
+	// replies received before the coroutine suspended don't need the executor
+	BOOST_CHECK(num_resumed > 0u);
+	BOOST_CHECK(num_resumed <= num_requests);
+}
+
+BOOST_AUTO_TEST_CASE(coroutine_gets_connection_error) {
+	std::uint16_t port;
+	{
+		// the port is unused once the listener is closed
+		Listener listener;
+		port = listener.port;
+	}
+	redisxx::Connection<redisxx::PosixTcpSocket> conn{"127.0.0.1", port};
+	bool suspended = false;
+	auto coroutine = [&]() -> Task {
+		// fails before suspending, so the executor is not used
+		co_await redisxx::await(conn, redisxx::Command{"PING"}, [&](std::coroutine_handle<> handle) {
+			suspended = true;
+			handle.resume();
+		});
+	};
+	auto task = coroutine();
+	BOOST_CHECK_THROW(task.future.get(), redisxx::ConnectionError);
+	BOOST_CHECK(!suspended);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,42 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/event_loop.hpp>
+
+#if defined(REDISXX_EPOLL)
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_event_loop)
+
+BOOST_AUTO_TEST_CASE(event_loop_calls_handler_while_readable) {
+	int fds[2];
+	BOOST_REQUIRE_EQUAL(::pipe(fds), 0);
+	std::atomic<int> num_calls{0};
+	{
+		redisxx::priv::EventLoop loop{2u};
+		auto id = loop.add(fds[0], [&]() {
+			char c;
+			if (::read(fds[0], &c, 1u) == 1) {
+				++num_calls;
+			}
+		});
+		BOOST_REQUIRE_EQUAL(::write(fds[1], "abc", 3u), 3);
+		for (auto i = 0u; i < 1000u && num_calls < 3; ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		}
+		BOOST_CHECK_EQUAL(num_calls, 3);
+
+		// removed handlers are not called anymore
+		loop.remove(id);
+		BOOST_REQUIRE_EQUAL(::write(fds[1], "d", 1u), 1);
+		std::this_thread::sleep_for(std::chrono::milliseconds{20});
+		BOOST_CHECK_EQUAL(num_calls, 3);
+	}
+	::close(fds[0]);
+	::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
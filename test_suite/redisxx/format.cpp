@@ -0,0 +1,191 @@
+#include <string>
+#include <limits>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/format.hpp>
+
+// format an integer using the given function
+template <typename T>
+std::string integer_to_string(T value) {
+	char tmp[redisxx::priv::max_integer_length];
+	return std::string{tmp, redisxx::priv::format_integer(tmp, value)};
+}
+
+// format a floating point number
+template <typename T>
+std::string float_to_string(T value) {
+	char tmp[redisxx::priv::max_float_length];
+	return std::string{tmp, redisxx::priv::format_float(tmp, value)};
+}
+
+// ----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_format)
+
+BOOST_AUTO_TEST_CASE(format_integer_boundaries) {
+	BOOST_CHECK_EQUAL(integer_to_string(0), "0");
+	BOOST_CHECK_EQUAL(integer_to_string(-1), "-1");
+	BOOST_CHECK_EQUAL(integer_to_string(false), "0");
+	std::uint64_t value = 1u;
+	for (auto i = 0u; i < 19u; ++i, value *= 10u) {
+		BOOST_CHECK_EQUAL(integer_to_string(value - 1u), std::to_string(value - 1u));
+		BOOST_CHECK_EQUAL(integer_to_string(value), std::to_string(value));
+		BOOST_CHECK_EQUAL(redisxx::priv::num_digits(value), i + 1u);
+		BOOST_CHECK_EQUAL(redisxx::priv::num_digits(value - 1u), (i == 0u) ? 1u : i);
+	}
+	BOOST_CHECK_EQUAL(redisxx::priv::num_digits(0u), 1u);
+	BOOST_CHECK_EQUAL(redisxx::priv::num_digits(value), 20u);
+	BOOST_CHECK_EQUAL(redisxx::priv::num_digits(value - 1u), 19u);
+	BOOST_CHECK_EQUAL(redisxx::priv::num_digits(std::numeric_limits<std::uint64_t>::max()), 20u);
+	BOOST_CHECK_EQUAL(integer_to_string(std::numeric_limits<std::uint64_t>::max()), "18446744073709551615");
+	BOOST_CHECK_EQUAL(integer_to_string(std::numeric_limits<std::int64_t>::min()), "-9223372036854775808");
+	BOOST_CHECK_EQUAL(integer_to_string(std::numeric_limits<std::int8_t>::min()), "-128");
+}
+
+BOOST_AUTO_TEST_CASE(format_integer_random) {
+	std::mt19937_64 random{42u};
+	for (auto i = 0u; i < 10000u; ++i) {
+		auto value = static_cast<std::int64_t>(random()) >> (i % 64u);
+		BOOST_REQUIRE_EQUAL(integer_to_string(value), std::to_string(value));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(format_float_shortest) {
+	BOOST_CHECK_EQUAL(float_to_string(0.1), "0.1");
+	BOOST_CHECK_EQUAL(float_to_string(3.14f), "3.14");
+	BOOST_CHECK_EQUAL(float_to_string(-0.234), "-0.234");
+	BOOST_CHECK_EQUAL(float_to_string(100.0), "100");
+	BOOST_CHECK_EQUAL(float_to_string(0.30000000000000004), "0.30000000000000004");
+	BOOST_CHECK_EQUAL(float_to_string(std::numeric_limits<double>::infinity()), "inf");
+	BOOST_CHECK_EQUAL(float_to_string(-std::numeric_limits<double>::infinity()), "-inf");
+}
+
+BOOST_AUTO_TEST_CASE(format_float_independent_of_standard) {
+	// the same bytes are written by the C++11 and the C++17 implementation
+	BOOST_CHECK_EQUAL(float_to_string(1e6), "1000000");
+	BOOST_CHECK_EQUAL(float_to_string(1.5e6f), "1500000");
+	BOOST_CHECK_EQUAL(float_to_string(1234567.5), "1234567.5");
+	BOOST_CHECK_EQUAL(float_to_string(1e20), "1e+20");
+	BOOST_CHECK_EQUAL(float_to_string(-2.5e300), "-2.5e+300");
+	BOOST_CHECK_EQUAL(float_to_string(1e-4), "1e-04");
+	BOOST_CHECK_EQUAL(float_to_string(1.5e-4), "0.00015");
+	BOOST_CHECK_EQUAL(float_to_string(5e-5), "5e-05");
+	BOOST_CHECK_EQUAL(float_to_string(1.25e-7f), "1.25e-07");
+	BOOST_CHECK_EQUAL(float_to_string(-0.0), "-0");
+	// Grisu2's digits, even if std::to_chars would write fewer
+	BOOST_CHECK_EQUAL(float_to_string(1e23), "9.999999999999999e+22");
+	BOOST_CHECK_EQUAL(float_to_string(969728693705784320.0), "969728693705784300");
+}
+
+BOOST_AUTO_TEST_CASE(format_float_round_trip) {
+	std::mt19937_64 random{42u};
+	std::uniform_real_distribution<double> mantissa{-1.0, 1.0};
+	std::uniform_int_distribution<int> exponent{-300, 300};
+	for (auto i = 0u; i < 10000u; ++i) {
+		auto value = std::ldexp(mantissa(random), exponent(random));
+		auto str = float_to_string(value);
+		BOOST_REQUIRE_LE(str.size(), redisxx::priv::max_float_length);
+		BOOST_REQUIRE_EQUAL(std::strtod(str.c_str(), nullptr), value);
+	}
+	for (auto value: {std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+		std::numeric_limits<double>::min(), std::numeric_limits<double>::denorm_min()}) {
+		BOOST_CHECK_EQUAL(std::strtod(float_to_string(value).c_str(), nullptr), value);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(format_shortest_round_trip) {
+	std::mt19937_64 random{42u};
+	char tmp[redisxx::priv::max_float_length];
+	for (auto i = 0u; i < 100000u; ++i) {
+		auto bits = random();
+		double value;
+		std::memcpy(&value, &bits, sizeof value);
+		if (!std::isfinite(value) || value == 0.0) {
+			continue;
+		}
+		std::string str{tmp, redisxx::priv::format_shortest(tmp, value)};
+		BOOST_REQUIRE_EQUAL(std::strtod(str.c_str(), nullptr), value);
+		// never longer than 17 significant digits
+		BOOST_REQUIRE_LE(str.size(), 24u);
+	}
+	for (auto i = 0u; i < 100000u; ++i) {
+		auto bits = static_cast<std::uint32_t>(random());
+		float value;
+		std::memcpy(&value, &bits, sizeof value);
+		if (!std::isfinite(value) || value == 0.0f) {
+			continue;
+		}
+		std::string str{tmp, redisxx::priv::format_shortest(tmp, value)};
+		BOOST_REQUIRE_EQUAL(std::strtof(str.c_str(), nullptr), value);
+		BOOST_REQUIRE_LE(str.size(), 15u);
+	}
+	for (auto value: {std::numeric_limits<double>::max(), std::numeric_limits<double>::min(),
+		std::numeric_limits<double>::denorm_min(), 0.1, 1e-4, 5e-324, 1e23}) {
+		// some numbers (e.g. 1e23) get one more digit than needed, but still read back correctly
+		std::string str{tmp, redisxx::priv::format_shortest(tmp, value)};
+		BOOST_CHECK_EQUAL(std::strtod(str.c_str(), nullptr), value);
+	}
+	BOOST_CHECK_EQUAL(std::string(tmp, redisxx::priv::format_shortest(tmp, 0.1)), "0.1");
+	BOOST_CHECK_EQUAL(std::string(tmp, redisxx::priv::format_shortest(tmp, -1.5e-4)), "-0.00015");
+	BOOST_CHECK_EQUAL(std::string(tmp, redisxx::priv::format_shortest(tmp, 1e-4)), "1e-04");
+	BOOST_CHECK_EQUAL(std::string(tmp, redisxx::priv::format_shortest(tmp, 2.5e20)), "2.5e+20");
+	BOOST_CHECK_EQUAL(std::string(tmp, redisxx::priv::format_shortest(tmp, 5e-324)), "5e-324");
+	BOOST_CHECK_EQUAL(std::string(tmp, redisxx::priv::format_shortest(tmp, 123456.75)), "123456.75");
+	BOOST_CHECK_EQUAL(std::string(tmp, redisxx::priv::format_shortest(tmp, 1.25e-7f)), "1.25e-07");
+	BOOST_CHECK_EQUAL(std::string(tmp, redisxx::priv::format_shortest(tmp, 3.4028235e38f)), "3.4028235e+38");
+}
+
+BOOST_AUTO_TEST_CASE(parse_integer_boundaries) {
+	auto parse = [](std::string const & str, std::int64_t& value) {
+		return redisxx::priv::parse_integer(str.data(), str.data() + str.size(), value);
+	};
+	std::int64_t value = 0;
+	BOOST_CHECK(parse("0", value) && value == 0);
+	BOOST_CHECK(parse("-42", value) && value == -42);
+	BOOST_CHECK(parse("9223372036854775807", value) && value == std::numeric_limits<std::int64_t>::max());
+	BOOST_CHECK(parse("-9223372036854775808", value) && value == std::numeric_limits<std::int64_t>::min());
+	BOOST_CHECK(!parse("9223372036854775808", value));
+	BOOST_CHECK(!parse("", value));
+	BOOST_CHECK(!parse("-", value));
+	BOOST_CHECK(!parse("12a", value));
+	BOOST_CHECK(!parse("1.5", value));
+
+	std::uint8_t small = 0u;
+	std::string str{"255"};
+	BOOST_CHECK(redisxx::priv::parse_integer(str.data(), str.data() + str.size(), small) && small == 255u);
+	str = "256";
+	BOOST_CHECK(!redisxx::priv::parse_integer(str.data(), str.data() + str.size(), small));
+	str = "-1";
+	BOOST_CHECK(!redisxx::priv::parse_integer(str.data(), str.data() + str.size(), small));
+}
+
+BOOST_AUTO_TEST_CASE(parse_number_round_trip) {
+	auto parse = [](std::string const & str, double& value) {
+		return redisxx::priv::parse_number(str.data(), str.data() + str.size(), value);
+	};
+	double value = 0.0;
+	BOOST_CHECK(parse("3.14", value) && value == 3.14);
+	BOOST_CHECK(parse("-10", value) && value == -10.0);
+	BOOST_CHECK(parse("1e-5", value) && value == 1e-5);
+	BOOST_CHECK(parse("inf", value) && value == std::numeric_limits<double>::infinity());
+	BOOST_CHECK(parse("-inf", value) && value == -std::numeric_limits<double>::infinity());
+	BOOST_CHECK(!parse("", value));
+	BOOST_CHECK(!parse("1.5x", value));
+	BOOST_CHECK(!parse("abc", value));
+
+	std::mt19937_64 random{42u};
+	std::uniform_real_distribution<double> mantissa{-1.0, 1.0};
+	std::uniform_int_distribution<int> exponent{-300, 300};
+	for (auto i = 0u; i < 1000u; ++i) {
+		auto expected = std::ldexp(mantissa(random), exponent(random));
+		BOOST_REQUIRE(parse(float_to_string(expected), value));
+		BOOST_REQUIRE_EQUAL(value, expected);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
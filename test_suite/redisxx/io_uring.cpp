@@ -0,0 +1,316 @@
+#include <string>
+#include <cstring>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/connection.hpp>
+#include <redisxx/multiplexer.hpp>
+#include <redisxx/socket/io_uring.hpp>
+
+#include "loopback.hpp"
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_io_uring)
+
+BOOST_AUTO_TEST_CASE(uring_socket_watches_itself) {
+	BOOST_CHECK(redisxx::priv::has_watch<redisxx::UringTcpSocket>::value);
+	BOOST_CHECK(!redisxx::priv::has_watch<redisxx::PosixTcpSocket>::value);
+	BOOST_CHECK(!redisxx::priv::uses_event_loop<redisxx::UringTcpSocket>::value);
+	BOOST_CHECK(redisxx::priv::has_vectored_write<redisxx::UringTcpSocket>::value);
+	BOOST_CHECK(redisxx::priv::is_tcp_socket<redisxx::UringTcpSocket>::value);
+	BOOST_CHECK(!redisxx::priv::is_stream_socket<redisxx::UringTcpSocket>::value);
+	BOOST_CHECK(redisxx::priv::is_stream_socket<redisxx::UringUnixSocket>::value);
+}
+
+BOOST_AUTO_TEST_CASE(uring_tcp_writes_and_reads) {
+	Listener listener;
+	redisxx::UringTcpSocket socket{"127.0.0.1", listener.port};
+	if (!socket.isUsingUring()) {
+		BOOST_TEST_MESSAGE("io_uring is not available, testing the fallback");
+	}
+	auto peer = listener.accept();
+	char const payload[] = "$4\r\nPING\r\n";
+	redisxx::iovec segments[] = {
+		{const_cast<char*>("*1\r\n"), 4u},
+		{const_cast<char*>(payload), std::strlen(payload)}
+	};
+	socket.write(segments, 2u);
+	BOOST_CHECK_EQUAL(receive(peer, 14u), "*1\r\n$4\r\nPING\r\n");
+
+	char buffer[16];
+	if (socket.isUsingUring()) {
+		// reads never block
+		BOOST_CHECK_EQUAL(socket.read_some(buffer, 16u), 0u);
+	}
+	::send(peer, "+PONG\r\n+OK\r\n", 12u, 0);
+	socket.read_block(buffer, 7u);
+	BOOST_CHECK_EQUAL(std::string(buffer, 7u), "+PONG\r\n");
+	// the rest was received at once, so it is available right away
+	socket.read_block(buffer, 5u);
+	BOOST_CHECK_EQUAL(std::string(buffer, 5u), "+OK\r\n");
+
+	::close(peer);
+	BOOST_CHECK_THROW(socket.read_block(buffer, 1u), redisxx::ConnectionError);
+}
+
+BOOST_AUTO_TEST_CASE(uring_tcp_io_timeout) {
+	Listener listener;
+	redisxx::SocketOptions options;
+	options.io_timeout = std::chrono::milliseconds{10};
+	redisxx::UringTcpSocket socket{"127.0.0.1", listener.port, options};
+	auto peer = listener.accept();
+	char buffer[4];
+	BOOST_CHECK_THROW(socket.read_block(buffer, 4u), redisxx::ConnectionError);
+	// data that arrives later is still received
+	::send(peer, "+OK\r\n", 5u, 0);
+	socket.read_block(buffer, 4u);
+	BOOST_CHECK_EQUAL(std::string(buffer, 4u), "+OK\r");
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(uring_tcp_writes_large_segments) {
+	Listener listener;
+	redisxx::SocketOptions options;
+	options.send_buffer_size = 4096;
+	redisxx::UringTcpSocket socket{"127.0.0.1", listener.port, options};
+	auto peer = listener.accept();
+	// larger than the send buffer, so sends complete partially
+	std::string huge(1u << 20, 'x');
+	huge.back() = 'y';
+	std::string received;
+	std::thread reader{[&]() {
+		received = receive(peer, 4u + huge.size());
+	}};
+	redisxx::iovec segments[] = {
+		{const_cast<char*>("head"), 4u},
+		{&huge[0], huge.size()}
+	};
+	socket.write(segments, 2u);
+	reader.join();
+	BOOST_CHECK(received == "head" + huge);
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(uring_tcp_writes_without_waiting_for_peer) {
+	Listener listener;
+	redisxx::SocketOptions options;
+	options.send_buffer_size = 4096;
+	redisxx::UringTcpSocket socket{"127.0.0.1", listener.port, options};
+	if (!socket.isUsingUring()) {
+		BOOST_TEST_MESSAGE("io_uring is not available, writes block");
+		return;
+	}
+	auto peer = listener.accept();
+	// the peer does not read yet, so the sends cannot complete
+	std::vector<std::string> lines;
+	std::string expected;
+	for (auto i = 0u; i < 1000u; ++i) {
+		lines.push_back(std::to_string(i) + std::string(1000u, '-') + "\n");
+		expected += lines.back();
+	}
+	std::promise<void> done;
+	std::thread writer{[&]() {
+		for (auto const & line: lines) {
+			socket.write(line.data(), line.size());
+		}
+		done.set_value();
+	}};
+	auto returned = done.get_future().wait_for(std::chrono::seconds{5}) == std::future_status::ready;
+	BOOST_CHECK(returned);
+	if (returned) {
+		// the sends are still in flight after the writing thread exited
+		writer.join();
+	}
+	std::string received;
+	std::thread reader{[&]() {
+		received = receive(peer, expected.size());
+	}};
+	reader.join();
+	if (!returned) {
+		writer.join();
+	}
+	// sent in order, although queued writes were gathered
+	BOOST_CHECK(received == expected);
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(uring_tcp_write_reports_failed_send) {
+	Listener listener;
+	redisxx::UringTcpSocket socket{"127.0.0.1", listener.port};
+	auto peer = listener.accept();
+	::close(peer);
+	// the first sends may succeed, until the peer reset the connection
+	bool failed = false;
+	for (auto i = 0u; i < 100u && !failed; ++i) {
+		try {
+			socket.write("*1\r\n$4\r\nPING\r\n", 14u);
+			std::this_thread::sleep_for(std::chrono::milliseconds{10});
+		} catch (redisxx::ConnectionError const &) {
+			failed = true;
+		}
+	}
+	BOOST_CHECK(failed);
+}
+
+BOOST_AUTO_TEST_CASE(uring_tcp_calls_handler) {
+	Listener listener;
+	redisxx::UringTcpSocket socket{"127.0.0.1", listener.port};
+	auto peer = listener.accept();
+	std::promise<std::string> promise;
+	std::string data;
+	socket.watch([&]() {
+		char buffer[4];
+		try {
+			auto n = socket.read_some(buffer, 4u);
+			data.append(buffer, n);
+			if (data.size() == 10u) {
+				promise.set_value(data);
+			}
+		} catch (redisxx::ConnectionError const &) {
+		}
+	});
+	// more than the handler takes at once
+	::send(peer, "0123456789", 10u, 0);
+	auto future = promise.get_future();
+	BOOST_REQUIRE(future.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	BOOST_CHECK_EQUAL(future.get(), "0123456789");
+	socket.unwatch();
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(uring_engine_overflows_submission_queue) {
+	auto engine = redisxx::priv::UringEngine::get();
+	if (engine == nullptr) {
+		BOOST_TEST_MESSAGE("io_uring is not available");
+		return;
+	}
+	// far more receives than the submission queue holds are armed at once
+	std::size_t const num_streams = 2000u;
+	std::vector<int> peers;
+	std::vector<std::uint64_t> ids;
+	std::mutex mutex;
+	std::size_t num_received = 0u;
+	std::promise<void> promise;
+	for (auto i = 0u; i < num_streams; ++i) {
+		int fds[2];
+		BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+		auto id = engine->attach(fds[0]);
+		::close(fds[0]);
+		peers.push_back(fds[1]);
+		ids.push_back(id);
+	}
+	std::thread watcher{[&]() {
+		for (auto id: ids) {
+			engine->watch(id, [&, id]() {
+				char byte;
+				int error;
+				if (engine->receive(id, &byte, 1u, false, error) == 1u) {
+					std::lock_guard<std::mutex> lock{mutex};
+					if (++num_received == num_streams) {
+						promise.set_value();
+					}
+				}
+			});
+		}
+	}};
+	watcher.join();
+	for (auto peer: peers) {
+		::send(peer, "x", 1u, 0);
+	}
+	auto future = promise.get_future();
+	BOOST_CHECK(future.wait_for(std::chrono::seconds{10}) == std::future_status::ready);
+	for (auto id: ids) {
+		engine->detach(id);
+	}
+	for (auto peer: peers) {
+		::close(peer);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(uring_engine_cancels_operations_on_destruction) {
+	if (redisxx::priv::UringEngine::get() == nullptr) {
+		BOOST_TEST_MESSAGE("io_uring is not available");
+		return;
+	}
+	int fds[2];
+	BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+	auto destroyed = std::async(std::launch::async, [&]() {
+		redisxx::priv::UringEngine engine;
+		auto id = engine.attach(fds[0]);
+		// a receive and a send (to a peer that never reads) are in flight
+		engine.watch(id, []() {});
+		std::string data(1u << 22, 'x');
+		redisxx::iovec segment{const_cast<char*>(data.data()), data.size()};
+		BOOST_CHECK_EQUAL(engine.send(id, &segment, 1u), 0);
+	});
+	BOOST_CHECK(destroyed.wait_for(std::chrono::seconds{10}) == std::future_status::ready);
+	::close(fds[0]);
+	::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(uring_tcp_connections_roundtrip) {
+	std::size_t const num_connections = 8u, num_requests = 200u;
+	PingServer server{num_connections};
+	std::vector<std::thread> clients;
+	std::vector<std::size_t> num_pongs(num_connections, 0u);
+	for (auto i = 0u; i < num_connections; ++i) {
+		clients.emplace_back([&, i]() {
+			redisxx::Connection<redisxx::UringTcpSocket> conn{"127.0.0.1", server.listener.port, {1u}};
+			std::vector<std::future<redisxx::Reply>> replies;
+			for (auto j = 0u; j < num_requests; ++j) {
+				replies.push_back(conn(redisxx::Command{"PING"}));
+			}
+			for (auto& reply: replies) {
+				if (reply.get().getString() == "PONG") {
+					++num_pongs[i];
+				}
+			}
+		});
+	}
+	for (auto& client: clients) {
+		client.join();
+	}
+	for (auto num: num_pongs) {
+		BOOST_CHECK_EQUAL(num, num_requests);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(uring_tcp_handler_submits_request) {
+	PingServer server{1u};
+	std::promise<std::string> promise;
+	{
+		redisxx::Connection<redisxx::UringTcpSocket> conn{"127.0.0.1", server.listener.port, {1u}};
+		// the second request is written by the I/O thread, which must not wait for itself
+		conn.async(redisxx::Command{"PING"}, [&](std::exception_ptr error, redisxx::Reply) {
+			if (error != nullptr) {
+				promise.set_exception(error);
+				return;
+			}
+			conn.async(redisxx::Command{"PING"}, [&](std::exception_ptr error, redisxx::Reply reply) {
+				if (error != nullptr) {
+					promise.set_exception(error);
+				} else {
+					promise.set_value(std::string(reply.getString()));
+				}
+			});
+		});
+		auto future = promise.get_future();
+		BOOST_REQUIRE(future.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+		BOOST_CHECK_EQUAL(future.get(), "PONG");
+	}
+}
+
+BOOST_AUTO_TEST_CASE(uring_tcp_connection_refused) {
+	std::uint16_t port;
+	{
+		// the port is unused once the listener is closed
+		Listener listener;
+		port = listener.port;
+	}
+	BOOST_CHECK_THROW(redisxx::UringTcpSocket("127.0.0.1", port), redisxx::ConnectionError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,92 @@
+#include <string>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/keys.hpp>
+
+using redisxx::StringView;
+using redisxx::priv::hash_slot;
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_keys)
+
+BOOST_AUTO_TEST_CASE(keys_crc16) {
+	BOOST_CHECK_EQUAL(redisxx::priv::crc16("123456789", 9u), 0x31c3u);
+	BOOST_CHECK_EQUAL(redisxx::priv::crc16("", 0u), 0u);
+	// slots used by redis cluster
+	BOOST_CHECK_EQUAL(hash_slot(StringView{"foo"}), 12182u);
+	BOOST_CHECK_EQUAL(hash_slot(StringView{"bar"}), 5061u);
+	BOOST_CHECK_EQUAL(hash_slot(StringView{"hello"}), 866u);
+}
+
+BOOST_AUTO_TEST_CASE(keys_hash_tags) {
+	BOOST_CHECK_EQUAL(hash_slot(StringView{"{user1000}.following"}), hash_slot(StringView{"user1000"}));
+	BOOST_CHECK_EQUAL(hash_slot(StringView{"{user1000}.followers"}), hash_slot(StringView{"user1000"}));
+	BOOST_CHECK_EQUAL(redisxx::priv::hash_tag(StringView{"foo{bar}{zap}"}), "bar");
+	BOOST_CHECK_EQUAL(redisxx::priv::hash_tag(StringView{"foo{{bar}}zap"}), "{bar");
+	// empty or unterminated tags are no tags
+	BOOST_CHECK_EQUAL(redisxx::priv::hash_tag(StringView{"foo{}{bar}"}), "foo{}{bar}");
+	BOOST_CHECK_EQUAL(redisxx::priv::hash_tag(StringView{"foo{bar"}), "foo{bar");
+	BOOST_CHECK_EQUAL(redisxx::priv::hash_tag(StringView{"foo}bar{"}), "foo}bar{");
+}
+
+BOOST_AUTO_TEST_CASE(keys_hash64) {
+	// shards are placed by this hash, so it must not change
+	BOOST_CHECK_EQUAL(redisxx::priv::hash64("", 0u), 0xefd01f60ba992926ull);
+	BOOST_CHECK_EQUAL(redisxx::priv::hash64("user:1", 6u), 0x4ce53ee4648cef41ull);
+	BOOST_CHECK(redisxx::priv::hash64("user:1", 6u) != redisxx::priv::hash64("user:2", 6u));
+}
+
+BOOST_AUTO_TEST_CASE(keys_of_commands) {
+	// the key refers into the command
+	StringView key;
+	redisxx::Command get{"GET", "foo"}, mget{"mget", "a", "b"};
+	BOOST_REQUIRE(redisxx::priv::key_of(get, key));
+	BOOST_CHECK_EQUAL(key, "foo");
+	BOOST_REQUIRE(redisxx::priv::key_of(mget, key));
+	BOOST_CHECK_EQUAL(key, "a");
+	BOOST_CHECK(!redisxx::priv::key_of(redisxx::Command{"PING"}, key));
+	BOOST_CHECK(!redisxx::priv::key_of(redisxx::Command{"echo", "foo"}, key));
+	BOOST_CHECK(!redisxx::priv::key_of(redisxx::Command{"CLUSTER", "SLOTS"}, key));
+
+	// scripts refer to their first key
+	redisxx::Command evalsha{"evalsha", "abc", 2, "k1", "k2", "arg"};
+	BOOST_CHECK(!redisxx::priv::key_of(redisxx::Command{"EVAL", "return 1", 0}, key));
+	BOOST_REQUIRE(redisxx::priv::key_of(evalsha, key));
+	BOOST_CHECK_EQUAL(key, "k1");
+
+	// streams follow STREAMS
+	redisxx::Command xread{"XREAD", "COUNT", 2, "streams", "s1", "0"};
+	BOOST_REQUIRE(redisxx::priv::key_of(xread, key));
+	BOOST_CHECK_EQUAL(key, "s1");
+	BOOST_CHECK(!redisxx::priv::key_of(redisxx::Command{"XREAD", "COUNT", 2}, key));
+
+	// container commands refer to the key following their subcommand
+	BOOST_REQUIRE(redisxx::priv::key_of(redisxx::Command{"OBJECT", "ENCODING", "foo"}, key));
+	BOOST_CHECK_EQUAL(key, "foo");
+	BOOST_REQUIRE(redisxx::priv::key_of(redisxx::Command{"memory", "usage", "foo", "SAMPLES", 5}, key));
+	BOOST_CHECK_EQUAL(key, "foo");
+	BOOST_REQUIRE(redisxx::priv::key_of(redisxx::Command{"XINFO", "STREAM", "s1"}, key));
+	BOOST_CHECK_EQUAL(key, "s1");
+	BOOST_REQUIRE(redisxx::priv::key_of(redisxx::Command{"XGROUP", "CREATE", "s1", "group", "$"}, key));
+	BOOST_CHECK_EQUAL(key, "s1");
+	BOOST_CHECK(!redisxx::priv::key_of(redisxx::Command{"MEMORY", "STATS"}, key));
+	BOOST_CHECK(!redisxx::priv::key_of(redisxx::Command{"XINFO", "HELP"}, key));
+
+	// BITOP refers to its destination key
+	BOOST_REQUIRE(redisxx::priv::key_of(redisxx::Command{"BITOP", "AND", "dest", "src"}, key));
+	BOOST_CHECK_EQUAL(key, "dest");
+
+	// the number of keys (and a timeout) precede the keys
+	for (auto name: {"ZUNION", "ZINTER", "ZDIFF", "ZINTERCARD", "SINTERCARD", "LMPOP", "ZMPOP"}) {
+		BOOST_REQUIRE(redisxx::priv::key_of(redisxx::Command{name, 2, "a", "b"}, key));
+		BOOST_CHECK_EQUAL(key, "a");
+	}
+	BOOST_REQUIRE(redisxx::priv::key_of(redisxx::Command{"lmpop", 2, "a", "b", "LEFT"}, key));
+	BOOST_CHECK_EQUAL(key, "a");
+	BOOST_REQUIRE(redisxx::priv::key_of(redisxx::Command{"BLMPOP", 0, 2, "a", "b", "LEFT"}, key));
+	BOOST_CHECK_EQUAL(key, "a");
+	BOOST_REQUIRE(redisxx::priv::key_of(redisxx::Command{"BZMPOP", "1.5", 1, "z", "MIN"}, key));
+	BOOST_CHECK_EQUAL(key, "z");
+	BOOST_CHECK(!redisxx::priv::key_of(redisxx::Command{"ZINTER", 2}, key));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
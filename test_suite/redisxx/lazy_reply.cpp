@@ -0,0 +1,118 @@
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <limits>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/lazy_reply.hpp>
+
+// wrap an already validated reply
+redisxx::LazyReply make_lazy(std::string const & text) {
+	auto data = std::make_shared<redisxx::priv::ReplyData>();
+	data->buffer = text;
+	return redisxx::LazyReply{data, 0u};
+}
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_lazy_reply)
+
+BOOST_AUTO_TEST_CASE(lazy_reply_scalar_types) {
+	BOOST_CHECK_EQUAL(make_lazy("+OK\r\n").getString(), "OK");
+	BOOST_CHECK(make_lazy("-ERR no\r\n").isError());
+	BOOST_CHECK_EQUAL(make_lazy(":-17\r\n").getInteger(), -17);
+	BOOST_CHECK_EQUAL(make_lazy(":-9223372036854775808\r\n").getInteger(), std::numeric_limits<std::int64_t>::min());
+	BOOST_CHECK_EQUAL(make_lazy(":9223372036854775807\r\n").getInteger(), std::numeric_limits<std::int64_t>::max());
+	BOOST_CHECK_EQUAL(make_lazy("$5\r\nhe\r\no\r\n").getString(), "he\r\no");
+	BOOST_CHECK(make_lazy("$-1\r\n").isNull());
+	BOOST_CHECK(make_lazy("*-1\r\n").isNull());
+	BOOST_CHECK(redisxx::LazyReply{}.isNull());
+	BOOST_CHECK_THROW(make_lazy("+OK\r\n").getInteger(), redisxx::TypeError);
+	BOOST_CHECK_THROW(make_lazy(":1\r\n").getString(), redisxx::TypeError);
+}
+
+BOOST_AUTO_TEST_CASE(lazy_reply_resp3_types) {
+	BOOST_CHECK_EQUAL(make_lazy(",1.5\r\n").getDouble(), 1.5);
+	BOOST_CHECK_EQUAL(make_lazy(",1.5\r\n").getString(), "1.5");
+	BOOST_CHECK_EQUAL(make_lazy(":2\r\n").getDouble(), 2.0);
+	BOOST_CHECK(make_lazy("#t\r\n").getBoolean());
+	BOOST_CHECK(!make_lazy("#f\r\n").getBoolean());
+	BOOST_CHECK(make_lazy("_\r\n").isNull());
+	BOOST_CHECK(make_lazy("(12345678901234567890\r\n").isBigNumber());
+	BOOST_CHECK_EQUAL(make_lazy("=8\r\ntxt:Some\r\n").getString(), "Some");
+	BOOST_CHECK(make_lazy("!2\r\nNO\r\n").isError());
+	BOOST_CHECK_EQUAL(make_lazy("!2\r\nNO\r\n").getString(), "NO");
+	BOOST_CHECK_THROW(make_lazy("%0\r\n").getString(), redisxx::TypeError);
+
+	auto map = make_lazy("%2\r\n+a\r\n~2\r\n#t\r\n,2\r\n=6\r\ntxt:bc\r\n%1\r\n_\r\n:1\r\n");
+	BOOST_REQUIRE(map.isMap());
+	BOOST_REQUIRE_EQUAL(map.size(), 4u);
+	BOOST_CHECK_EQUAL(map[0].getString(), "a");
+	BOOST_CHECK_EQUAL(map[1].size(), 2u);
+	BOOST_CHECK_EQUAL(map[2].getString(), "bc");
+	BOOST_CHECK_EQUAL(map[3][1].getInteger(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(lazy_reply_skips_push_frames) {
+	std::string push{">2\r\n$10\r\ninvalidate\r\n*1\r\n$3\r\nfoo\r\n"};
+	auto reply = make_lazy(push + "*3\r\n" + push + ":1\r\n" + push + push + "+OK\r\n:3\r\n");
+	BOOST_REQUIRE(reply.isArray());
+	BOOST_REQUIRE_EQUAL(reply.size(), 3u);
+	BOOST_CHECK_EQUAL(reply[0].getInteger(), 1);
+	BOOST_CHECK_EQUAL(reply[1].getString(), "OK");
+	BOOST_CHECK_EQUAL(reply[2].getInteger(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(lazy_reply_sequential_access) {
+	auto reply = make_lazy("*5\r\n$3\r\nfoo\r\n*2\r\n:1\r\n*1\r\n$-1\r\n+OK\r\n*0\r\n:42\r\n");
+	BOOST_REQUIRE(reply.isArray());
+	BOOST_REQUIRE_EQUAL(reply.size(), 5u);
+	auto it = reply.begin();
+	BOOST_CHECK_EQUAL((*it).getString(), "foo");
+	auto nested = *++it;
+	BOOST_REQUIRE_EQUAL(nested.size(), 2u);
+	BOOST_CHECK_EQUAL((*nested.begin()).getInteger(), 1);
+	BOOST_CHECK((*++it).isStatus());
+	BOOST_CHECK((*++it).empty());
+	BOOST_CHECK_EQUAL((*++it).getInteger(), 42);
+	BOOST_CHECK(++it == reply.end());
+
+	std::size_t num = 0u;
+	for (auto const & elem: reply) {
+		BOOST_CHECK(!elem.isNull());
+		++num;
+	}
+	BOOST_CHECK_EQUAL(num, 5u);
+}
+
+BOOST_AUTO_TEST_CASE(lazy_reply_iterator_outlives_element) {
+	auto reply = make_lazy("*2\r\n$4\r\nname\r\n*3\r\n:1\r\n:2\r\n:3\r\n");
+	// the iterators are taken from a temporary element
+	auto it = reply.at(1).begin();
+	auto end = reply.at(1).end();
+	BOOST_CHECK_EQUAL((*it).getInteger(), 1);
+	BOOST_CHECK_EQUAL((*++it).getInteger(), 2);
+	BOOST_CHECK_EQUAL((*++it).getInteger(), 3);
+	BOOST_CHECK(++it == end);
+}
+
+BOOST_AUTO_TEST_CASE(lazy_reply_random_access) {
+	std::string text{"*1000\r\n"};
+	for (auto i = 0u; i < 1000u; ++i) {
+		auto value = std::to_string(i);
+		text += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+	}
+	auto reply = make_lazy(text);
+	BOOST_CHECK(!reply.hasIndex());
+	BOOST_CHECK_EQUAL(reply.at(500).getString(), "500");
+	BOOST_CHECK(!reply.hasIndex());
+	reply.buildIndex();
+	BOOST_CHECK(reply.hasIndex());
+	BOOST_CHECK_EQUAL(reply[0].getString(), "0");
+	BOOST_CHECK_EQUAL(reply[999].getString(), "999");
+	BOOST_CHECK_THROW(reply.at(1000), std::out_of_range);
+
+	// index is shared by copies
+	auto copy = reply;
+	BOOST_CHECK(copy.hasIndex());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
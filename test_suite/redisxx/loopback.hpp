@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// listening loopback socket
+struct Listener {
+	int fd;
+	std::uint16_t port;
+
+	Listener()
+		: fd{::socket(AF_INET, SOCK_STREAM, 0)}
+		, port{0u} {
+		sockaddr_in address;
+		std::memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t length = sizeof(address);
+		BOOST_REQUIRE_EQUAL(::bind(fd, reinterpret_cast<sockaddr*>(&address), length), 0);
+		BOOST_REQUIRE_EQUAL(::listen(fd, 64), 0);
+		::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+		port = ntohs(address.sin_port);
+	}
+
+	~Listener() {
+		::close(fd);
+	}
+
+	int accept() {
+		return ::accept(fd, nullptr, nullptr);
+	}
+};
+
+// read exactly num_bytes from a plain file descriptor
+inline std::string receive(int fd, std::size_t num_bytes) {
+	std::string out(num_bytes, '\0');
+	std::size_t pos = 0u;
+	while (pos < num_bytes) {
+		auto n = ::recv(fd, &out[pos], num_bytes - pos, 0);
+		BOOST_REQUIRE(n > 0);
+		pos += static_cast<std::size_t>(n);
+	}
+	return out;
+}
+
+// stand-in server replying +PONG to each PING, one thread per client
+struct PingServer {
+	Listener listener;
+	std::size_t num_clients;
+	std::thread acceptor;
+
+	PingServer(std::size_t num_clients)
+		: listener{}
+		, num_clients{num_clients}
+		, acceptor{[this]() {
+			std::vector<std::thread> clients;
+			for (auto i = 0u; i < this->num_clients; ++i) {
+				auto fd = listener.accept();
+				clients.emplace_back(&PingServer::serve, fd);
+			}
+			for (auto& client: clients) {
+				client.join();
+			}
+		}} {
+	}
+
+	~PingServer() {
+		acceptor.join();
+	}
+
+	// reply until the client disconnects
+	static void serve(int fd) {
+		static std::string const request{"*1\r\n$4\r\nPING\r\n"};
+		std::string pending;
+		char buffer[4096];
+		while (true) {
+			auto n = ::recv(fd, buffer, sizeof(buffer), 0);
+			if (n <= 0) {
+				break;
+			}
+			pending.append(buffer, static_cast<std::size_t>(n));
+			std::string replies;
+			while (pending.compare(0u, request.size(), request) == 0) {
+				pending.erase(0u, request.size());
+				replies += "+PONG\r\n";
+			}
+			if (!replies.empty()) {
+				::send(fd, replies.data(), replies.size(), MSG_NOSIGNAL);
+			}
+		}
+		::close(fd);
+	}
+};
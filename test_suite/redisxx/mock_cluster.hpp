@@ -0,0 +1,261 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <redisxx/error.hpp>
+#include <redisxx/keys.hpp>
+
+#include "mock_socket.hpp"
+
+// state of a stand-in cluster, whose nodes are identified by their ports (a function-local
+// static, so each test may include this header)
+struct MockClusterState {
+	std::mutex mutex;
+	std::vector<std::uint16_t> ports;
+	std::vector<std::size_t> owners;						// node of each slot
+	std::map<std::size_t, std::size_t> importing;			// node each slot is migrated to
+	std::vector<std::map<std::string, std::string>> stores;	// keys of each node
+	std::vector<std::size_t> num_writes;					// of each node
+	std::size_t num_moved, num_ask;							// redirects replied
+	bool clustered;											// else the nodes are independent
+	std::size_t blocked;									// node that cannot be connected to yet
+	std::condition_variable unblocked;
+
+	static MockClusterState& get() {
+		static MockClusterState state;
+		return state;
+	}
+
+	static std::uint16_t port(std::size_t node) {
+		return static_cast<std::uint16_t>(7000u + node);
+	}
+
+	// create nodes owning equal ranges of slots (or independent nodes owning any key)
+	static void reset(std::size_t num_nodes, bool clustered=true) {
+		auto& state = get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		state.ports.clear();
+		for (auto i = 0u; i < num_nodes; ++i) {
+			state.ports.push_back(port(i));
+		}
+		state.owners.resize(redisxx::priv::num_hash_slots);
+		for (auto slot = 0u; slot < state.owners.size(); ++slot) {
+			state.owners[slot] = slot * num_nodes / redisxx::priv::num_hash_slots;
+		}
+		state.importing.clear();
+		state.stores.assign(num_nodes, {});
+		state.num_writes.assign(num_nodes, 0u);
+		state.num_moved = 0u;
+		state.num_ask = 0u;
+		state.clustered = clustered;
+		state.blocked = num_nodes;
+	}
+
+	// connecting to the given node blocks until `unblock()` is called
+	static void block(std::size_t node) {
+		auto& state = get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		state.blocked = node;
+	}
+
+	static void unblock() {
+		auto& state = get();
+		{
+			std::lock_guard<std::mutex> lock{state.mutex};
+			state.blocked = state.ports.size();
+		}
+		state.unblocked.notify_all();
+	}
+
+	// move the keys of the given slot from its owner to the given node (the lock is held)
+	void transfer(std::size_t slot, std::size_t node) {
+		auto& source = stores[owners[slot]];
+		for (auto it = source.begin(); it != source.end(); ) {
+			if (redisxx::priv::hash_slot(redisxx::StringView{it->first}) == slot) {
+				stores[node][it->first] = it->second;
+				it = source.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	// assign the key's slot to the given node, taking its keys with it
+	static void move(std::string const & key, std::size_t node) {
+		auto& state = get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		auto const slot = redisxx::priv::hash_slot(redisxx::StringView{key});
+		state.transfer(slot, node);
+		state.owners[slot] = node;
+	}
+
+	// start migrating the key's slot to the given node, which gets its keys already
+	static void migrate(std::string const & key, std::size_t node) {
+		auto& state = get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		auto const slot = redisxx::priv::hash_slot(redisxx::StringView{key});
+		state.transfer(slot, node);
+		state.importing[slot] = node;
+	}
+
+	static std::string value(std::size_t node, std::string const & key) {
+		auto& state = get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		auto it = state.stores[node].find(key);
+		return (it == state.stores[node].end()) ? std::string{} : it->second;
+	}
+};
+
+// socket talking to a node of the stand-in cluster
+struct MockClusterSocket: MockSocketPair<MockClusterSocket> {
+	std::size_t node;
+	bool asking, multi, aborted;
+	std::vector<std::vector<std::string>> queued;
+
+	MockClusterSocket(std::string const & host, std::uint16_t port)
+		: MockSocketPair{host, port}
+		, node{0u}
+		, asking{false}
+		, multi{false}
+		, aborted{false}
+		, queued{} {
+		auto& state = MockClusterState::get();
+		std::unique_lock<std::mutex> lock{state.mutex};
+		while (node < state.ports.size() && state.ports[node] != port) {
+			++node;
+		}
+		if (host != "127.0.0.1" || node == state.ports.size()) {
+			throw redisxx::ConnectionError{"Connection refused", host, port};
+		}
+		state.unblocked.wait(lock, [&]() {
+			return state.blocked != node;
+		});
+	}
+
+	static std::string address(std::size_t node) {
+		return "127.0.0.1:" + std::to_string(MockClusterState::port(node));
+	}
+
+	// "CLUSTER SLOTS" lists each range of slots owned by the same node
+	std::string slots() {
+		auto const & owners = MockClusterState::get().owners;
+		std::string ranges;
+		std::size_t num = 0u;
+		for (std::size_t first = 0u; first < owners.size(); ++num) {
+			auto last = first;
+			while (last + 1u < owners.size() && owners[last + 1u] == owners[first]) {
+				++last;
+			}
+			ranges += "*3\r\n:" + std::to_string(first) + "\r\n:" + std::to_string(last) + "\r\n"
+				+ "*3\r\n" + bulk("127.0.0.1") + ":" + std::to_string(MockClusterState::port(owners[first]))
+				+ "\r\n" + bulk("node" + std::to_string(owners[first]));
+			first = last + 1u;
+		}
+		return "*" + std::to_string(num) + "\r\n" + ranges;
+	}
+
+	// check whether this node serves the given key
+	std::string redirect(std::string const & key) {
+		auto& state = MockClusterState::get();
+		auto const slot = redisxx::priv::hash_slot(redisxx::StringView{key});
+		auto const importing = state.importing.find(slot);
+		if (state.owners[slot] != node) {
+			if (asking && importing != state.importing.end() && importing->second == node) {
+				return std::string{};
+			}
+			++state.num_moved;
+			return "-MOVED " + std::to_string(slot) + " " + address(state.owners[slot]) + "\r\n";
+		}
+		if (importing != state.importing.end() && state.stores[node].count(key) == 0u) {
+			++state.num_ask;
+			return "-ASK " + std::to_string(slot) + " " + address(importing->second) + "\r\n";
+		}
+		return std::string{};
+	}
+
+	// execute a single command and return its reply
+	std::string execute(std::vector<std::string> const & args) {
+		auto& store = MockClusterState::get().stores[node];
+		auto const & name = args[0];
+		if (name == "SET" && args.size() == 3u) {
+			store[args[1]] = args[2];
+			return "+OK\r\n";
+		} else if (name == "GET" && args.size() == 2u) {
+			auto it = store.find(args[1]);
+			return (it == store.end()) ? "$-1\r\n" : bulk(it->second);
+		} else if (name == "INCR" && args.size() == 2u) {
+			auto value = std::to_string(std::stoll(store[args[1]].empty() ? "0" : store[args[1]]) + 1);
+			store[args[1]] = value;
+			return ":" + value + "\r\n";
+		}
+		return "-ERR unknown command '" + name + "'\r\n";
+	}
+
+	// handle a command with respect to slots and transactions
+	std::string handle(std::vector<std::string> const & args) {
+		std::lock_guard<std::mutex> lock{MockClusterState::get().mutex};
+		auto const & name = args[0];
+		if (name == "PING") {
+			return "+PONG\r\n";
+		} else if (name == "CLUSTER" && args.size() == 2u && args[1] == "SLOTS") {
+			return slots();
+		} else if (name == "ASKING") {
+			asking = true;
+			return "+OK\r\n";
+		} else if (name == "MULTI") {
+			multi = true;
+			return "+OK\r\n";
+		} else if (name == "EXEC") {
+			multi = false;
+			std::string reply;
+			if (aborted) {
+				reply = "-EXECABORT Transaction discarded because of previous errors.\r\n";
+			} else {
+				reply = "*" + std::to_string(queued.size()) + "\r\n";
+				for (auto const & cmd: queued) {
+					reply += execute(cmd);
+				}
+			}
+			queued.clear();
+			aborted = false;
+			return reply;
+		}
+		auto reply = (MockClusterState::get().clustered && args.size() > 1u) ? redirect(args[1]) : std::string{};
+		asking = false;
+		if (!reply.empty()) {
+			aborted = aborted || multi;
+			return reply;
+		}
+		if (multi) {
+			queued.push_back(args);
+			return "+QUEUED\r\n";
+		}
+		return execute(args);
+	}
+
+	bool serve(std::vector<std::string> const & args) {
+		send(fds[1], handle(args));
+		return true;
+	}
+
+	void write(char const * data, std::size_t num_bytes) {
+		{
+			auto& state = MockClusterState::get();
+			std::lock_guard<std::mutex> lock{state.mutex};
+			++state.num_writes[node];
+		}
+		MockSocketPair::write(data, num_bytes);
+	}
+
+	void write(redisxx::iovec const * segments, std::size_t num) {
+		write_segments(segments, num);
+	}
+
+	int native_handle() {
+		return fds[0];
+	}
+};
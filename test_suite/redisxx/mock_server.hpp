@@ -0,0 +1,278 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sys/socket.h>
+
+#include "mock_socket.hpp"
+
+// state shared by all sockets (a function-local static, so each test may include this header)
+struct MockServerState {
+	// client receiving invalidations of the keys starting with any prefix (CLIENT TRACKING BCAST)
+	struct Tracking {
+		std::int64_t redirect;
+		std::vector<std::string> prefixes;
+	};
+
+	std::mutex mutex;
+	std::map<std::string, std::string> store;
+	std::map<std::string, std::map<std::string, std::string>> hashes;
+	std::atomic<std::size_t> num_writes;
+	std::int64_t next_id;						// of the next client
+	std::map<std::int64_t, Tracking> tracking;	// by tracking client
+	std::map<std::int64_t, int> subscribers;	// socket of each client subscribed to invalidations
+	std::map<std::int64_t, int> pushers;		// socket of each client speaking RESP3
+
+	MockServerState()
+		: mutex{}
+		, store{}
+		, hashes{}
+		, num_writes{0u}
+		, next_id{1}
+		, tracking{}
+		, subscribers{}
+		, pushers{} {
+	}
+
+	static MockServerState& get() {
+		static MockServerState state;
+		return state;
+	}
+};
+
+// socket talking to a tiny in-memory redis server
+// note: only a few commands are supported
+struct MockServerSocket: MockSocketPair<MockServerSocket> {
+	std::int64_t id;		// client id
+	bool multi, quit, resp3;
+	std::vector<std::vector<std::string>> queued;
+
+	MockServerSocket(std::string const & host, std::uint16_t port)
+		: MockSocketPair{host, port}
+		, id{0}
+		, multi{false}
+		, quit{false}
+		, resp3{false}
+		, queued{} {
+		auto& state = MockServerState::get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		id = state.next_id++;
+	}
+
+	~MockServerSocket() {
+		auto& state = MockServerState::get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		state.tracking.erase(id);
+		state.subscribers.erase(id);
+		state.pushers.erase(id);
+	}
+
+	static void flush() {
+		auto& state = MockServerState::get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		state.store.clear();
+		state.hashes.clear();
+		state.num_writes = 0u;
+	}
+
+	static std::size_t getNumSubscribers() {
+		auto& state = MockServerState::get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		return state.subscribers.size();
+	}
+
+	// close the connections of all clients subscribed to invalidations
+	static void dropSubscribers() {
+		auto& state = MockServerState::get();
+		std::lock_guard<std::mutex> lock{state.mutex};
+		for (auto const & subscriber: state.subscribers) {
+			::shutdown(subscriber.second, SHUT_WR);
+		}
+		state.subscribers.clear();
+	}
+
+	static std::size_t getNumWrites() {
+		return MockServerState::get().num_writes;
+	}
+
+	// send an invalidation message to each client tracking the given key (or all keys if null)
+	// note: RESP3 clients tracking without redirect get a push frame instead
+	static void invalidate(std::string const * key) {
+		auto& state = MockServerState::get();
+		auto const keys = (key == nullptr) ? std::string{"*-1\r\n"} : "*1\r\n" + bulk(*key);
+		auto const message = "*3\r\n" + bulk("message") + bulk("__redis__:invalidate") + keys;
+		auto const push = ">2\r\n" + bulk("invalidate") + keys;
+		for (auto const & tracking: state.tracking) {
+			auto matches = tracking.second.prefixes.empty();
+			for (auto const & prefix: tracking.second.prefixes) {
+				matches = matches || key == nullptr || key->compare(0u, prefix.size(), prefix) == 0;
+			}
+			auto subscriber = state.subscribers.find(tracking.second.redirect);
+			auto pusher = state.pushers.find(tracking.second.redirect);
+			if (matches && tracking.first == tracking.second.redirect && pusher != state.pushers.end()) {
+				send(pusher->second, push);
+			} else if (matches && subscriber != state.subscribers.end()) {
+				send(subscriber->second, message);
+			}
+		}
+	}
+
+	// handle the commands of the invalidation channel
+	std::string track(std::vector<std::string> const & args) {
+		auto& state = MockServerState::get();
+		auto const & name = args[0];
+		if (name == "CLIENT" && args.size() == 2u && args[1] == "ID") {
+			return ":" + std::to_string(id) + "\r\n";
+		} else if (name == "HELLO" && args.size() == 2u) {
+			if (args[1] != "2" && args[1] != "3") {
+				return "-NOPROTO unsupported protocol version\r\n";
+			}
+			resp3 = (args[1] == "3");
+			if (resp3) {
+				state.pushers[id] = fds[1];
+			} else {
+				state.pushers.erase(id);
+			}
+			return (resp3 ? "%2\r\n" : "*4\r\n") + bulk("server") + bulk("redis") + bulk("proto") + ":" + args[1] + "\r\n";
+		} else if (name == "CLIENT" && args.size() >= 4u && args[1] == "TRACKING" && args[2] == "ON"
+			&& args[3] == "BCAST" && resp3) {
+			// invalidations are pushed to the tracking client itself
+			MockServerState::Tracking tracking{id, {}};
+			for (auto i = 4u; i + 1u < args.size(); i += 2u) {
+				tracking.prefixes.push_back(args[i + 1u]);
+			}
+			state.tracking[id] = tracking;
+			return "+OK\r\n";
+		} else if (name == "CLIENT" && args.size() >= 6u && args[1] == "TRACKING" && args[2] == "ON"
+			&& args[3] == "REDIRECT" && args[5] == "BCAST") {
+			MockServerState::Tracking tracking{std::stoll(args[4]), {}};
+			for (auto i = 6u; i + 1u < args.size(); i += 2u) {
+				tracking.prefixes.push_back(args[i + 1u]);
+			}
+			state.tracking[id] = tracking;
+			return "+OK\r\n";
+		} else if (name == "SUBSCRIBE" && args.size() == 2u) {
+			state.subscribers[id] = fds[1];
+			return "*3\r\n" + bulk("subscribe") + bulk(args[1]) + ":1\r\n";
+		} else if (name == "UNSUBSCRIBE") {
+			state.subscribers.erase(id);
+			return "*3\r\n" + bulk("unsubscribe") + bulk("__redis__:invalidate") + ":0\r\n";
+		}
+		return std::string{};
+	}
+
+	// execute a single command and return its reply
+	std::string execute(std::vector<std::string> const & args) {
+		auto& store = MockServerState::get().store;
+		auto& hashes = MockServerState::get().hashes;
+		auto const & name = args[0];
+		if (name == "PING") {
+			return "+PONG\r\n";
+		} else if (name == "ECHO" && args.size() == 2u) {
+			return bulk(args[1]);
+		} else if (name == "SET" && args.size() == 3u) {
+			store[args[1]] = args[2];
+			invalidate(&args[1]);
+			return "+OK\r\n";
+		} else if (name == "GET" && args.size() == 2u) {
+			auto it = store.find(args[1]);
+			return (it == store.end()) ? "$-1\r\n" : bulk(it->second);
+		} else if (name == "INCR" && args.size() == 2u) {
+			auto value = std::to_string(std::stoll(store[args[1]].empty() ? "0" : store[args[1]]) + 1);
+			store[args[1]] = value;
+			invalidate(&args[1]);
+			return ":" + value + "\r\n";
+		} else if (name == "HSET" && args.size() == 4u) {
+			hashes[args[1]][args[2]] = args[3];
+			invalidate(&args[1]);
+			return ":1\r\n";
+		} else if (name == "HGET" && args.size() == 3u) {
+			auto it = hashes.find(args[1]);
+			if (it == hashes.end() || it->second.count(args[2]) == 0u) {
+				return "$-1\r\n";
+			}
+			return bulk(it->second[args[2]]);
+		} else if (name == "HGETALL" && args.size() == 2u) {
+			auto const & hash = hashes[args[1]];
+			auto reply = resp3 ? "%" + std::to_string(hash.size()) + "\r\n" : "*" + std::to_string(2u * hash.size()) + "\r\n";
+			for (auto const & field: hash) {
+				reply += bulk(field.first) + bulk(field.second);
+			}
+			return reply;
+		} else if (name == "FLUSHALL") {
+			store.clear();
+			hashes.clear();
+			invalidate(nullptr);
+			return "+OK\r\n";
+		}
+		auto reply = track(args);
+		return reply.empty() ? "-ERR unknown command '" + name + "'\r\n" : reply;
+	}
+
+	// handle a command with respect to transactions (the lock is held)
+	std::string handle(std::vector<std::string> const & args) {
+		if (args[0] == "QUIT") {
+			quit = true;
+			return "+OK\r\n";
+		}
+		if (args[0] == "MULTI") {
+			multi = true;
+			return "+OK\r\n";
+		}
+		if (args[0] == "EXEC") {
+			multi = false;
+			auto reply = "*" + std::to_string(queued.size()) + "\r\n";
+			for (auto const & cmd: queued) {
+				reply += execute(cmd);
+			}
+			queued.clear();
+			return reply;
+		}
+		if (multi) {
+			queued.push_back(args);
+			return "+QUEUED\r\n";
+		}
+		return execute(args);
+	}
+
+	// reply to a request, close the connection after QUIT
+	bool serve(std::vector<std::string> const & args) {
+		{
+			// reply before any invalidation caused by another client
+			std::lock_guard<std::mutex> lock{MockServerState::get().mutex};
+			send(fds[1], handle(args));
+		}
+		if (quit) {
+			::shutdown(fds[1], SHUT_WR);
+			return false;
+		}
+		return true;
+	}
+
+	void write(char const * data, std::size_t num_bytes) {
+		++MockServerState::get().num_writes;
+		MockSocketPair::write(data, num_bytes);
+	}
+};
+
+// same as above, but watched by the event loop and written by vectored writes
+struct MockServerFdSocket: MockServerSocket {
+	MockServerFdSocket(std::string const & host, std::uint16_t port)
+		: MockServerSocket{host, port} {
+	}
+
+	int native_handle() {
+		return fds[0];
+	}
+
+	using MockServerSocket::write;
+
+	void write(redisxx::iovec const * segments, std::size_t num) {
+		write_segments(segments, num);
+	}
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <redisxx/error.hpp>
+#include <redisxx/parser.hpp>
+#include <redisxx/segments.hpp>
+
+// client side of a stand-in server, whose replies are passed through a socket pair, so reading
+// blocks like a real socket does
+// note: requests are parsed like a real server would, each one is passed to the derived socket's
+// `serve()`, which replies and returns false to ignore further requests
+template <typename Derived>
+struct MockSocketPair {
+	int fds[2];				// client side, server side
+	std::string input;		// unparsed requests
+
+	MockSocketPair(std::string const & host, std::uint16_t port)
+		: fds{-1, -1}
+		, input{} {
+		if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+			throw redisxx::ConnectionError{"Cannot create socket pair", host, port};
+		}
+	}
+
+	MockSocketPair(MockSocketPair const &) = delete;
+
+	~MockSocketPair() {
+		::close(fds[0]);
+		::close(fds[1]);
+	}
+
+	static std::string bulk(std::string const & value) {
+		return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+	}
+
+	static void send(int fd, std::string const & data) {
+		for (std::size_t sent = 0u; sent < data.size(); ) {
+			auto n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0) {
+				throw redisxx::ConnectionError{"Mock server cannot reply", "mock", 0u};
+			}
+			sent += static_cast<std::size_t>(n);
+		}
+	}
+
+	void write(char const * data, std::size_t num_bytes) {
+		input.append(data, num_bytes);
+		std::size_t offset = 0u;
+		while (offset < input.size()) {
+			redisxx::priv::ReplyParser parser;
+			auto consumed = parser.feed(input.data() + offset, input.size() - offset);
+			if (!parser.done()) {
+				break;
+			}
+			auto request = redisxx::priv::parse_reply(input.substr(offset, consumed));
+			std::vector<std::string> args;
+			for (auto const & arg: request) {
+				args.emplace_back(arg.getString());
+			}
+			offset += consumed;
+			if (!static_cast<Derived&>(*this).serve(args)) {
+				break;
+			}
+		}
+		input.erase(0u, offset);
+	}
+
+	// join the segments, so they are handled like a single write
+	void write_segments(redisxx::iovec const * segments, std::size_t num) {
+		std::string request;
+		for (auto i = 0u; i < num; ++i) {
+			request.append(static_cast<char const *>(segments[i].iov_base), segments[i].iov_len);
+		}
+		static_cast<Derived&>(*this).write(request.data(), request.size());
+	}
+
+	void read_block(char* data, std::size_t num_bytes) {
+		while (num_bytes > 0u) {
+			auto received = read_some(data, num_bytes);
+			data += received;
+			num_bytes -= received;
+		}
+	}
+
+	std::size_t read_some(char* data, std::size_t num_bytes) {
+		auto received = ::read(fds[0], data, num_bytes);
+		if (received <= 0) {
+			throw redisxx::ConnectionError{"Mock server closed the connection", "mock", 0u};
+		}
+		return static_cast<std::size_t>(received);
+	}
+};
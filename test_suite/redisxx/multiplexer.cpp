@@ -0,0 +1,332 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+
+#include <redisxx/connection.hpp>
+
+#include "mock_server.hpp"
+
+// sockets read by a dedicated thread and by the event loop
+using MockSockets = boost::mpl::list<MockServerSocket, MockServerFdSocket>;
+
+// socket whose server refuses each connection
+struct RefusedSocket {
+	RefusedSocket(std::string const & host, std::uint16_t port) {
+		throw redisxx::ConnectionError{"Connection refused", host, port};
+	}
+
+	void write(char const * data, std::size_t num_bytes) {
+	}
+
+	void read_block(char* data, std::size_t num_bytes) {
+	}
+
+	std::size_t read_some(char* data, std::size_t num_bytes) {
+		return 0u;
+	}
+};
+
+// ----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_multiplexer)
+
+BOOST_AUTO_TEST_CASE(multiplexer_detects_native_handle) {
+	BOOST_CHECK(!redisxx::priv::has_native_handle<MockServerSocket>::value);
+	BOOST_CHECK(redisxx::priv::has_native_handle<MockServerFdSocket>::value);
+	BOOST_CHECK(!redisxx::priv::has_vectored_write<MockServerSocket>::value);
+	BOOST_CHECK(redisxx::priv::has_vectored_write<MockServerFdSocket>::value);
+#if defined(REDISXX_EPOLL)
+	BOOST_CHECK(redisxx::priv::uses_event_loop<MockServerFdSocket>::value);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_concurrent_requests, Socket, MockSockets) {
+	MockServerSocket::flush();
+	std::size_t const num_threads = 8u, num_requests = 200u;
+	redisxx::Connection<Socket> conn{"localhost", 6379};
+
+	std::vector<std::thread> threads;
+	std::vector<bool> ok(num_threads, true);
+	for (auto i = 0u; i < num_threads; ++i) {
+		threads.emplace_back([&, i]() {
+			std::vector<std::future<redisxx::Reply>> futures;
+			for (auto j = 0u; j < num_requests; ++j) {
+				futures.push_back(conn(redisxx::Command{"ECHO", std::to_string(i * num_requests + j)}));
+			}
+			for (auto j = 0u; j < num_requests; ++j) {
+				if (futures[j].get().getString() != std::to_string(i * num_requests + j)) {
+					ok[i] = false;
+				}
+			}
+		});
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+	for (auto i = 0u; i < num_threads; ++i) {
+		BOOST_CHECK(ok[i]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_mixed_requests, Socket, MockSockets) {
+	MockServerSocket::flush();
+	redisxx::Connection<Socket> conn{"localhost", 6379};
+
+	redisxx::CommandList pipeline{redisxx::BatchType::Pipeline};
+	pipeline << redisxx::Command{"SET", "foo", "bar"} << redisxx::Command{"GET", "foo"};
+	redisxx::CommandList transaction{redisxx::BatchType::Transaction};
+	transaction << redisxx::Command{"INCR", "counter"} << redisxx::Command{"INCR", "counter"};
+
+	auto first = conn(pipeline);
+	auto second = conn.lazy(pipeline);
+	auto third = conn(transaction);
+	auto fourth = conn(redisxx::Command{"PING"});
+
+	auto reply = first.get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK_EQUAL(reply[1].getString(), "bar");
+	auto lazy = second.get();
+	BOOST_REQUIRE_EQUAL(lazy.size(), 2u);
+	BOOST_CHECK_EQUAL(lazy[0].getString(), "OK");
+	BOOST_CHECK_EQUAL(lazy[1].getString(), "bar");
+	reply = third.get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK_EQUAL(reply[0].getInteger(), 1);
+	BOOST_CHECK_EQUAL(reply[1].getInteger(), 2);
+	BOOST_CHECK_EQUAL(fourth.get().getString(), "PONG");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_large_reply, Socket, MockSockets) {
+	MockServerSocket::flush();
+	redisxx::Connection<Socket> conn{"localhost", 6379};
+	std::string value(100000u, 'x');
+	auto set = conn(redisxx::Command{"SET", "large", value});
+	auto get = conn(redisxx::Command{"GET", "large"});
+	auto ping = conn(redisxx::Command{"PING"});
+	BOOST_CHECK_EQUAL(set.get().getString(), "OK");
+	BOOST_CHECK(get.get().getString() == value);
+	BOOST_CHECK_EQUAL(ping.get().getString(), "PONG");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_borrowed_payload, Socket, MockSockets) {
+	MockServerSocket::flush();
+	redisxx::Connection<Socket> conn{"localhost", 6379};
+	std::string value(100000u, 'y');
+	redisxx::CommandList list{redisxx::BatchType::Transaction};
+	list << redisxx::Command{"SET", "borrowed", redisxx::borrow(value)} << redisxx::Command{"GET", "borrowed"};
+	auto results = conn(list);
+	// the payload is written before the request returns
+	value.assign(value.size(), 'z');
+	auto reply = results.get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK_EQUAL(reply[0].getString(), "OK");
+	BOOST_CHECK(reply[1].getString() == std::string(value.size(), 'y'));
+}
+
+// number of clients that connected to the mock server so far
+std::int64_t num_clients() {
+	auto& state = MockServerState::get();
+	std::lock_guard<std::mutex> lock{state.mutex};
+	return state.next_id - 1;
+}
+
+BOOST_AUTO_TEST_CASE(multiplexer_spreads_threads_over_sockets) {
+	MockServerSocket::flush();
+	// replies are read by a thread per socket, so a blocked handler only blocks its own socket
+	redisxx::Connection<MockServerSocket> conn{"localhost", 6379, redisxx::PoolPolicy{2u}};
+	auto const num_before = num_clients();
+	std::promise<void> release;
+	auto released = release.get_future().share();
+	// keep a request in flight on the calling thread's socket
+	auto busy = [&conn, released]() {
+		std::promise<void> entered;
+		conn.async(redisxx::Command{"PING"}, [&entered, released](std::exception_ptr, redisxx::Reply) {
+			entered.set_value();
+			released.wait();
+		});
+		entered.get_future().wait();
+		return conn(redisxx::Command{"CLIENT", "ID"});
+	};
+	auto first = busy();
+	// another thread gets another socket, since the first one is busy
+	std::future<redisxx::Reply> second, third;
+	std::thread{[&]() {
+		second = busy();
+	}}.join();
+	// both sockets are busy, so the pool's size makes the next thread share one of them
+	std::thread{[&]() {
+		third = conn(redisxx::Command{"CLIENT", "ID"});
+	}}.join();
+	release.set_value();
+	auto const first_id = first.get().getInteger();
+	auto const second_id = second.get().getInteger();
+	auto const third_id = third.get().getInteger();
+	BOOST_CHECK_NE(first_id, second_id);
+	BOOST_CHECK(third_id == first_id || third_id == second_id);
+	BOOST_CHECK_EQUAL(num_clients() - num_before, 2);
+	// each thread keeps using its socket
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"CLIENT", "ID"}).get().getInteger(), first_id);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_closes_idle_socket, Socket, MockSockets) {
+	MockServerSocket::flush();
+	redisxx::Connection<Socket> conn{"localhost", 6379, redisxx::PoolPolicy{1u, std::chrono::milliseconds{50}}};
+	auto const first = conn(redisxx::Command{"CLIENT", "ID"}).get().getInteger();
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"CLIENT", "ID"}).get().getInteger(), first);
+	std::this_thread::sleep_for(std::chrono::milliseconds{200});
+	// the idle socket was replaced by a new one
+	auto const second = conn(redisxx::Command{"CLIENT", "ID"}).get().getInteger();
+	BOOST_CHECK_NE(second, first);
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"CLIENT", "ID"}).get().getInteger(), second);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_reconnects_after_failure, Socket, MockSockets) {
+	MockServerSocket::flush();
+	redisxx::Connection<Socket> conn{"localhost", 6379, redisxx::PoolPolicy{1u}};
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"QUIT"}).get().getString(), "OK");
+	// the server closed the connection, so the next request either fails or uses a new socket
+	try {
+		conn(redisxx::Command{"PING"}).get();
+	} catch (redisxx::ConnectionError const &) {
+	}
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"PING"}).get().getString(), "PONG");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_async_requests, Socket, MockSockets) {
+	MockServerSocket::flush();
+	std::size_t const num_requests = 200u;
+	redisxx::Connection<Socket> conn{"localhost", 6379};
+
+	// only touched by the I/O thread until all replies arrived
+	struct State {
+		std::vector<std::string> values;
+		std::thread::id caller;
+		bool on_caller;
+		std::promise<void> done;
+	} state{{}, std::this_thread::get_id(), false, {}};
+	for (auto i = 0u; i < num_requests; ++i) {
+		conn.async(redisxx::Command{"ECHO", std::to_string(i)}, [&state, num_requests](std::exception_ptr error, redisxx::Reply reply) {
+			state.values.push_back((error != nullptr) ? "error" : std::string{reply.getString()});
+			state.on_caller = state.on_caller || std::this_thread::get_id() == state.caller;
+			if (state.values.size() == num_requests) {
+				state.done.set_value();
+			}
+		});
+	}
+	state.done.get_future().get();
+	BOOST_CHECK(!state.on_caller);
+	for (auto i = 0u; i < num_requests; ++i) {
+		BOOST_CHECK_EQUAL(state.values[i], std::to_string(i));
+	}
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_async_handler_throws, Socket, MockSockets) {
+	MockServerSocket::flush();
+	std::size_t const num_requests = 50u;
+	redisxx::Connection<Socket> conn{"localhost", 6379, redisxx::PoolPolicy{1u}};
+	// only touched by the I/O thread until all handlers were called
+	std::size_t num_called = 0u;
+	std::promise<void> done;
+	for (auto i = 0u; i < num_requests; ++i) {
+		conn.async(redisxx::Command{"ECHO", std::to_string(i)}, [&, i](std::exception_ptr error, redisxx::Reply) {
+			if (error == nullptr && ++num_called == num_requests) {
+				done.set_value();
+			}
+			if (i % 2u == 0u) {
+				throw std::runtime_error{"handler failed"};
+			}
+		});
+	}
+	auto future = done.get_future();
+	BOOST_REQUIRE(future.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	// the channel is not broken by the handlers
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"PING"}).get().getString(), "PONG");
+}
+
+BOOST_AUTO_TEST_CASE(multiplexer_async_handler_throws_on_caller) {
+	redisxx::Connection<RefusedSocket> conn{"localhost", 6379};
+	// the handler gets the error before async() returns, its exception is ignored
+	bool called = false;
+	BOOST_CHECK_NO_THROW(conn.async(redisxx::Command{"PING"}, [&called](std::exception_ptr error, redisxx::Reply) {
+		called = (error != nullptr);
+		throw std::runtime_error{"handler failed"};
+	}));
+	BOOST_CHECK(called);
+	BOOST_CHECK_THROW(conn(redisxx::Command{"PING"}).get(), redisxx::ConnectionError);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_async_after_failure, Socket, MockSockets) {
+	MockServerSocket::flush();
+	redisxx::Connection<Socket> conn{"localhost", 6379, redisxx::PoolPolicy{1u}};
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"QUIT"}).get().getString(), "OK");
+	// the handler is called once, either with the error or with the reply
+	std::promise<std::string> result;
+	conn.async(redisxx::Command{"PING"}, [&result](std::exception_ptr error, redisxx::Reply reply) {
+		result.set_value((error != nullptr) ? "error" : std::string{reply.getString()});
+	});
+	auto value = result.get_future().get();
+	BOOST_CHECK(value == "error" || value == "PONG");
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"PING"}).get().getString(), "PONG");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_released_by_handler, Socket, MockSockets) {
+	MockServerSocket::flush();
+	auto conn = std::make_shared<redisxx::Connection<Socket>>("localhost", 6379);
+	std::promise<void> entered, submitted;
+	std::promise<std::string> second;
+	// the first handler releases the connection while the second request is in flight
+	conn->async(redisxx::Command{"ECHO", "first"}, [&](std::exception_ptr, redisxx::Reply) {
+		entered.set_value();
+		submitted.get_future().wait();
+		conn.reset();
+	});
+	entered.get_future().wait();
+	conn->async(redisxx::Command{"ECHO", "second"}, [&second](std::exception_ptr error, redisxx::Reply reply) {
+		second.set_value((error != nullptr) ? "error" : std::string{reply.getString()});
+	});
+	submitted.set_value();
+	auto future = second.get_future();
+	BOOST_REQUIRE(future.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	BOOST_CHECK_EQUAL(future.get(), "second");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(multiplexer_resp3_push_frames, Socket, MockSockets) {
+	MockServerSocket::flush();
+	std::mutex mutex;
+	std::vector<std::string> keys;
+	redisxx::PoolPolicy policy{1u, std::chrono::milliseconds{0}, redisxx::Protocol::Resp3};
+	policy.push_handler = [&](redisxx::Reply frame) {
+		std::lock_guard<std::mutex> lock{mutex};
+		keys.push_back(frame[1][0].as<std::string>());
+	};
+	redisxx::Connection<Socket> conn{"localhost", 6379, policy};
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"CLIENT", "TRACKING", "ON", "BCAST"}).get().getString(), "OK");
+
+	// invalidations of the client's own writes precede their replies
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"HSET", "user", "name", "max"}).get().getInteger(), 1);
+	redisxx::Reply hash = conn(redisxx::Command{"HGETALL", "user"}).get();
+	BOOST_REQUIRE(hash.isMap());
+	BOOST_CHECK((hash.as<std::map<std::string, std::string>>() == std::map<std::string, std::string>{{"name", "max"}}));
+	redisxx::CommandList transaction{redisxx::BatchType::Transaction};
+	transaction << redisxx::Command{"SET", "foo", "1"} << redisxx::Command{"GET", "foo"};
+	auto reply = conn(transaction).get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK_EQUAL(reply[1].getString(), "1");
+	BOOST_CHECK_EQUAL(conn.lazy(redisxx::Command{"INCR", "foo"}).get().getInteger(), 2);
+
+	// invalidations caused by another client arrive while no request is in flight
+	redisxx::Connection<Socket> other{"localhost", 6379};
+	other(redisxx::Command{"SET", "bar", "x"}).get();
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"PING"}).get().getString(), "PONG");
+	std::lock_guard<std::mutex> lock{mutex};
+	BOOST_CHECK((keys == std::vector<std::string>{"user", "foo", "foo", "bar"}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,255 @@
+#include <limits>
+#include <string>
+#include <random>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/parser.hpp>
+
+// feed the entire string at once and return the number of consumed bytes
+std::size_t parse_at_once(std::string const & reply) {
+	redisxx::priv::ReplyParser parser;
+	auto consumed = parser.feed(reply.data(), reply.size());
+	BOOST_CHECK(parser.done());
+	return consumed;
+}
+
+// feed the string byte by byte and return the number of consumed bytes
+std::size_t parse_bytewise(std::string const & reply) {
+	redisxx::priv::ReplyParser parser;
+	std::size_t consumed = 0u;
+	for (auto i = 0u; i < reply.size() && !parser.done(); ++i) {
+		consumed += parser.feed(reply.data() + i, 1u);
+	}
+	BOOST_CHECK(parser.done());
+	return consumed;
+}
+
+// feed the string in chunks of random size and return the recorded values
+std::vector<redisxx::priv::ReplyNode> record_chunked(std::string const & reply, std::size_t max_chunk, std::mt19937& random) {
+	std::vector<redisxx::priv::ReplyNode> nodes;
+	redisxx::priv::ReplyParser parser{&nodes};
+	std::size_t pos = 0u;
+	while (pos < reply.size() && !parser.done()) {
+		auto n = std::min<std::size_t>(1u + random() % max_chunk, reply.size() - pos);
+		pos += parser.feed(reply.data() + pos, n);
+	}
+	BOOST_CHECK(parser.done());
+	BOOST_CHECK_EQUAL(pos, reply.size());
+	return nodes;
+}
+
+// HGETALL-like reply mixing all kinds of values and header lengths
+std::string mixed_reply(std::size_t num, std::mt19937& random) {
+	std::string reply{"*" + std::to_string(num) + "\r\n"};
+	for (auto i = 0u; i < num; ++i) {
+		switch (random() % 8u) {
+			case 0u:
+				reply += ":" + std::to_string(static_cast<std::int64_t>(random()) - (1ll << 31)) + "\r\n";
+				break;
+			case 1u:
+				// longest numbers checked by the fast path and beyond
+				reply += (random() % 2u == 0u) ? ":-922337203685477580\r\n" : ":1000000000000000000\r\n";
+				break;
+			case 2u:
+				reply += "+OK\r\n";
+				break;
+			case 3u:
+				reply += "*2\r\n$-1\r\n$0\r\n\r\n";
+				break;
+			default: {
+				std::string value(random() % 40u, 'x');
+				reply += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+				break;
+			}
+		}
+	}
+	return reply;
+}
+
+// ----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_parser)
+
+BOOST_AUTO_TEST_CASE(parser_simple_values) {
+	for (std::string reply: {"+OK\r\n", "-ERR unknown\r\n", ":-1234\r\n",
+		"$5\r\nhello\r\n", "$0\r\n\r\n", "$-1\r\n", "*0\r\n", "*-1\r\n"}) {
+		BOOST_CHECK_EQUAL(parse_at_once(reply), reply.size());
+		BOOST_CHECK_EQUAL(parse_bytewise(reply), reply.size());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(parser_bulk_string_containing_crlf) {
+	std::string reply{"$12\r\n+OK\r\n*2\r\n:12\r\n:1\r\n"};
+	BOOST_CHECK_EQUAL(parse_at_once(reply), reply.size() - 4u);
+	BOOST_CHECK_EQUAL(parse_bytewise(reply), reply.size() - 4u);
+}
+
+BOOST_AUTO_TEST_CASE(parser_nested_arrays) {
+	std::string reply{"*3\r\n*2\r\n$3\r\nfoo\r\n*-1\r\n:7\r\n*1\r\n*1\r\n$-1\r\n"};
+	BOOST_CHECK_EQUAL(parse_at_once(reply), reply.size());
+	BOOST_CHECK_EQUAL(parse_bytewise(reply), reply.size());
+}
+
+BOOST_AUTO_TEST_CASE(parser_stops_after_reply) {
+	std::string first{"*2\r\n$3\r\nfoo\r\n:5\r\n"}, second{"+OK\r\n"};
+	auto stream = first + second + first;
+	redisxx::priv::ReplyParser parser;
+	auto consumed = parser.feed(stream.data(), stream.size());
+	BOOST_CHECK(parser.done());
+	BOOST_CHECK_EQUAL(consumed, first.size());
+	BOOST_CHECK_EQUAL(parser.feed(stream.data() + consumed, stream.size() - consumed), 0u);
+
+	parser.reset();
+	auto pos = consumed;
+	consumed = parser.feed(stream.data() + pos, stream.size() - pos);
+	BOOST_CHECK(parser.done());
+	BOOST_CHECK_EQUAL(consumed, second.size());
+
+	parser.reset();
+	pos += consumed;
+	consumed = parser.feed(stream.data() + pos, stream.size() - pos);
+	BOOST_CHECK(parser.done());
+	BOOST_CHECK_EQUAL(pos + consumed, stream.size());
+}
+
+BOOST_AUTO_TEST_CASE(parser_expected_bytes) {
+	std::string reply{"$1000\r\n"};
+	redisxx::priv::ReplyParser parser;
+	parser.feed(reply.data(), reply.size());
+	BOOST_CHECK(!parser.done());
+	BOOST_CHECK_EQUAL(parser.expected(), 1002u);
+	std::string payload(600u, 'x');
+	parser.feed(payload.data(), payload.size());
+	BOOST_CHECK_EQUAL(parser.expected(), 402u);
+}
+
+BOOST_AUTO_TEST_CASE(parser_protocol_errors) {
+	for (std::string reply: {"?\r\n", ":12a\r\n", ":\r\n", "$-2\r\n", "*-5\r\n",
+		"$3\r\nfoobar\r\n", "+OK\rX", ":99999999999999999999\r\n", "#x\r\n", "#tf\r\n", "_x\r\n",
+		"%-1\r\n", "!-1\r\n", "=3\r\ntxt\r\n", "|1\r\n"}) {
+		redisxx::priv::ReplyParser parser;
+		BOOST_CHECK_THROW(parser.feed(reply.data(), reply.size()), redisxx::ProtocolError);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(parser_64bit_bounds) {
+	for (auto expected: {std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min()}) {
+		std::string reply{":" + std::to_string(expected) + "\r\n"};
+		std::vector<redisxx::priv::ReplyNode> nodes;
+		redisxx::priv::ReplyParser parser{&nodes};
+		BOOST_CHECK_EQUAL(parser.feed(reply.data(), reply.size()), reply.size());
+		BOOST_REQUIRE_EQUAL(nodes.size(), 1u);
+		BOOST_CHECK(nodes[0].type == redisxx::ReplyType::Integer);
+		BOOST_CHECK_EQUAL(nodes[0].value, expected);
+		BOOST_CHECK_EQUAL(parse_bytewise(reply), reply.size());
+	}
+	// one past either bound
+	for (std::string reply: {":9223372036854775808\r\n", ":-9223372036854775809\r\n"}) {
+		redisxx::priv::ReplyParser parser;
+		BOOST_CHECK_THROW(parser.feed(reply.data(), reply.size()), redisxx::ProtocolError);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(parser_resp3_values) {
+	for (std::string reply: {",3.14\r\n", ",-inf\r\n", "(3492890328409238509324850943850943825024385\r\n",
+		"#t\r\n", "#f\r\n", "_\r\n", "!3\r\nERR\r\n", "=8\r\ntxt:Some\r\n", "%0\r\n", "~0\r\n",
+		"%2\r\n+a\r\n:1\r\n$1\r\nb\r\n~2\r\n#f\r\n_\r\n", "*2\r\n%1\r\n,1\r\n(2\r\n=4\r\ntxt:\r\n"}) {
+		BOOST_CHECK_EQUAL(parse_at_once(reply), reply.size());
+		BOOST_CHECK_EQUAL(parse_bytewise(reply), reply.size());
+	}
+	// maps are recorded as their keys and values in turn
+	std::vector<redisxx::priv::ReplyNode> nodes;
+	redisxx::priv::ReplyParser parser{&nodes};
+	std::string reply{"%2\r\n+a\r\n:1\r\n=5\r\nmkd:x\r\n!2\r\nNO\r\n"};
+	parser.feed(reply.data(), reply.size());
+	BOOST_REQUIRE_EQUAL(nodes.size(), 5u);
+	BOOST_CHECK(nodes[0].type == redisxx::ReplyType::Map);
+	BOOST_CHECK_EQUAL(nodes[0].value, 4);
+	BOOST_CHECK(nodes[3].type == redisxx::ReplyType::Verbatim);
+	BOOST_CHECK_EQUAL(reply.substr(nodes[3].offset, nodes[3].value), "x");
+	BOOST_CHECK(nodes[4].type == redisxx::ReplyType::Error);
+	BOOST_CHECK_EQUAL(reply.substr(nodes[4].offset, nodes[4].value), "NO");
+}
+
+BOOST_AUTO_TEST_CASE(parser_diverts_push_frames) {
+	std::vector<std::string> pushes;
+	redisxx::PushHandler handler = [&](redisxx::Reply frame) {
+		BOOST_REQUIRE(frame.isPush());
+		pushes.push_back(frame[1][0].as<std::string>());
+	};
+	std::string push{">2\r\n$10\r\ninvalidate\r\n*1\r\n$3\r\nfoo\r\n"};
+	auto stream = push + "*2\r\n:1\r\n" + push + ":2\r\n" + push;
+	// split the stream at each position
+	for (auto split = 0u; split <= stream.size(); ++split) {
+		pushes.clear();
+		std::vector<redisxx::priv::ReplyNode> nodes;
+		redisxx::priv::ReplyParser parser{&nodes, 0u, &handler};
+		auto consumed = parser.feed(stream.data(), split);
+		consumed += parser.feed(stream.data() + consumed, stream.size() - consumed);
+		BOOST_REQUIRE(parser.done());
+		BOOST_REQUIRE_EQUAL(consumed, stream.size() - push.size());
+		BOOST_REQUIRE_EQUAL(nodes.size(), 3u);
+		BOOST_CHECK(nodes[0].type == redisxx::ReplyType::Array);
+		BOOST_CHECK_EQUAL(nodes[1].value, 1);
+		BOOST_CHECK_EQUAL(nodes[2].value, 2);
+		BOOST_CHECK_EQUAL(pushes.size(), 2u);
+
+		// trailing frames are consumed while idle
+		parser.idle();
+		consumed += parser.feed(stream.data() + consumed, stream.size() - consumed);
+		BOOST_CHECK(parser.done());
+		BOOST_CHECK_EQUAL(consumed, stream.size());
+		BOOST_CHECK_EQUAL(pushes.size(), 3u);
+	}
+
+	// frames that were fed before are not passed again
+	pushes.clear();
+	redisxx::priv::ReplyParser parser{nullptr, 0u, &handler};
+	parser.replay(push.size() + 4u);
+	parser.feed(stream.data(), stream.size());
+	BOOST_CHECK_EQUAL(pushes.size(), 1u);
+
+	// anything else is left while idle
+	parser.idle();
+	BOOST_CHECK_EQUAL(parser.feed("+OK\r\n", 5u), 0u);
+	BOOST_CHECK(parser.done());
+}
+
+BOOST_AUTO_TEST_CASE(parser_kernels_agree) {
+	std::mt19937 random{42u};
+	auto reply = mixed_reply(5000u, random);
+	// values fed byte by byte are never parsed by the fast path
+	redisxx::priv::setScanKernel(redisxx::priv::ScanKernel::Scalar);
+	auto expected = record_chunked(reply, 1u, random);
+	for (auto kernel: {redisxx::priv::ScanKernel::Scalar, redisxx::priv::ScanKernel::Sse2, redisxx::priv::ScanKernel::Avx2}) {
+		redisxx::priv::setScanKernel(kernel);
+		for (auto max_chunk: {reply.size(), std::size_t{7u}, std::size_t{64u}}) {
+			auto nodes = record_chunked(reply, max_chunk, random);
+			BOOST_REQUIRE_EQUAL(nodes.size(), expected.size());
+			for (auto i = 0u; i < nodes.size(); ++i) {
+				BOOST_REQUIRE(nodes[i].type == expected[i].type);
+				BOOST_REQUIRE_EQUAL(nodes[i].offset, expected[i].offset);
+				BOOST_REQUIRE_EQUAL(nodes[i].value, expected[i].value);
+			}
+		}
+	}
+	redisxx::priv::setScanKernel(redisxx::priv::detect_scan_kernel());
+}
+
+BOOST_AUTO_TEST_CASE(parser_kernels_protocol_errors) {
+	// followed by enough data for a full SIMD window
+	std::string padding(64u, '+');
+	for (auto kernel: {redisxx::priv::ScanKernel::Scalar, redisxx::priv::ScanKernel::Sse2, redisxx::priv::ScanKernel::Avx2}) {
+		redisxx::priv::setScanKernel(kernel);
+		for (std::string reply: {"?\r\n", ":12a\r\n", ":\r\n", ":-\r\n", ":1-2\r\n", ":\xb1\r\n", "$-2\r\n", "*-5\r\n",
+			"$3\r\nfoobar\r\n", "$3\r\nfoo\rX", "+OK\rX", ":12\rX", ":99999999999999999999\r\n", "#x\r\n", "_x\r\n", "%-1\r\n"}) {
+			redisxx::priv::ReplyParser parser;
+			auto stream = reply + padding;
+			BOOST_CHECK_THROW(parser.feed(stream.data(), stream.size()), redisxx::ProtocolError);
+		}
+	}
+	redisxx::priv::setScanKernel(redisxx::priv::detect_scan_kernel());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,286 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <stdexcept>
+#include <cstdint>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/connection.hpp>
+
+#include "mock_server.hpp"
+
+using MockConnection = redisxx::Connection<MockServerSocket>;
+
+// parse replies to a transaction, which are grouped as an array
+std::shared_ptr<redisxx::priv::ReplyData> parse_transaction(std::string const & replies, std::size_t num_cmds) {
+	auto data = std::make_shared<redisxx::priv::ReplyData>();
+	data->buffer = "*" + std::to_string(num_cmds + 2u) + "\r\n" + replies;
+	redisxx::priv::ReplyParser parser{&data->nodes};
+	parser.feed(data->buffer.data(), data->buffer.size());
+	BOOST_REQUIRE(parser.done());
+	return data;
+}
+
+// ----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_pipeline)
+
+BOOST_AUTO_TEST_CASE(pipeline_layout) {
+	auto layout = redisxx::priv::layout_of(redisxx::Command{"PING"});
+	BOOST_CHECK(!layout.grouped);
+	BOOST_CHECK_EQUAL(layout.header(), "");
+
+	redisxx::CommandList list{redisxx::BatchType::Transaction};
+	list << redisxx::Command{"INCR", "foo"} << redisxx::Command{"GET", "foo"};
+	layout = redisxx::priv::layout_of(list);
+	BOOST_CHECK(layout.grouped);
+	BOOST_CHECK(layout.transaction);
+	BOOST_CHECK_EQUAL(layout.header(), "*4\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(transaction_results) {
+	auto reply = redisxx::priv::unpack_transaction(parse_transaction(
+		"+OK\r\n+QUEUED\r\n+QUEUED\r\n+QUEUED\r\n*3\r\n+OK\r\n:5\r\n*1\r\n$3\r\nfoo\r\n", 3u), 0u);
+	BOOST_REQUIRE(reply.isArray());
+	BOOST_REQUIRE_EQUAL(reply.size(), 3u);
+	BOOST_CHECK(reply[0].isStatus());
+	BOOST_CHECK_EQUAL(reply[1].getInteger(), 5);
+	BOOST_REQUIRE_EQUAL(reply[2].size(), 1u);
+	BOOST_CHECK_EQUAL(reply[2][0].getString(), "foo");
+}
+
+BOOST_AUTO_TEST_CASE(transaction_queueing_errors) {
+	auto reply = redisxx::priv::unpack_transaction(parse_transaction(
+		"+OK\r\n+QUEUED\r\n-ERR unknown command\r\n-EXECABORT Transaction discarded\r\n", 2u), 0u);
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK_EQUAL(reply[0].getString(), "EXECABORT Transaction discarded");
+	BOOST_CHECK_EQUAL(reply[1].getString(), "ERR unknown command");
+
+	// older servers execute the successfully queued commands
+	reply = redisxx::priv::unpack_transaction(parse_transaction(
+		"+OK\r\n-ERR unknown command\r\n+QUEUED\r\n*1\r\n:1\r\n", 2u), 0u);
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK(reply[0].isError());
+	BOOST_CHECK_EQUAL(reply[1].getInteger(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(transaction_aborted) {
+	auto reply = redisxx::priv::unpack_transaction(parse_transaction(
+		"+OK\r\n+QUEUED\r\n*-1\r\n", 1u), 0u);
+	BOOST_CHECK(reply.isNull());
+
+	reply = redisxx::priv::unpack_transaction(parse_transaction(
+		"-ERR MULTI calls can not be nested\r\n+QUEUED\r\n-ERR EXEC without MULTI\r\n", 1u), 0u);
+	BOOST_CHECK_EQUAL(reply.getString(), "ERR MULTI calls can not be nested");
+
+	reply = redisxx::priv::unpack_transaction(parse_transaction("+OK\r\n*0\r\n", 0u), 0u);
+	BOOST_CHECK(reply.isArray());
+	BOOST_CHECK(reply.empty());
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_disabled_by_default) {
+	MockServerSocket::flush();
+	MockConnection conn{"localhost", 6379};
+	auto reply = conn(redisxx::Command{"PING"}).get();
+	BOOST_CHECK_EQUAL(reply.getString(), "PONG");
+	BOOST_CHECK_EQUAL(MockServerSocket::getNumWrites(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_coalesces_concurrent_requests) {
+	MockServerSocket::flush();
+	std::size_t const num_threads = 8u, num_requests = 50u;
+	MockConnection conn{"localhost", 6379, redisxx::PoolPolicy{},
+		redisxx::PipelinePolicy{64u, std::chrono::microseconds{500}}};
+
+	std::vector<std::thread> threads;
+	std::vector<bool> ok(num_threads, true);
+	for (auto i = 0u; i < num_threads; ++i) {
+		threads.emplace_back([&, i]() {
+			std::vector<std::future<redisxx::Reply>> futures;
+			for (auto j = 0u; j < num_requests; ++j) {
+				auto value = std::to_string(i) + ":" + std::to_string(j);
+				futures.push_back(conn(redisxx::Command{"ECHO", value}));
+			}
+			for (auto j = 0u; j < num_requests; ++j) {
+				auto reply = futures[j].get();
+				if (reply.getString() != std::to_string(i) + ":" + std::to_string(j)) {
+					ok[i] = false;
+				}
+			}
+		});
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+	for (auto i = 0u; i < num_threads; ++i) {
+		BOOST_CHECK(ok[i]);
+	}
+	BOOST_CHECK_LT(MockServerSocket::getNumWrites(), num_threads * num_requests);
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_mixed_requests) {
+	MockServerSocket::flush();
+	MockConnection conn{"localhost", 6379, redisxx::PoolPolicy{},
+		redisxx::PipelinePolicy{16u, std::chrono::microseconds{1000}}};
+
+	redisxx::CommandList pipeline{redisxx::BatchType::Pipeline};
+	pipeline << redisxx::Command{"SET", "foo", "bar"} << redisxx::Command{"GET", "foo"};
+	redisxx::CommandList transaction{redisxx::BatchType::Transaction};
+	transaction << redisxx::Command{"INCR", "counter"} << redisxx::Command{"INCR", "counter"};
+
+	auto first = conn(redisxx::Command{"PING"});
+	auto second = conn(pipeline);
+	auto third = conn(transaction);
+	auto fourth = conn(redisxx::Command{"GET", "missing"});
+
+	BOOST_CHECK_EQUAL(first.get().getString(), "PONG");
+	auto reply = second.get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK_EQUAL(reply[0].getString(), "OK");
+	BOOST_CHECK_EQUAL(reply[1].getString(), "bar");
+	reply = third.get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 2u);
+	BOOST_CHECK_EQUAL(reply[0].getInteger(), 1);
+	BOOST_CHECK_EQUAL(reply[1].getInteger(), 2);
+	BOOST_CHECK(fourth.get().isNull());
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_resp3_push_frames) {
+	MockServerSocket::flush();
+	std::mutex mutex;
+	std::vector<std::string> keys;
+	redisxx::PoolPolicy policy{2u, std::chrono::milliseconds{0}, redisxx::Protocol::Resp3};
+	policy.push_handler = [&](redisxx::Reply frame) {
+		std::lock_guard<std::mutex> lock{mutex};
+		keys.push_back(frame[1][0].as<std::string>());
+	};
+	MockConnection conn{"localhost", 6379, policy, redisxx::PipelinePolicy{16u, std::chrono::microseconds{1000}}};
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"CLIENT", "TRACKING", "ON", "BCAST"}).get().getString(), "OK");
+
+	// invalidations are interleaved with the replies of a batch
+	auto first = conn(redisxx::Command{"SET", "foo", "1"});
+	auto second = conn(redisxx::Command{"GET", "foo"});
+	auto third = conn(redisxx::Command{"HSET", "user", "name", "max"});
+	auto fourth = conn(redisxx::Command{"HGETALL", "user"});
+	BOOST_CHECK_EQUAL(first.get().getString(), "OK");
+	BOOST_CHECK_EQUAL(second.get().getString(), "1");
+	BOOST_CHECK_EQUAL(third.get().getInteger(), 1);
+	BOOST_CHECK(fourth.get().isMap());
+
+	// invalidations caused by another client precede the next batch
+	MockConnection other{"localhost", 6379};
+	other(redisxx::Command{"SET", "bar", "x"}).get();
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"PING"}).get().getString(), "PONG");
+	std::lock_guard<std::mutex> lock{mutex};
+	BOOST_CHECK((keys == std::vector<std::string>{"foo", "user", "bar"}));
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_async_handler_throws) {
+	MockServerSocket::flush();
+	std::size_t const num_requests = 8u;
+	MockConnection conn{"localhost", 6379, redisxx::PoolPolicy{},
+		redisxx::PipelinePolicy{num_requests, std::chrono::microseconds{100000}}};
+	// all requests are sent as one batch, each handler throws
+	std::vector<std::future<redisxx::Reply>> futures;
+	for (auto i = 0u; i < num_requests; ++i) {
+		auto promise = std::make_shared<std::promise<redisxx::Reply>>();
+		futures.push_back(promise->get_future());
+		conn.async(redisxx::Command{"ECHO", std::to_string(i)}, [promise](std::exception_ptr error, redisxx::Reply reply) {
+			promise->set_value(std::move(reply));
+			throw std::runtime_error{"handler failed"};
+		});
+	}
+	for (auto i = 0u; i < num_requests; ++i) {
+		BOOST_REQUIRE(futures[i].wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+		BOOST_CHECK_EQUAL(futures[i].get().getString(), std::to_string(i));
+	}
+	// the worker thread keeps processing
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"PING"}).get().getString(), "PONG");
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_drains_queue_on_destruction) {
+	MockServerSocket::flush();
+	std::future<redisxx::Reply> future;
+	{
+		MockConnection conn{"localhost", 6379, redisxx::PoolPolicy{},
+			redisxx::PipelinePolicy{4u, std::chrono::microseconds{100000}}};
+		future = conn(redisxx::Command{"ECHO", "last words"});
+	}
+	BOOST_CHECK_EQUAL(future.get().getString(), "last words");
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_released_by_handler) {
+	MockServerSocket::flush();
+	auto conn = std::make_shared<MockConnection>("localhost", 6379, redisxx::PoolPolicy{},
+		redisxx::PipelinePolicy{8u, std::chrono::milliseconds{200}});
+	std::promise<std::string> released;
+	// the handler holds the last copy of the connection, which is destroyed by the pipeline's thread
+	conn->async(redisxx::Command{"ECHO", "last"}, [conn, &released](std::exception_ptr error, redisxx::Reply reply) {
+		released.set_value((error != nullptr) ? "error" : std::string{reply.getString()});
+	});
+	conn.reset();
+	auto future = released.get_future();
+	BOOST_REQUIRE(future.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	BOOST_CHECK_EQUAL(future.get(), "last");
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_unbounded_batch_size) {
+	MockServerSocket::flush();
+	// batches are only sent once the window elapsed
+	MockConnection conn{"localhost", 6379, redisxx::PoolPolicy{},
+		redisxx::PipelinePolicy{SIZE_MAX, std::chrono::microseconds{1000}}};
+	auto first = conn(redisxx::Command{"ECHO", "first"});
+	auto second = conn(redisxx::Command{"ECHO", "second"});
+	BOOST_CHECK_EQUAL(first.get().getString(), "first");
+	BOOST_CHECK_EQUAL(second.get().getString(), "second");
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_empty_command_list) {
+	MockServerSocket::flush();
+	redisxx::CommandList empty{redisxx::BatchType::Pipeline};
+	MockConnection conn{"localhost", 6379};
+	MockConnection pipelined{"localhost", 6379, redisxx::PoolPolicy{},
+		redisxx::PipelinePolicy{16u, std::chrono::microseconds{1000}}};
+	for (auto connection: {&conn, &pipelined}) {
+		auto future = (*connection)(empty);
+		BOOST_REQUIRE(future.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+		auto reply = future.get();
+		BOOST_CHECK(reply.isArray());
+		BOOST_CHECK_EQUAL(reply.size(), 0u);
+
+		bool called = false;
+		connection->async(empty, [&](std::exception_ptr error, redisxx::Reply reply) {
+			called = (error == nullptr && reply.isArray() && reply.size() == 0u);
+		});
+		BOOST_CHECK(called);
+	}
+	auto lazy = conn.lazy(empty);
+	BOOST_REQUIRE(lazy.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	BOOST_CHECK_EQUAL(lazy.get().size(), 0u);
+	BOOST_CHECK_EQUAL(MockServerSocket::getNumWrites(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(pipeline_reserves_a_socket) {
+	MockServerSocket::flush();
+	redisxx::PipelinePolicy pipelining{16u, std::chrono::microseconds{1000}};
+	// a single socket cannot be shared by the pipeline and lazy requests
+	BOOST_CHECK_THROW((MockConnection{"localhost", 6379, redisxx::PoolPolicy{1u}, pipelining}), std::invalid_argument);
+
+	MockConnection conn{"localhost", 6379, redisxx::PoolPolicy{2u}, pipelining};
+	// lazy request first, pipelined request second, and vice versa
+	auto lazy = conn.lazy(redisxx::Command{"ECHO", "lazy"});
+	BOOST_REQUIRE(lazy.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	BOOST_CHECK_EQUAL(lazy.get().getString(), "lazy");
+	auto pipelined = conn(redisxx::Command{"ECHO", "pipelined"});
+	BOOST_REQUIRE(pipelined.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	BOOST_CHECK_EQUAL(pipelined.get().getString(), "pipelined");
+	lazy = conn.lazy(redisxx::Command{"ECHO", "lazy again"});
+	BOOST_REQUIRE(lazy.wait_for(std::chrono::seconds{5}) == std::future_status::ready);
+	BOOST_CHECK_EQUAL(lazy.get().getString(), "lazy again");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,145 @@
+#include <string>
+#include <thread>
+#include <chrono>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/error.hpp>
+#include <redisxx/pool.hpp>
+
+struct PoolMockSocket {
+	static std::size_t num_created;
+	static bool refuse;
+
+	PoolMockSocket(std::string const & host, std::uint16_t port) {
+		if (refuse) {
+			throw redisxx::ConnectionError{"refused", host, port};
+		}
+		++num_created;
+	}
+
+	void write(char const * data, std::size_t num_bytes) {
+	}
+
+	void read_block(char* data, std::size_t num_bytes) {
+	}
+
+	std::size_t read_some(char* data, std::size_t num_bytes) {
+		return 0u;
+	}
+};
+
+std::size_t PoolMockSocket::num_created = 0u;
+bool PoolMockSocket::refuse = false;
+
+using MockPool = redisxx::priv::SocketPool<PoolMockSocket>;
+
+// ----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_pool)
+
+BOOST_AUTO_TEST_CASE(pool_reuses_recycled_socket) {
+	PoolMockSocket::num_created = 0u;
+	MockPool pool{"localhost", 6379, redisxx::PoolPolicy{2u}};
+	BOOST_CHECK_EQUAL(pool.size(), 0u);
+	PoolMockSocket* first = nullptr;
+	{
+		auto socket = pool.acquire();
+		first = &*socket;
+		socket.recycle();
+	}
+	{
+		auto socket = pool.acquire();
+		BOOST_CHECK_EQUAL(&*socket, first);
+		socket.recycle();
+	}
+	BOOST_CHECK_EQUAL(PoolMockSocket::num_created, 1u);
+	BOOST_CHECK_EQUAL(pool.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(pool_closes_broken_socket) {
+	PoolMockSocket::num_created = 0u;
+	MockPool pool{"localhost", 6379, redisxx::PoolPolicy{2u}};
+	{
+		// not recycled, e.g. because the request threw
+		auto socket = pool.acquire();
+	}
+	BOOST_CHECK_EQUAL(pool.size(), 0u);
+	{
+		auto socket = pool.acquire();
+		socket.recycle();
+	}
+	BOOST_CHECK_EQUAL(PoolMockSocket::num_created, 2u);
+	BOOST_CHECK_EQUAL(pool.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(pool_opens_sockets_up_to_size) {
+	PoolMockSocket::num_created = 0u;
+	MockPool pool{"localhost", 6379, redisxx::PoolPolicy{2u}};
+	auto first = pool.acquire();
+	auto second = pool.acquire();
+	BOOST_CHECK_EQUAL(pool.size(), 2u);
+	BOOST_CHECK(&*first != &*second);
+
+	// third lease blocks until another one is returned
+	PoolMockSocket* leased = nullptr;
+	std::thread waiter{[&]() {
+		auto third = pool.acquire();
+		leased = &*third;
+		third.recycle();
+	}};
+	std::this_thread::sleep_for(std::chrono::milliseconds{10});
+	BOOST_CHECK(leased == nullptr);
+	PoolMockSocket* returned = &*second;
+	second.recycle();
+	{
+		auto tmp = std::move(second);
+	}
+	waiter.join();
+	BOOST_CHECK_EQUAL(leased, returned);
+	BOOST_CHECK_EQUAL(PoolMockSocket::num_created, 2u);
+	first.recycle();
+}
+
+BOOST_AUTO_TEST_CASE(pool_try_acquire_does_not_wait) {
+	PoolMockSocket::num_created = 0u;
+	MockPool pool{"localhost", 6379, redisxx::PoolPolicy{1u}};
+	auto first = pool.tryAcquire();
+	BOOST_REQUIRE(first != nullptr);
+	BOOST_CHECK(pool.tryAcquire() == nullptr);
+	PoolMockSocket* returned = &**first;
+	first->recycle();
+	first.reset();
+	auto second = pool.tryAcquire();
+	BOOST_REQUIRE(second != nullptr);
+	BOOST_CHECK_EQUAL(&**second, returned);
+	BOOST_CHECK_EQUAL(PoolMockSocket::num_created, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(pool_closes_idle_socket) {
+	PoolMockSocket::num_created = 0u;
+	MockPool pool{"localhost", 6379, redisxx::PoolPolicy{2u, std::chrono::milliseconds{1}}};
+	{
+		auto socket = pool.acquire();
+		socket.recycle();
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds{5});
+	{
+		auto socket = pool.acquire();
+		socket.recycle();
+	}
+	BOOST_CHECK_EQUAL(PoolMockSocket::num_created, 2u);
+	BOOST_CHECK_EQUAL(pool.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(pool_frees_slot_if_connect_fails) {
+	PoolMockSocket::num_created = 0u;
+	PoolMockSocket::refuse = true;
+	MockPool pool{"localhost", 6379, redisxx::PoolPolicy{1u}};
+	BOOST_CHECK_THROW(pool.acquire(), redisxx::ConnectionError);
+	PoolMockSocket::refuse = false;
+	BOOST_CHECK_EQUAL(pool.size(), 0u);
+	auto socket = pool.acquire();
+	BOOST_CHECK_EQUAL(pool.size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,203 @@
+#include <string>
+#include <cstring>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <redisxx/connection.hpp>
+#include <redisxx/socket/posix.hpp>
+
+#include "loopback.hpp"
+
+int get_option(int fd, int level, int name) {
+	int value = 0;
+	socklen_t size = sizeof(value);
+	::getsockopt(fd, level, name, &value, &size);
+	return value;
+}
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_posix_socket)
+
+BOOST_AUTO_TEST_CASE(posix_tcp_applies_options) {
+	Listener listener;
+	redisxx::SocketOptions options;
+	options.receive_buffer_size = 65536;
+	redisxx::PosixTcpSocket socket{"127.0.0.1", listener.port, options};
+	auto peer = listener.accept();
+	auto fd = socket.native_handle();
+	BOOST_CHECK_NE(get_option(fd, IPPROTO_TCP, TCP_NODELAY), 0);
+	BOOST_CHECK_NE(get_option(fd, SOL_SOCKET, SO_KEEPALIVE), 0);
+	// the kernel may double the requested size
+	BOOST_CHECK_GE(get_option(fd, SOL_SOCKET, SO_RCVBUF), 65536);
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(posix_tcp_writes_and_reads) {
+	Listener listener;
+	redisxx::PosixTcpSocket socket{"localhost", listener.port};
+	auto peer = listener.accept();
+	socket.write("*1\r\n", 4u);
+	char const payload[] = "$4\r\nPING\r\n";
+	redisxx::iovec segments[] = {
+		{const_cast<char*>("*1\r\n"), 4u},
+		{const_cast<char*>(payload), std::strlen(payload)}
+	};
+	socket.write(segments, 2u);
+	BOOST_CHECK_EQUAL(receive(peer, 4u + 4u + 10u), "*1\r\n*1\r\n$4\r\nPING\r\n");
+	BOOST_CHECK_EQUAL(segments[1].iov_len, 10u);
+
+	::send(peer, "+PONG\r\n", 7u, 0);
+	char buffer[7];
+	socket.read_block(buffer, 7u);
+	BOOST_CHECK_EQUAL(std::string(buffer, 7u), "+PONG\r\n");
+
+	::close(peer);
+	BOOST_CHECK_THROW(socket.read_some(buffer, 7u), redisxx::ConnectionError);
+}
+
+BOOST_AUTO_TEST_CASE(posix_tcp_writes_large_segments) {
+	Listener listener;
+	redisxx::SocketOptions options;
+	options.send_buffer_size = 4096;
+	redisxx::PosixTcpSocket socket{"127.0.0.1", listener.port, options};
+	auto peer = listener.accept();
+	// larger than the send buffer, so sendmsg() writes partially
+	std::string huge(1u << 20, 'x');
+	huge.back() = 'y';
+	std::string received;
+	std::thread reader{[&]() {
+		received = receive(peer, 4u + huge.size());
+	}};
+	redisxx::iovec segments[] = {
+		{const_cast<char*>("head"), 4u},
+		{&huge[0], huge.size()}
+	};
+	socket.write(segments, 2u);
+	reader.join();
+	BOOST_CHECK(received == "head" + huge);
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(posix_tcp_non_blocking_read) {
+	Listener listener;
+	redisxx::SocketOptions options;
+	options.non_blocking = true;
+	redisxx::PosixTcpSocket socket{"127.0.0.1", listener.port, options};
+	auto peer = listener.accept();
+	char buffer[16];
+	BOOST_CHECK_EQUAL(socket.read_some(buffer, 16u), 0u);
+	::send(peer, ":1\r\n", 4u, 0);
+	socket.read_block(buffer, 4u);
+	BOOST_CHECK_EQUAL(std::string(buffer, 4u), ":1\r\n");
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(posix_tcp_io_timeout) {
+	Listener listener;
+	redisxx::SocketOptions options;
+	options.non_blocking = true;
+	options.io_timeout = std::chrono::milliseconds{10};
+	redisxx::PosixTcpSocket socket{"127.0.0.1", listener.port, options};
+	auto peer = listener.accept();
+	char buffer[4];
+	BOOST_CHECK_THROW(socket.read_block(buffer, 4u), redisxx::ConnectionError);
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(posix_tcp_io_timeout_in_blocking_mode) {
+	Listener listener;
+	redisxx::SocketOptions options;
+	options.io_timeout = std::chrono::milliseconds{10};
+	BOOST_REQUIRE(!options.non_blocking);
+	redisxx::PosixTcpSocket socket{"127.0.0.1", listener.port, options};
+	auto peer = listener.accept();
+	char buffer[4];
+	BOOST_CHECK_THROW(socket.read_some(buffer, 4u), redisxx::ConnectionError);
+	BOOST_CHECK_THROW(socket.read_block(buffer, 4u), redisxx::ConnectionError);
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(posix_tcp_default_options_obey_io_timeout) {
+	Listener listener;
+	auto& defaults = redisxx::PosixTcpSocket::defaults();
+	auto previous = defaults;
+	defaults.io_timeout = std::chrono::milliseconds{10};
+	redisxx::PosixTcpSocket socket{"127.0.0.1", listener.port};
+	defaults = previous;
+	auto peer = listener.accept();
+	char buffer[4];
+	BOOST_CHECK_THROW(socket.read_block(buffer, 4u), redisxx::ConnectionError);
+	::close(peer);
+}
+
+BOOST_AUTO_TEST_CASE(posix_tcp_connection_refused) {
+	std::uint16_t port;
+	{
+		// the port is unused once the listener is closed
+		Listener listener;
+		port = listener.port;
+	}
+	BOOST_CHECK_THROW(redisxx::PosixTcpSocket("127.0.0.1", port), redisxx::ConnectionError);
+	BOOST_CHECK_THROW(redisxx::PosixTcpSocket("host.invalid", 6379), redisxx::ConnectionError);
+}
+
+BOOST_AUTO_TEST_CASE(posix_unix_writes_and_reads) {
+	std::string filename = "/tmp/redisxx_test_" + std::to_string(::getpid()) + ".sock";
+	::unlink(filename.c_str());
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	std::strcpy(address.sun_path, filename.c_str());
+	BOOST_REQUIRE_EQUAL(::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+	BOOST_REQUIRE_EQUAL(::listen(fd, 1), 0);
+	{
+		redisxx::PosixUnixSocket socket{filename};
+		auto peer = ::accept(fd, nullptr, nullptr);
+		socket.write("hello", 5u);
+		BOOST_CHECK_EQUAL(receive(peer, 5u), "hello");
+		::close(peer);
+	}
+	::close(fd);
+	::unlink(filename.c_str());
+	BOOST_CHECK_THROW(redisxx::PosixUnixSocket{filename}, redisxx::ConnectionError);
+}
+
+BOOST_AUTO_TEST_CASE(posix_socket_constructors) {
+	BOOST_CHECK(redisxx::priv::is_tcp_socket<redisxx::PosixTcpSocket>::value);
+	BOOST_CHECK(!redisxx::priv::is_stream_socket<redisxx::PosixTcpSocket>::value);
+	BOOST_CHECK(redisxx::priv::is_stream_socket<redisxx::PosixUnixSocket>::value);
+	BOOST_CHECK(!redisxx::priv::is_tcp_socket<redisxx::PosixUnixSocket>::value);
+	try {
+		// this MIGHT throw, but we're testing compilation here
+		redisxx::Connection<redisxx::PosixUnixSocket> conn{"/tmp/redis.sock"};
+	} catch (redisxx::ConnectionError const &) {
+	}
+}
+
+BOOST_AUTO_TEST_CASE(posix_tcp_connection_roundtrip) {
+	Listener listener;
+	std::thread server{[&]() {
+		auto peer = listener.accept();
+		auto request = receive(peer, 14u);
+		BOOST_CHECK_EQUAL(request, "*1\r\n$4\r\nPING\r\n");
+		::send(peer, "+PONG\r\n", 7u, 0);
+		char buffer[1];
+		// wait until the client disconnects
+		::recv(peer, buffer, 1u, 0);
+		::close(peer);
+	}};
+	{
+		redisxx::Connection<redisxx::PosixTcpSocket> conn{"127.0.0.1", listener.port, {1u}};
+		auto reply = conn(redisxx::Command{"PING"}).get();
+		BOOST_CHECK_EQUAL(reply.getString(), "PONG");
+	}
+	server.join();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
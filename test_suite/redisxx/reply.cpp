@@ -0,0 +1,233 @@
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/parser.hpp>
+#include <redisxx/reply.hpp>
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_reply)
+
+BOOST_AUTO_TEST_CASE(reply_scalar_types) {
+	auto status = redisxx::priv::parse_reply("+OK\r\n");
+	BOOST_CHECK(status.getType() == redisxx::ReplyType::Status);
+	BOOST_CHECK_EQUAL(status.getString(), "OK");
+	BOOST_CHECK_THROW(status.getInteger(), redisxx::TypeError);
+
+	auto error = redisxx::priv::parse_reply("-ERR wrong type\r\n");
+	BOOST_CHECK(error.isError());
+	BOOST_CHECK_EQUAL(error.getString(), "ERR wrong type");
+
+	auto integer = redisxx::priv::parse_reply(":-42\r\n");
+	BOOST_CHECK(integer.isInteger());
+	BOOST_CHECK_EQUAL(integer.getInteger(), -42);
+	BOOST_CHECK_THROW(integer.getString(), redisxx::TypeError);
+
+	auto bulk = redisxx::priv::parse_reply("$7\r\nfoo\r\nba\r\n");
+	BOOST_CHECK(bulk.isBulk());
+	BOOST_CHECK_EQUAL(bulk.getString(), "foo\r\nba");
+	BOOST_CHECK_EQUAL(bulk.size(), 0u);
+
+	auto null = redisxx::priv::parse_reply("$-1\r\n");
+	BOOST_CHECK(null.isNull());
+	BOOST_CHECK(redisxx::Reply{}.isNull());
+}
+
+BOOST_AUTO_TEST_CASE(reply_array_access) {
+	auto reply = redisxx::priv::parse_reply("*4\r\n$4\r\nname\r\n*2\r\n:1\r\n:2\r\n$3\r\nmax\r\n*0\r\n");
+	BOOST_REQUIRE(reply.isArray());
+	BOOST_REQUIRE_EQUAL(reply.size(), 4u);
+	BOOST_CHECK_EQUAL(reply[0].getString(), "name");
+	BOOST_REQUIRE_EQUAL(reply[1].size(), 2u);
+	BOOST_CHECK_EQUAL(reply[1][0].getInteger(), 1);
+	BOOST_CHECK_EQUAL(reply[1][1].getInteger(), 2);
+	BOOST_CHECK_EQUAL(reply.at(2).getString(), "max");
+	BOOST_CHECK(reply[3].isArray());
+	BOOST_CHECK(reply[3].empty());
+	BOOST_CHECK_THROW(reply.at(4), std::out_of_range);
+	BOOST_CHECK_THROW(reply[0].at(0), redisxx::TypeError);
+
+	std::vector<redisxx::ReplyType> types;
+	for (auto const & elem: reply) {
+		types.push_back(elem.getType());
+	}
+	BOOST_REQUIRE_EQUAL(types.size(), 4u);
+	BOOST_CHECK(types[1] == redisxx::ReplyType::Array);
+	BOOST_CHECK_EQUAL(reply.end() - reply.begin(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(reply_shares_receive_buffer) {
+	std::string text{"*2\r\n$3\r\nfoo\r\n$3\r\nbar\r\n"};
+	redisxx::StringView view;
+	redisxx::Reply element;
+	{
+		auto reply = redisxx::priv::parse_reply(text);
+		element = reply[1];
+		view = reply[0].getString();
+	}
+	// buffer is kept alive by the element
+	BOOST_CHECK_EQUAL(element.getString(), "bar");
+	BOOST_CHECK_EQUAL(view.data() + 9, element.getString().data());
+}
+
+BOOST_AUTO_TEST_CASE(reply_iterator_outlives_element) {
+	auto reply = redisxx::priv::parse_reply("*2\r\n$4\r\nname\r\n*3\r\n:1\r\n:2\r\n:3\r\n");
+	// the iterators are taken from a temporary element
+	auto begin = reply[1].begin();
+	auto end = reply.at(1).end();
+	BOOST_REQUIRE_EQUAL(end - begin, 3);
+	auto found = std::find_if(begin, end, [](redisxx::Reply const & elem) {
+		return elem.getInteger() == 2;
+	});
+	BOOST_REQUIRE(found != end);
+	BOOST_CHECK_EQUAL((*found).getInteger(), 2);
+	BOOST_CHECK_EQUAL(begin[2].getInteger(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(reply_large_array) {
+	std::string text{"*10000\r\n"};
+	for (auto i = 0u; i < 10000u; ++i) {
+		auto value = std::to_string(i);
+		text += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+	}
+	auto reply = redisxx::priv::parse_reply(text);
+	BOOST_REQUIRE_EQUAL(reply.size(), 10000u);
+	BOOST_CHECK_EQUAL(reply[9999].getString(), "9999");
+}
+
+BOOST_AUTO_TEST_CASE(reply_parse_incomplete) {
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply("*2\r\n:1\r\n"), redisxx::ProtocolError);
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply(":1\r\n:2\r\n"), redisxx::ProtocolError);
+}
+
+BOOST_AUTO_TEST_CASE(reply_as_scalars) {
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply(":-42\r\n").as<std::int64_t>(), -42);
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply("$3\r\n123\r\n").as<int>(), 123);
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply("$4\r\n2.25\r\n").as<double>(), 2.25);
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply(":7\r\n").as<double>(), 7.0);
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply(":7\r\n").as<std::string>(), "7");
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply("+OK\r\n").as<std::string>(), "OK");
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply("$3\r\nfoo\r\n").as<redisxx::StringView>(), "foo");
+	BOOST_CHECK(redisxx::priv::parse_reply(":1\r\n").as<bool>());
+
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply("$3\r\nfoo\r\n").as<int>(), redisxx::TypeError);
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply(":300\r\n").as<std::uint8_t>(), redisxx::TypeError);
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply(":-1\r\n").as<unsigned>(), redisxx::TypeError);
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply("$-1\r\n").as<std::string>(), redisxx::TypeError);
+	BOOST_CHECK_THROW(redisxx::Reply{}.as<int>(), redisxx::TypeError);
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply("*1\r\n:1\r\n").as<int>(), redisxx::TypeError);
+}
+
+BOOST_AUTO_TEST_CASE(reply_as_containers) {
+	auto numbers = redisxx::priv::parse_reply("*3\r\n:1\r\n$2\r\n-2\r\n:3\r\n").as<std::vector<std::int64_t>>();
+	BOOST_CHECK_EQUAL(numbers.capacity(), 3u);
+	BOOST_CHECK((numbers == std::vector<std::int64_t>{1, -2, 3}));
+
+	auto scores = redisxx::priv::parse_reply("*3\r\n$3\r\n1.5\r\n$3\r\ninf\r\n$3\r\n1.5\r\n").as<std::set<double>>();
+	BOOST_CHECK((scores == std::set<double>{1.5, std::numeric_limits<double>::infinity()}));
+
+	auto names = redisxx::priv::parse_reply("*2\r\n$3\r\nfoo\r\n$3\r\nbar\r\n").as<std::list<std::string>>();
+	BOOST_CHECK((names == std::list<std::string>{"foo", "bar"}));
+
+	auto hash = redisxx::priv::parse_reply("*4\r\n$4\r\nname\r\n$3\r\nmax\r\n$3\r\nage\r\n$2\r\n42\r\n")
+		.as<std::unordered_map<std::string, std::string>>();
+	BOOST_REQUIRE_EQUAL(hash.size(), 2u);
+	BOOST_CHECK_EQUAL(hash["name"], "max");
+	BOOST_CHECK_EQUAL(hash["age"], "42");
+
+	auto ages = redisxx::priv::parse_reply("*4\r\n$3\r\nmax\r\n$2\r\n42\r\n$3\r\nbob\r\n:7\r\n").as<std::map<std::string, int>>();
+	BOOST_CHECK((ages == std::map<std::string, int>{{"bob", 7}, {"max", 42}}));
+
+	auto nested = redisxx::priv::parse_reply("*2\r\n*2\r\n:1\r\n:2\r\n*0\r\n").as<std::vector<std::vector<int>>>();
+	BOOST_REQUIRE_EQUAL(nested.size(), 2u);
+	BOOST_CHECK((nested[0] == std::vector<int>{1, 2}));
+	BOOST_CHECK(nested[1].empty());
+
+	// null arrays (e.g. after a timeout) are empty
+	BOOST_CHECK(redisxx::priv::parse_reply("*-1\r\n").as<std::vector<int>>().empty());
+	BOOST_CHECK_THROW((redisxx::priv::parse_reply("*3\r\n:1\r\n:2\r\n:3\r\n").as<std::map<int, int>>()), redisxx::TypeError);
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply("*1\r\n$1\r\nx\r\n").as<std::vector<int>>(), redisxx::TypeError);
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply(":1\r\n").as<std::vector<int>>(), redisxx::TypeError);
+}
+
+BOOST_AUTO_TEST_CASE(reply_resp3_types) {
+	auto number = redisxx::priv::parse_reply(",-2.5\r\n");
+	BOOST_CHECK(number.isDouble());
+	BOOST_CHECK_EQUAL(number.getDouble(), -2.5);
+	BOOST_CHECK_EQUAL(number.getString(), "-2.5");
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply(",inf\r\n").getDouble(), std::numeric_limits<double>::infinity());
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply("$3\r\n1.5\r\n").getDouble(), 1.5);
+	BOOST_CHECK_EQUAL(redisxx::priv::parse_reply(":3\r\n").getDouble(), 3.0);
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply("+OK\r\n").getDouble(), redisxx::TypeError);
+
+	auto boolean = redisxx::priv::parse_reply("#t\r\n");
+	BOOST_CHECK(boolean.isBoolean());
+	BOOST_CHECK(boolean.getBoolean());
+	BOOST_CHECK(boolean.as<bool>());
+	BOOST_CHECK(!redisxx::priv::parse_reply("#f\r\n").getBoolean());
+	BOOST_CHECK(redisxx::priv::parse_reply(":1\r\n").getBoolean());
+	BOOST_CHECK_THROW(redisxx::priv::parse_reply(":2\r\n").getBoolean(), redisxx::TypeError);
+
+	BOOST_CHECK(redisxx::priv::parse_reply("_\r\n").isNull());
+	auto big = redisxx::priv::parse_reply("(3492890328409238509324850943850943825024385\r\n");
+	BOOST_CHECK(big.isBigNumber());
+	BOOST_CHECK_EQUAL(big.getString(), "3492890328409238509324850943850943825024385");
+	auto verbatim = redisxx::priv::parse_reply("=15\r\ntxt:Some string\r\n");
+	BOOST_CHECK(verbatim.isVerbatim());
+	BOOST_CHECK_EQUAL(verbatim.as<std::string>(), "Some string");
+	auto error = redisxx::priv::parse_reply("!21\r\nSYNTAX invalid syntax\r\n");
+	BOOST_CHECK(error.isError());
+	BOOST_CHECK_EQUAL(error.getString(), "SYNTAX invalid syntax");
+}
+
+BOOST_AUTO_TEST_CASE(reply_resp3_aggregates) {
+	auto map = redisxx::priv::parse_reply("%2\r\n$4\r\nname\r\n$3\r\nmax\r\n+age\r\n:42\r\n");
+	BOOST_REQUIRE(map.isMap());
+	BOOST_CHECK(map.isAggregate());
+	BOOST_REQUIRE_EQUAL(map.size(), 4u);
+	BOOST_CHECK_EQUAL(map[0].getString(), "name");
+	BOOST_CHECK_EQUAL(map[3].getInteger(), 42);
+	auto hash = map.as<std::map<std::string, std::string>>();
+	BOOST_CHECK((hash == std::map<std::string, std::string>{{"age", "42"}, {"name", "max"}}));
+
+	auto set = redisxx::priv::parse_reply("~3\r\n,1.5\r\n:2\r\n,1.5\r\n");
+	BOOST_REQUIRE(set.isSet());
+	BOOST_CHECK_EQUAL(set.size(), 3u);
+	BOOST_CHECK((set.as<std::set<double>>() == std::set<double>{1.5, 2.0}));
+
+	auto nested = redisxx::priv::parse_reply("*2\r\n~1\r\n#t\r\n%1\r\n_\r\n*0\r\n");
+	BOOST_REQUIRE_EQUAL(nested.size(), 2u);
+	BOOST_CHECK(nested[0][0].getBoolean());
+	BOOST_CHECK(nested[1][0].isNull());
+	BOOST_CHECK(nested[1][1].isArray());
+	BOOST_CHECK(redisxx::priv::parse_reply("%0\r\n").empty());
+}
+
+BOOST_AUTO_TEST_CASE(reply_join) {
+	std::vector<redisxx::Reply> elements;
+	elements.push_back(redisxx::priv::parse_reply("+OK\r\n"));
+	elements.push_back(redisxx::priv::parse_reply("*3\r\n$3\r\nfoo\r\n:42\r\n*1\r\n$-1\r\n")[0]);
+	elements.push_back(redisxx::priv::parse_reply("*2\r\n:1\r\n*2\r\n$3\r\nbar\r\n-ERR no\r\n"));
+	elements.push_back(redisxx::Reply{});
+	auto joined = redisxx::priv::join_replies(elements);
+	BOOST_REQUIRE(joined.isArray());
+	BOOST_REQUIRE_EQUAL(joined.size(), 4u);
+	BOOST_CHECK(joined[0].isStatus());
+	BOOST_CHECK_EQUAL(joined[0].getString(), "OK");
+	BOOST_CHECK_EQUAL(joined[1].getString(), "foo");
+	BOOST_REQUIRE_EQUAL(joined[2].size(), 2u);
+	BOOST_CHECK_EQUAL(joined[2][0].getInteger(), 1);
+	BOOST_CHECK_EQUAL(joined[2][1][0].getString(), "bar");
+	BOOST_CHECK(joined[2][1][1].isError());
+	BOOST_CHECK_EQUAL(joined[2][1][1].getString(), "ERR no");
+	BOOST_CHECK(joined[3].isNull());
+	BOOST_CHECK(redisxx::priv::join_replies({}).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,128 @@
+#include <string>
+#include <future>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/sharding.hpp>
+
+#include "mock_cluster.hpp"
+
+using MockShardedConnection = redisxx::ShardedConnection<MockClusterSocket>;
+
+// shards of the stand-in cluster, whose nodes are independent
+inline std::vector<redisxx::Shard> mock_shards(std::size_t num) {
+	MockClusterState::reset(num, false);
+	std::vector<redisxx::Shard> shards;
+	for (auto i = 0u; i < num; ++i) {
+		shards.emplace_back("127.0.0.1", MockClusterState::port(i));
+	}
+	return shards;
+}
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_sharding)
+
+BOOST_AUTO_TEST_CASE(hash_ring_spreads_keys) {
+	redisxx::priv::HashRing ring{{"a:6379", "b:6379", "c:6379", "d:6379"}};
+	std::vector<std::size_t> num_keys(4u, 0u);
+	for (auto i = 0u; i < 10000u; ++i) {
+		++num_keys[ring.locate(redisxx::StringView{"key:" + std::to_string(i)})];
+	}
+	for (auto num: num_keys) {
+		BOOST_CHECK(num > 1500u);
+		BOOST_CHECK(num < 3500u);
+	}
+	// keys sharing a hash tag belong to the same shard
+	BOOST_CHECK_EQUAL(ring.locate(redisxx::StringView{"{user:42}.name"}), ring.locate(redisxx::StringView{"user:42"}));
+}
+
+BOOST_AUTO_TEST_CASE(hash_ring_is_consistent) {
+	std::vector<std::string> const all{"a:6379", "b:6379", "c:6379", "d:6379"};
+	std::vector<std::string> const remaining{"d:6379", "a:6379", "b:6379"};
+	redisxx::priv::HashRing before{all}, after{remaining};
+	std::size_t num_moved = 0u;
+	for (auto i = 0u; i < 10000u; ++i) {
+		auto const key = "key:" + std::to_string(i);
+		auto const & old_shard = all[before.locate(redisxx::StringView{key})];
+		auto const & new_shard = remaining[after.locate(redisxx::StringView{key})];
+		if (old_shard != "c:6379") {
+			// only the keys of the removed shard move
+			BOOST_CHECK_EQUAL(old_shard, new_shard);
+		} else {
+			++num_moved;
+		}
+	}
+	BOOST_CHECK(num_moved > 1500u);
+	BOOST_CHECK(num_moved < 3500u);
+}
+
+BOOST_AUTO_TEST_CASE(sharded_connection_routes_commands) {
+	MockShardedConnection conn{mock_shards(3u)};
+	BOOST_CHECK_EQUAL(conn.getNumShards(), 3u);
+	std::vector<std::future<redisxx::Reply>> replies;
+	for (auto i = 0u; i < 30u; ++i) {
+		replies.push_back(conn(redisxx::Command{"SET", "key:" + std::to_string(i), i}));
+	}
+	for (auto& reply: replies) {
+		BOOST_CHECK_EQUAL(reply.get().getString(), "OK");
+	}
+	for (auto i = 0u; i < 30u; ++i) {
+		auto const key = "key:" + std::to_string(i);
+		BOOST_CHECK_EQUAL(MockClusterState::value(conn.getShardOf(redisxx::StringView{key}), key), std::to_string(i));
+		BOOST_CHECK_EQUAL(conn(redisxx::Command{"GET", key}).get().getString(), std::to_string(i));
+	}
+	for (auto num: MockClusterState::get().num_writes) {
+		BOOST_CHECK(num > 0u);
+	}
+	BOOST_CHECK_EQUAL(conn(redisxx::Command{"PING"}).get().getString(), "PONG");
+	BOOST_CHECK_EQUAL(conn.getShard(0u)(redisxx::Command{"PING"}).get().getString(), "PONG");
+	BOOST_CHECK_THROW(MockShardedConnection{std::vector<redisxx::Shard>{}}, std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(sharded_connection_fans_out_pipelines) {
+	MockShardedConnection conn{mock_shards(3u)};
+	redisxx::CommandList list{redisxx::BatchType::Pipeline};
+	for (auto i = 0u; i < 30u; ++i) {
+		list << redisxx::Command{"INCR", "counter:" + std::to_string(i % 15u)};
+	}
+	auto reply = conn(list).get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 30u);
+	for (auto i = 0u; i < 30u; ++i) {
+		BOOST_CHECK_EQUAL(reply[i].getInteger(), (i < 15u) ? 1 : 2);
+	}
+	// one pipeline per shard
+	for (auto num: MockClusterState::get().num_writes) {
+		BOOST_CHECK_EQUAL(num, 1u);
+	}
+
+	// keys sharing a hash tag are sent as a single pipeline
+	redisxx::CommandList tagged{redisxx::BatchType::Pipeline};
+	tagged << redisxx::Command{"SET", "{t}a", 1} << redisxx::Command{"INCR", "{t}a"} << redisxx::Command{"GET", "{t}a"};
+	reply = conn(tagged).get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 3u);
+	BOOST_CHECK_EQUAL(reply[2].getString(), "2");
+	BOOST_CHECK(conn(redisxx::CommandList{redisxx::BatchType::Pipeline}).get().empty());
+}
+
+BOOST_AUTO_TEST_CASE(sharded_connection_transactions) {
+	MockShardedConnection conn{mock_shards(3u)};
+	redisxx::CommandList list{redisxx::BatchType::Transaction};
+	list << redisxx::Command{"INCR", "{t}a"} << redisxx::Command{"INCR", "{t}b"} << redisxx::Command{"INCR", "{t}a"};
+	auto reply = conn(list).get();
+	BOOST_REQUIRE_EQUAL(reply.size(), 3u);
+	BOOST_CHECK_EQUAL(reply[2].getInteger(), 2);
+	BOOST_CHECK_EQUAL(MockClusterState::value(conn.getShardOf(redisxx::StringView{"t"}), "{t}b"), "1");
+}
+
+BOOST_AUTO_TEST_CASE(sharded_connection_fails_pipeline) {
+	// the last shard cannot be reached
+	auto shards = mock_shards(2u);
+	shards.emplace_back("127.0.0.1", 6379u);
+	MockShardedConnection conn{shards};
+	redisxx::CommandList list{redisxx::BatchType::Pipeline};
+	for (auto i = 0u; i < 30u; ++i) {
+		list << redisxx::Command{"GET", "key:" + std::to_string(i)};
+	}
+	BOOST_CHECK_THROW(conn(list).get(), redisxx::ConnectionError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,77 @@
+#include <string>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/simd.hpp>
+
+// scan the header line of the given string using the given scanner
+template <typename Scanner>
+int scan_header(std::string const & line) {
+	// pad, so SIMD scanners load full windows
+	auto padded = line + std::string(64u, 'x');
+	return Scanner::header(padded.data(), padded.data() + padded.size());
+}
+
+// scan a header line at the end of the data
+template <typename Scanner>
+int scan_tail(std::string const & line) {
+	return Scanner::header(line.data(), line.data() + line.size());
+}
+
+#if defined(REDISXX_SIMD_X86)
+// run the AVX2 scanner from a function compiled for AVX2
+REDISXX_TARGET_AVX2
+int scan_avx2(std::string const & line) {
+	return scan_header<redisxx::priv::Avx2Scanner>(line);
+}
+#endif
+
+// ----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_simd)
+
+BOOST_AUTO_TEST_CASE(simd_scalar_header) {
+	using Scanner = redisxx::priv::ScalarScanner;
+	BOOST_CHECK_EQUAL(scan_header<Scanner>("5\r\n"), 1);
+	BOOST_CHECK_EQUAL(scan_header<Scanner>("-1\r\n"), 2);
+	BOOST_CHECK_EQUAL(scan_header<Scanner>("-9223372036854775808\r\n"), 20);
+	BOOST_CHECK_EQUAL(scan_header<Scanner>("123456789012345678901\r\n"), -1);
+	BOOST_CHECK_EQUAL(scan_header<Scanner>("\r\n"), -1);
+	BOOST_CHECK_EQUAL(scan_header<Scanner>("-\r\n"), -1);
+	BOOST_CHECK_EQUAL(scan_header<Scanner>("1a\r\n"), -1);
+	BOOST_CHECK_EQUAL(scan_tail<Scanner>("12"), -1);
+	BOOST_CHECK_EQUAL(scan_tail<Scanner>("12\r"), 2);
+}
+
+#if defined(REDISXX_SIMD_X86)
+BOOST_AUTO_TEST_CASE(simd_kernels_match_scalar) {
+	for (std::string line: {"5\r\n", "-1\r\n", "1234567890123\r\n", "12345678901234\r\n",
+		"123456789012345\r\n", "-9223372036854775808\r\n", "\r\n", "-\r\n", "--1\r\n", "1-\r\n",
+		"1a\r\n", "\xb1\r\n", "12 \r\n", "1234567890123456789012345678901234\r\n", "+OK\r\n"}) {
+		auto expected = scan_header<redisxx::priv::ScalarScanner>(line);
+		// lines above 15 bytes exceed the SSE2 window
+		auto sse2 = scan_header<redisxx::priv::Sse2Scanner>(line);
+		BOOST_CHECK(sse2 == expected || (sse2 == -1 && line.size() > 16u));
+		if (redisxx::priv::supports_scan_kernel(redisxx::priv::ScanKernel::Avx2)) {
+			BOOST_CHECK_EQUAL(scan_avx2(line), expected);
+		}
+		// less than a window at the end of the data is scanned byte by byte
+		auto tail = scan_tail<redisxx::priv::Sse2Scanner>(line);
+		BOOST_CHECK(tail == scan_tail<redisxx::priv::ScalarScanner>(line) || (tail == -1 && line.size() > 16u));
+	}
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(simd_kernel_selection) {
+	auto fallback = redisxx::priv::detect_scan_kernel();
+	BOOST_CHECK(redisxx::priv::getScanKernel() == fallback);
+	BOOST_CHECK(redisxx::priv::supports_scan_kernel(fallback));
+	redisxx::priv::setScanKernel(redisxx::priv::ScanKernel::Scalar);
+	BOOST_CHECK(redisxx::priv::getScanKernel() == redisxx::priv::ScanKernel::Scalar);
+	// unsupported kernels are replaced by the default one
+	redisxx::priv::setScanKernel(redisxx::priv::ScanKernel::Avx2);
+	auto avx2 = redisxx::priv::supports_scan_kernel(redisxx::priv::ScanKernel::Avx2);
+	BOOST_CHECK(redisxx::priv::getScanKernel() == (avx2 ? redisxx::priv::ScanKernel::Avx2 : fallback));
+	redisxx::priv::setScanKernel(fallback);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <boost/test/unit_test.hpp>
+
+#include <redisxx/small_buffer.hpp>
+
+using Buffer = redisxx::priv::SmallBuffer<std::allocator<char>, 16u>;
+
+// assign the given content
+void assign(Buffer& buffer, std::string const & value) {
+	buffer.resize(value.size());
+	std::memcpy(buffer.data(), value.data(), value.size());
+}
+
+BOOST_AUTO_TEST_SUITE(redisxx_test_small_buffer)
+
+BOOST_AUTO_TEST_CASE(small_buffer_grows_beyond_inline_storage) {
+	Buffer buffer;
+	assign(buffer, "short");
+	BOOST_CHECK_EQUAL(buffer.capacity(), 16u);
+	auto inline_data = buffer.data();
+	buffer.resize(100u);
+	BOOST_CHECK_GE(buffer.capacity(), 100u);
+	BOOST_CHECK(buffer.data() != inline_data);
+	// content is kept
+	BOOST_CHECK_EQUAL(std::string(buffer.data(), 5u), "short");
+	buffer.clear();
+	BOOST_CHECK_EQUAL(buffer.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(small_buffer_copy_and_move) {
+	Buffer small, large;
+	assign(small, "abc");
+	assign(large, std::string(40u, 'x'));
+
+	Buffer copy{large};
+	BOOST_CHECK(copy == large);
+	BOOST_CHECK(copy.data() != large.data());
+
+	auto data = large.data();
+	Buffer moved{std::move(large)};
+	BOOST_CHECK(moved.data() == data);
+	BOOST_CHECK_EQUAL(large.size(), 0u);
+
+	Buffer moved_small{std::move(small)};
+	BOOST_CHECK_EQUAL(std::string(moved_small.data(), moved_small.size()), "abc");
+
+	copy = moved_small;
+	BOOST_CHECK(copy == moved_small);
+	moved_small = std::move(moved);
+	BOOST_CHECK(moved_small.data() == data);
+	BOOST_CHECK(moved_small != copy);
+}
+
+BOOST_AUTO_TEST_CASE(small_buffer_moves_without_allocating) {
+	BOOST_CHECK(std::is_nothrow_move_constructible<Buffer>::value);
+	BOOST_CHECK(std::is_nothrow_move_assignable<Buffer>::value);
+
+	// inline content is copied into the allocated memory of the target
+	Buffer small, large;
+	assign(small, "abc");
+	assign(large, std::string(40u, 'x'));
+	auto data = large.data();
+	large = std::move(small);
+	BOOST_CHECK(large.data() == data);
+	BOOST_CHECK_EQUAL(std::string(large.data(), large.size()), "abc");
+	BOOST_CHECK_EQUAL(small.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
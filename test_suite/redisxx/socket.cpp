@@ -1,5 +1,7 @@
 #include <string>
 #include <cstring>
+#include <algorithm>
+#include <vector>
 #include <boost/test/unit_test.hpp>
 
 #include <redisxx/socket.hpp>
@@ -7,10 +9,12 @@
 struct MockSocket {
 	std::string buffer;
 	std::size_t pos;
+	std::size_t max_chunk;	// max. number of bytes returned per read
 	
-	MockSocket()
+	MockSocket(std::size_t max_chunk=std::string::npos)
 		: buffer{}
-		, pos{0u} {
+		, pos{0u}
+		, max_chunk{max_chunk} {
 	}
 	
 	void write(char const * data, std::size_t num_bytes) {
@@ -27,7 +31,10 @@ struct MockSocket {
 			buffer = "$14\r\nThis is a test\r\n";
 			
 		} else if (tmp == "array") {
-			buffer = "*5\r\n$10\r\nhello world\r\n:15634\r\n+OK\r\n-No\r\n";
+			buffer = "*4\r\n$11\r\nhello world\r\n:15634\r\n+OK\r\n-No\r\n";
+			
+		} else if (tmp == "nested") {
+			buffer = "*3\r\n*2\r\n$-1\r\n*0\r\n*-1\r\n*1\r\n$0\r\n\r\n";
 			
 		} else if (tmp == "huge") {
 			buffer = "$1500\r\n";
@@ -36,27 +43,36 @@ struct MockSocket {
 			}
 			buffer += "\r\n";
 			
+		} else if (tmp == "megabyte") {
+			buffer = "$1048576\r\n" + std::string(1048576u, 'x') + "\r\n";
+			
+		} else if (tmp == "pipeline") {
+			buffer = "+OK\r\n:5\r\n*2\r\n$-1\r\n:1\r\n-ERR wrong type\r\n";
+			
+		} else if (tmp == "too much") {
+			buffer = "+OK\r\n+OK\r\n";
+			
 		} else {
 			buffer = "-Unknown Command\r\n";
 		}
 	}
 
 	void read_block(char* data, std::size_t num_bytes) {
-		if (pos + num_bytes >= buffer.size()) {
+		if (pos + num_bytes > buffer.size()) {
 			throw "This should not happen with the mock!";
 		}
-		std::strncpy(data, buffer.data() + pos, num_bytes);
+		std::memcpy(data, buffer.data() + pos, num_bytes);
 		pos += num_bytes;
 	}
 
 	std::size_t read_some(char* data, std::size_t num_bytes) {
 		// determine number of received bytes
-		std::size_t received = num_bytes;
-		if (pos + num_bytes >= buffer.size()) {
+		std::size_t received = std::min(num_bytes, max_chunk);
+		if (pos + received >= buffer.size()) {
 			received = buffer.size() - pos;
 		}
 		// copy string
-		std::strncpy(data, buffer.data() + pos, received);
+		std::memcpy(data, buffer.data() + pos, received);
 		pos += received;
 		return received;
 	}
@@ -69,38 +85,127 @@ BOOST_AUTO_TEST_SUITE(redisxx_test_socket)
 BOOST_AUTO_TEST_CASE(process_test_status_string) {
 	MockSocket socket;
 	auto out = redisxx::priv::_execute_request(socket, "status");
-	BOOST_CHECK_EQUAL(out, socket.buffer);
+	BOOST_REQUIRE(out.isStatus());
+	BOOST_CHECK_EQUAL(out.getString(), "OK");
 }
 
 BOOST_AUTO_TEST_CASE(process_test_number_string) {
 	MockSocket socket;
 	auto out = redisxx::priv::_execute_request(socket, "number");
-	BOOST_CHECK_EQUAL(out, socket.buffer);
+	BOOST_REQUIRE(out.isInteger());
+	BOOST_CHECK_EQUAL(out.getInteger(), 124);
 }
 
 BOOST_AUTO_TEST_CASE(process_test_bulk_string) {
 	MockSocket socket;
 	auto out = redisxx::priv::_execute_request(socket, "bulk");
-	BOOST_CHECK_EQUAL(out, socket.buffer);
+	BOOST_REQUIRE(out.isBulk());
+	BOOST_CHECK_EQUAL(out.getString(), "This is a test");
 }
 
 BOOST_AUTO_TEST_CASE(process_test_array_string) {
 	MockSocket socket;
 	auto out = redisxx::priv::_execute_request(socket, "array");
-	BOOST_CHECK_EQUAL(out, socket.buffer);
+	BOOST_REQUIRE(out.isArray());
+	BOOST_REQUIRE_EQUAL(out.size(), 4u);
+	BOOST_CHECK_EQUAL(out[0].getString(), "hello world");
+	BOOST_CHECK_EQUAL(out[1].getInteger(), 15634);
+	BOOST_CHECK(out[2].isStatus());
+	BOOST_CHECK(out[3].isError());
+	BOOST_CHECK_EQUAL(out[3].getString(), "No");
 }
 
 BOOST_AUTO_TEST_CASE(process_test_huge_bulk_string) {
 	MockSocket socket;
 	auto out = redisxx::priv::_execute_request(socket, "huge");
-	BOOST_CHECK_EQUAL(out, socket.buffer);
+	BOOST_REQUIRE(out.isBulk());
+	BOOST_CHECK_EQUAL(out.getString().size(), 1500u);
+}
+
+BOOST_AUTO_TEST_CASE(process_test_nested_array_string) {
+	MockSocket socket;
+	auto out = redisxx::priv::_execute_request(socket, "nested");
+	BOOST_REQUIRE_EQUAL(out.size(), 3u);
+	BOOST_REQUIRE_EQUAL(out[0].size(), 2u);
+	BOOST_CHECK(out[0][0].isNull());
+	BOOST_CHECK(out[0][1].isArray());
+	BOOST_CHECK(out[0][1].empty());
+	BOOST_CHECK(out[1].isNull());
+	BOOST_REQUIRE_EQUAL(out[2].size(), 1u);
+	BOOST_CHECK(out[2][0].isBulk());
+	BOOST_CHECK(out[2][0].getString().empty());
+}
+
+BOOST_AUTO_TEST_CASE(process_test_megabyte_bulk_string) {
+	MockSocket socket;
+	auto out = redisxx::priv::_execute_request(socket, "megabyte");
+	BOOST_REQUIRE(out.isBulk());
+	BOOST_CHECK(out.getString() == std::string(1048576u, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE(process_test_slow_reply) {
+	// each read returns only a few bytes
+	MockSocket socket{3u};
+	auto out = redisxx::priv::_execute_request(socket, "huge");
+	BOOST_CHECK_EQUAL(out.getString().size(), 1500u);
+	
+	MockSocket socket2{1u};
+	out = redisxx::priv::_execute_request(socket2, "array");
+	BOOST_REQUIRE_EQUAL(out.size(), 4u);
+	BOOST_CHECK_EQUAL(out[3].getString(), "No");
+}
+
+BOOST_AUTO_TEST_CASE(process_test_pipelined_replies) {
+	// replies to a batch are grouped as an array
+	MockSocket socket{5u};
+	auto out = redisxx::priv::_execute_request(socket, "pipeline", "*4\r\n");
+	BOOST_REQUIRE(out.isArray());
+	BOOST_REQUIRE_EQUAL(out.size(), 4u);
+	BOOST_CHECK(out[0].isStatus());
+	BOOST_CHECK_EQUAL(out[1].getInteger(), 5);
+	BOOST_REQUIRE_EQUAL(out[2].size(), 2u);
+	BOOST_CHECK(out[2][0].isNull());
+	BOOST_CHECK_EQUAL(out[3].getString(), "ERR wrong type");
+	
+	MockSocket socket2;
+	BOOST_CHECK_THROW(redisxx::priv::_execute_request(socket2, "pipeline", "*5\r\n"), char const *);
+	
+	MockSocket socket3;
+	out = redisxx::priv::_execute_request(socket3, "", "*0\r\n");
+	BOOST_CHECK(out.isArray());
+	BOOST_CHECK(out.empty());
+}
+
+BOOST_AUTO_TEST_CASE(process_test_surplus_reply) {
+	MockSocket socket;
+	BOOST_CHECK_THROW(redisxx::priv::_execute_request(socket, "too much"), redisxx::ProtocolError);
+}
+
+BOOST_AUTO_TEST_CASE(write_segments_without_vectored_write) {
+	struct RecordingSocket {
+		std::vector<std::string> writes;
+
+		void write(char const * data, std::size_t num_bytes) {
+			writes.emplace_back(data, num_bytes);
+		}
+	} socket;
+	std::string small{"*2\r\n"}, large(redisxx::priv::direct_write_size, 'x'), tail{"\r\n"};
+	std::vector<redisxx::iovec> segments{
+		{&small[0], small.size()}, {&small[0], small.size()}, {&large[0], large.size()}, {&tail[0], tail.size()}
+	};
+	redisxx::priv::_write_segments(socket, segments.data(), segments.size());
+	// small segments are merged, large ones are written directly
+	BOOST_REQUIRE_EQUAL(socket.writes.size(), 3u);
+	BOOST_CHECK_EQUAL(socket.writes[0], small + small);
+	BOOST_CHECK(socket.writes[1] == large);
+	BOOST_CHECK_EQUAL(socket.writes[2], tail);
 }
 
 BOOST_AUTO_TEST_CASE(process_test_error_string) {
 	MockSocket socket;
 	auto out = redisxx::priv::_execute_request(socket, "foo bar");
-	BOOST_CHECK_EQUAL(out, socket.buffer);
+	BOOST_REQUIRE(out.isError());
+	BOOST_CHECK_EQUAL(out.getString(), "Unknown Command");
 }
 
 BOOST_AUTO_TEST_SUITE_END()
-